@@ -0,0 +1,151 @@
+// Measures what code/data logging adds per emulated instruction
+//
+// This runs the same work the execution and read hooks do while logging (finding the bank/offset of an address and
+// marking the opcode, its operands, and data reads) over a synthetic instruction stream, and compares it to running the
+// stream without logging. SameBoy isn't involved, so the result is the cost of the hooks themselves; how much that is
+// relative to the emulator depends on how fast the emulator is on the machine, which can be passed in.
+//
+// Build and run:
+//   c++ -std=c++20 -O2 -I../src code_data_logger_overhead.cpp ../src/code_data_logger.cpp -o code_data_logger_overhead
+//   ./code_data_logger_overhead [emulator ns per instruction]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "code_data_logger.hpp"
+#include "sm83.hpp"
+
+// Same as GameInstance::MappedBanks/code_data_location() in game_instance.cpp
+struct Banks {
+    std::uint16_t rom0 = 0, romx = 1, vram = 0, sram = 0, wram = 1;
+};
+
+static inline bool code_data_location(std::uint16_t address, const Banks &banks, CodeDataLogger::Region &region, std::size_t &offset) noexcept {
+    if(address < 0x4000) {
+        region = CodeDataLogger::RegionROM;
+        offset = banks.rom0 * 0x4000 + address;
+    }
+    else if(address < 0x8000) {
+        region = CodeDataLogger::RegionROM;
+        offset = banks.romx * 0x4000 + (address - 0x4000);
+    }
+    else if(address < 0xA000) {
+        region = CodeDataLogger::RegionVRAM;
+        offset = banks.vram * 0x2000 + (address - 0x8000);
+    }
+    else if(address < 0xC000) {
+        region = CodeDataLogger::RegionCartRAM;
+        offset = banks.sram * 0x2000 + (address - 0xA000);
+    }
+    else if(address < 0xD000) {
+        region = CodeDataLogger::RegionWRAM;
+        offset = address - 0xC000;
+    }
+    else if(address < 0xE000) {
+        region = CodeDataLogger::RegionWRAM;
+        offset = banks.wram * 0x1000 + (address - 0xD000);
+    }
+    else if(address >= 0xFF80 && address < 0xFFFF) {
+        region = CodeDataLogger::RegionHRAM;
+        offset = address - 0xFF80;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+static volatile std::uint64_t sink;
+
+struct Step {
+    std::uint16_t pc;
+    std::uint8_t opcode;
+    std::uint16_t data_address; // 0 if the instruction doesn't read memory
+};
+
+int main(int argc, const char **argv) {
+    // Code mostly runs from ROM with some loops in WRAM/HRAM, and about a third of instructions read memory
+    static constexpr const std::size_t STEP_COUNT = 1 << 20;
+    std::mt19937 random(1234);
+    std::vector<std::uint8_t> rom(0x200000);
+    for(auto &b : rom) {
+        b = static_cast<std::uint8_t>(random());
+    }
+
+    std::vector<Step> steps(STEP_COUNT);
+    std::uint16_t pc = 0x150;
+    for(auto &step : steps) {
+        if(random() % 64 == 0) {
+            auto where = random() % 16;
+            pc = static_cast<std::uint16_t>(where < 12 ? random() % 0x8000 : where < 15 ? 0xC000 + random() % 0x2000 : 0xFF80 + random() % 0x7F);
+        }
+        step.pc = pc;
+        step.opcode = rom[pc % rom.size()];
+        step.data_address = random() % 3 == 0 ? static_cast<std::uint16_t>(random()) : 0;
+        pc = static_cast<std::uint16_t>(pc + SM83::instruction_length(step.opcode));
+    }
+
+    CodeDataLogger logger;
+    logger.resize(CodeDataLogger::RegionROM, rom.size());
+    logger.resize(CodeDataLogger::RegionVRAM, 0x4000);
+    logger.resize(CodeDataLogger::RegionCartRAM, 0x20000);
+    logger.resize(CodeDataLogger::RegionWRAM, 0x8000);
+    logger.resize(CodeDataLogger::RegionHRAM, 0x7F);
+    Banks banks;
+
+    auto log = [&logger, &banks](std::uint16_t address, CodeDataLogger::Access access) {
+        CodeDataLogger::Region region;
+        std::size_t offset;
+        if(code_data_location(address, banks, region, offset)) {
+            logger.mark(region, offset, access);
+        }
+    };
+
+    // Walk the stream either way; the difference is what logging costs
+    static constexpr const int PASSES = 50;
+    auto run = [&](bool logging) {
+        std::uint64_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for(int pass = 0; pass < PASSES; pass++) {
+            for(auto &step : steps) {
+                checksum += step.opcode;
+                if(logging) {
+                    log(step.pc, CodeDataLogger::AccessExecuted);
+                    auto length = SM83::instruction_length(step.opcode);
+                    for(std::uint8_t i = 1; i < length; i++) {
+                        log(static_cast<std::uint16_t>(step.pc + i), CodeDataLogger::AccessOperand);
+                    }
+                    if(step.data_address != 0) {
+                        log(step.data_address, CodeDataLogger::AccessData);
+                    }
+                }
+            }
+            banks.romx = static_cast<std::uint16_t>(1 + pass % 127);
+        }
+        auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        sink = checksum; // keep the walk from being optimized out
+        return elapsed / (static_cast<double>(STEP_COUNT) * PASSES);
+    };
+
+    run(true); // warm up
+    auto without = run(false);
+    auto with = run(true);
+    auto cost = with - without;
+
+    // A Game Boy runs at most 1048576 instructions per second (one per M-cycle); most take 2-3 M-cycles
+    static constexpr const double MAX_INSTRUCTIONS_PER_SECOND = 1048576.0;
+    std::printf("Logging costs %.2f ns per instruction\n", cost);
+    std::printf("At 1x speed that is at most %.2f%% of one core\n", cost * MAX_INSTRUCTIONS_PER_SECOND / 1e9 * 100.0);
+
+    if(argc > 1) {
+        auto emulator = std::strtod(argv[1], nullptr);
+        if(emulator > 0.0) {
+            std::printf("Relative to %.2f ns per emulated instruction: %.1f%% slower\n", emulator, cost / emulator * 100.0);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,415 @@
+#include "breakpoint_condition.hpp"
+#include "symbol_table.hpp"
+
+#include <cctype>
+#include <cstdio>
+
+namespace {
+    struct Name {
+        const char *name;
+        std::int32_t operand;
+    };
+
+    // Registers are indices into BreakpointCondition::State; 8-bit registers are (index << 1) | (1 if high byte)
+    constexpr const Name REGISTERS_16[] = {
+        { "af", 0 }, { "bc", 1 }, { "de", 2 }, { "hl", 3 }, { "sp", 4 }, { "pc", 5 }
+    };
+    constexpr const Name REGISTERS_8[] = {
+        { "a", 0 << 1 | 1 }, { "f", 0 << 1 }, { "b", 1 << 1 | 1 }, { "c", 1 << 1 }, { "d", 2 << 1 | 1 }, { "e", 2 << 1 }, { "h", 3 << 1 | 1 }, { "l", 3 << 1 }
+    };
+    constexpr const Name FLAGS[] = {
+        { "zero", 0x80 }, { "subtract", 0x40 }, { "halfcarry", 0x20 }, { "carry", 0x10 }
+    };
+
+    template<std::size_t N> const Name *find_name(const Name (&names)[N], std::string_view name) noexcept {
+        for(auto &n : names) {
+            std::string_view candidate = n.name;
+            if(candidate.size() != name.size()) {
+                continue;
+            }
+            bool match = true;
+            for(std::size_t i = 0; i < name.size() && match; i++) {
+                match = std::tolower(static_cast<unsigned char>(name[i])) == candidate[i];
+            }
+            if(match) {
+                return &n;
+            }
+        }
+        return nullptr;
+    }
+
+    std::uint16_t register16(const BreakpointCondition::State &state, std::int32_t index) noexcept {
+        switch(index) {
+            case 0: return state.af;
+            case 1: return state.bc;
+            case 2: return state.de;
+            case 3: return state.hl;
+            case 4: return state.sp;
+            default: return state.pc;
+        }
+    }
+}
+
+// Recursive descent parser that emits ops as it goes, folding anything that's constant
+class BreakpointCondition::Parser {
+public:
+    Parser(std::string_view text, std::vector<Op> &ops, const SymbolTable *symbols) : text(text), ops(ops), symbols(symbols) {}
+
+    bool parse(std::string &error) {
+        this->parse_binary(0);
+        this->skip_whitespace();
+        if(this->error.empty() && this->position < this->text.size()) {
+            this->fail("Unexpected '%c'", this->text[this->position]);
+        }
+        if(this->error.empty() && this->max_depth > MAX_STACK_DEPTH) {
+            this->error = "Condition is too complex";
+        }
+        error = this->error;
+        return this->error.empty();
+    }
+
+    static std::int32_t apply(Opcode opcode, std::int32_t a, std::int32_t b) noexcept {
+        // Wrap around rather than overflow
+        auto ua = static_cast<std::uint32_t>(a), ub = static_cast<std::uint32_t>(b);
+        switch(opcode) {
+            case OpNegate: return static_cast<std::int32_t>(0u - ua);
+            case OpNot: return a == 0;
+            case OpComplement: return static_cast<std::int32_t>(~ua);
+            case OpMultiply: return static_cast<std::int32_t>(ua * ub);
+            case OpDivide: return b == 0 ? 0 : b == -1 ? static_cast<std::int32_t>(0u - ua) : a / b;
+            case OpModulo: return b == 0 || b == -1 ? 0 : a % b;
+            case OpAdd: return static_cast<std::int32_t>(ua + ub);
+            case OpSubtract: return static_cast<std::int32_t>(ua - ub);
+            case OpShiftLeft: return static_cast<std::int32_t>(ua << (ub & 31));
+            case OpShiftRight: return a >> (ub & 31);
+            case OpLess: return a < b;
+            case OpLessEqual: return a <= b;
+            case OpGreater: return a > b;
+            case OpGreaterEqual: return a >= b;
+            case OpEqual: return a == b;
+            case OpNotEqual: return a != b;
+            case OpBitAnd: return a & b;
+            case OpBitXor: return a ^ b;
+            case OpBitOr: return a | b;
+            case OpAnd: return a != 0 && b != 0;
+            case OpOr: return a != 0 || b != 0;
+            default: return 0;
+        }
+    }
+
+private:
+    std::string_view text;
+    std::size_t position = 0;
+    std::vector<Op> &ops;
+    const SymbolTable *symbols;
+    std::string error;
+    std::size_t depth = 0;
+    std::size_t max_depth = 0;
+
+    struct BinaryOperator {
+        const char *token;
+        Opcode opcode;
+        int precedence;
+    };
+
+    // Longer tokens first so "<=" isn't read as "<"
+    static constexpr const BinaryOperator BINARY_OPERATORS[] = {
+        { "||", OpOr, 1 },
+        { "&&", OpAnd, 2 },
+        { "==", OpEqual, 6 },
+        { "!=", OpNotEqual, 6 },
+        { "<=", OpLessEqual, 7 },
+        { ">=", OpGreaterEqual, 7 },
+        { "<<", OpShiftLeft, 8 },
+        { ">>", OpShiftRight, 8 },
+        { "|", OpBitOr, 3 },
+        { "^", OpBitXor, 4 },
+        { "&", OpBitAnd, 5 },
+        { "<", OpLess, 7 },
+        { ">", OpGreater, 7 },
+        { "+", OpAdd, 9 },
+        { "-", OpSubtract, 9 },
+        { "*", OpMultiply, 10 },
+        { "/", OpDivide, 10 },
+        { "%", OpModulo, 10 }
+    };
+
+    template<typename... Args> void fail(const char *format, Args... args) {
+        if(!this->error.empty()) {
+            return;
+        }
+        char message[256];
+        std::snprintf(message, sizeof(message), format, args...);
+        this->error = message;
+
+        char where[64];
+        std::snprintf(where, sizeof(where), " at column %zu", this->position + 1);
+        this->error += where;
+    }
+
+    void skip_whitespace() noexcept {
+        while(this->position < this->text.size() && std::isspace(static_cast<unsigned char>(this->text[this->position]))) {
+            this->position++;
+        }
+    }
+
+    bool accept(char c) noexcept {
+        this->skip_whitespace();
+        if(this->position < this->text.size() && this->text[this->position] == c) {
+            this->position++;
+            return true;
+        }
+        return false;
+    }
+
+    const BinaryOperator *peek_binary_operator() noexcept {
+        this->skip_whitespace();
+        auto rest = this->text.substr(this->position);
+        for(auto &o : BINARY_OPERATORS) {
+            if(rest.starts_with(o.token)) {
+                return &o;
+            }
+        }
+        return nullptr;
+    }
+
+    void push(Op op) {
+        this->ops.emplace_back(op);
+        if(++this->depth > this->max_depth) {
+            this->max_depth = this->depth;
+        }
+    }
+
+    void emit_unary(Opcode opcode) {
+        auto &last = this->ops.back();
+        if(last.opcode == OpConstant) {
+            last.operand = apply(opcode, last.operand, 0);
+        }
+        else {
+            this->ops.emplace_back(Op { opcode, 0 });
+        }
+    }
+
+    void emit_binary(Opcode opcode) {
+        auto count = this->ops.size();
+        auto &a = this->ops[count - 2];
+        auto &b = this->ops[count - 1];
+        if(a.opcode == OpConstant && b.opcode == OpConstant) {
+            a.operand = apply(opcode, a.operand, b.operand);
+            this->ops.pop_back();
+        }
+        else {
+            this->ops.emplace_back(Op { opcode, 0 });
+        }
+        this->depth--;
+    }
+
+    void parse_binary(int min_precedence) {
+        this->parse_unary();
+        while(this->error.empty()) {
+            auto *o = this->peek_binary_operator();
+            if(!o || o->precedence < min_precedence) {
+                break;
+            }
+            this->position += std::char_traits<char>::length(o->token);
+            this->parse_binary(o->precedence + 1);
+            if(!this->error.empty()) {
+                return;
+            }
+            this->emit_binary(o->opcode);
+        }
+    }
+
+    void parse_unary() {
+        if(this->accept('-')) {
+            this->parse_unary();
+            if(this->error.empty()) {
+                this->emit_unary(OpNegate);
+            }
+        }
+        else if(this->accept('!')) {
+            this->parse_unary();
+            if(this->error.empty()) {
+                this->emit_unary(OpNot);
+            }
+        }
+        else if(this->accept('~')) {
+            this->parse_unary();
+            if(this->error.empty()) {
+                this->emit_unary(OpComplement);
+            }
+        }
+        else if(this->accept('+')) {
+            this->parse_unary();
+        }
+        else {
+            this->parse_primary();
+        }
+    }
+
+    void parse_primary() {
+        this->skip_whitespace();
+        if(this->position >= this->text.size()) {
+            this->fail("Expected a value");
+            return;
+        }
+
+        if(this->accept('(')) {
+            this->parse_binary(0);
+            if(this->error.empty() && !this->accept(')')) {
+                this->fail("Expected ')'");
+            }
+            return;
+        }
+
+        if(this->accept('[')) {
+            this->parse_binary(0);
+            if(this->error.empty() && !this->accept(']')) {
+                this->fail("Expected ']'");
+            }
+            if(this->error.empty()) {
+                this->ops.emplace_back(Op { OpReadMemory, 0 });
+            }
+            return;
+        }
+
+        auto c = this->text[this->position];
+        if(c == '$' || c == '%' || std::isdigit(static_cast<unsigned char>(c))) {
+            this->parse_number();
+        }
+        else if(std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '.') {
+            this->parse_name();
+        }
+        else {
+            this->fail("Unexpected '%c'", c);
+        }
+    }
+
+    void parse_number() {
+        unsigned base = 10;
+        if(this->accept('$')) {
+            base = 16;
+        }
+        else if(this->accept('%')) {
+            base = 2;
+        }
+        else if(this->text.substr(this->position).starts_with("0x") || this->text.substr(this->position).starts_with("0X")) {
+            base = 16;
+            this->position += 2;
+        }
+
+        std::uint64_t value = 0;
+        std::size_t digits = 0;
+        for(; this->position < this->text.size(); this->position++, digits++) {
+            auto c = std::tolower(static_cast<unsigned char>(this->text[this->position]));
+            unsigned digit;
+            if(c >= '0' && c <= '9') {
+                digit = c - '0';
+            }
+            else if(c >= 'a' && c <= 'f') {
+                digit = c - 'a' + 10;
+            }
+            else {
+                break;
+            }
+            if(digit >= base) {
+                break;
+            }
+            value = value * base + digit;
+            if(value > 0xFFFFFFFF) {
+                this->fail("Number is too large");
+                return;
+            }
+        }
+
+        if(digits == 0) {
+            this->fail("Expected a number");
+            return;
+        }
+
+        this->push(Op { OpConstant, static_cast<std::int32_t>(static_cast<std::uint32_t>(value)) });
+    }
+
+    void parse_name() {
+        auto start = this->position;
+        while(this->position < this->text.size()) {
+            auto c = this->text[this->position];
+            if(!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.' && c != '@' && c != '#') {
+                break;
+            }
+            this->position++;
+        }
+        auto name = this->text.substr(start, this->position - start);
+
+        if(auto *r = find_name(REGISTERS_16, name)) {
+            this->push(Op { OpRegister16, r->operand });
+        }
+        else if(auto *r = find_name(REGISTERS_8, name)) {
+            this->push(Op { OpRegister8, r->operand });
+        }
+        else if(auto *f = find_name(FLAGS, name)) {
+            this->push(Op { OpFlag, f->operand });
+        }
+        else if(auto *symbol = this->symbols ? this->symbols->lookup(name) : nullptr) {
+            this->push(Op { OpConstant, symbol->address });
+        }
+        else {
+            this->position = start;
+            this->fail("Unknown name '%.*s'", static_cast<int>(name.size()), name.data());
+        }
+    }
+};
+
+bool BreakpointCondition::compile(std::string_view expression, std::string &error, const SymbolTable *symbols) {
+    this->ops.clear();
+
+    std::vector<Op> ops;
+    if(!Parser(expression, ops, symbols).parse(error)) {
+        return false;
+    }
+
+    this->ops = std::move(ops);
+    return true;
+}
+
+std::int32_t BreakpointCondition::calculate(const State &state, ReadMemory read_memory, void *user_data) const noexcept {
+    if(this->ops.empty()) {
+        return 0;
+    }
+
+    std::int32_t stack[MAX_STACK_DEPTH];
+    std::size_t sp = 0;
+
+    for(auto &op : this->ops) {
+        switch(op.opcode) {
+            case OpConstant:
+                stack[sp++] = op.operand;
+                break;
+            case OpRegister16:
+                stack[sp++] = register16(state, op.operand);
+                break;
+            case OpRegister8: {
+                auto r = register16(state, op.operand >> 1);
+                stack[sp++] = (op.operand & 1) ? (r >> 8) : (r & 0xFF);
+                break;
+            }
+            case OpFlag:
+                stack[sp++] = (state.af & op.operand) != 0;
+                break;
+            case OpReadMemory:
+                stack[sp - 1] = read_memory(user_data, static_cast<std::uint16_t>(stack[sp - 1]));
+                break;
+            case OpNegate:
+            case OpNot:
+            case OpComplement:
+                stack[sp - 1] = Parser::apply(op.opcode, stack[sp - 1], 0);
+                break;
+            default:
+                sp--;
+                stack[sp - 1] = Parser::apply(op.opcode, stack[sp - 1], stack[sp]);
+                break;
+        }
+    }
+
+    return stack[0];
+}
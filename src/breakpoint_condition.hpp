@@ -0,0 +1,111 @@
+#ifndef BREAKPOINT_CONDITION_HPP
+#define BREAKPOINT_CONDITION_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class SymbolTable;
+
+// A breakpoint condition compiled into bytecode for a small stack machine, so checking it when the breakpoint is hit is
+// just a loop over a few ops rather than parsing the expression again. This is also used for watch expressions, which
+// want the value rather than whether it's nonzero.
+//
+// Expressions use C operators and precedence. Operands can be numbers ($3F, 0x3F, %00111111, or 63), registers (a, b,
+// c, d, e, f, h, l, af, bc, de, hl, sp, pc), flags (zero, subtract, halfcarry, carry), a byte of memory ([$C000]), or
+// symbols if a symbol table is given.
+class BreakpointCondition {
+public:
+    struct State {
+        std::uint16_t af, bc, de, hl, sp, pc;
+    };
+
+    /** Reads a byte of memory when evaluating */
+    using ReadMemory = std::uint8_t (*)(void *user_data, std::uint16_t address);
+
+    /**
+     * Compile an expression, replacing whatever was compiled before
+     *
+     * @param  expression expression to compile
+     * @param  error      set to what's wrong with the expression if it fails to compile
+     * @param  symbols    symbols to resolve names with (optional)
+     * @return            true if successful
+     */
+    bool compile(std::string_view expression, std::string &error, const SymbolTable *symbols = nullptr);
+
+    /**
+     * Evaluate the condition
+     *
+     * @param  state       registers
+     * @param  read_memory function to read memory with
+     * @param  user_data   passed to read_memory
+     * @return             true if the condition is met (nonzero), or if nothing is compiled
+     */
+    bool evaluate(const State &state, ReadMemory read_memory, void *user_data) const noexcept {
+        return this->ops.empty() || this->calculate(state, read_memory, user_data) != 0;
+    }
+
+    /**
+     * Calculate the value of the expression
+     *
+     * @param  state       registers
+     * @param  read_memory function to read memory with
+     * @param  user_data   passed to read_memory
+     * @return             value (0 if nothing is compiled)
+     */
+    std::int32_t calculate(const State &state, ReadMemory read_memory, void *user_data) const noexcept;
+
+    /**
+     * Get whether there is anything to evaluate
+     *
+     * @return true if empty
+     */
+    bool empty() const noexcept { return this->ops.empty(); }
+
+private:
+    enum Opcode : std::uint8_t {
+        OpConstant,
+        OpRegister8,
+        OpRegister16,
+        OpFlag,
+        OpReadMemory,
+
+        OpNegate,
+        OpNot,
+        OpComplement,
+
+        OpMultiply,
+        OpDivide,
+        OpModulo,
+        OpAdd,
+        OpSubtract,
+        OpShiftLeft,
+        OpShiftRight,
+        OpLess,
+        OpLessEqual,
+        OpGreater,
+        OpGreaterEqual,
+        OpEqual,
+        OpNotEqual,
+        OpBitAnd,
+        OpBitXor,
+        OpBitOr,
+        OpAnd,
+        OpOr
+    };
+
+    struct Op {
+        Opcode opcode;
+        std::int32_t operand; // constant, register index, or flag mask
+    };
+
+    static constexpr const std::size_t MAX_STACK_DEPTH = 32;
+
+    std::vector<Op> ops;
+
+    class Parser;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "call_graph_profiler.hpp"
+
+#include <algorithm>
+
+enum InstructionKind {
+    InstructionOther,    // leaves SP alone
+    InstructionCall,     // CALL/RST (SP - 2 if taken)
+    InstructionReturn,   // RET/RETI (SP + 2 if taken)
+    InstructionPush,     // SP - 2
+    InstructionPop,      // SP + 2
+    InstructionSetsSP    // does something else to SP (LD SP, ADD SP, etc.)
+};
+
+static InstructionKind instruction_kind(std::uint8_t opcode) noexcept {
+    switch(opcode) {
+        case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC:
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+            return InstructionCall;
+        case 0xC9: case 0xD9: case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+            return InstructionReturn;
+        case 0xC5: case 0xD5: case 0xE5: case 0xF5:
+            return InstructionPush;
+        case 0xC1: case 0xD1: case 0xE1: case 0xF1:
+            return InstructionPop;
+        case 0x31: case 0x33: case 0x3B: case 0xE8: case 0xF9:
+            return InstructionSetsSP;
+        default:
+            return InstructionOther;
+    }
+}
+
+static bool is_rst(std::uint8_t opcode) noexcept {
+    return (opcode & 0xC7) == 0xC7;
+}
+
+static bool is_interrupt_vector(std::uint16_t address) noexcept {
+    return address == 0x40 || address == 0x48 || address == 0x50 || address == 0x58 || address == 0x60;
+}
+
+void CallGraphProfiler::instruction(std::uint16_t address, std::uint16_t bank, std::uint8_t opcode, std::uint16_t sp, std::uint64_t now) {
+    if(this->has_last) {
+        // Anything whose return address is now above the stack has returned
+        while(this->depth > 0 && this->stack[this->depth - 1].sp < sp) {
+            this->leave(now);
+        }
+
+        auto delta = static_cast<std::int16_t>(sp - this->last_sp);
+        bool vector = is_interrupt_vector(address);
+
+        switch(instruction_kind(this->last_opcode)) {
+            case InstructionCall:
+                if(delta == -2) {
+                    this->enter(address, bank, sp, now);
+                }
+                else if(delta == -4 && vector) {
+                    // Called and then immediately interrupted. We only know where an RST went; a CALL's target never ran.
+                    if(is_rst(this->last_opcode)) {
+                        this->enter(this->last_opcode & 0x38, bank, sp + 2, now);
+                    }
+                    this->enter(address, bank, sp, now);
+                }
+                break;
+
+            case InstructionReturn:
+                // Returned and then immediately interrupted (so SP is back where it was), or didn't return but got interrupted
+                if(vector && (delta == 0 || delta == -2)) {
+                    if(delta == 0) {
+                        while(this->depth > 0 && this->stack[this->depth - 1].sp <= this->last_sp) {
+                            this->leave(now);
+                        }
+                    }
+                    this->enter(address, bank, sp, now);
+                }
+                break;
+
+            case InstructionPush:
+                if(vector && delta == -4) {
+                    this->enter(address, bank, sp, now);
+                }
+                break;
+
+            case InstructionPop:
+                if(vector && delta == 0) {
+                    this->enter(address, bank, sp, now);
+                }
+                break;
+
+            case InstructionOther:
+                if(vector && delta == -2) {
+                    this->enter(address, bank, sp, now);
+                }
+                break;
+
+            case InstructionSetsSP:
+                break;
+        }
+    }
+
+    this->has_last = true;
+    this->last_address = address;
+    this->last_sp = sp;
+    this->last_opcode = opcode;
+}
+
+void CallGraphProfiler::enter(std::uint16_t address, std::uint16_t bank, std::uint16_t sp, std::uint64_t now) {
+    auto &function = this->functions[static_cast<std::uint32_t>(bank) << 16 | address];
+    function.calls++;
+
+    if(this->depth == MAX_DEPTH) {
+        this->dropped_calls++;
+        return;
+    }
+
+    this->stack[this->depth++] = Frame { &function, sp, now, 0 };
+}
+
+void CallGraphProfiler::leave(std::uint64_t now) noexcept {
+    auto &frame = this->stack[--this->depth];
+    auto cycles = now - frame.start;
+
+    auto &function = *frame.function;
+    function.total_cycles += cycles;
+    function.self_cycles += cycles - std::min(cycles, frame.child_cycles);
+    function.max_cycles = std::max(function.max_cycles, cycles);
+
+    if(this->depth > 0) {
+        this->stack[this->depth - 1].child_cycles += cycles;
+    }
+}
+
+void CallGraphProfiler::frame(std::uint64_t now) noexcept {
+    if(this->frame_start != 0) {
+        this->frame_cycles = now - this->frame_start;
+    }
+    this->frame_start = now;
+}
+
+void CallGraphProfiler::reset_stack() noexcept {
+    this->depth = 0;
+    this->has_last = false;
+    this->frame_start = 0;
+}
+
+void CallGraphProfiler::clear() {
+    this->reset_stack();
+    this->functions.clear();
+    this->dropped_calls = 0;
+    this->frame_cycles = 0;
+}
+
+CallGraphProfiler::Profile CallGraphProfiler::get_profile() const {
+    Profile profile;
+    profile.functions.assign(this->functions.begin(), this->functions.end());
+    profile.frame_cycles = this->frame_cycles;
+    profile.dropped_calls = this->dropped_calls;
+    return profile;
+}
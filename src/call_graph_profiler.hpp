@@ -0,0 +1,106 @@
+#ifndef CALL_GRAPH_PROFILER_HPP
+#define CALL_GRAPH_PROFILER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+
+// Times every function call by watching each instruction as it runs. Calls are found by looking at what the previous
+// instruction was and how the stack pointer changed (CALL/RST push two bytes, and so do interrupts, but an interrupt
+// can follow any instruction). Returns are found by the stack being unwound past a call's return address, which also
+// catches functions that pop their return address and jump instead of returning.
+class CallGraphProfiler {
+public:
+    struct FunctionStats {
+        /** Number of times the function was entered */
+        std::uint64_t calls = 0;
+
+        /** Cycles spent in the function but not anything it called */
+        std::uint64_t self_cycles = 0;
+
+        /** Cycles spent in the function and anything it called */
+        std::uint64_t total_cycles = 0;
+
+        /** Most cycles a single call took (including anything it called) */
+        std::uint64_t max_cycles = 0;
+    };
+
+    struct Profile {
+        /** Stats for every function entered, by location (bank << 16 | address) */
+        std::vector<std::pair<std::uint32_t, FunctionStats>> functions;
+
+        /** Cycles the last full frame took */
+        std::uint64_t frame_cycles = 0;
+
+        /** Calls that were not tracked because the shadow stack was full */
+        std::uint64_t dropped_calls = 0;
+    };
+
+    /**
+     * Call right before each instruction runs
+     *
+     * @param address address of the instruction
+     * @param bank    bank the instruction is in
+     * @param opcode  opcode of the instruction
+     * @param sp      current stack pointer
+     * @param now     current cycle count
+     */
+    void instruction(std::uint16_t address, std::uint16_t bank, std::uint8_t opcode, std::uint16_t sp, std::uint64_t now);
+
+    /**
+     * Call at the start of every frame
+     *
+     * @param now current cycle count
+     */
+    void frame(std::uint64_t now) noexcept;
+
+    /**
+     * Forget the call stack (e.g. if the state was replaced). Stats are kept.
+     */
+    void reset_stack() noexcept;
+
+    /**
+     * Throw out all stats and the call stack
+     */
+    void clear();
+
+    /**
+     * Get a copy of the stats
+     *
+     * @return profile
+     */
+    Profile get_profile() const;
+
+private:
+    struct Frame {
+        FunctionStats *function;
+        std::uint16_t sp; // where the return address is
+        std::uint64_t start;
+        std::uint64_t child_cycles;
+    };
+
+    // Shadow stack. SM83 stacks are tiny, so anything deeper than this is almost certainly a stack leak.
+    static constexpr const std::size_t MAX_DEPTH = 256;
+    Frame stack[MAX_DEPTH];
+    std::size_t depth = 0;
+    std::uint64_t dropped_calls = 0;
+
+    // Stats by location. Elements of an unordered_map never move, so frames can hold a pointer to them.
+    std::unordered_map<std::uint32_t, FunctionStats> functions;
+
+    // What ran before this
+    bool has_last = false;
+    std::uint16_t last_address = 0;
+    std::uint16_t last_sp = 0;
+    std::uint8_t last_opcode = 0;
+
+    // Frame timing
+    std::uint64_t frame_start = 0;
+    std::uint64_t frame_cycles = 0;
+
+    void enter(std::uint16_t address, std::uint16_t bank, std::uint16_t sp, std::uint64_t now);
+    void leave(std::uint64_t now) noexcept;
+};
+
+#endif
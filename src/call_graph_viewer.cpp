@@ -0,0 +1,172 @@
+#include "call_graph_viewer.hpp"
+
+#include <QCheckBox>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QStatusBar>
+#include <QFontDatabase>
+
+#include <cmath>
+#include <cstdio>
+
+#include "game_window.hpp"
+
+enum CallGraphColumn {
+    ColumnFunction,
+    ColumnCalls,
+    ColumnSelf,
+    ColumnTotal,
+    ColumnMax,
+    ColumnMaxFrame,
+
+    ColumnCount
+};
+
+CallGraphViewer::CallGraphViewer(GameWindow *window) : QMainWindow(window), window(window) {
+    this->setWindowTitle("Call Graph Profiler");
+
+    auto *central_widget = new QWidget(this);
+    auto *layout = new QVBoxLayout(central_widget);
+    central_widget->setLayout(layout);
+
+    // Record and reset
+    auto *top_widget = new QWidget(central_widget);
+    auto *top_layout = new QHBoxLayout(top_widget);
+    top_layout->setContentsMargins(0,0,0,0);
+    top_widget->setLayout(top_layout);
+
+    this->record_box = new QCheckBox("Record", top_widget);
+    this->record_box->setToolTip("Time every call, RST, and interrupt until it returns. This slows down emulation.");
+    connect(this->record_box, &QCheckBox::clicked, this, &CallGraphViewer::action_toggle_recording);
+    top_layout->addWidget(this->record_box);
+
+    auto *reset_button = new QPushButton("Reset", top_widget);
+    connect(reset_button, &QPushButton::clicked, this, &CallGraphViewer::action_reset);
+    top_layout->addWidget(reset_button);
+    top_layout->addStretch(1);
+
+    layout->addWidget(top_widget);
+
+    // Functions
+    this->functions = new QTableWidget(central_widget);
+    this->functions->setColumnCount(ColumnCount);
+    this->functions->setHorizontalHeaderLabels({"Function", "Calls", "Self", "Total", "Max/Call", "Max % of Frame"});
+    this->functions->horizontalHeaderItem(ColumnSelf)->setToolTip("Cycles spent in the function but not anything it called");
+    this->functions->horizontalHeaderItem(ColumnTotal)->setToolTip("Cycles spent in the function and anything it called");
+    this->functions->horizontalHeaderItem(ColumnMax)->setToolTip("Most cycles a single call took, including anything it called");
+    this->functions->horizontalHeaderItem(ColumnMaxFrame)->setToolTip("Most cycles a single call took compared to the length of a frame");
+    this->functions->horizontalHeader()->setSectionResizeMode(ColumnFunction, QHeaderView::Stretch);
+    this->functions->verticalHeader()->setVisible(false);
+    this->functions->setSelectionBehavior(QAbstractItemView::SelectRows);
+    this->functions->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->functions->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    this->functions->setSortingEnabled(true);
+    this->functions->sortByColumn(ColumnSelf, Qt::DescendingOrder);
+    this->functions->setMinimumSize(640, 400);
+    layout->addWidget(this->functions);
+
+    this->setCentralWidget(central_widget);
+
+    this->status_label = new QLabel(this);
+    this->statusBar()->addWidget(this->status_label);
+}
+
+CallGraphViewer::~CallGraphViewer() {}
+
+void CallGraphViewer::showEvent(QShowEvent *) {
+    this->record_box->setChecked(this->window->get_instance().is_call_graph_profiler_enabled());
+    this->refresh_functions();
+}
+
+void CallGraphViewer::refresh_view() {
+    if(this->isHidden()) {
+        return;
+    }
+
+    // Update at 2 Hz (sorting thousands of functions every frame is a waste)
+    auto now = std::chrono::steady_clock::now();
+    if(now - this->last_update < std::chrono::milliseconds(500)) {
+        return;
+    }
+
+    this->refresh_functions();
+}
+
+void CallGraphViewer::action_toggle_recording() {
+    this->window->get_instance().set_call_graph_profiler_enabled(this->record_box->isChecked());
+}
+
+void CallGraphViewer::action_reset() {
+    this->window->get_instance().clear_call_graph_profile();
+    this->refresh_functions();
+}
+
+void CallGraphViewer::refresh_functions() {
+    this->last_update = std::chrono::steady_clock::now();
+
+    auto &instance = this->window->get_instance();
+    auto profile = instance.get_call_graph_profile();
+    auto symbols = instance.get_symbol_table();
+
+    // Turn sorting off while filling in the table, or else rows will move around while we're setting them
+    auto *header = this->functions->horizontalHeader();
+    auto sort_column = header->sortIndicatorSection();
+    auto sort_order = header->sortIndicatorOrder();
+    this->functions->setSortingEnabled(false);
+    this->functions->setRowCount(static_cast<int>(profile.functions.size()));
+
+    auto make_number = [](auto value) {
+        auto *item = new QTableWidgetItem();
+        item->setData(Qt::DisplayRole, value);
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+
+    int row = 0;
+    for(auto &[location, stats] : profile.functions) {
+        std::uint16_t bank = location >> 16;
+        std::uint16_t address = location & 0xFFFF;
+
+        QString name;
+        if(symbols) {
+            name = QString::fromStdString(symbols->describe(bank, address, false));
+        }
+        else {
+            char unnamed[16];
+            std::snprintf(unnamed, sizeof(unnamed), "$%02x:%04x", bank, address);
+            name = unnamed;
+        }
+
+        this->functions->setItem(row, ColumnFunction, new QTableWidgetItem(name));
+        this->functions->setItem(row, ColumnCalls, make_number(static_cast<qulonglong>(stats.calls)));
+        this->functions->setItem(row, ColumnSelf, make_number(static_cast<qulonglong>(stats.self_cycles)));
+        this->functions->setItem(row, ColumnTotal, make_number(static_cast<qulonglong>(stats.total_cycles)));
+        this->functions->setItem(row, ColumnMax, make_number(static_cast<qulonglong>(stats.max_cycles)));
+        if(profile.frame_cycles > 0) {
+            double percent = static_cast<double>(stats.max_cycles) * 100.0 / static_cast<double>(profile.frame_cycles);
+            auto *item = make_number(std::round(percent * 10.0) / 10.0);
+            if(percent >= 100.0) {
+                item->setForeground(Qt::red);
+            }
+            this->functions->setItem(row, ColumnMaxFrame, item);
+        }
+        else {
+            this->functions->setItem(row, ColumnMaxFrame, new QTableWidgetItem());
+        }
+        row++;
+    }
+
+    this->functions->setSortingEnabled(true);
+    this->functions->sortByColumn(sort_column, sort_order);
+
+    char status[128];
+    std::snprintf(status, sizeof(status), "%zu functions, %llu cycles per frame, %llu calls dropped (too deep)",
+                  profile.functions.size(),
+                  static_cast<unsigned long long>(profile.frame_cycles),
+                  static_cast<unsigned long long>(profile.dropped_calls));
+    this->status_label->setText(status);
+}
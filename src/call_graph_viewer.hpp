@@ -0,0 +1,37 @@
+#ifndef CALL_GRAPH_VIEWER_HPP
+#define CALL_GRAPH_VIEWER_HPP
+
+#include <QMainWindow>
+
+#include <chrono>
+
+class GameWindow;
+class QCheckBox;
+class QTableWidget;
+class QLabel;
+
+class CallGraphViewer : public QMainWindow {
+    Q_OBJECT
+
+public:
+    CallGraphViewer(GameWindow *window);
+    ~CallGraphViewer() override;
+
+    /** Refresh the information in view */
+    void refresh_view();
+
+private:
+    GameWindow *window;
+    QCheckBox *record_box;
+    QTableWidget *functions;
+    QLabel *status_label;
+
+    std::chrono::steady_clock::time_point last_update = {};
+
+    void action_toggle_recording();
+    void action_reset();
+    void refresh_functions();
+    void showEvent(QShowEvent *) override;
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include "code_data_logger.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <bit>
+#include <algorithm>
+
+// File format (all integers are little endian):
+//   char[8]  magic ("SDXCDL" followed by two null bytes)
+//   u32      version
+//   u32      region count
+//   for each region:
+//     u32    size in bytes
+//     u64[]  (size + 63) / 64 words for each access type, in the order of CodeDataLogger::Access
+static const char CDL_MAGIC[8] = { 'S', 'D', 'X', 'C', 'D', 'L', 0, 0 };
+static const std::uint32_t CDL_VERSION = 1;
+
+static bool write_u32(std::FILE *f, std::uint32_t value) {
+    std::uint8_t bytes[4];
+    for(std::size_t i = 0; i < sizeof(bytes); i++) {
+        bytes[i] = static_cast<std::uint8_t>(value >> (i * 8));
+    }
+    return std::fwrite(bytes, sizeof(bytes), 1, f) == 1;
+}
+
+static bool read_u32(std::FILE *f, std::uint32_t &value) {
+    std::uint8_t bytes[4];
+    if(std::fread(bytes, sizeof(bytes), 1, f) != 1) {
+        return false;
+    }
+    value = 0;
+    for(std::size_t i = 0; i < sizeof(bytes); i++) {
+        value |= static_cast<std::uint32_t>(bytes[i]) << (i * 8);
+    }
+    return true;
+}
+
+static bool write_plane(std::FILE *f, const std::vector<std::uint64_t> &plane) {
+    std::vector<std::uint8_t> bytes(plane.size() * sizeof(std::uint64_t));
+    for(std::size_t w = 0; w < plane.size(); w++) {
+        for(std::size_t i = 0; i < sizeof(std::uint64_t); i++) {
+            bytes[w * sizeof(std::uint64_t) + i] = static_cast<std::uint8_t>(plane[w] >> (i * 8));
+        }
+    }
+    return bytes.empty() || std::fwrite(bytes.data(), bytes.size(), 1, f) == 1;
+}
+
+static bool read_plane(std::FILE *f, std::size_t words, std::vector<std::uint64_t> *merge_into) {
+    std::vector<std::uint8_t> bytes(words * sizeof(std::uint64_t));
+    if(!bytes.empty() && std::fread(bytes.data(), bytes.size(), 1, f) != 1) {
+        return false;
+    }
+    if(merge_into != nullptr) {
+        for(std::size_t w = 0; w < words; w++) {
+            std::uint64_t value = 0;
+            for(std::size_t i = 0; i < sizeof(std::uint64_t); i++) {
+                value |= static_cast<std::uint64_t>(bytes[w * sizeof(std::uint64_t) + i]) << (i * 8);
+            }
+            (*merge_into)[w] |= value;
+        }
+    }
+    return true;
+}
+
+static std::size_t words_for_size(std::size_t size) noexcept {
+    return (size + 63) / 64;
+}
+
+void CodeDataLogger::resize(Region region, std::size_t size) {
+    auto &r = this->regions[region];
+    if(r.size == size) {
+        return;
+    }
+
+    r.size = size;
+    for(auto &plane : r.planes) {
+        plane.assign(words_for_size(size), 0);
+    }
+}
+
+void CodeDataLogger::clear() noexcept {
+    for(auto &r : this->regions) {
+        for(auto &plane : r.planes) {
+            std::fill(plane.begin(), plane.end(), 0);
+        }
+    }
+}
+
+std::uint8_t CodeDataLogger::get(Region region, std::size_t offset) const noexcept {
+    auto &r = this->regions[region];
+    if(offset >= r.size) {
+        return 0;
+    }
+
+    std::uint8_t flags = 0;
+    for(std::size_t a = 0; a < AccessCount; a++) {
+        if((r.planes[a][offset >> 6] >> (offset & 63)) & 1) {
+            flags |= 1 << a;
+        }
+    }
+    return flags;
+}
+
+std::size_t CodeDataLogger::count(Region region, Access access) const noexcept {
+    std::size_t total = 0;
+    for(auto w : this->regions[region].planes[access]) {
+        total += std::popcount(w);
+    }
+    return total;
+}
+
+bool CodeDataLogger::save(const std::filesystem::path &path) const {
+    std::FILE *f = std::fopen(path.string().c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+
+    bool ok = std::fwrite(CDL_MAGIC, sizeof(CDL_MAGIC), 1, f) == 1 && write_u32(f, CDL_VERSION) && write_u32(f, RegionCount);
+    for(auto &r : this->regions) {
+        ok = ok && write_u32(f, static_cast<std::uint32_t>(r.size));
+        for(auto &plane : r.planes) {
+            ok = ok && write_plane(f, plane);
+        }
+    }
+
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
+
+bool CodeDataLogger::load(const std::filesystem::path &path) {
+    std::FILE *f = std::fopen(path.string().c_str(), "rb");
+    if(!f) {
+        return false;
+    }
+
+    char magic[sizeof(CDL_MAGIC)];
+    std::uint32_t version, region_count;
+    bool ok = std::fread(magic, sizeof(magic), 1, f) == 1 && std::memcmp(magic, CDL_MAGIC, sizeof(magic)) == 0
+           && read_u32(f, version) && version == CDL_VERSION
+           && read_u32(f, region_count);
+
+    for(std::uint32_t region = 0; ok && region < region_count; region++) {
+        std::uint32_t size;
+        if(!(ok = read_u32(f, size))) {
+            break;
+        }
+
+        // Skip (but still read past) anything that doesn't line up with what we have
+        RegionData *r = (region < RegionCount && this->regions[region].size == size) ? &this->regions[region] : nullptr;
+        for(std::size_t a = 0; ok && a < AccessCount; a++) {
+            ok = read_plane(f, words_for_size(size), r ? &r->planes[a] : nullptr);
+        }
+    }
+
+    std::fclose(f);
+    return ok;
+}
@@ -0,0 +1,115 @@
+#ifndef CODE_DATA_LOGGER_HPP
+#define CODE_DATA_LOGGER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <filesystem>
+
+// Records how each byte of ROM and RAM has been accessed (executed, read as an operand, or read as data). Each kind of
+// access is its own bitset so marking a byte is a single OR.
+class CodeDataLogger {
+public:
+    enum Region : std::uint8_t {
+        RegionROM,
+        RegionVRAM,
+        RegionCartRAM,
+        RegionWRAM,
+        RegionHRAM,
+
+        RegionCount
+    };
+
+    enum Access : std::uint8_t {
+        AccessExecuted,
+        AccessOperand,
+        AccessData,
+
+        AccessCount
+    };
+
+    enum Flag : std::uint8_t {
+        FlagExecuted = 1 << AccessExecuted,
+        FlagOperand = 1 << AccessOperand,
+        FlagData = 1 << AccessData
+    };
+
+    /**
+     * Set the size of a region. If the size changes, everything recorded for the region is cleared.
+     *
+     * @param region region to resize
+     * @param size   size in bytes
+     */
+    void resize(Region region, std::size_t size);
+
+    /**
+     * Get the size of a region
+     *
+     * @param  region region
+     * @return        size in bytes
+     */
+    std::size_t size(Region region) const noexcept { return this->regions[region].size; }
+
+    /**
+     * Clear everything recorded (sizes are kept)
+     */
+    void clear() noexcept;
+
+    /**
+     * Record an access to a byte. Offsets outside of the region are ignored.
+     *
+     * @param region region
+     * @param offset offset in the region
+     * @param access kind of access
+     */
+    void mark(Region region, std::size_t offset, Access access) noexcept {
+        auto &r = this->regions[region];
+        if(offset < r.size) {
+            r.planes[access][offset >> 6] |= static_cast<std::uint64_t>(1) << (offset & 63);
+        }
+    }
+
+    /**
+     * Get the Flag bits recorded for a byte
+     *
+     * @param  region region
+     * @param  offset offset in the region
+     * @return        flags (0 if nothing was recorded or it is out of bounds)
+     */
+    std::uint8_t get(Region region, std::size_t offset) const noexcept;
+
+    /**
+     * Count the bytes in a region that have the given access recorded
+     *
+     * @param  region region
+     * @param  access kind of access
+     * @return        number of bytes
+     */
+    std::size_t count(Region region, Access access) const noexcept;
+
+    /**
+     * Save everything to a file
+     *
+     * @param  path path to save to
+     * @return      true if successful
+     */
+    bool save(const std::filesystem::path &path) const;
+
+    /**
+     * Load a file, merging it with what is already recorded. Regions whose size doesn't match the current size are
+     * skipped since they can't be from the same cartridge/model.
+     *
+     * @param  path path to load
+     * @return      true if successful
+     */
+    bool load(const std::filesystem::path &path);
+
+private:
+    struct RegionData {
+        std::size_t size = 0;
+        std::vector<std::uint64_t> planes[AccessCount];
+    };
+    RegionData regions[RegionCount];
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "cpu_usage_meter.hpp"
+
+#include <algorithm>
+
+void CPUUsageMeter::reset() noexcept {
+    this->current = {};
+    this->started = false;
+    this->depth = 0;
+    this->ring_next = 0;
+    this->ring_count = 0;
+    this->history.store(History {});
+}
+
+void CPUUsageMeter::frame(std::uint32_t number, std::uint64_t now) noexcept {
+    if(!this->started) {
+        this->started = true;
+        this->current = {};
+        this->current.number = number;
+        this->frame_start = now;
+        return;
+    }
+
+    // Halted cycles are counted per GB_run() call, which can straddle vblank, so keep it from going over
+    this->current.cycles = static_cast<std::uint32_t>(now - this->frame_start);
+    this->current.halted_cycles = std::min(this->current.halted_cycles, this->current.cycles);
+
+    this->ring[this->ring_next] = this->current;
+    this->ring_next = (this->ring_next + 1) % HISTORY_FRAMES;
+    this->ring_count = std::min(this->ring_count + 1, HISTORY_FRAMES);
+
+    History history;
+    history.count = this->ring_count;
+    auto first = (this->ring_next + HISTORY_FRAMES - this->ring_count) % HISTORY_FRAMES;
+    for(std::size_t i = 0; i < this->ring_count; i++) {
+        history.frames[i] = this->ring[(first + i) % HISTORY_FRAMES];
+    }
+    this->history.store(history);
+
+    this->current = {};
+    this->current.number = number;
+    this->frame_start = now;
+}
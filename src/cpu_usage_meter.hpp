@@ -0,0 +1,128 @@
+#ifndef CPU_USAGE_METER_HPP
+#define CPU_USAGE_METER_HPP
+
+#include <cstdint>
+#include <cstddef>
+
+#include "seqlock.hpp"
+
+// Measures how much of each frame the game spends running code, waiting in HALT/STOP, and in each interrupt handler
+//
+// This is fed the cycles of every GB_run() call along with whether the CPU was halted going in and whether an interrupt
+// was dispatched, and the totals are closed off at each vblank. Handlers are followed by stack pointer: a handler is
+// entered when an interrupt is dispatched and has returned once its return address is popped. The last few frames are
+// published through a seqlock, so reading them never blocks the emulator.
+class CPUUsageMeter {
+public:
+    enum Interrupt : std::uint8_t {
+        InterruptVBlank,
+        InterruptSTAT,
+        InterruptTimer,
+        InterruptSerial,
+        InterruptJoypad,
+
+        InterruptCount
+    };
+
+    struct Frame {
+        /** Frame number */
+        std::uint32_t number;
+
+        /** Cycles between the vblank that started this frame and the one that ended it */
+        std::uint32_t cycles;
+
+        /** Cycles spent in HALT or STOP */
+        std::uint32_t halted_cycles;
+
+        /** Cycles spent in each interrupt handler (not counting other handlers that interrupted it) */
+        std::uint32_t interrupt_cycles[InterruptCount];
+
+        /**
+         * Get the fraction of the frame the CPU was not halted
+         *
+         * @return utilization from 0 to 1
+         */
+        double get_utilization() const noexcept {
+            return this->cycles == 0 ? 0.0 : 1.0 - static_cast<double>(this->halted_cycles) / this->cycles;
+        }
+    };
+
+    static constexpr const std::size_t HISTORY_FRAMES = 120;
+
+    struct History {
+        /** Frames, oldest first */
+        Frame frames[HISTORY_FRAMES];
+
+        /** Number of frames recorded (up to HISTORY_FRAMES); the newest ones are at the end of the array */
+        std::size_t count;
+    };
+
+    /**
+     * Throw out everything. Nothing is recorded until the next vblank since the frame in progress is only partly measured.
+     */
+    void reset() noexcept;
+
+    /**
+     * Record what happened in a GB_run() call
+     *
+     * @param cycles     cycles run
+     * @param halted     CPU was halted or stopped before running
+     * @param dispatched an interrupt was dispatched (IME went from set to clear)
+     * @param pc         PC afterwards
+     * @param sp         SP afterwards
+     */
+    void run(std::uint32_t cycles, bool halted, bool dispatched, std::uint16_t pc, std::uint16_t sp) noexcept {
+        if(halted) {
+            this->current.halted_cycles += cycles;
+        }
+        else if(this->depth > 0) {
+            this->current.interrupt_cycles[this->handlers[this->depth - 1].interrupt] += cycles;
+        }
+
+        // Anything whose return address is now above the stack has returned
+        while(this->depth > 0 && sp > this->handlers[this->depth - 1].sp) {
+            this->depth--;
+        }
+
+        if(dispatched && pc >= 0x40 && pc <= 0x60 && (pc & 7) == 0 && this->depth < MAX_DEPTH) {
+            this->handlers[this->depth++] = { sp, static_cast<Interrupt>((pc - 0x40) / 8) };
+        }
+    }
+
+    /**
+     * Finish the current frame and publish it (call on vblank)
+     *
+     * @param number number of the frame that's starting
+     * @param now    current cycle count
+     */
+    void frame(std::uint32_t number, std::uint64_t now) noexcept;
+
+    /**
+     * Get the last few frames. This does not block and can be called from any thread.
+     *
+     * @return history
+     */
+    History get_history() const noexcept { return this->history.load(); }
+
+private:
+    static constexpr const std::size_t MAX_DEPTH = 8;
+
+    struct Handler {
+        std::uint16_t sp;
+        Interrupt interrupt;
+    };
+
+    Frame current = {};
+    std::uint64_t frame_start = 0;
+    bool started = false;
+    Handler handlers[MAX_DEPTH] = {};
+    std::size_t depth = 0;
+
+    // Ring of finished frames (only touched by the emulator), copied out in order when published
+    Frame ring[HISTORY_FRAMES] = {};
+    std::size_t ring_next = 0;
+    std::size_t ring_count = 0;
+    Seqlock<History> history;
+};
+
+#endif
@@ -20,6 +20,15 @@
 #include <QGroupBox>
 #include <QScrollBar>
 #include <QMouseEvent>
+#include <QStatusBar>
+#include <QPushButton>
+#include <QComboBox>
+#include <QDialog>
+#include <QFileDialog>
+#include <QSpinBox>
+#include <QInputDialog>
+#include <QPainter>
+#include <limits>
 
 #include "debugger_break_and_trace_results_dialog.hpp"
 #include "gb_proxy.h"
@@ -41,6 +50,68 @@ private:
     Debugger *window;
 };
 
+// Per-frame CPU usage as a stacked bar per frame (newest on the right): each interrupt handler, then everything else
+// that ran, with time spent halted left empty
+class Debugger::CPUUsageGraph : public QWidget {
+public:
+    static constexpr const int BAR_WIDTH = 2;
+
+    CPUUsageGraph(QWidget *parent) : QWidget(parent) {
+        this->setFixedHeight(64);
+        this->setMinimumWidth(static_cast<int>(CPUUsageMeter::HISTORY_FRAMES) * BAR_WIDTH);
+    }
+
+    void set_history(const CPUUsageMeter::History &history) {
+        this->history = history;
+        this->update();
+    }
+
+    static QColor interrupt_color(std::size_t interrupt) {
+        static const QColor COLORS[CPUUsageMeter::InterruptCount] = {
+            QColor(0xE0, 0x40, 0x40), // vblank
+            QColor(0xE0, 0xA0, 0x20), // stat
+            QColor(0x40, 0xA0, 0xE0), // timer
+            QColor(0xA0, 0x60, 0xE0), // serial
+            QColor(0x40, 0xC0, 0x80)  // joypad
+        };
+        return COLORS[interrupt];
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override {
+        QPainter painter(this);
+        auto palette = this->palette();
+        painter.fillRect(this->rect(), palette.color(QPalette::Base));
+
+        auto height = this->height();
+        auto x = this->width() - static_cast<int>(this->history.count) * BAR_WIDTH;
+        for(std::size_t f = 0; f < this->history.count; f++, x += BAR_WIDTH) {
+            auto &frame = this->history.frames[f];
+            if(frame.cycles == 0) {
+                continue;
+            }
+
+            double scale = static_cast<double>(height) / frame.cycles;
+            auto running = static_cast<int>((frame.cycles - frame.halted_cycles) * scale);
+            painter.fillRect(x, height - running, BAR_WIDTH, running, palette.color(QPalette::Text));
+
+            int y = height;
+            for(std::size_t i = 0; i < CPUUsageMeter::InterruptCount; i++) {
+                auto h = static_cast<int>(frame.interrupt_cycles[i] * scale);
+                y -= h;
+                painter.fillRect(x, y, BAR_WIDTH, h, interrupt_color(i));
+            }
+        }
+
+        // Full frame
+        painter.setPen(palette.color(QPalette::Mid));
+        painter.drawRect(this->rect().adjusted(0, 0, -1, -1));
+    }
+
+private:
+    CPUUsageMeter::History history = {};
+};
+
 Debugger::Debugger(GameWindow *window) : game_window(window) {
     // Set the preferred font for the debugger
     this->table_font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
@@ -72,6 +143,28 @@ Debugger::Debugger(GameWindow *window) : game_window(window) {
     
     bar->addSeparator();
     
+    this->run_frames_button = bar->addAction("Run Frames...");
+    connect(this->run_frames_button, &QAction::triggered, this, &Debugger::action_run_frames);
+    
+    this->run_until_button = bar->addAction("Run Until...");
+    connect(this->run_until_button, &QAction::triggered, this, &Debugger::action_run_until);
+    
+    bar->addSeparator();
+    
+    this->reverse_step_button = bar->addAction("Reverse Step");
+    this->reverse_step_button->setEnabled(false);
+    connect(this->reverse_step_button, &QAction::triggered, this, [this]() { this->action_reverse(GameInstance::ReverseCommand::ReverseStep); });
+    
+    this->reverse_step_over_button = bar->addAction("Reverse Step Over");
+    this->reverse_step_over_button->setEnabled(false);
+    connect(this->reverse_step_over_button, &QAction::triggered, this, [this]() { this->action_reverse(GameInstance::ReverseCommand::ReverseNext); });
+    
+    this->reverse_continue_button = bar->addAction("Reverse Continue");
+    this->reverse_continue_button->setEnabled(false);
+    connect(this->reverse_continue_button, &QAction::triggered, this, [this]() { this->action_reverse(GameInstance::ReverseCommand::ReverseContinue); });
+    
+    bar->addSeparator();
+    
     this->clear_breakpoints_button = bar->addAction("Clear Breakpoints");
     this->clear_breakpoints_button->setEnabled(false);
     connect(this->clear_breakpoints_button, &QAction::triggered, this, &Debugger::action_clear_breakpoints);
@@ -138,6 +231,11 @@ Debugger::Debugger(GameWindow *window) : game_window(window) {
     flag_widget->setLayout(flag_layout);
     register_view_layout->addWidget(flag_widget);
 
+    this->cpu_state = new QLabel(register_view);
+    this->cpu_state->setFont(this->table_font);
+    this->cpu_state->setTextInteractionFlags(Qt::TextSelectableByMouse);
+    register_view_layout->addWidget(this->cpu_state);
+
 
     register_view->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
     right_view_layout->addWidget(register_view);
@@ -154,11 +252,192 @@ Debugger::Debugger(GameWindow *window) : game_window(window) {
     backtrace_frame->setLayout(backtrace_layout);
     right_view_layout->addWidget(backtrace_frame);
     
+    // Anything on the side view (but not in the right view) can be used while the game is running
+    auto *side_view = new QWidget(this);
+    auto *side_view_layout = new QVBoxLayout(side_view);
+    side_view_layout->setContentsMargins(0,0,0,0);
+    side_view->setLayout(side_view_layout);
+    side_view_layout->addWidget(this->right_view);
+
+    // Watch expressions
+    auto *watch_frame = new QGroupBox(side_view);
+    watch_frame->setTitle("Watch");
+    auto *watch_layout = new QVBoxLayout(watch_frame);
+    watch_frame->setLayout(watch_layout);
+
+    this->watch_table = new QTableWidget(watch_frame);
+    this->format_table(this->watch_table);
+    this->watch_table->setColumnCount(2);
+    this->watch_table->setColumnWidth(0, 150);
+    this->watch_table->setMinimumHeight(100);
+    connect(this->watch_table, &QTableWidget::itemSelectionChanged, this, [this]() {
+        this->remove_watch_button->setEnabled(this->watch_table->currentRow() >= 0);
+    });
+    watch_layout->addWidget(this->watch_table);
+
+    auto *watch_buttons = new QWidget(watch_frame);
+    auto *watch_buttons_layout = new QHBoxLayout(watch_buttons);
+    watch_buttons_layout->setContentsMargins(0,0,0,0);
+    watch_buttons->setLayout(watch_buttons_layout);
+
+    this->watch_input = new QLineEdit(watch_buttons);
+    this->watch_input->setPlaceholderText("Expression, e.g. [$C000] + a");
+    connect(this->watch_input, &QLineEdit::returnPressed, this, &Debugger::action_add_watch);
+    watch_buttons_layout->addWidget(this->watch_input);
+
+    this->remove_watch_button = new QPushButton("Remove", watch_buttons);
+    this->remove_watch_button->setEnabled(false);
+    connect(this->remove_watch_button, &QPushButton::clicked, this, &Debugger::action_remove_watch);
+    watch_buttons_layout->addWidget(this->remove_watch_button);
+
+    watch_layout->addWidget(watch_buttons);
+    watch_frame->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
+    side_view_layout->addWidget(watch_frame);
+
+    // Watchpoints
+    auto *watchpoint_frame = new QGroupBox(side_view);
+    watchpoint_frame->setTitle("Watchpoints");
+    auto *watchpoint_layout = new QVBoxLayout(watchpoint_frame);
+    watchpoint_frame->setLayout(watchpoint_layout);
+
+    this->watchpoints = new QTableWidget(watchpoint_frame);
+    this->format_table(this->watchpoints);
+    this->watchpoints->setColumnCount(1);
+    this->watchpoints->setMinimumHeight(100);
+    watchpoint_layout->addWidget(this->watchpoints);
+
+    auto *watchpoint_buttons = new QWidget(watchpoint_frame);
+    auto *watchpoint_buttons_layout = new QHBoxLayout(watchpoint_buttons);
+    watchpoint_buttons_layout->setContentsMargins(0,0,0,0);
+    watchpoint_buttons->setLayout(watchpoint_buttons_layout);
+
+    auto *add_watchpoint_button = new QPushButton("Add...", watchpoint_buttons);
+    connect(add_watchpoint_button, &QPushButton::clicked, this, &Debugger::action_add_watchpoint);
+    watchpoint_buttons_layout->addWidget(add_watchpoint_button);
+
+    this->remove_watchpoint_button = new QPushButton("Remove", watchpoint_buttons);
+    this->remove_watchpoint_button->setEnabled(false);
+    connect(this->remove_watchpoint_button, &QPushButton::clicked, this, &Debugger::action_remove_watchpoint);
+    watchpoint_buttons_layout->addWidget(this->remove_watchpoint_button);
+
+    this->clear_watchpoints_button = new QPushButton("Clear", watchpoint_buttons);
+    this->clear_watchpoints_button->setEnabled(false);
+    connect(this->clear_watchpoints_button, &QPushButton::clicked, this, &Debugger::action_clear_watchpoints);
+    watchpoint_buttons_layout->addWidget(this->clear_watchpoints_button);
+
+    watchpoint_layout->addWidget(watchpoint_buttons);
+    watchpoint_frame->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
+    side_view_layout->addWidget(watchpoint_frame);
+
+    // Sampling profiler
+    auto *profiler_frame = new QGroupBox(side_view);
+    profiler_frame->setTitle("Profiler");
+    auto *profiler_layout = new QVBoxLayout(profiler_frame);
+    profiler_frame->setLayout(profiler_layout);
+
+    auto *profiler_buttons = new QWidget(profiler_frame);
+    auto *profiler_buttons_layout = new QHBoxLayout(profiler_buttons);
+    profiler_buttons_layout->setContentsMargins(0,0,0,0);
+    profiler_buttons->setLayout(profiler_buttons_layout);
+
+    this->profiler_enabled = new QCheckBox("Sample", profiler_buttons);
+    connect(this->profiler_enabled, &QCheckBox::stateChanged, this, &Debugger::action_toggle_profiler);
+    profiler_buttons_layout->addWidget(this->profiler_enabled);
+    profiler_buttons_layout->addStretch(1);
+
+    auto *reset_profiler_button = new QPushButton("Reset", profiler_buttons);
+    connect(reset_profiler_button, &QPushButton::clicked, this, &Debugger::action_reset_profiler);
+    profiler_buttons_layout->addWidget(reset_profiler_button);
+
+    auto *export_profile_button = new QPushButton("Export...", profiler_buttons);
+    connect(export_profile_button, &QPushButton::clicked, this, &Debugger::action_export_profile);
+    profiler_buttons_layout->addWidget(export_profile_button);
+
+    profiler_layout->addWidget(profiler_buttons);
+
+    this->profiler_functions = new QTableWidget(profiler_frame);
+    this->format_table(this->profiler_functions);
+    this->profiler_functions->setColumnCount(1);
+    this->profiler_functions->setMinimumHeight(150);
+    this->profiler_functions->setToolTip("Top functions (self %, total %, name). Double-click to go to one.");
+    connect(this->profiler_functions, &QTableWidget::cellDoubleClicked, this, [this](int row, int) {
+        auto *item = this->profiler_functions->item(row, 0);
+        if(item) {
+            this->disassembler->go_to(static_cast<std::uint16_t>(item->data(Qt::UserRole).toUInt()));
+        }
+    });
+    profiler_layout->addWidget(this->profiler_functions);
+
+    this->profiler_sample_count = new QLabel(profiler_frame);
+    profiler_layout->addWidget(this->profiler_sample_count);
+
+    profiler_frame->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
+    side_view_layout->addWidget(profiler_frame);
+
+    // CPU usage
+    auto *cpu_usage_frame = new QGroupBox(side_view);
+    cpu_usage_frame->setTitle("CPU Usage");
+    auto *cpu_usage_layout = new QVBoxLayout(cpu_usage_frame);
+    cpu_usage_frame->setLayout(cpu_usage_layout);
+
+    this->cpu_usage_enabled = new QCheckBox("Measure", cpu_usage_frame);
+    connect(this->cpu_usage_enabled, &QCheckBox::stateChanged, this, &Debugger::action_toggle_cpu_usage);
+    cpu_usage_layout->addWidget(this->cpu_usage_enabled);
+
+    this->cpu_usage_graph = new CPUUsageGraph(cpu_usage_frame);
+    this->cpu_usage_graph->setToolTip("Share of each frame spent running (bottom to top: VBlank, STAT, timer, serial, and joypad handlers, then everything else). The rest was spent halted.");
+    cpu_usage_layout->addWidget(this->cpu_usage_graph);
+
+    this->cpu_usage_summary = new QLabel(cpu_usage_frame);
+    this->cpu_usage_summary->setFont(this->table_font);
+    cpu_usage_layout->addWidget(this->cpu_usage_summary);
+
+    cpu_usage_frame->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
+    side_view_layout->addWidget(cpu_usage_frame);
+
+    // Time travel
+    auto *time_travel_frame = new QGroupBox(side_view);
+    time_travel_frame->setTitle("Time Travel");
+    auto *time_travel_layout = new QGridLayout(time_travel_frame);
+    time_travel_frame->setLayout(time_travel_layout);
+
+    this->time_travel_enabled = new QCheckBox("Record history", time_travel_frame);
+    this->time_travel_enabled->setToolTip("Keep history so the reverse buttons can go back through it");
+    connect(this->time_travel_enabled, &QCheckBox::stateChanged, this, &Debugger::action_toggle_time_travel);
+    time_travel_layout->addWidget(this->time_travel_enabled, 0, 0, 1, 2);
+
+    time_travel_layout->addWidget(new QLabel("Keyframe every:", time_travel_frame), 1, 0);
+    this->time_travel_interval = new QSpinBox(time_travel_frame);
+    this->time_travel_interval->setRange(1, 1024);
+    this->time_travel_interval->setValue(16);
+    this->time_travel_interval->setSuffix("K instructions");
+    this->time_travel_interval->setToolTip("Shorter intervals make going back faster, but less history fits in memory");
+    connect(this->time_travel_interval, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &Debugger::action_update_time_travel_settings);
+    time_travel_layout->addWidget(this->time_travel_interval, 1, 1);
+
+    time_travel_layout->addWidget(new QLabel("Memory limit:", time_travel_frame), 2, 0);
+    this->time_travel_memory_limit = new QSpinBox(time_travel_frame);
+    this->time_travel_memory_limit->setRange(1, 4096);
+    this->time_travel_memory_limit->setValue(64);
+    this->time_travel_memory_limit->setSuffix(" MiB");
+    connect(this->time_travel_memory_limit, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &Debugger::action_update_time_travel_settings);
+    time_travel_layout->addWidget(this->time_travel_memory_limit, 2, 1);
+
+    this->time_travel_status = new QLabel(time_travel_frame);
+    time_travel_layout->addWidget(this->time_travel_status, 3, 0, 1, 2);
+
+    time_travel_frame->setSizePolicy(QSizePolicy::Policy::Expanding, QSizePolicy::Policy::Fixed);
+    side_view_layout->addWidget(time_travel_frame);
+
     // Done
-    layout->addWidget(this->right_view);
-    this->right_view->setMaximumWidth(300);
-    this->right_view->setMinimumWidth(300);
+    layout->addWidget(side_view);
+    side_view->setMaximumWidth(300);
+    side_view->setMinimumWidth(300);
     this->right_view->setEnabled(false);
+
+    // Show how long steps take to come back
+    this->step_latency_label = new QLabel(this);
+    this->statusBar()->addPermanentWidget(this->step_latency_label);
     
     this->setWindowTitle("Debugger");
 }
@@ -187,6 +466,47 @@ void Debugger::action_finish() {
     this->set_known_breakpoint(false);
 }
 
+void Debugger::action_run_frames() {
+    bool ok;
+    auto frames = QInputDialog::getInt(this, "Run Frames", "Frames to run before breaking:", this->run_frames_count, 1, std::numeric_limits<int>::max(), 1, &ok);
+    if(!ok) {
+        return;
+    }
+
+    this->run_frames_count = frames;
+    this->get_instance().run_frames(static_cast<std::uint32_t>(frames));
+    this->set_known_breakpoint(false);
+}
+
+void Debugger::action_run_until() {
+    while(true) {
+        bool ok;
+        auto condition = QInputDialog::getText(this, "Run Until", "Break before the first instruction where this is true (e.g. [$FF44] == 144 && a == 0):", QLineEdit::Normal, this->run_until_condition, &ok).trimmed();
+        if(!ok || condition.isEmpty()) {
+            return;
+        }
+
+        this->run_until_condition = condition;
+
+        std::string error;
+        if(!this->get_instance().run_until(condition.toStdString(), error)) {
+            QMessageBox(QMessageBox::Icon::Critical, "Invalid Condition", QString::fromStdString(error), QMessageBox::StandardButton::Ok).exec();
+            continue;
+        }
+
+        this->set_known_breakpoint(false);
+        return;
+    }
+}
+
+void Debugger::action_reverse(GameInstance::ReverseCommand command) {
+    if(!this->get_instance().reverse(command)) {
+        this->statusBar()->showMessage(this->time_travel_enabled->isChecked() ? "There is no history to go back through yet." : "Turn on Record history under Time Travel to go back.");
+        return;
+    }
+    this->set_known_breakpoint(false);
+}
+
 void Debugger::set_known_breakpoint(bool known_breakpoint) {
     if(this->known_breakpoint != known_breakpoint) {
         this->known_breakpoint = known_breakpoint;
@@ -196,6 +516,9 @@ void Debugger::set_known_breakpoint(bool known_breakpoint) {
         this->step_button->setEnabled(known_breakpoint);
         this->step_over_button->setEnabled(known_breakpoint);
         this->finish_fn_button->setEnabled(known_breakpoint);
+        this->reverse_step_button->setEnabled(known_breakpoint);
+        this->reverse_step_over_button->setEnabled(known_breakpoint);
+        this->reverse_continue_button->setEnabled(known_breakpoint);
         
         if(known_breakpoint) {
             this->disassembler->go_to(this->get_instance().get_register_value(GameInstance::SM83Register::SM83_REG_PC));
@@ -203,8 +526,8 @@ void Debugger::set_known_breakpoint(bool known_breakpoint) {
     }
 }
 
-void Debugger::refresh_flags() {
-    auto f = this->get_instance().get_register_value(GameInstance::SM83Register::SM83_REG_F);
+void Debugger::refresh_flags(const GameInstance::DebugSnapshot &snapshot) {
+    auto f = snapshot.af & 0xFF;
 
     #define PROCESS_FLAG_FIELD(field, flag) {\
         this->field->blockSignals(true); \
@@ -220,27 +543,45 @@ void Debugger::refresh_flags() {
     #undef PROCESS_FLAG_FIELD
 }
 
-void Debugger::refresh_registers() {
-    auto &instance = this->get_instance();
-
+void Debugger::refresh_registers(const GameInstance::DebugSnapshot &snapshot) {
     #define PROCESS_REGISTER_FIELD(name, field, fmt) {\
         char str[8]; \
-        std::snprintf(str, sizeof(str), fmt, instance.get_register_value(GameInstance::SM83Register::SM83_REG_##name)); \
+        std::snprintf(str, sizeof(str), fmt, snapshot.name); \
         this->field->blockSignals(true); \
         this->field->setText(str); \
         this->field->blockSignals(false); \
     }
 
-    PROCESS_REGISTER_FIELD(AF, register_af, "$%04x");
-    PROCESS_REGISTER_FIELD(BC, register_bc, "$%04x");
-    PROCESS_REGISTER_FIELD(DE, register_de, "$%04x");
-    PROCESS_REGISTER_FIELD(HL, register_hl, "$%04x");
-    PROCESS_REGISTER_FIELD(SP, register_sp, "$%04x");
-    PROCESS_REGISTER_FIELD(PC, register_pc, "$%04x");
+    PROCESS_REGISTER_FIELD(af, register_af, "$%04x");
+    PROCESS_REGISTER_FIELD(bc, register_bc, "$%04x");
+    PROCESS_REGISTER_FIELD(de, register_de, "$%04x");
+    PROCESS_REGISTER_FIELD(hl, register_hl, "$%04x");
+    PROCESS_REGISTER_FIELD(sp, register_sp, "$%04x");
+    PROCESS_REGISTER_FIELD(pc, register_pc, "$%04x");
 
     #undef PROCESS_REGISTER_FIELD
 }
 
+void Debugger::refresh_cpu_state(const GameInstance::DebugSnapshot &snapshot) {
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "IME %u%s  IE $%02x  IF $%02x\n"
+                  "LCDC $%02x  STAT $%02x  LY %u\n"
+                  "ROM $%03x:$%03x  VRAM %u  SRAM $%02x  WRAM %u\n"
+                  "Frame %u  Cycle %llu",
+                  snapshot.ime, snapshot.halted ? " (halted)" : "", snapshot.interrupt_enable, snapshot.interrupt_flags,
+                  snapshot.lcdc, snapshot.stat, snapshot.ly,
+                  snapshot.banks.rom0, snapshot.banks.romx, snapshot.banks.vram, snapshot.banks.sram, snapshot.banks.wram,
+                  snapshot.frame, static_cast<unsigned long long>(snapshot.cycle));
+    this->cpu_state->setText(text);
+}
+
+void Debugger::go_to_address(std::uint16_t address) {
+    this->show();
+    this->activateWindow();
+    this->disassembler->go_to(address);
+}
+
 void Debugger::refresh_view() {
     // If we aren't visible, go away
     if(!this->isVisible()) {
@@ -249,37 +590,71 @@ void Debugger::refresh_view() {
     
     auto &instance = this->get_instance();
     bool bp_pause = instance.is_paused_from_breakpoint();
+
+    // Only query things that changed since we last looked. Checking this does not lock anything, so an idle debugger costs nothing.
+    auto generations = instance.get_generations();
+    if(generations.breakpoints != this->shown_generations.breakpoints) {
+        this->breakpoints_copy = instance.get_breakpoints();
+        this->clear_breakpoints_button->setEnabled(this->breakpoints_copy.size() > 0);
+        this->shown_generations.breakpoints = generations.breakpoints;
+    }
     
     this->disassembler->refresh_view();
-    this->breakpoints_copy = instance.get_breakpoints();
-    this->clear_breakpoints_button->setEnabled(this->breakpoints_copy.size() > 0);
-    this->backtrace_copy = instance.get_backtrace();
 
-    // Update debugger at 20 Hz
+    // Update the profiler once a second since totaling everything up isn't free
     auto now = std::chrono::steady_clock::now();
+    if(this->profiler_enabled->isChecked() && now - this->last_profiler_update >= std::chrono::seconds(1)) {
+        this->refresh_profiler();
+    }
+
+    // Update debugger at 20 Hz
     if(now - this->last_update < std::chrono::milliseconds(1000 / 20)) {
         return;
     }
     this->last_update = now;
 
+    // Everything in here is from the same point in time, even if the game is running
+    auto snapshot = instance.get_debug_snapshot();
+    this->refresh_cpu_state(snapshot);
+
+    this->refresh_watches();
+
+    if(this->cpu_usage_enabled->isChecked()) {
+        this->refresh_cpu_usage();
+    }
+
+    if(this->time_travel_enabled->isChecked()) {
+        this->refresh_time_travel();
+    }
+
     // If paused from breakpoint, update this information
     if(bp_pause) {
-        this->refresh_registers();
-        this->refresh_flags();
-
-        int row = 0;
-        this->backtrace->setRowCount(this->backtrace_copy.size());
-        for(auto &l : this->backtrace_copy) {
-            auto l_trimmed = QString::fromStdString(l.first).trimmed();
-            if(l_trimmed.isEmpty()) {
-                continue;
+        if(generations.registers != this->shown_generations.registers) {
+            this->refresh_registers(snapshot);
+            this->refresh_flags(snapshot);
+            this->refresh_step_latency();
+            this->refresh_watchpoint_hit();
+            this->shown_generations.registers = generations.registers;
+        }
+
+        if(generations.backtrace != this->shown_generations.backtrace) {
+            this->backtrace_copy = instance.get_backtrace();
+            this->shown_generations.backtrace = generations.backtrace;
+
+            int row = 0;
+            this->backtrace->setRowCount(this->backtrace_copy.size());
+            for(auto &l : this->backtrace_copy) {
+                auto l_trimmed = QString::fromStdString(l.first).trimmed();
+                if(l_trimmed.isEmpty()) {
+                    continue;
+                }
+                auto *item = new QTableWidgetItem(l_trimmed);
+                item->setToolTip(l_trimmed);
+                item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+                this->backtrace->setItem(row, 0, item);
+                item->setData(Qt::UserRole, l.second);
+                row++;
             }
-            auto *item = new QTableWidgetItem(l_trimmed);
-            item->setToolTip(l_trimmed);
-            item->setFlags(item->flags() & ~Qt::ItemIsEditable);
-            this->backtrace->setItem(row, 0, item);
-            item->setData(Qt::UserRole, l.second);
-            row++;
         }
     }
     
@@ -293,6 +668,7 @@ void Debugger::refresh_view() {
         if(instance.break_and_trace_results_ready()) {
             auto bnt = instance.pop_break_and_trace_results().value();
             std::vector<ProcessedBNTResult> results;
+            results.reserve(bnt.size());
 
             // Strip address pointer, newlines, and comment from instruction
             for(auto &b : bnt) {
@@ -305,6 +681,7 @@ void Debugger::refresh_view() {
                 d_second_to_last = d_second_to_last.mid(d_second_to_last.indexOf(":") + 1);
                 d_second_to_last = d_second_to_last.mid(0, d_second_to_last.indexOf(" ;")).trimmed();
                 r.instruction = d_second_to_last.toStdString();
+                r.disassembly = {}; // the full disassembly isn't needed past this point
 
                 auto comma_index = d_second_to_last.indexOf(",");
 
@@ -324,9 +701,9 @@ void Debugger::refresh_view() {
                             condition = d_second_to_last.replace("RET ", "").toLower();
                         }
 
-                        auto condition_met = (condition == "z" && r.zero) &&
-                                             (condition == "nz" && !r.zero) &&
-                                             (condition == "c" && r.carry) &&
+                        auto condition_met = (condition == "z" && r.zero) ||
+                                             (condition == "nz" && !r.zero) ||
+                                             (condition == "c" && r.carry) ||
                                              (condition == "nc" && !r.carry);
                         if(!condition_met) {
                             is_call = false;
@@ -344,29 +721,10 @@ void Debugger::refresh_view() {
             }
 
             // Turn it into a 2D thing
-            ProcessedBNTResultNode::directory_t top_directory;
-            std::vector<ProcessedBNTResultNode::directory_t *> trace = { &top_directory };
-
-            for(auto &r : results) {
-                auto *current_directory = trace[trace.size() - 1];
-                auto &d = current_directory->emplace_back();
-                d.result = r;
-
-                if(r.direction == 1) {
-                    trace.emplace_back(&d.children);
-                }
-                else if(r.direction == -1) {
-                    trace.erase(trace.begin() + (trace.size() - 1));
+            ProcessedBNTResultTree tree;
+            tree.build(std::move(results));
 
-                    // Make a new top directory if we returned to a higher level than we breakpoint
-                    if(trace.size() == 0) {
-                        top_directory = { top_directory };
-                        trace = { &top_directory };
-                    }
-                }
-            }
-
-            auto *dialog = new BreakAndTraceResultsDialog(this, this, std::move(top_directory));
+            auto *dialog = new BreakAndTraceResultsDialog(this, this, std::move(tree));
             dialog->show();
 
             instance.clear_all_button_states();
@@ -376,6 +734,469 @@ void Debugger::refresh_view() {
     this->set_known_breakpoint(bp_pause);
 }
 
+void Debugger::ProcessedBNTResultTree::build(std::vector<ProcessedBNTResult> &&results) {
+    this->nodes.clear();
+    this->nodes.reserve(results.size());
+    this->first_root = NO_NODE;
+
+    // Each level we're in, and the last node added to it
+    std::vector<std::uint32_t> parents = { NO_NODE };
+    std::vector<std::uint32_t> last_children = { NO_NODE };
+
+    for(auto &r : results) {
+        auto index = static_cast<std::uint32_t>(this->nodes.size());
+        auto &node = this->nodes.emplace_back();
+        node.result = std::move(r);
+        node.parent = parents.back();
+        node.depth = static_cast<std::uint32_t>(parents.size() - 1);
+
+        auto previous = last_children.back();
+        if(previous != NO_NODE) {
+            this->nodes[previous].next_sibling = index;
+            node.row = this->nodes[previous].row + 1;
+        }
+        else if(node.parent != NO_NODE) {
+            this->nodes[node.parent].first_child = index;
+        }
+        else {
+            this->first_root = index;
+        }
+        last_children.back() = index;
+
+        if(node.result.direction == 1) {
+            parents.emplace_back(index);
+            last_children.emplace_back(NO_NODE);
+        }
+
+        // If we returned to a higher level than we breakpointed at, just keep going at the top level
+        else if(node.result.direction == -1 && parents.size() > 1) {
+            parents.pop_back();
+            last_children.pop_back();
+        }
+    }
+}
+
+void Debugger::refresh_step_latency() {
+    auto latency = this->get_instance().get_step_latency();
+    if(latency.count == 0) {
+        this->step_latency_label->clear();
+        return;
+    }
+
+    char text[128];
+    std::snprintf(text, sizeof(text), "Step latency: %.3f ms (average %.3f ms over %zu steps)",
+                  latency.last.count() / 1000000.0,
+                  latency.average.count() / 1000000.0,
+                  latency.count);
+    this->step_latency_label->setText(text);
+}
+
+void Debugger::refresh_watchpoint_hit() {
+    auto hit = this->get_instance().get_last_watchpoint_hit();
+    if(!hit.has_value() || hit->hit_number == this->shown_watchpoint_hit) {
+        return;
+    }
+    this->shown_watchpoint_hit = hit->hit_number;
+
+    char message[128];
+    std::snprintf(message, sizeof(message), "Watchpoint hit: %s $%02x %s $%04x (PC = $%04x)",
+                  hit->type == GameInstance::WatchpointType::WatchpointRead ? "read" : "wrote",
+                  hit->value,
+                  hit->type == GameInstance::WatchpointType::WatchpointRead ? "from" : "to",
+                  hit->address,
+                  hit->pc);
+    this->statusBar()->showMessage(message);
+}
+
+void Debugger::refresh_watchpoints() {
+    auto watchpoints = this->get_instance().get_watchpoints();
+
+    this->watchpoints->clear();
+    this->watchpoints->setRowCount(static_cast<int>(watchpoints.size()));
+
+    int row = 0;
+    for(auto &w : watchpoints) {
+        char text[128];
+        int length;
+
+        static const char *TYPE_NAMES[] = { "", "R", "W", "RW" };
+        if(w.start == w.end) {
+            length = std::snprintf(text, sizeof(text), "%-2s $%04x", TYPE_NAMES[w.type], w.start);
+        }
+        else {
+            length = std::snprintf(text, sizeof(text), "%-2s $%04x-$%04x", TYPE_NAMES[w.type], w.start, w.end);
+        }
+
+        if(w.value.has_value()) {
+            length += std::snprintf(text + length, sizeof(text) - length, " = $%02x", *w.value);
+        }
+        if(w.trace_count > 0) {
+            std::snprintf(text + length, sizeof(text) - length, " (trace %zu)", w.trace_count);
+        }
+
+        auto *item = new QTableWidgetItem(text);
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        this->watchpoints->setItem(row++, 0, item);
+    }
+
+    this->remove_watchpoint_button->setEnabled(!watchpoints.empty());
+    this->clear_watchpoints_button->setEnabled(!watchpoints.empty());
+}
+
+void Debugger::action_add_watchpoint() {
+    QDialog dialog;
+    dialog.setWindowTitle("Add Watchpoint");
+    dialog.setFixedWidth(400);
+
+    auto *layout = new QVBoxLayout(&dialog);
+    dialog.setLayout(layout);
+
+    auto *input_grid_w = new QWidget(&dialog);
+    auto *input_grid = new QGridLayout(input_grid_w);
+    input_grid->setContentsMargins(0,0,0,0);
+    input_grid_w->setLayout(input_grid);
+
+    int row = 0;
+    auto add_line_edit = [&input_grid, &input_grid_w, &row](const char *name, const char *default_text) {
+        input_grid->addWidget(new QLabel(name, input_grid_w), row, 0);
+        auto *edit = new QLineEdit(input_grid_w);
+        edit->setText(default_text);
+        input_grid->addWidget(edit, row++, 1);
+        return edit;
+    };
+
+    auto *start = add_line_edit("Start Address:", "$c000");
+    auto *end = add_line_edit("End Address:", "");
+    end->setPlaceholderText("(same as start)");
+
+    input_grid->addWidget(new QLabel("Type:", input_grid_w), row, 0);
+    auto *type = new QComboBox(input_grid_w);
+    type->addItem("Write", GameInstance::WatchpointType::WatchpointWrite);
+    type->addItem("Read", GameInstance::WatchpointType::WatchpointRead);
+    type->addItem("Read/Write", GameInstance::WatchpointType::WatchpointAccess);
+    input_grid->addWidget(type, row++, 1);
+
+    auto *value = add_line_edit("Value:", "");
+    value->setPlaceholderText("(any)");
+
+    auto *trace_count = add_line_edit("Trace Count:", "0");
+
+    input_grid->addWidget(new QLabel("Trace Step Over:", input_grid_w), row, 0);
+    auto *step_over = new QCheckBox(input_grid_w);
+    step_over->setMinimumHeight(trace_count->sizeHint().height());
+    input_grid->addWidget(step_over, row++, 1);
+
+    input_grid->addWidget(new QLabel("Break When Done Tracing:", input_grid_w), row, 0);
+    auto *break_when_done = new QCheckBox(input_grid_w);
+    break_when_done->setMinimumHeight(trace_count->sizeHint().height());
+    input_grid->addWidget(break_when_done, row++, 1);
+
+    layout->addWidget(input_grid_w);
+
+    auto *ok_button_row = new QWidget(&dialog);
+    layout->addWidget(ok_button_row);
+    auto *ok_button_row_l = new QHBoxLayout(ok_button_row);
+    ok_button_row_l->setContentsMargins(0,0,0,0);
+    ok_button_row->setLayout(ok_button_row_l);
+    ok_button_row_l->addStretch(1);
+
+    auto *ok_button = new QPushButton("OK", ok_button_row);
+    ok_button_row_l->addWidget(ok_button);
+    connect(ok_button, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(start, &QLineEdit::returnPressed, &dialog, &QDialog::accept);
+
+    start->selectAll();
+
+    auto &instance = this->get_instance();
+    auto evaluate = [&instance](QLineEdit *edit) -> std::optional<std::uint16_t> {
+        auto text = edit->text().toUtf8();
+        auto result = instance.evaluate_expression(text.data());
+        if(!result.has_value()) {
+            char error_message[512];
+            std::snprintf(error_message, sizeof(error_message), "An invalid expression `%s` was given. Check your input and try again.", text.data());
+            QMessageBox(QMessageBox::Icon::Critical, "Invalid Expression", error_message, QMessageBox::StandardButton::Ok).exec();
+        }
+        return result;
+    };
+
+    // Keep asking until the user enters something valid or gives up
+    while(dialog.exec() == QDialog::Accepted) {
+        GameInstance::Watchpoint watchpoint = {};
+
+        auto start_maybe = evaluate(start);
+        if(!start_maybe.has_value()) {
+            continue;
+        }
+        watchpoint.start = *start_maybe;
+        watchpoint.end = *start_maybe;
+
+        if(!end->text().trimmed().isEmpty()) {
+            auto end_maybe = evaluate(end);
+            if(!end_maybe.has_value()) {
+                continue;
+            }
+            watchpoint.end = *end_maybe;
+        }
+
+        if(!value->text().trimmed().isEmpty()) {
+            auto value_maybe = evaluate(value);
+            if(!value_maybe.has_value()) {
+                continue;
+            }
+            watchpoint.value = static_cast<std::uint8_t>(*value_maybe);
+        }
+
+        auto trace_count_maybe = evaluate(trace_count);
+        if(!trace_count_maybe.has_value()) {
+            continue;
+        }
+
+        watchpoint.type = static_cast<GameInstance::WatchpointType>(type->currentData().toInt());
+        watchpoint.trace_count = *trace_count_maybe;
+        watchpoint.trace_step_over = step_over->isChecked();
+        watchpoint.trace_break_when_done = break_when_done->isChecked();
+
+        instance.add_watchpoint(watchpoint);
+        this->refresh_watchpoints();
+        break;
+    }
+}
+
+void Debugger::action_remove_watchpoint() {
+    auto row = this->watchpoints->currentRow();
+    if(row < 0) {
+        return;
+    }
+    this->get_instance().remove_watchpoint(static_cast<std::size_t>(row));
+    this->refresh_watchpoints();
+}
+
+void Debugger::action_clear_watchpoints() {
+    this->get_instance().remove_all_watchpoints();
+    this->refresh_watchpoints();
+}
+
+void Debugger::action_add_watch() {
+    auto text = this->watch_input->text().trimmed();
+    if(text.isEmpty()) {
+        return;
+    }
+    this->watch_expressions.emplace_back(text.toStdString());
+    this->watch_input->clear();
+    this->update_watch_expressions();
+}
+
+void Debugger::action_remove_watch() {
+    auto row = this->watch_table->currentRow();
+    if(row < 0 || static_cast<std::size_t>(row) >= this->watch_expressions.size()) {
+        return;
+    }
+    this->watch_expressions.erase(this->watch_expressions.begin() + row);
+    this->update_watch_expressions();
+}
+
+void Debugger::update_watch_expressions() {
+    this->watch_errors = this->get_instance().set_watch_expressions(this->watch_expressions);
+
+    auto count = static_cast<int>(this->watch_expressions.size());
+    this->watch_table->clear();
+    this->watch_table->setRowCount(count);
+    for(int i = 0; i < count; i++) {
+        auto *expression = new QTableWidgetItem(QString::fromStdString(this->watch_expressions[i]));
+        expression->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        this->watch_table->setItem(i, 0, expression);
+
+        auto *value = new QTableWidgetItem(QString::fromStdString(this->watch_errors[i]));
+        value->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
+        value->setToolTip(value->text());
+        this->watch_table->setItem(i, 1, value);
+    }
+    this->remove_watch_button->setEnabled(this->watch_table->currentRow() >= 0);
+
+    this->shown_watch_generation = 0;
+    this->refresh_watches();
+}
+
+void Debugger::refresh_watches() {
+    // This doesn't lock anything, so it's fine to do as often as we like
+    auto &values = this->get_instance().get_watch_values();
+    if(values.generation == this->shown_watch_generation) {
+        return;
+    }
+    this->shown_watch_generation = values.generation;
+
+    auto count = std::min(values.values.size(), static_cast<std::size_t>(this->watch_table->rowCount()));
+    for(std::size_t i = 0; i < count; i++) {
+        auto &value = values.values[i];
+        auto *item = this->watch_table->item(static_cast<int>(i), 1);
+        if(!item || !value.has_value()) {
+            continue;
+        }
+
+        char text[64];
+        auto v = *value;
+        if(v >= 0 && v <= 0xFF) {
+            std::snprintf(text, sizeof(text), "$%02X (%i)", v, v);
+        }
+        else if(v >= 0 && v <= 0xFFFF) {
+            std::snprintf(text, sizeof(text), "$%04X (%i)", v, v);
+        }
+        else {
+            std::snprintf(text, sizeof(text), "%i", v);
+        }
+        item->setText(text);
+    }
+}
+
+void Debugger::action_toggle_profiler() {
+    this->get_instance().set_sampling_profiler_enabled(this->profiler_enabled->isChecked());
+    this->refresh_profiler();
+}
+
+void Debugger::action_toggle_cpu_usage() {
+    this->get_instance().set_cpu_usage_enabled(this->cpu_usage_enabled->isChecked());
+    this->refresh_cpu_usage();
+}
+
+void Debugger::refresh_cpu_usage() {
+    auto history = this->get_instance().get_cpu_usage();
+    this->cpu_usage_graph->set_history(history);
+
+    if(history.count == 0) {
+        this->cpu_usage_summary->setText(this->cpu_usage_enabled->isChecked() ? "Waiting for a frame..." : "");
+        return;
+    }
+
+    // Average over the last second or so
+    static constexpr const std::size_t AVERAGE_FRAMES = 60;
+    auto frames = std::min(history.count, AVERAGE_FRAMES);
+    std::uint64_t cycles = 0, halted = 0, interrupts[CPUUsageMeter::InterruptCount] = {};
+    double peak = 0.0;
+    for(std::size_t f = history.count - frames; f < history.count; f++) {
+        auto &frame = history.frames[f];
+        cycles += frame.cycles;
+        halted += frame.halted_cycles;
+        for(std::size_t i = 0; i < CPUUsageMeter::InterruptCount; i++) {
+            interrupts[i] += frame.interrupt_cycles[i];
+        }
+        peak = std::max(peak, frame.get_utilization());
+    }
+
+    double total = std::max(cycles, static_cast<std::uint64_t>(1));
+    char text[256];
+    std::snprintf(text, sizeof(text),
+                  "Busy %5.1f%% (peak %5.1f%%)\n"
+                  "VBL %4.1f%% STAT %4.1f%% TIM %4.1f%%\n"
+                  "SER %4.1f%% JOY %4.1f%%",
+                  (cycles - halted) * 100.0 / total, peak * 100.0,
+                  interrupts[CPUUsageMeter::InterruptVBlank] * 100.0 / total,
+                  interrupts[CPUUsageMeter::InterruptSTAT] * 100.0 / total,
+                  interrupts[CPUUsageMeter::InterruptTimer] * 100.0 / total,
+                  interrupts[CPUUsageMeter::InterruptSerial] * 100.0 / total,
+                  interrupts[CPUUsageMeter::InterruptJoypad] * 100.0 / total);
+    this->cpu_usage_summary->setText(text);
+}
+
+void Debugger::action_toggle_time_travel() {
+    this->action_update_time_travel_settings();
+    this->get_instance().set_time_travel_enabled(this->time_travel_enabled->isChecked());
+    this->refresh_time_travel();
+}
+
+void Debugger::action_update_time_travel_settings() {
+    this->get_instance().set_time_travel_settings(static_cast<std::uint32_t>(this->time_travel_interval->value()) * 1024,
+                                                  static_cast<std::size_t>(this->time_travel_memory_limit->value()) * 1024 * 1024);
+}
+
+void Debugger::refresh_time_travel() {
+    if(!this->time_travel_enabled->isChecked()) {
+        this->time_travel_status->clear();
+        return;
+    }
+
+    auto status = this->get_instance().get_time_travel_status();
+    char text[256];
+    if(status.reversing) {
+        std::snprintf(text, sizeof(text), "Going back...");
+    }
+    else {
+        std::snprintf(text, sizeof(text), "%zu keyframes (%.1f MiB)\n%llu instructions of history\nLast reverse: %.3f ms",
+                      status.keyframes,
+                      status.memory_usage / 1024.0 / 1024.0,
+                      static_cast<unsigned long long>(status.history),
+                      status.last_latency.count() / 1000000.0);
+    }
+    this->time_travel_status->setText(text);
+}
+
+void Debugger::action_reset_profiler() {
+    this->get_instance().clear_sampling_profile();
+    this->refresh_profiler();
+}
+
+void Debugger::action_export_profile() {
+    static const char *FOLDED_FILTER = "Folded Stacks for Flame Graphs (*.folded)";
+    static const char *FLAT_FILTER = "Flat Profile (*.txt)";
+    static const char *INCLUSIVE_FILTER = "Inclusive Profile (*.txt)";
+
+    QFileDialog file_dialog;
+    file_dialog.setFileMode(QFileDialog::FileMode::AnyFile);
+    file_dialog.setNameFilters(QStringList { FOLDED_FILTER, FLAT_FILTER, INCLUSIVE_FILTER });
+    file_dialog.setWindowTitle("Export Profile");
+    file_dialog.setAcceptMode(QFileDialog::AcceptSave);
+
+    if(file_dialog.exec() == QFileDialog::Accepted) {
+        auto output = std::filesystem::path(file_dialog.selectedFiles()[0].toStdString());
+        auto filter = file_dialog.selectedNameFilter();
+
+        auto type = SamplingProfiler::ReportType::ReportFolded;
+        if(filter == FLAT_FILTER) {
+            type = SamplingProfiler::ReportType::ReportFlat;
+        }
+        else if(filter == INCLUSIVE_FILTER) {
+            type = SamplingProfiler::ReportType::ReportInclusive;
+        }
+
+        auto &instance = this->get_instance();
+        auto symbols = instance.get_symbol_table();
+        if(!SamplingProfiler::write_report(instance.get_sampling_profile(), symbols.get(), type, output)) {
+            QMessageBox(QMessageBox::Icon::Critical, "Failed to save", QString("Failed to write ") + output.string().c_str() + ".").exec();
+        }
+    }
+}
+
+void Debugger::refresh_profiler() {
+    this->last_profiler_update = std::chrono::steady_clock::now();
+
+    auto &instance = this->get_instance();
+    auto profile = instance.get_sampling_profile();
+    auto symbols = instance.get_symbol_table();
+    auto functions = SamplingProfiler::get_function_stats(profile, symbols.get());
+
+    static constexpr const std::size_t TOP_FUNCTIONS = 10;
+    auto rows = std::min(functions.size(), TOP_FUNCTIONS);
+    double total = std::max(profile.total_samples, static_cast<std::uint64_t>(1));
+
+    this->profiler_functions->clear();
+    this->profiler_functions->setRowCount(static_cast<int>(rows));
+    for(std::size_t row = 0; row < rows; row++) {
+        auto &f = functions[row];
+
+        char text[256];
+        std::snprintf(text, sizeof(text), "%5.1f%% %5.1f%% %s", f.self_samples * 100.0 / total, f.inclusive_samples * 100.0 / total, f.name.c_str());
+
+        auto *item = new QTableWidgetItem(text);
+        item->setToolTip(text);
+        item->setData(Qt::UserRole, f.address);
+        item->setFlags(item->flags() & ~Qt::ItemIsEditable);
+        this->profiler_functions->setItem(static_cast<int>(row), 0, item);
+    }
+
+    char count[64];
+    std::snprintf(count, sizeof(count), "%llu samples", static_cast<unsigned long long>(profile.total_samples));
+    this->profiler_sample_count->setText(count);
+}
+
 void Debugger::action_clear_breakpoints() noexcept {
     this->get_instance().remove_all_breakpoints();
 }
@@ -403,12 +1224,14 @@ void Debugger::action_update_registers() noexcept {
     
     #undef PROCESS_REGISTER_FIELD
 
-    this->refresh_flags();
+    this->refresh_flags(instance.get_debug_snapshot());
 }
 
 void Debugger::closeEvent(QCloseEvent *) {
     this->disassembler->clear();
+    this->disassembler->invalidate();
     this->backtrace->clear();
+    this->shown_generations = {};
 }
 
 Debugger::~Debugger() {}
@@ -448,5 +1271,5 @@ void Debugger::action_register_flag_state_changed(int) noexcept {
     #undef SET_FLAG_IF_CHECKED
     instance.set_register_value(GameInstance::SM83Register::SM83_REG_F, f);
 
-    this->refresh_registers();
+    this->refresh_registers(instance.get_debug_snapshot());
 }
@@ -18,6 +18,9 @@ class QLineEdit;
 class GameWindow;
 class QTableWidget;
 class QCheckBox;
+class QLabel;
+class QPushButton;
+class QSpinBox;
 
 class Debugger : public QMainWindow {
     Q_OBJECT
@@ -29,11 +32,30 @@ public:
         char direction = 0; // -1 = return; 1 = call; 0 = next instruction
     };
 
-    struct ProcessedBNTResultNode {
-        using directory_t = std::list<ProcessedBNTResultNode>;
+    // Trace results as a tree (calls are parents of everything run until they return), stored flat in trace order
+    struct ProcessedBNTResultTree {
+        static constexpr const std::uint32_t NO_NODE = UINT32_MAX;
 
-        ProcessedBNTResult result;
-        directory_t children;
+        struct Node {
+            ProcessedBNTResult result;
+
+            std::uint32_t parent = NO_NODE;
+            std::uint32_t first_child = NO_NODE;
+            std::uint32_t next_sibling = NO_NODE;
+
+            std::uint32_t row = 0;   // index among siblings
+            std::uint32_t depth = 0; // number of parents
+        };
+
+        std::vector<Node> nodes;
+        std::uint32_t first_root = NO_NODE;
+
+        /**
+         * Build the tree from trace results
+         *
+         * @param results results in trace order
+         */
+        void build(std::vector<ProcessedBNTResult> &&results);
     };
 
     Debugger(GameWindow *window);
@@ -58,6 +80,13 @@ public:
     
     /** Refresh the information in view */
     void refresh_view();
+
+    /**
+     * Show the debugger and disassemble at an address
+     *
+     * @param address address to go to
+     */
+    void go_to_address(std::uint16_t address);
 private:
     DebuggerDisassembler *disassembler;
     
@@ -67,10 +96,17 @@ private:
     // Copy of breakpoints and backtrace
     std::vector<std::pair<std::string, std::uint16_t>> backtrace_copy;
     std::vector<std::uint16_t> breakpoints_copy;
+
+    // Generations of what we're currently showing (zero = not queried yet)
+    GameInstance::Generations shown_generations = {};
     
     // Did we check if breakpoint
     bool known_breakpoint = false;
     void set_known_breakpoint(bool known_breakpoint);
+
+    // Last values used for Run Frames and Run Until
+    int run_frames_count = 1;
+    QString run_until_condition;
     
     // Set the preferred font for the debugger
     QFont table_font;
@@ -80,12 +116,16 @@ private:
     void action_step();
     void action_step_over();
     void action_finish();
+    void action_run_frames();
+    void action_run_until();
+    void action_reverse(GameInstance::ReverseCommand command);
     void action_clear_breakpoints() noexcept;
     void action_update_registers() noexcept;
     void action_register_flag_state_changed(int) noexcept;
 
-    void refresh_registers();
-    void refresh_flags();
+    void refresh_registers(const GameInstance::DebugSnapshot &snapshot);
+    void refresh_flags(const GameInstance::DebugSnapshot &snapshot);
+    void refresh_cpu_state(const GameInstance::DebugSnapshot &snapshot);
     
     QWidget *right_view;
     
@@ -94,12 +134,71 @@ private:
     QAction *step_button;
     QAction *step_over_button;
     QAction *finish_fn_button;
+    QAction *run_frames_button;
+    QAction *run_until_button;
+    QAction *reverse_step_button;
+    QAction *reverse_step_over_button;
+    QAction *reverse_continue_button;
     QAction *clear_breakpoints_button;
     
     QLineEdit *register_af, *register_bc, *register_de, *register_hl, *register_sp, *register_pc;
     QCheckBox *flag_carry, *flag_half_carry, *flag_subtract, *flag_zero;
+    QLabel *cpu_state;
     BacktraceTable *backtrace;
     GameWindow *game_window;
+
+    QLabel *step_latency_label;
+    void refresh_step_latency();
+
+    // Watch expressions
+    QTableWidget *watch_table;
+    QLineEdit *watch_input;
+    QPushButton *remove_watch_button;
+    std::vector<std::string> watch_expressions;
+    std::vector<std::string> watch_errors;
+    std::uint64_t shown_watch_generation = 0;
+    void action_add_watch();
+    void action_remove_watch();
+    void update_watch_expressions();
+    void refresh_watches();
+
+    // Watchpoints
+    QTableWidget *watchpoints;
+    QPushButton *remove_watchpoint_button;
+    QPushButton *clear_watchpoints_button;
+    std::uint64_t shown_watchpoint_hit = 0;
+    void action_add_watchpoint();
+    void action_remove_watchpoint();
+    void action_clear_watchpoints();
+    void refresh_watchpoints();
+    void refresh_watchpoint_hit();
+
+    // Sampling profiler
+    QCheckBox *profiler_enabled;
+    QTableWidget *profiler_functions;
+    QLabel *profiler_sample_count;
+    std::chrono::steady_clock::time_point last_profiler_update = {};
+    void action_toggle_profiler();
+    void action_reset_profiler();
+    void action_export_profile();
+    void refresh_profiler();
+
+    // CPU usage meter
+    class CPUUsageGraph;
+    QCheckBox *cpu_usage_enabled;
+    CPUUsageGraph *cpu_usage_graph;
+    QLabel *cpu_usage_summary;
+    void action_toggle_cpu_usage();
+    void refresh_cpu_usage();
+
+    // Time travel
+    QCheckBox *time_travel_enabled;
+    QSpinBox *time_travel_interval;
+    QSpinBox *time_travel_memory_limit;
+    QLabel *time_travel_status;
+    void action_toggle_time_travel();
+    void action_update_time_travel_settings();
+    void refresh_time_travel();
     
     static void log_callback(GB_gameboy_s *, const char *, GB_log_attributes);
     void closeEvent(QCloseEvent *) override;
@@ -4,13 +4,185 @@
 #include <QVBoxLayout>
 #include <QLabel>
 #include <QFontDatabase>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
+#include <QTreeView>
+#include <QAbstractItemModel>
 #include <QPushButton>
 #include <QFileDialog>
 #include <QMessageBox>
 
-Debugger::BreakAndTraceResultsDialog::BreakAndTraceResultsDialog(QWidget *parent, Debugger *window, ProcessedBNTResultNode::directory_t &&results) : QDialog(parent), window(window), results(results) {
+#include <unordered_map>
+
+// Shows the tree without making anything for a row until it's shown. Children are loaded in chunks as the view asks for
+// them (scrolling or expanding), so even a trace with millions of steps at one level opens instantly.
+class Debugger::BreakAndTraceResultsDialog::Model : public QAbstractItemModel {
+public:
+    Model(QObject *parent, const ProcessedBNTResultTree &tree) : QAbstractItemModel(parent), tree(tree), font(QFontDatabase::systemFont(QFontDatabase::FixedFont)) {}
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override {
+        auto *children = this->loaded_children(this->node_index(parent));
+        if(column != 0 || row < 0 || !children || static_cast<std::size_t>(row) >= children->nodes.size()) {
+            return QModelIndex();
+        }
+        return this->createIndex(row, column, static_cast<quintptr>(children->nodes[row]));
+    }
+
+    QModelIndex parent(const QModelIndex &child) const override {
+        if(!child.isValid()) {
+            return QModelIndex();
+        }
+
+        auto parent = this->tree.nodes[child.internalId()].parent;
+        if(parent == ProcessedBNTResultTree::NO_NODE) {
+            return QModelIndex();
+        }
+        return this->createIndex(static_cast<int>(this->tree.nodes[parent].row), 0, static_cast<quintptr>(parent));
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        if(parent.column() > 0) {
+            return 0;
+        }
+        auto *children = this->loaded_children(this->node_index(parent));
+        return children ? static_cast<int>(children->nodes.size()) : 0;
+    }
+
+    int columnCount(const QModelIndex & = QModelIndex()) const override {
+        return 1;
+    }
+
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override {
+        return this->first_child(this->node_index(parent)) != ProcessedBNTResultTree::NO_NODE;
+    }
+
+    bool canFetchMore(const QModelIndex &parent) const override {
+        auto node = this->node_index(parent);
+        auto *children = this->loaded_children(node);
+        if(!children) {
+            return this->first_child(node) != ProcessedBNTResultTree::NO_NODE;
+        }
+        return children->next != ProcessedBNTResultTree::NO_NODE;
+    }
+
+    void fetchMore(const QModelIndex &parent) override {
+        static constexpr const std::size_t CHUNK_SIZE = 1024;
+
+        auto node = this->node_index(parent);
+        auto [loaded, inserted] = this->children.try_emplace(node);
+        if(inserted) {
+            loaded->second.next = this->first_child(node);
+        }
+
+        auto &c = loaded->second;
+        if(c.next == ProcessedBNTResultTree::NO_NODE) {
+            return;
+        }
+
+        // Count how many we're adding first so the view knows
+        std::size_t count = 0;
+        for(auto n = c.next; n != ProcessedBNTResultTree::NO_NODE && count < CHUNK_SIZE; n = this->tree.nodes[n].next_sibling) {
+            count++;
+        }
+
+        auto first = static_cast<int>(c.nodes.size());
+        this->beginInsertRows(parent, first, first + static_cast<int>(count) - 1);
+        for(std::size_t i = 0; i < count; i++) {
+            c.nodes.emplace_back(c.next);
+            c.next = this->tree.nodes[c.next].next_sibling;
+        }
+        this->endInsertRows();
+    }
+
+    // Load as much of the tree as it takes to show a node, and get its index
+    QModelIndex index_for_node(std::uint32_t node) {
+        if(node == ProcessedBNTResultTree::NO_NODE) {
+            return QModelIndex();
+        }
+
+        auto parent = this->index_for_node(this->tree.nodes[node].parent);
+        auto row = this->tree.nodes[node].row;
+        while(true) {
+            auto *children = this->loaded_children(this->node_index(parent));
+            if(children && children->nodes.size() > row) {
+                break;
+            }
+            if(!this->canFetchMore(parent)) {
+                return QModelIndex();
+            }
+            this->fetchMore(parent);
+        }
+        return this->createIndex(static_cast<int>(row), 0, static_cast<quintptr>(node));
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override {
+        if(!index.isValid()) {
+            return QVariant();
+        }
+
+        auto &result = this->tree.nodes[index.internalId()].result;
+        switch(role) {
+            case Qt::DisplayRole: {
+                char text[256];
+                std::snprintf(text, sizeof(text), "$%04x - %s", result.pc, result.instruction.c_str());
+                return QString(text);
+            }
+            case Qt::FontRole:
+                return this->font;
+            default:
+                return QVariant();
+        }
+    }
+
+private:
+    const ProcessedBNTResultTree &tree;
+    QFont font;
+
+    // Children loaded so far for each node (NO_NODE for the top level)
+    struct LoadedChildren {
+        std::vector<std::uint32_t> nodes;
+        std::uint32_t next = ProcessedBNTResultTree::NO_NODE;
+    };
+    std::unordered_map<std::uint32_t, LoadedChildren> children;
+
+    std::uint32_t node_index(const QModelIndex &index) const {
+        return index.isValid() ? static_cast<std::uint32_t>(index.internalId()) : ProcessedBNTResultTree::NO_NODE;
+    }
+
+    std::uint32_t first_child(std::uint32_t node) const {
+        return node == ProcessedBNTResultTree::NO_NODE ? this->tree.first_root : this->tree.nodes[node].first_child;
+    }
+
+    const LoadedChildren *loaded_children(std::uint32_t node) const {
+        auto children = this->children.find(node);
+        return children == this->children.end() ? nullptr : &children->second;
+    }
+};
+
+// Reads the results being shown so they can be compared against a trace file
+class ResultsTraceSource : public TraceDiff::Source {
+public:
+    ResultsTraceSource(const Debugger::ProcessedBNTResultTree &tree) : tree(tree) {}
+
+    bool next(TraceDiff::Entry &entry) override {
+        if(this->index >= this->tree.nodes.size()) {
+            return false;
+        }
+
+        auto &r = this->tree.nodes[this->index++].result;
+        entry.pc = r.pc;
+        entry.sp = r.sp;
+        entry.af = static_cast<std::uint16_t>(r.a << 8 | r.f);
+        entry.bc = static_cast<std::uint16_t>(r.b << 8 | r.c);
+        entry.de = static_cast<std::uint16_t>(r.d << 8 | r.e);
+        entry.hl = static_cast<std::uint16_t>(r.h << 8 | r.l);
+        return true;
+    }
+
+private:
+    const Debugger::ProcessedBNTResultTree &tree;
+    std::size_t index = 0;
+};
+
+Debugger::BreakAndTraceResultsDialog::BreakAndTraceResultsDialog(QWidget *parent, Debugger *window, ProcessedBNTResultTree &&results) : QDialog(parent), results(std::move(results)), window(window) {
     this->setWindowTitle("Break and Trace Results");
 
     auto *layout = new QVBoxLayout(this);
@@ -22,39 +194,20 @@ Debugger::BreakAndTraceResultsDialog::BreakAndTraceResultsDialog(QWidget *parent
 
     // Make the tree view
     auto fixed_font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
-    auto *table_view = new QTreeWidget(inner_widget);
+    auto *table_view = new QTreeView(inner_widget);
+    this->tree_view = table_view;
+    this->model = new Model(this, this->results);
+    table_view->setModel(this->model);
     table_view->setAnimated(false);
     table_view->setAlternatingRowColors(true);
     table_view->setHeaderHidden(true);
-    auto add_directory = [&table_view, &fixed_font](const ProcessedBNTResultNode::directory_t &dir, QTreeWidgetItem *parent, auto &add_directory) -> void {
-        for(auto &i : dir) {
-            char text[256];
-            std::snprintf(text, sizeof(text), "$%04x - %s", i.result.pc, i.result.instruction.c_str());
-
-            // Make our widget item
-            QTreeWidgetItem *new_item;
-            if(parent) {
-                new_item = new QTreeWidgetItem(parent);
-                parent->addChild(new_item);
-            }
-            else {
-                new_item = new QTreeWidgetItem(table_view);
-                table_view->addTopLevelItem(new_item);
-            }
-            new_item->setText(0, text);
-            new_item->setFont(0, fixed_font);
-            new_item->setData(0, Qt::UserRole, QVariant::fromValue(reinterpret_cast<std::uintptr_t>(&i)));
-
-            add_directory(i.children, new_item, add_directory);
-        }
-    };
-    connect(table_view, &QTreeWidget::itemDoubleClicked, this, &BreakAndTraceResultsDialog::double_clicked_item);
-    connect(table_view, &QTreeWidget::currentItemChanged, this, &BreakAndTraceResultsDialog::show_info_for_register);
+    table_view->setUniformRowHeights(true);
+    connect(table_view, &QTreeView::doubleClicked, this, &BreakAndTraceResultsDialog::double_clicked_item);
+    connect(table_view->selectionModel(), &QItemSelectionModel::currentChanged, this, &BreakAndTraceResultsDialog::show_info_for_register);
 
-    // Populate it and add it
+    // Add it
     table_view->setMinimumWidth(500);
     table_view->setMinimumHeight(400);
-    add_directory(this->results, nullptr, add_directory);
     inner_layout->addWidget(table_view);
 
     // Add register info here
@@ -66,12 +219,37 @@ Debugger::BreakAndTraceResultsDialog::BreakAndTraceResultsDialog(QWidget *parent
     this->register_info = new QLabel(right_widget);
     this->register_info->setFont(fixed_font);
     this->register_info->setAlignment(Qt::AlignmentFlag::AlignTop | Qt::AlignmentFlag::AlignLeft);
-    this->show_info_for_register(nullptr, nullptr);
+    this->show_info_for_register(QModelIndex(), QModelIndex());
     right_layout->addWidget(this->register_info);
 
     auto *export_results_button = new QPushButton("Export to CSV...", right_widget);
     connect(export_results_button, &QPushButton::clicked, this, &BreakAndTraceResultsDialog::export_results);
     right_layout->addWidget(export_results_button);
+
+    auto *compare_results_button = new QPushButton("Compare with Trace...", right_widget);
+    compare_results_button->setToolTip("Find where these results stop matching an exported CSV or a recorded instruction trace");
+    connect(compare_results_button, &QPushButton::clicked, this, &BreakAndTraceResultsDialog::compare_results);
+    right_layout->addWidget(compare_results_button);
+
+    this->divergence_info = new QLabel(right_widget);
+    this->divergence_info->setFont(fixed_font);
+    this->divergence_info->setAlignment(Qt::AlignmentFlag::AlignTop | Qt::AlignmentFlag::AlignLeft);
+    right_layout->addWidget(this->divergence_info);
+
+    auto *divergence_buttons = new QWidget(right_widget);
+    auto *divergence_buttons_layout = new QHBoxLayout(divergence_buttons);
+    divergence_buttons_layout->setContentsMargins(0,0,0,0);
+    divergence_buttons->setLayout(divergence_buttons_layout);
+    this->previous_divergence_button = new QPushButton("Previous", divergence_buttons);
+    this->next_divergence_button = new QPushButton("Next", divergence_buttons);
+    this->previous_divergence_button->setEnabled(false);
+    this->next_divergence_button->setEnabled(false);
+    connect(this->previous_divergence_button, &QPushButton::clicked, this, [this]() { this->show_divergence(this->shown_divergence - 1); });
+    connect(this->next_divergence_button, &QPushButton::clicked, this, [this]() { this->show_divergence(this->shown_divergence + 1); });
+    divergence_buttons_layout->addWidget(this->previous_divergence_button);
+    divergence_buttons_layout->addWidget(this->next_divergence_button);
+    right_layout->addWidget(divergence_buttons);
+    right_layout->addStretch(1);
     inner_layout->addWidget(right_widget);
 
     // Add the thing
@@ -81,17 +259,26 @@ Debugger::BreakAndTraceResultsDialog::BreakAndTraceResultsDialog(QWidget *parent
     this->setLayout(layout);
 }
 
-void Debugger::BreakAndTraceResultsDialog::double_clicked_item(QTreeWidgetItem *item, int column) {
-    if(item) {
-        this->window->disassembler->go_to(reinterpret_cast<const Debugger::ProcessedBNTResultNode *>(item->data(0, Qt::UserRole).value<std::uintptr_t>())->result.pc);
+const Debugger::ProcessedBNTResultTree::Node *Debugger::BreakAndTraceResultsDialog::node_for_index(const QModelIndex &index) const {
+    if(!index.isValid()) {
+        return nullptr;
+    }
+    return &this->results.nodes[index.internalId()];
+}
+
+void Debugger::BreakAndTraceResultsDialog::double_clicked_item(const QModelIndex &index) {
+    auto *node = this->node_for_index(index);
+    if(node) {
+        this->window->disassembler->go_to(node->result.pc);
     }
 }
 
-void Debugger::BreakAndTraceResultsDialog::show_info_for_register(QTreeWidgetItem *current, QTreeWidgetItem *) {
+void Debugger::BreakAndTraceResultsDialog::show_info_for_register(const QModelIndex &current, const QModelIndex &) {
     std::uint16_t af = 0, hl = 0, bc = 0, sp = 0, de = 0, pc = 0;
 
-    if(current) {
-        auto &data = reinterpret_cast<const Debugger::ProcessedBNTResultNode *>(current->data(0, Qt::UserRole).value<std::uintptr_t>())->result;
+    auto *node = this->node_for_index(current);
+    if(node) {
+        auto &data = node->result;
         af = data.a << 8 | data.f;
         hl = data.h << 8 | data.l;
         bc = data.b << 8 | data.c;
@@ -146,38 +333,95 @@ void Debugger::BreakAndTraceResultsDialog::export_results() {
         // Print the header
         std::fprintf(f, "depth,instruction,af,bc,de,hl,sp,pc,carry,halfcarry,subtract,zero\n");
 
-        // Let's do this
-        auto export_directory = [&f](const ProcessedBNTResultNode::directory_t &directory, int depth, auto &export_directory) -> void {
-            auto directory_size = directory.size();
-            auto d = directory.begin();
-            for(std::size_t i = 0; i < directory_size; i++, d++) {
-                auto af = d->result.a << 8 | d->result.f;
-                auto bc = d->result.b << 8 | d->result.c;
-                auto de = d->result.d << 8 | d->result.e;
-                auto hl = d->result.h << 8 | d->result.l;
-
-                std::fprintf(f, "%i,\"%s\",$%04x,$%04x,$%04x,$%04x,$%04x,$%04x,%i,%i,%i,%i\n",
-                                depth,
-                                d->result.instruction.c_str(),
-                                af,
-                                bc,
-                                de,
-                                hl,
-                                d->result.sp,
-                                d->result.pc,
-                                (d->result.f & GB_CARRY_FLAG) != 0,
-                                (d->result.f & GB_HALF_CARRY_FLAG) != 0,
-                                (d->result.f & GB_SUBTRACT_FLAG) != 0,
-                                (d->result.f & GB_ZERO_FLAG) != 0);
-
-                if(!d->children.empty()) {
-                    export_directory(d->children, depth + 1, export_directory);
-                }
-            }
-        };
-        export_directory(this->results, 0, export_directory);
+        // Let's do this (nodes are already in trace order)
+        for(auto &node : this->results.nodes) {
+            auto &r = node.result;
+            auto af = r.a << 8 | r.f;
+            auto bc = r.b << 8 | r.c;
+            auto de = r.d << 8 | r.e;
+            auto hl = r.h << 8 | r.l;
+
+            std::fprintf(f, "%u,\"%s\",$%04x,$%04x,$%04x,$%04x,$%04x,$%04x,%i,%i,%i,%i\n",
+                            node.depth,
+                            r.instruction.c_str(),
+                            af,
+                            bc,
+                            de,
+                            hl,
+                            r.sp,
+                            r.pc,
+                            (r.f & GB_CARRY_FLAG) != 0,
+                            (r.f & GB_HALF_CARRY_FLAG) != 0,
+                            (r.f & GB_SUBTRACT_FLAG) != 0,
+                            (r.f & GB_ZERO_FLAG) != 0);
+        }
 
         // Done!
         std::fclose(f);
     }
 }
+
+void Debugger::BreakAndTraceResultsDialog::compare_results() {
+    QFileDialog file_dialog;
+    file_dialog.setFileMode(QFileDialog::FileMode::ExistingFile);
+    file_dialog.setNameFilters(QStringList { "Instruction Traces (*.sdxtrace *.csv)" });
+    file_dialog.setWindowTitle("Select a Trace to Compare With");
+
+    if(file_dialog.exec() != QFileDialog::Accepted) {
+        return;
+    }
+
+    auto input = std::filesystem::path(file_dialog.selectedFiles()[0].toStdString());
+    auto other = TraceDiff::open(input);
+    if(!other) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to open trace", QString(input.string().c_str()) + " is not a valid trace.").exec();
+        return;
+    }
+
+    ResultsTraceSource ours(this->results);
+    auto result = TraceDiff::compare(ours, *other);
+    this->divergences = std::move(result.regions);
+
+    if(this->divergences.empty()) {
+        char text[128];
+        std::snprintf(text, sizeof(text), "No differences\n(%llu instructions)", static_cast<unsigned long long>(result.a_records));
+        this->divergence_info->setText(text);
+        this->previous_divergence_button->setEnabled(false);
+        this->next_divergence_button->setEnabled(false);
+        return;
+    }
+
+    this->show_divergence(0);
+}
+
+void Debugger::BreakAndTraceResultsDialog::show_divergence(std::size_t divergence) {
+    if(divergence >= this->divergences.size()) {
+        return;
+    }
+
+    this->shown_divergence = divergence;
+    auto &d = this->divergences[divergence];
+
+    char text[512];
+    std::snprintf(text, sizeof(text), "Difference %zu of %zu\n\nHere: #%llu (%llu instructions)\n      PC: $%04x\nOther: #%llu (%llu instructions)\n      PC: $%04x%s",
+                  divergence + 1,
+                  this->divergences.size(),
+                  static_cast<unsigned long long>(d.a_start),
+                  static_cast<unsigned long long>(d.a_length),
+                  d.a_first.pc,
+                  static_cast<unsigned long long>(d.b_start),
+                  static_cast<unsigned long long>(d.b_length),
+                  d.b_first.pc,
+                  d.resynced ? "" : "\n\nThe traces never match again.");
+    this->divergence_info->setText(text);
+
+    this->previous_divergence_button->setEnabled(divergence > 0);
+    this->next_divergence_button->setEnabled(divergence + 1 < this->divergences.size());
+
+    // Nodes are in trace order, so the record index is the node index
+    if(d.a_start < this->results.nodes.size()) {
+        auto index = this->model->index_for_node(static_cast<std::uint32_t>(d.a_start));
+        this->tree_view->setCurrentIndex(index);
+        this->tree_view->scrollTo(index, QAbstractItemView::PositionAtCenter);
+    }
+}
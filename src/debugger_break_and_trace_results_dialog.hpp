@@ -4,22 +4,39 @@
 #include <QDialog>
 
 #include "debugger.hpp"
+#include "trace_diff.hpp"
 
-class QTreeWidgetItem;
+class QModelIndex;
 class QLabel;
+class QPushButton;
+class QTreeView;
 
 class Debugger::BreakAndTraceResultsDialog : public QDialog {
 public:
-    BreakAndTraceResultsDialog(QWidget *parent, Debugger *window, ProcessedBNTResultNode::directory_t &&results);
+    BreakAndTraceResultsDialog(QWidget *parent, Debugger *window, ProcessedBNTResultTree &&results);
 
 private:
-    ProcessedBNTResultNode::directory_t results;
+    class Model;
+
+    ProcessedBNTResultTree results;
+    Model *model;
+    QTreeView *tree_view;
     QLabel *register_info;
     Debugger *window;
 
-    void double_clicked_item(QTreeWidgetItem *item, int column);
-    void show_info_for_register(QTreeWidgetItem *current, QTreeWidgetItem *);
+    // Comparison against another trace
+    std::vector<TraceDiff::Region> divergences;
+    std::size_t shown_divergence = 0;
+    QLabel *divergence_info;
+    QPushButton *previous_divergence_button;
+    QPushButton *next_divergence_button;
+
+    const ProcessedBNTResultTree::Node *node_for_index(const QModelIndex &index) const;
+    void double_clicked_item(const QModelIndex &index);
+    void show_info_for_register(const QModelIndex &current, const QModelIndex &);
     void export_results();
+    void compare_results();
+    void show_divergence(std::size_t divergence);
 };
 
 #endif
@@ -14,6 +14,8 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QLabel>
+#include <QLineEdit>
+#include <QComboBox>
 
 #include "gb_proxy.h"
 #include "debugger_disassembler.hpp"
@@ -45,6 +47,16 @@ DebuggerDisassembler::DebuggerDisassembler(Debugger *parent) : QTableWidget(pare
     this->text_highlight_color = palette.color(QPalette::ColorRole::HighlightedText);
     this->bg_highlight_color = palette.color(QPalette::ColorRole::Highlight);
 
+    // Code/data log coverage is shown as a faint tint over the default background
+    auto tint = [this](const QColor &color) {
+        static constexpr const float strength = 0.2F;
+        return QColor::fromRgbF(this->bg_default_color.redF() * (1.0F - strength) + color.redF() * strength,
+                                this->bg_default_color.greenF() * (1.0F - strength) + color.greenF() * strength,
+                                this->bg_default_color.blueF() * (1.0F - strength) + color.blueF() * strength);
+    };
+    this->bg_executed_color = tint(QColor(0, 255, 0));
+    this->bg_data_color = tint(QColor(0, 128, 255));
+
     this->setMinimumHeight(400);
     this->setMinimumWidth(400);
 }
@@ -81,6 +93,10 @@ void DebuggerDisassembler::add_breakpoint() {
     this->debugger->get_instance().break_at(*this->last_disassembly->address);
 }
 
+void DebuggerDisassembler::run_to_address() {
+    this->debugger->get_instance().run_to_address(*this->last_disassembly->address);
+}
+
 void DebuggerDisassembler::add_break_and_trace_breakpoint() {
     QDialog dialog;
     dialog.setWindowTitle("Break and Trace");
@@ -155,6 +171,100 @@ void DebuggerDisassembler::add_break_and_trace_breakpoint() {
     }
 }
 
+void DebuggerDisassembler::add_conditional_breakpoint() {
+    QDialog dialog;
+    dialog.setWindowTitle("Conditional Breakpoint");
+    dialog.setFixedWidth(500);
+
+    // Set up the UI
+    auto *layout = new QVBoxLayout(&dialog);
+    dialog.setLayout(layout);
+
+    auto *input_grid_w = new QWidget(&dialog);
+    auto *input_grid = new QGridLayout(input_grid_w);
+    input_grid->setContentsMargins(0,0,0,0);
+    input_grid_w->setLayout(input_grid);
+
+    char address_test[6];
+    std::snprintf(address_test, sizeof(address_test), "$%04x", *this->last_disassembly->address);
+
+    auto *address = new QLineEdit(input_grid_w);
+    address->setText(address_test);
+
+    input_grid->addWidget(new QLabel("Address:", input_grid_w), 0, 0);
+    input_grid->addWidget(address, 0, 1);
+
+    input_grid->addWidget(new QLabel("Condition:", input_grid_w), 1, 0);
+    auto *condition = new QLineEdit(input_grid_w);
+    condition->setPlaceholderText("e.g. a == $3F && [$C000] > 4 (leave empty to always break)");
+    input_grid->addWidget(condition, 1, 1);
+
+    input_grid->addWidget(new QLabel("Break:", input_grid_w), 2, 0);
+    auto *hit_mode = new QComboBox(input_grid_w);
+    hit_mode->addItem("Every time", GameInstance::BreakpointHitMode::BreakAlways);
+    hit_mode->addItem("Only on hit #", GameInstance::BreakpointHitMode::BreakOnHit);
+    hit_mode->addItem("From hit # onward", GameInstance::BreakpointHitMode::BreakFromHit);
+    hit_mode->addItem("Every #th hit", GameInstance::BreakpointHitMode::BreakEveryHit);
+    input_grid->addWidget(hit_mode, 2, 1);
+
+    input_grid->addWidget(new QLabel("Hit #:", input_grid_w), 3, 0);
+    auto *hit_target = new QLineEdit(input_grid_w);
+    hit_target->setText("1");
+    hit_target->setEnabled(false);
+    input_grid->addWidget(hit_target, 3, 1);
+    connect(hit_mode, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), hit_target, [hit_target](int index) { hit_target->setEnabled(index != 0); });
+
+    layout->addWidget(input_grid_w);
+
+    auto *ok_button_row = new QWidget(&dialog);
+    layout->addWidget(ok_button_row);
+    auto *ok_button_row_l = new QHBoxLayout(ok_button_row);
+    ok_button_row_l->setContentsMargins(0,0,0,0);
+    ok_button_row->setLayout(ok_button_row_l);
+    ok_button_row_l->addStretch(1);
+
+    auto *ok_button = new QPushButton("OK", ok_button_row);
+    ok_button_row_l->addWidget(ok_button);
+
+    // Start with the condition since that's what's most likely to be typed in
+    condition->setFocus();
+
+    // Pressing enter on any the controls will accept the dialog
+    connect(ok_button, &QPushButton::clicked, &dialog, &QDialog::accept);
+    connect(address, &QLineEdit::returnPressed, &dialog, &QDialog::accept);
+    connect(condition, &QLineEdit::returnPressed, &dialog, &QDialog::accept);
+    connect(hit_target, &QLineEdit::returnPressed, &dialog, &QDialog::accept);
+
+    // Keep asking for something until the user enters something valid or gives up
+    while(dialog.exec() == QDialog::Accepted) {
+        auto &instance = this->debugger->get_instance();
+        auto address_maybe = evaluate_address_with_error_message(instance, address->text().toUtf8().data());
+        if(!address_maybe.has_value()) {
+            continue;
+        }
+
+        GameInstance::ConditionalBreakpoint breakpoint;
+        breakpoint.address = *address_maybe;
+        breakpoint.condition = condition->text().toStdString();
+        breakpoint.hit_mode = static_cast<GameInstance::BreakpointHitMode>(hit_mode->currentData().toInt());
+        if(breakpoint.hit_mode != GameInstance::BreakpointHitMode::BreakAlways) {
+            bool ok;
+            breakpoint.hit_target = hit_target->text().toULongLong(&ok);
+            if(!ok) {
+                QMessageBox(QMessageBox::Icon::Critical, "Invalid Hit Count", "The hit count must be a number.", QMessageBox::StandardButton::Ok).exec();
+                continue;
+            }
+        }
+
+        std::string error;
+        if(!instance.add_conditional_breakpoint(breakpoint, error)) {
+            QMessageBox(QMessageBox::Icon::Critical, "Invalid Condition", QString::fromStdString(error), QMessageBox::StandardButton::Ok).exec();
+            continue;
+        }
+        break;
+    }
+}
+
 void DebuggerDisassembler::delete_breakpoint() {
     this->debugger->get_instance().remove_breakpoint(*this->last_disassembly->address);
 }
@@ -205,7 +315,17 @@ void DebuggerDisassembler::show_context_menu(const QPoint &point) {
                     std::snprintf(breakpoint_text, sizeof(breakpoint_text), "Break-and-trace at $%04X", *address);
                     auto *set_bnt_breakpoint = menu.addAction(breakpoint_text);
                     connect(set_bnt_breakpoint, &QAction::triggered, this, &DebuggerDisassembler::add_break_and_trace_breakpoint);
+
+                    std::snprintf(breakpoint_text, sizeof(breakpoint_text), "Conditional breakpoint at $%04X...", *address);
+                    auto *set_conditional_breakpoint = menu.addAction(breakpoint_text);
+                    connect(set_conditional_breakpoint, &QAction::triggered, this, &DebuggerDisassembler::add_conditional_breakpoint);
                 }
+
+                std::snprintf(breakpoint_text, sizeof(breakpoint_text), "Run to $%04X", *address);
+                auto *run_to = menu.addAction(breakpoint_text);
+                connect(run_to, &QAction::triggered, this, &DebuggerDisassembler::run_to_address);
+
+                this->add_references_menu(menu, *address);
             }
         }
     }
@@ -213,6 +333,38 @@ void DebuggerDisassembler::show_context_menu(const QPoint &point) {
     menu.exec(this->mapToGlobal(point));
 }
 
+void DebuggerDisassembler::add_references_menu(QMenu &menu, std::uint16_t address) {
+    auto &instance = this->debugger->get_instance();
+    auto analysis = instance.get_rom_analysis();
+    if(analysis == nullptr) {
+        return;
+    }
+
+    std::uint16_t bank = address < 0x4000 ? this->banks.rom0 : this->banks.romx;
+    auto references = analysis->get_references_to(bank, address);
+    if(references.empty()) {
+        return;
+    }
+
+    char text[512];
+    std::snprintf(text, sizeof(text), "References to $%04X (%zu)", address, references.size());
+    auto *references_menu = menu.addMenu(text);
+    auto symbols = instance.get_symbol_table();
+
+    static constexpr const char *KINDS[] = { "Call", "Jump", "Branch", "Jump table", "Read", "Write" };
+    static constexpr const std::size_t MAX_SHOWN = 64;
+    for(std::size_t i = 0; i < references.size() && i < MAX_SHOWN; i++) {
+        auto &r = references[i];
+        std::snprintf(text, sizeof(text), "%s from %s", KINDS[r.kind], symbols->describe(r.from_bank, r.from_address, false).c_str());
+        auto *go_to_reference = references_menu->addAction(text);
+        connect(go_to_reference, &QAction::triggered, this, [this, from = r.from_address]() { this->go_to(from); });
+    }
+    if(references.size() > MAX_SHOWN) {
+        std::snprintf(text, sizeof(text), "%zu more...", references.size() - MAX_SHOWN);
+        references_menu->addAction(text)->setEnabled(false);
+    }
+}
+
 bool DebuggerDisassembler::address_is_breakpoint(std::uint16_t address) {
     for(auto &i : this->debugger->get_breakpoints()) {
         if(i == address) {
@@ -242,6 +394,15 @@ void DebuggerDisassembler::jump_to_address_window() {
     
     // Go to the address
     if(dialog.exec() == QInputDialog::Accepted) {
+        // Labels can be looked up directly without going through the expression evaluator
+        auto text = dialog.textValue().trimmed().toStdString();
+        auto symbols = this->debugger->get_instance().get_symbol_table();
+        auto *symbol = symbols->lookup(text);
+        if(symbol) {
+            this->go_to(symbol->address);
+            return;
+        }
+
         auto where_to = evaluate_address_with_error_message(this->debugger->get_instance(), dialog.textValue().toUtf8().data());
         if(where_to.has_value()) {
             this->go_to(*where_to);
@@ -252,7 +413,7 @@ void DebuggerDisassembler::jump_to_address_window() {
 void DebuggerDisassembler::wheelEvent(QWheelEvent *event) {
     int d = event->angleDelta().y();
     if(d > 0) {
-        this->current_address -= std::min(static_cast<std::uint16_t>(1), this->current_address);
+        this->current_address = this->previous_address(this->current_address);
     }
     else if(d < 0) {
         this->current_address = this->next_address_medium;
@@ -268,9 +429,13 @@ void DebuggerDisassembler::keyPressEvent(QKeyEvent *event) {
             this->current_address = next_address_far;
             break;
         case Qt::Key::Key_PageUp:
-            this->current_address -= std::min(static_cast<std::uint16_t>(10), this->current_address);
+            for(int i = 0; i < 10; i++) {
+                this->current_address = this->previous_address(this->current_address);
+            }
             break;
         case Qt::Key::Key_Up:
+            this->current_address = this->previous_address(this->current_address);
+            break;
         case Qt::Key::Key_Left:
             this->current_address -= std::min(static_cast<std::uint16_t>(1), this->current_address);
             break;
@@ -296,8 +461,64 @@ void DebuggerDisassembler::refresh_view() {
     
     // Disassemble based on the number of rows that are visible (plus one in case there is a partial row on the bottom)
     auto query_rows = static_cast<std::uint8_t>(std::min(255, this->height() / this->debugger->get_table_font().pixelSize() + 1));
+
+    // Don't bother if nothing changed since last time
+    ShownState state = { this->current_address, query_rows, this->debugger->get_instance().get_generations() };
+    if(this->shown_state == state) {
+        return;
+    }
+    this->shown_state = state;
+
+    auto &instance = this->debugger->get_instance();
+
+    // We need to know about writes to RAM to know when to throw out what we cached
+    if(!this->write_tracking) {
+        instance.set_write_tracking_enabled(true);
+        this->write_tracking = true;
+    }
+
+    // A new ROM means new symbols, so nothing we have is any good anymore
+    if(state.generations.rom != this->cache_rom_generation) {
+        this->cache.clear();
+        this->cache_rom_generation = state.generations.rom;
+    }
+
+    this->banks = instance.get_mapped_banks();
+    std::optional<std::uint16_t> pc;
+    if(instance.is_paused_from_breakpoint()) {
+        pc = instance.get_register_value(GameInstance::SM83Register::SM83_REG_PC);
+    }
+
     this->setRowCount(query_rows);
-    this->disassembly = this->disassemble_at_address(this->current_address, query_rows);
+    this->disassembly.clear();
+
+    // Walk forward through the cache, only asking SameBoy for what we don't have
+    std::uint16_t address = this->current_address;
+    while(this->disassembly.size() < query_rows) {
+        auto *instruction = this->find_cached(address);
+        if(instruction == nullptr) {
+            this->cache_instructions(address, static_cast<std::uint8_t>(query_rows - this->disassembly.size()));
+            if((instruction = this->find_cached(address)) == nullptr) {
+                break;
+            }
+        }
+
+        instruction->boundary = true;
+        for(auto &row : instruction->rows) {
+            auto &d = this->disassembly.emplace_back(row);
+            if(d.address.has_value() && d.address == pc) {
+                d.current_location = true;
+                d.raw_result.replace(0, 4, "  ->");
+            }
+        }
+
+        // Stop if we wrapped around
+        if(instruction->next_address <= address) {
+            break;
+        }
+        address = instruction->next_address;
+    }
+
     this->next_address_short = this->current_address;
     this->next_address_medium = this->current_address;
     this->next_address_far = this->current_address;
@@ -320,6 +541,19 @@ void DebuggerDisassembler::refresh_view() {
         }
     }
     
+    // Find out which of these have been executed or read as data, if we're logging that
+    std::vector<std::uint8_t> code_data_flags;
+    if(instance.is_code_data_logging_enabled()) {
+        std::size_t span = 0;
+        for(auto &d : this->disassembly) {
+            if(d.address.has_value() && *d.address >= this->current_address) {
+                span = std::max(span, static_cast<std::size_t>(*d.address - this->current_address + 1));
+            }
+        }
+        code_data_flags.resize(span);
+        instance.get_code_data_flags(this->current_address, span, this->banks, code_data_flags.data());
+    }
+
     // If anything has a breakpoint set, highlight it
     auto disassembly_count = this->disassembly.size();
     for(std::size_t row = 0; row < disassembly_count && row < query_rows; row++) {
@@ -336,19 +570,153 @@ void DebuggerDisassembler::refresh_view() {
         }
         else {
             item->setForeground(this->text_default_color);
-            item->setBackground(this->bg_default_color);
+
+            std::uint8_t flags = 0;
+            if(d.address.has_value() && *d.address >= this->current_address && *d.address - this->current_address < code_data_flags.size()) {
+                flags = code_data_flags[*d.address - this->current_address];
+            }
+
+            if(flags & (CodeDataLogger::FlagExecuted | CodeDataLogger::FlagOperand)) {
+                item->setBackground(this->bg_executed_color);
+            }
+            else if(flags & CodeDataLogger::FlagData) {
+                item->setBackground(this->bg_data_color);
+            }
+            else {
+                item->setBackground(this->bg_default_color);
+            }
         }
         
         this->setItem(row, 0, item);
     }
 }
 
-std::vector<DebuggerDisassembler::Disassembly> DebuggerDisassembler::disassemble_at_address(std::uint16_t address, std::uint8_t count) {
+void DebuggerDisassembler::invalidate() {
+    this->shown_state = std::nullopt;
+
+    // Nobody's looking, so we don't need to track writes anymore (RAM will be invalidated when it is turned back on)
+    if(this->write_tracking) {
+        this->debugger->get_instance().set_write_tracking_enabled(false);
+        this->write_tracking = false;
+    }
+}
+
+std::uint32_t DebuggerDisassembler::cache_key(std::uint16_t address) const noexcept {
+    return (static_cast<std::uint32_t>(this->banks.bank_for_address(address)) << 16) | address;
+}
+
+DebuggerDisassembler::CachedInstruction *DebuggerDisassembler::find_cached(std::uint16_t address) {
+    auto c = this->cache.find(this->cache_key(address));
+    if(c == this->cache.end()) {
+        return nullptr;
+    }
+
+    // ROM doesn't change, but anything else might have been written to since we decoded it
+    if(address >= 0x8000) {
+        auto &instance = this->debugger->get_instance();
+        auto &instruction = c->second;
+        std::uint16_t last_byte = instruction.next_address - 1;
+        if(instruction.page_generation[0] != instance.get_page_write_generation(address >> 8) || instruction.page_generation[1] != instance.get_page_write_generation(last_byte >> 8)) {
+            this->cache.erase(c);
+            return nullptr;
+        }
+    }
+
+    return &c->second;
+}
+
+void DebuggerDisassembler::cache_instructions(std::uint16_t address, std::uint8_t count) {
+    auto &instance = this->debugger->get_instance();
+
+    // Get the write generations before disassembling so anything written while we do this invalidates it
+    std::uint32_t generations[0x100];
+    for(std::size_t page = 0; page < sizeof(generations) / sizeof(generations[0]); page++) {
+        generations[page] = instance.get_page_write_generation(static_cast<std::uint8_t>(page));
+    }
+
+    // Disassemble one more than we need since we can only cache an instruction once we know where the next one starts
+    auto rows = this->disassemble_at_address(address, static_cast<std::uint8_t>(std::min(255, count + 1)), this->banks);
+
+    std::vector<Disassembly> pending_rows;
+    std::optional<std::uint16_t> pending_address;
+    std::vector<Disassembly> markers;
+
+    for(auto &row : rows) {
+        // Labels go with the instruction after them
+        if(!row.address.has_value()) {
+            markers.emplace_back(std::move(row));
+            continue;
+        }
+
+        // The current location is marked when shown instead since it changes
+        if(row.current_location) {
+            row.current_location = false;
+            row.raw_result.replace(0, 4, "    ");
+        }
+
+        // Now we know where the previous instruction ends
+        auto next_address = *row.address;
+        if(pending_address.has_value() && next_address > *pending_address) {
+            auto &instruction = this->cache[this->cache_key(*pending_address)];
+            bool boundary = instruction.boundary;
+            instruction.rows = std::move(pending_rows);
+            instruction.next_address = next_address;
+            instruction.page_generation[0] = generations[*pending_address >> 8];
+            instruction.page_generation[1] = generations[static_cast<std::uint16_t>(next_address - 1) >> 8];
+            instruction.boundary = boundary;
+        }
+
+        pending_rows = std::move(markers);
+        markers.clear();
+        pending_rows.emplace_back(std::move(row));
+        pending_address = next_address;
+    }
+}
+
+std::uint16_t DebuggerDisassembler::previous_address(std::uint16_t address) {
+    if(address == 0) {
+        return 0;
+    }
+
+    // Find an instruction that ends where this one begins, preferring ones that are known to be on a boundary
+    auto find_previous = [this, &address]() -> std::optional<std::uint16_t> {
+        std::optional<std::uint16_t> found;
+        for(std::uint16_t length = 1; length <= 3 && length <= address; length++) {
+            std::uint16_t candidate = address - length;
+            auto *instruction = this->find_cached(candidate);
+            if(instruction != nullptr && instruction->next_address == address) {
+                if(instruction->boundary) {
+                    return candidate;
+                }
+                else if(!found.has_value()) {
+                    found = candidate;
+                }
+            }
+        }
+        return found;
+    };
+
+    auto previous = find_previous();
+
+    // If we don't know, disassemble a few bytes before and see what lines up
+    if(!previous.has_value()) {
+        for(std::uint16_t length = 3; length >= 1; length--) {
+            if(length <= address) {
+                this->cache_instructions(address - length, 4);
+            }
+        }
+        previous = find_previous();
+    }
+
+    return previous.value_or(address - 1);
+}
+
+std::vector<DebuggerDisassembler::Disassembly> DebuggerDisassembler::disassemble_at_address(std::uint16_t address, std::uint8_t count, GameInstance::MappedBanks &banks) {
     // Tell sameboy to disassemble at the address and capture its output.
     // Doing it this way is horrible. Let's do it anyway.
     QStringList lines;
     
-    lines = QString::fromStdString(this->debugger->get_instance().disassemble_address(address, count)).split("\n");
+    lines = QString::fromStdString(this->debugger->get_instance().disassemble_address(address, count, banks)).split("\n");
     
     std::vector<Disassembly> returned_instructions;
     for(auto &l : lines) {
@@ -361,7 +729,7 @@ std::vector<DebuggerDisassembler::Disassembly> DebuggerDisassembler::disassemble
         
         if(l[0] == ' ') {
             instruction.address = l.mid(4, 4).toUInt(nullptr, 16);
-            instruction.current_location = l[0] == '-';
+            instruction.current_location = l.mid(0, 4).contains("->");
             
             int semicolon_offset = l.indexOf(';', 8);
             if(semicolon_offset >= 0) {
@@ -3,8 +3,12 @@
 
 #include <QTableWidget>
 #include <optional>
+#include <map>
+
+#include "game_instance.hpp"
 
 class Debugger;
+class QMenu;
 
 class DebuggerDisassembler : public QTableWidget {
     Q_OBJECT
@@ -46,24 +50,60 @@ public:
     void follow_address();
     void add_breakpoint();
     void add_break_and_trace_breakpoint();
+    void add_conditional_breakpoint();
+    void run_to_address();
     void delete_breakpoint();
+    void add_references_menu(QMenu &menu, std::uint16_t address);
     void refresh_view();
+    void invalidate();
     bool address_is_breakpoint(std::uint16_t address);
     void set_address_to_current_breakpoint();
     
     void wheelEvent(QWheelEvent *event) override;
     void keyPressEvent(QKeyEvent *event) override;
 
-    std::vector<Disassembly> disassemble_at_address(std::uint16_t address, std::uint8_t count);
+    std::vector<Disassembly> disassemble_at_address(std::uint16_t address, std::uint8_t count, GameInstance::MappedBanks &banks);
     
     QColor text_default_color;
     QColor text_highlight_color;
     
     QColor bg_default_color;
     QColor bg_highlight_color;
+
+    // Code/data log coverage
+    QColor bg_executed_color;
+    QColor bg_data_color;
     
 private:
     Debugger *debugger;
+
+    // What was last shown; if none of this changed, there is nothing to refresh
+    struct ShownState {
+        std::uint16_t address;
+        int rows;
+        GameInstance::Generations generations;
+
+        bool operator==(const ShownState &) const = default;
+    };
+    std::optional<ShownState> shown_state;
+
+    // Decoded instructions keyed by bank and address. ROM stays cached until a new ROM is loaded, while anything else
+    // is dropped when a write lands on one of its pages.
+    struct CachedInstruction {
+        std::vector<Disassembly> rows; // labels (if any) followed by the instruction
+        std::uint16_t next_address;
+        std::uint32_t page_generation[2]; // write generations of the first and last byte's pages when decoded
+        bool boundary = false; // shown while scrolling forward, so it is a known instruction boundary
+    };
+    std::map<std::uint32_t, CachedInstruction> cache;
+    std::uint64_t cache_rom_generation = 0;
+    GameInstance::MappedBanks banks = {};
+    bool write_tracking = false;
+
+    std::uint32_t cache_key(std::uint16_t address) const noexcept;
+    CachedInstruction *find_cached(std::uint16_t address);
+    void cache_instructions(std::uint16_t address, std::uint8_t count);
+    std::uint16_t previous_address(std::uint16_t address);
 };
 
 #endif
@@ -1,12 +1,20 @@
 #include "game_instance.hpp"
 #include "built_in_boot_rom.h"
 #include "gb_proxy.h"
+#include "sm83.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <cstring>
 #include <thread>
 #include <cassert>
 
+// SSE2 is always there on x86-64
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TILE_DECODE_SSE2
+#include <emmintrin.h>
+#endif
+
 #define MAKE_GETTER(what) { \
     this->mutex.lock(); \
     auto r = what; \
@@ -221,6 +229,58 @@ void GameInstance::on_vblank(GB_gameboy_s *gameboy, GB_vblank_type_t) noexcept {
 
     instance->should_rewind = instance->rewinding;
     instance->vblank_mutex.unlock();
+
+    // Memory has almost certainly changed since the last frame
+    instance->memory_generation++;
+    instance->frame_count++;
+
+    if(!instance->watch_expressions.empty()) {
+        instance->evaluate_watches();
+    }
+
+    // Frames being run through again when running backwards were already recorded the first time
+    if(instance->time_travel_phase != TimeTravelPhase::TimeTravelIdle) {
+        return;
+    }
+
+    if(instance->call_graph_profiler_enabled) {
+        instance->call_graph_profiler.frame(instance->get_cycle_count_without_mutex());
+    }
+
+    if(instance->scanline_capture_enabled) {
+        instance->scanline_capture_back ^= 1;
+        for(auto &line : instance->scanline_capture[instance->scanline_capture_back]) {
+            line.captured = false;
+        }
+    }
+
+    if(instance->timeline_enabled) {
+        instance->timeline.begin_frame(instance->frame_count, instance->get_cycle_count_without_mutex());
+    }
+
+    if(instance->cpu_usage_enabled) {
+        instance->cpu_usage.frame(instance->frame_count, instance->get_cycle_count_without_mutex());
+    }
+}
+
+void GameInstance::on_lcd_line(GB_gameboy_s *gameboy, std::uint8_t line) noexcept {
+    auto *instance = resolve_instance(gameboy);
+    if(line >= GB_SCREEN_LINES || instance->time_travel_phase != TimeTravelPhase::TimeTravelIdle) {
+        return;
+    }
+
+    auto &registers = instance->scanline_capture[instance->scanline_capture_back][line];
+    registers.captured = true;
+    registers.lcdc = get_gb_io_register(gameboy, GB_IO_LCDC);
+    registers.scy = get_gb_io_register(gameboy, GB_IO_SCY);
+    registers.scx = get_gb_io_register(gameboy, GB_IO_SCX);
+    registers.wy = get_gb_io_register(gameboy, GB_IO_WY);
+    registers.wx = get_gb_io_register(gameboy, GB_IO_WX);
+    registers.bgp = get_gb_io_register(gameboy, GB_IO_BGP);
+    registers.obp0 = get_gb_io_register(gameboy, GB_IO_OBP0);
+    registers.obp1 = get_gb_io_register(gameboy, GB_IO_OBP1);
+    registers.bgpi = get_gb_io_register(gameboy, GB_IO_BGPI);
+    registers.obpi = get_gb_io_register(gameboy, GB_IO_OBPI);
 }
 
 GameInstance::GameInstance(GB_model_t model, GB_border_mode_t border) {
@@ -240,6 +300,7 @@ GameInstance::GameInstance(GB_model_t model, GB_border_mode_t border) {
 }
 
 GameInstance::~GameInstance() {
+    this->cancel_rom_analysis_if_running();
     this->end_game_loop();
     this->close_sdl_audio_device();
     GB_free(&this->gameboy);
@@ -249,6 +310,14 @@ char *GameInstance::on_input_requested(GB_gameboy_s *gameboy) {
     auto *instance = resolve_instance(gameboy);
     instance->reset_audio();
 
+    // Are we running backwards?
+    if(instance->time_travel_phase != TimeTravelPhase::TimeTravelIdle) {
+        auto *command = instance->continue_time_travel();
+        if(command) {
+            return malloc_string(command);
+        }
+    }
+
     // Check if we're breaking and tracing?
     bool bnt = false;
     if(instance->current_break_and_trace_remaining > 0) {
@@ -271,6 +340,7 @@ char *GameInstance::on_input_requested(GB_gameboy_s *gameboy) {
 
         // If we've hit the end, do we continue or stop now?
         else if(!bnt && !instance->current_break_and_trace_break_when_done) {
+            instance->update_break_and_trace_results_available();
             return malloc_string("continue");
         }
     }
@@ -282,10 +352,7 @@ char *GameInstance::on_input_requested(GB_gameboy_s *gameboy) {
 
             auto &[bp_address, break_count, step_over, break_when_done] = *b;
             if(pc == bp_address) {
-                instance->current_break_and_trace_remaining = break_count;
-                instance->current_break_and_trace_step_over = step_over;
-                instance->current_break_and_trace_break_when_done = break_when_done;
-                instance->break_and_trace_result.emplace_back().reserve(instance->current_break_and_trace_remaining + 1);
+                instance->begin_break_and_trace(break_count, step_over, break_when_done);
                 bnt = true;
 
                 // Remove the breakpoint
@@ -293,12 +360,23 @@ char *GameInstance::on_input_requested(GB_gameboy_s *gameboy) {
                 std::snprintf(command, sizeof(command), "delete $%04x", pc);
                 instance->execute_command_without_mutex(malloc_string(command));
                 instance->break_and_trace_breakpoints.erase(b);
+                instance->breakpoints_generation++;
 
                 break;
             }
         }
     }
 
+    // Or maybe a watchpoint wants us to trace?
+    if(!bnt && instance->pending_watchpoint_trace.has_value()) {
+        auto &w = *instance->pending_watchpoint_trace;
+        instance->begin_break_and_trace(w.trace_count, w.trace_step_over, w.trace_break_when_done);
+        instance->pending_watchpoint_trace = std::nullopt;
+        bnt = true;
+    }
+
+    instance->update_break_and_trace_results_available();
+
     // If we are, continue after we record the current state
     if(bnt) {
         auto &b = instance->break_and_trace_result[instance->break_and_trace_result.size() - 1].emplace_back();
@@ -328,37 +406,44 @@ char *GameInstance::on_input_requested(GB_gameboy_s *gameboy) {
         }
     }
     
-    // Indicate we've paused
+    // Whatever stopped us, we aren't running to anything anymore
+    instance->run_target = RunTarget::RunTargetNone;
+    instance->run_target_condition = std::nullopt;
+
+    // Indicate we've paused (anything looking at our state will need to query it again)
+    instance->bump_execution_generations();
     instance->bp_paused = true;
-    char *continue_text = nullptr;
-    
-    // Unlock mutex since the thread is now halted
-    instance->mutex.unlock();
-    
-    // Check until we can continue
-    while(true) {
-        // Lock
-        instance->mutex.lock();
-        
-        // Exit if we need to
-        if(instance->loop_finishing) {
-            continue_text = malloc_string("continue");
-            break;
-        }
-        
-        if(instance->continue_text.has_value()) {
-            continue_text = malloc_string(instance->continue_text->c_str());
-            break;
-        }
-        
-        // Unlock
-        instance->mutex.unlock();
+    instance->breakpoint_pause_condition.notify_all();
+
+    // If we got here from a step, record how long it took
+    if(instance->step_started.has_value()) {
+        auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - *instance->step_started);
+        instance->step_started = std::nullopt;
+        instance->step_latency_total += latency;
+        instance->step_latency.last = latency;
+        instance->step_latency.count++;
+        instance->step_latency.average = instance->step_latency_total / instance->step_latency.count;
+    }
+
+    // Wait until we can continue. The mutex is unlocked while waiting since the thread is now halted, and it is locked again once we wake up.
+    // Wake up now and then to pick up symbols/labels that finished loading in the background, since the loop isn't
+    // running to do it while we're stopped here.
+    std::unique_lock<std::mutex> lock(instance->mutex, std::adopt_lock);
+    while(!instance->breakpoint_condition.wait_for(lock, std::chrono::milliseconds(100), [&instance]() { return instance->loop_finishing || instance->continue_text.has_value(); })) {
+        instance->pick_up_background_loads();
+    }
+    lock.release();
 
-        // Keep CPU usage low here
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // Exit if we need to
+    char *continue_text;
+    if(instance->loop_finishing) {
+        continue_text = malloc_string("continue");
+    }
+    else {
+        continue_text = malloc_string(instance->continue_text->c_str());
     }
     
-    // Unpause (mutex is locked from loop)
+    // Unpause (mutex is still locked)
     instance->continue_text = std::nullopt;
     return continue_text;
 }
@@ -374,6 +459,7 @@ void GameInstance::reset() noexcept {
     this->mutex.lock();
     this->reset_to_original_model();
     this->reset_audio();
+    this->bump_state_generations();
     this->mutex.unlock();
 }
 
@@ -384,6 +470,7 @@ void GameInstance::set_model(GB_model_t model, GB_border_mode_t border) {
     GB_set_border_mode(&this->gameboy, border);
     this->reset_audio();
     this->update_pixel_buffer_size();
+    this->bump_state_generations();
     this->mutex.unlock();
 }
 
@@ -417,6 +504,7 @@ void GameInstance::start_game_loop(GameInstance *instance) noexcept {
                 if(!GB_rewind_pop(&instance->gameboy)) { // if we can't rewind any further, pause until the user lets go of the rewind button
                     instance->rewind_paused = true;
                 }
+                instance->clear_time_travel();
                 instance->should_rewind = false;
             }
 
@@ -429,8 +517,69 @@ void GameInstance::start_game_loop(GameInstance *instance) noexcept {
                 button_bitfield = static_cast<decltype(button_bitfield)>(button_bitfield | instance->rapid_button_bitfield);
             }
 
+            // Log input for time travel, or play it back if we're running through history again
+            if(instance->time_travel_enabled) {
+                if(instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle) {
+                    instance->time_travel.record_input(instance->instructions_run, static_cast<std::uint8_t>(button_bitfield));
+                }
+                else {
+                    button_bitfield = static_cast<decltype(button_bitfield)>(instance->time_travel.get_input(instance->instructions_run));
+                }
+            }
+
             GB_set_key_mask(&instance->gameboy, button_bitfield);
-            GB_run(&instance->gameboy);
+            instance->instruction_run_this_step = false;
+
+            // Conditional breakpoints are checked here so we can stop before the instruction at PC runs. If an interrupt
+            // is about to be serviced instead, the instruction doesn't run until after RETI, so it's checked (and its hit
+            // counted) then instead.
+            if(instance->conditional_breakpoint_flags && instance->time_travel_phase != TimeTravelPhase::TimeTravelSeeking && !get_gb_halted(&instance->gameboy)) {
+                auto pc = get_16_bit_gb_register(&instance->gameboy, SM83Register::SM83_REG_PC);
+                if(instance->conditional_breakpoint_flags[pc] && !instance->interrupt_pending_without_mutex()) {
+                    if(instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle) {
+                        instance->check_conditional_breakpoints(pc);
+                    }
+
+                    // When running through history again for a reverse continue, hits were already counted the first
+                    // time, so just remember where any of them would have stopped
+                    else if(instance->time_travel_command == ReverseCommand::ReverseContinue && instance->instructions_run < instance->time_travel_scan_end && instance->conditional_breakpoint_matches(pc)) {
+                        instance->time_travel_candidate = std::pair<std::uint64_t, std::uint16_t>(instance->instructions_run, pc);
+                    }
+                }
+            }
+
+            // Same with run-to targets
+            if(instance->run_target != RunTarget::RunTargetNone && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle && instance->run_target_reached()) {
+                instance->run_target = RunTarget::RunTargetNone;
+                GB_debugger_break(&instance->gameboy);
+            }
+
+            if(instance->cpu_usage_enabled && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle) {
+                bool halted = get_gb_halted(&instance->gameboy) || get_gb_stopped(&instance->gameboy);
+                bool ime = get_gb_ime(&instance->gameboy);
+                auto cycles = GB_run(&instance->gameboy);
+                instance->cycle_count += cycles;
+                instance->cpu_usage.run(cycles, halted, ime && !get_gb_ime(&instance->gameboy), get_16_bit_gb_register(&instance->gameboy, SM83Register::SM83_REG_PC), get_16_bit_gb_register(&instance->gameboy, SM83Register::SM83_REG_SP));
+            }
+            else {
+                instance->cycle_count += GB_run(&instance->gameboy);
+            }
+
+            // Take a keyframe if it's time to
+            if(instance->time_travel_enabled && instance->instruction_run_this_step && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle && instance->instructions_run >= instance->next_keyframe) {
+                instance->take_keyframe();
+            }
+
+            // Sample what's running if it's time to
+            if(instance->sampling_profiler_enabled && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle && instance->cycle_count >= instance->next_profiler_sample) {
+                instance->take_profiler_sample();
+            }
+
+            // Let the debugger see what's going on while running too
+            if(instance->debug_snapshot_interval && instance->cycle_count >= instance->next_debug_snapshot) {
+                instance->publish_debug_snapshot();
+                instance->next_debug_snapshot = instance->cycle_count + instance->debug_snapshot_interval;
+            }
             
             // Wait until the end of GB_run to calculate frame rate
             if(instance->vblank_hit) {
@@ -457,6 +606,9 @@ void GameInstance::start_game_loop(GameInstance *instance) noexcept {
                 // Done
                 instance->vblank_hit = false;
 
+                // Pick up symbols/labels that finished loading so disassembly gets them without waiting for the UI to ask
+                instance->pick_up_background_loads();
+
                 // If we need to wait for a frame, do it
                 if(instance->turbo_mode_enabled) {
                     // Burn the thread until we get the next frame (I never said I was a good coder)
@@ -475,6 +627,7 @@ void GameInstance::start_game_loop(GameInstance *instance) noexcept {
 
         // If we're paused, we can sleep
         else {
+            instance->pick_up_background_loads();
             instance->mutex.unlock();
             std::this_thread::sleep_for(std::chrono::milliseconds(10));
             instance->mutex.lock();
@@ -533,11 +686,46 @@ std::vector<std::uint16_t> GameInstance::get_breakpoints_without_mutex() {
     for(std::size_t b = 0; b < bp_count; b++) {
         breakpoints[b] = get_gb_breakpoint_address(&this->gameboy, b);
     }
+    for(auto &b : this->conditional_breakpoints) {
+        breakpoints.emplace_back(b.breakpoint.address);
+    }
     return breakpoints;
 }
 
 std::vector<std::uint16_t> GameInstance::get_breakpoints() MAKE_GETTER(this->get_breakpoints_without_mutex())
 
+GameInstance::Generations GameInstance::get_generations() const noexcept {
+    return Generations {
+        this->breakpoints_generation.load(),
+        this->backtrace_generation.load(),
+        this->registers_generation.load(),
+        this->memory_generation.load(),
+        this->rom_generation.load()
+    };
+}
+
+void GameInstance::bump_execution_generations() noexcept {
+    // Publish before bumping so anyone who sees the new generations also sees the new snapshot
+    this->publish_debug_snapshot();
+
+    this->backtrace_generation++;
+    this->registers_generation++;
+    this->memory_generation++;
+
+    // Anything being watched may have changed too
+    if(!this->watch_expressions.empty()) {
+        this->evaluate_watches();
+    }
+}
+
+void GameInstance::bump_state_generations() noexcept {
+    this->bump_execution_generations();
+    this->bump_all_page_write_generations();
+    this->hook_banks_stale = true;
+    this->call_graph_profiler.reset_stack();
+    this->clear_time_travel();
+}
+
 bool GameInstance::read_pixel_buffer(std::uint32_t *destination, std::size_t destination_length) noexcept {
     this->vblank_mutex.lock();
 
@@ -585,6 +773,7 @@ void GameInstance::end_game_loop() noexcept {
     // Finish now
     this->loop_finishing = true;
     this->mutex.unlock();
+    this->breakpoint_condition.notify_all();
     
     bool finished = false;
     while(!finished) {
@@ -786,16 +975,122 @@ void GameInstance::unbreak(const char *command) {
         this->mutex.lock();
         this->continue_text = command;
         this->bp_paused = false;
+
+        // Measure how long it takes to come back if we're stepping
+        if(std::strcmp(command, "step") == 0 || std::strcmp(command, "next") == 0) {
+            this->step_started = clock::now();
+        }
+        else {
+            this->step_started = std::nullopt;
+        }
+
         this->mutex.unlock();
+        this->breakpoint_condition.notify_one();
+    }
+}
+
+void GameInstance::run_to_address(std::uint16_t address) noexcept {
+    this->mutex.lock();
+    this->begin_run_target_without_mutex(RunTarget::RunTargetAddress, address);
+    this->mutex.unlock();
+    this->breakpoint_condition.notify_one();
+}
+
+void GameInstance::run_frames(std::uint32_t frames) noexcept {
+    this->mutex.lock();
+    this->begin_run_target_without_mutex(RunTarget::RunTargetFrame, static_cast<std::uint64_t>(this->frame_count) + frames);
+    this->mutex.unlock();
+    this->breakpoint_condition.notify_one();
+}
+
+void GameInstance::run_cycles(std::uint64_t cycles) noexcept {
+    this->mutex.lock();
+    this->begin_run_target_without_mutex(RunTarget::RunTargetCycle, this->get_cycle_count_without_mutex() + cycles);
+    this->mutex.unlock();
+    this->breakpoint_condition.notify_one();
+}
+
+bool GameInstance::run_until(std::string_view condition, std::string &error) {
+    // Compile it before we lock anything (this also needs the mutex for the symbols)
+    BreakpointCondition compiled;
+    auto symbols = this->get_symbol_table();
+    if(!compiled.compile(condition, error, symbols.get())) {
+        return false;
+    }
+
+    this->mutex.lock();
+    this->begin_run_target_without_mutex(RunTarget::RunTargetCondition, 0);
+    this->run_target_condition = std::move(compiled);
+    this->mutex.unlock();
+    this->breakpoint_condition.notify_one();
+    return true;
+}
+
+void GameInstance::begin_run_target_without_mutex(RunTarget target, std::uint64_t value) noexcept {
+    this->run_target = target;
+    this->run_target_value = value;
+    this->run_target_started = this->cycle_count;
+    this->run_target_condition = std::nullopt;
+
+    // Continue if we're paused (the caller wakes up the game loop once the mutex is unlocked)
+    if(this->bp_paused) {
+        this->continue_text = "continue";
+        this->bp_paused = false;
+        this->step_started = std::nullopt;
+    }
+}
+
+bool GameInstance::run_target_reached() noexcept {
+    switch(this->run_target) {
+        case RunTarget::RunTargetNone:
+            return false;
+        case RunTarget::RunTargetFrame:
+            return this->frame_count >= this->run_target_value;
+        case RunTarget::RunTargetCycle:
+            return this->cycle_count >= this->run_target_value;
+        default:
+            break;
+    }
+
+    // Addresses and conditions are checked before an instruction, so there has to be one to check and we have to have run one already
+    if(get_gb_halted(&this->gameboy) || this->cycle_count == this->run_target_started) {
+        return false;
+    }
+
+    if(this->run_target == RunTarget::RunTargetAddress) {
+        return get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_PC) == this->run_target_value;
+    }
+    else {
+        return this->run_target_condition.has_value() && this->run_target_condition->evaluate(this->get_condition_state(), GameInstance::read_memory_for_condition, &this->gameboy);
     }
 }
 
+GameInstance::StepLatency GameInstance::get_step_latency() noexcept MAKE_GETTER(this->step_latency)
+
+bool GameInstance::wait_for_breakpoint_pause(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    return this->breakpoint_pause_condition.wait_for(lock, timeout, [this]() { return this->bp_paused.load(); });
+}
+
 std::uint16_t GameInstance::get_register_value(SM83Register reg) noexcept MAKE_GETTER(get_gb_register(&this->gameboy, reg))
-void GameInstance::set_register_value(SM83Register reg, std::uint16_t value) noexcept MAKE_SETTER(set_gb_register(&this->gameboy, reg, value))
+void GameInstance::set_register_value(SM83Register reg, std::uint16_t value) noexcept {
+    this->mutex.lock();
+    set_gb_register(&this->gameboy, reg, value);
+    this->publish_debug_snapshot();
+    this->registers_generation++;
+    if(!this->watch_expressions.empty()) {
+        this->evaluate_watches();
+    }
+    this->mutex.unlock();
+}
 
 std::optional<std::uint16_t> GameInstance::evaluate_expression(const char *expression) noexcept {
     std::uint16_t result_maybe;
-    if(GB_debugger_evaluate(&this->gameboy, expression, &result_maybe, nullptr) == 0) {
+    this->mutex.lock();
+    bool success = GB_debugger_evaluate(&this->gameboy, expression, &result_maybe, nullptr) == 0;
+    this->mutex.unlock();
+
+    if(success) {
         return result_maybe;
     }
     else {
@@ -803,6 +1098,60 @@ std::optional<std::uint16_t> GameInstance::evaluate_expression(const char *expre
     }
 }
 
+std::vector<std::string> GameInstance::set_watch_expressions(const std::vector<std::string> &expressions) {
+    // Compile everything before locking (getting the symbols needs the mutex too)
+    auto symbols = this->get_symbol_table();
+    std::vector<std::optional<BreakpointCondition>> compiled(expressions.size());
+    std::vector<std::string> errors(expressions.size());
+    for(std::size_t i = 0; i < expressions.size(); i++) {
+        if(!compiled[i].emplace().compile(expressions[i], errors[i], symbols.get())) {
+            compiled[i] = std::nullopt;
+        }
+    }
+
+    this->mutex.lock();
+    this->watch_expressions = std::move(compiled);
+    this->evaluate_watches();
+    this->mutex.unlock();
+
+    return errors;
+}
+
+BreakpointCondition::State GameInstance::get_condition_state() noexcept {
+    BreakpointCondition::State state;
+    state.af = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_AF);
+    state.bc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_BC);
+    state.de = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_DE);
+    state.hl = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_HL);
+    state.sp = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_SP);
+    state.pc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_PC);
+    return state;
+}
+
+std::uint8_t GameInstance::read_memory_for_condition(void *gameboy, std::uint16_t address) noexcept {
+    return GB_safe_read_memory(reinterpret_cast<GB_gameboy_s *>(gameboy), address);
+}
+
+void GameInstance::evaluate_watches() noexcept {
+    auto &values = this->watch_values.back();
+    values.values.resize(this->watch_expressions.size());
+
+    auto state = this->get_condition_state();
+    for(std::size_t i = 0; i < this->watch_expressions.size(); i++) {
+        auto &expression = this->watch_expressions[i];
+        if(expression.has_value()) {
+            values.values[i] = expression->calculate(state, GameInstance::read_memory_for_condition, &this->gameboy);
+        }
+        else {
+            values.values[i] = std::nullopt;
+        }
+    }
+
+    values.frame = this->frame_count;
+    values.generation = ++this->watch_values_generation;
+    this->watch_values.publish();
+}
+
 void GameInstance::assign_work_buffer() noexcept {
     GB_set_pixels_output(&this->gameboy, this->pixel_buffer[this->work_buffer].data());
 }
@@ -835,6 +1184,20 @@ void GameInstance::begin_loading_rom() noexcept {
     this->current_break_and_trace_remaining = 0;
     this->break_and_trace_result.clear();
     this->break_and_trace_breakpoints.clear();
+    this->pending_watchpoint_trace = std::nullopt;
+    this->update_break_and_trace_results_available();
+
+    // Anything logged was for the old ROM
+    this->code_data_logger.clear();
+    this->sampling_profiler.clear();
+    this->call_graph_profiler.clear();
+    this->timeline.clear();
+
+    // Don't wait for the old ROM's symbols to finish loading or for it to finish being analyzed
+    this->cancel_rom_analysis_if_running();
+    this->pending_symbol_table = {};
+    this->pending_rom_analysis = {};
+    this->rom_analysis = nullptr;
 
     // Pause SDL audio
     this->reset_audio();
@@ -845,6 +1208,11 @@ void GameInstance::begin_loading_rom() noexcept {
     // Reset frame times
     this->frame_time_index = 0;
     this->last_frame_time = clock::now();
+
+    // Everything is new
+    this->rom_generation++;
+    this->breakpoints_generation++;
+    this->bump_state_generations();
 }
 
 void GameInstance::load_rom(const std::byte *rom_data, const std::size_t rom_size, const std::optional<std::filesystem::path> &sram_path, const std::optional<std::filesystem::path> &symbol_path) noexcept {
@@ -872,6 +1240,40 @@ int GameInstance::load_isx(const std::filesystem::path &isx_path, const std::opt
     return result;
 }
 
+// Run something on its own thread. Unlike with std::async, the future doesn't wait for the thread when it's destroyed,
+// so throwing out a result that's still pending (e.g. when loading another ROM) never blocks.
+template<typename F> static auto run_in_background(F &&function) -> std::future<decltype(function())> {
+    std::promise<decltype(function())> promise;
+    auto future = promise.get_future();
+    std::thread([promise = std::move(promise), function = std::forward<F>(function)]() mutable {
+        try {
+            promise.set_value(function());
+        }
+        catch(...) {
+            promise.set_exception(std::current_exception());
+        }
+    }).detach();
+    return future;
+}
+
+// Hash a file's contents the same way ROMs are hashed (0 if it can't be read)
+static std::uint64_t hash_file(const std::filesystem::path &path) noexcept {
+    std::FILE *f = std::fopen(path.string().c_str(), "rb");
+    if(f == nullptr) {
+        return 0;
+    }
+
+    std::vector<std::uint8_t> data;
+    std::uint8_t buffer[4096];
+    std::size_t read;
+    while((read = std::fread(buffer, 1, sizeof(buffer), f)) > 0) {
+        data.insert(data.end(), buffer, buffer + read);
+    }
+    std::fclose(f);
+
+    return RomAnalysis::hash_rom(data.data(), data.size());
+}
+
 void GameInstance::load_save_and_symbols(const std::optional<std::filesystem::path> &sram_path, const std::optional<std::filesystem::path> &symbol_path) {
     GB_debugger_clear_symbols(&this->gameboy);
     this->rom_loaded = true;
@@ -879,8 +1281,109 @@ void GameInstance::load_save_and_symbols(const std::optional<std::filesystem::pa
     if(sram_path.has_value()) {
         GB_load_battery(&this->gameboy, sram_path->string().c_str());
     }
+
+    // Our own symbol table is only used for display, so it can finish loading in the background
+    this->symbol_table = std::make_shared<SymbolTable>();
     if(symbol_path.has_value()) {
         GB_debugger_load_symbol_file(&this->gameboy, symbol_path->string().c_str());
+        this->pending_symbol_table = run_in_background([path = *symbol_path]() {
+            auto symbol_table = std::make_shared<SymbolTable>();
+            symbol_table->load(path);
+            return std::shared_ptr<const SymbolTable>(std::move(symbol_table));
+        }).share();
+    }
+    else {
+        this->pending_symbol_table = {};
+    }
+
+    this->begin_rom_analysis(symbol_path);
+}
+
+void GameInstance::begin_rom_analysis(const std::optional<std::filesystem::path> &symbol_path) {
+    std::size_t rom_size;
+    std::uint16_t rom_bank;
+    auto *rom = static_cast<const std::uint8_t *>(GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_ROM, &rom_size, &rom_bank));
+    if(rom == nullptr || rom_size == 0) {
+        return;
+    }
+
+    this->cancel_rom_analysis = std::make_shared<std::atomic_bool>(false);
+    this->pending_rom_analysis = run_in_background([rom = std::vector<std::uint8_t>(rom, rom + rom_size), symbols = this->pending_symbol_table, symbol_path, cache_directory = this->analysis_cache_directory, cancel = this->cancel_rom_analysis]() {
+        RomAnalysisResult result;
+
+        // Anything that already has a symbol doesn't need a label
+        result.symbols = symbols.valid() ? symbols.get() : std::make_shared<const SymbolTable>();
+
+        // Analyzing a big ROM takes a bit, so reuse the last analysis if we have one. Labels are only generated for
+        // what the symbol file doesn't name, so a cached analysis is only good for the same symbol file.
+        auto hash = RomAnalysis::hash_rom(rom.data(), rom.size());
+        char name[48];
+        if(symbol_path.has_value()) {
+            std::snprintf(name, sizeof(name), "%016llx-%016llx", static_cast<unsigned long long>(hash), static_cast<unsigned long long>(hash_file(*symbol_path)));
+        }
+        else {
+            std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+        }
+        if(cache_directory.has_value()) {
+            result.analysis = RomAnalysis::load(*cache_directory / (std::string(name) + ".analysis"), hash, result.symbols.get());
+        }
+        if(result.analysis == nullptr) {
+            result.analysis = RomAnalysis::analyze(rom.data(), rom.size(), result.symbols.get(), cancel.get());
+            if(result.analysis == nullptr) {
+                return result;
+            }
+            if(cache_directory.has_value()) {
+                std::error_code ec;
+                std::filesystem::create_directories(*cache_directory, ec);
+                result.analysis->save(*cache_directory / (std::string(name) + ".analysis"));
+            }
+        }
+
+        // SameBoy can only load symbols from a file, so the labels need to be written out to be used in disassembly
+        if(cache_directory.has_value() && !result.analysis->get_labels().empty()) {
+            auto labels_path = *cache_directory / (std::string(name) + ".sym");
+            if(result.analysis->save_labels(labels_path)) {
+                std::vector<std::filesystem::path> paths;
+                if(symbol_path.has_value()) {
+                    paths.emplace_back(*symbol_path);
+                }
+                paths.emplace_back(labels_path);
+
+                auto merged = std::make_shared<SymbolTable>();
+                merged->load(paths);
+                result.symbols = std::move(merged);
+                result.labels_path = labels_path;
+            }
+        }
+
+        return result;
+    });
+}
+
+void GameInstance::cancel_rom_analysis_if_running() noexcept {
+    if(this->cancel_rom_analysis) {
+        *this->cancel_rom_analysis = true;
+    }
+}
+
+void GameInstance::pick_up_background_loads() {
+    if(this->pending_symbol_table.valid() && this->pending_symbol_table.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        this->symbol_table = this->pending_symbol_table.get();
+        this->pending_symbol_table = {};
+    }
+
+    if(this->pending_rom_analysis.valid() && this->pending_rom_analysis.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        auto result = this->pending_rom_analysis.get();
+        this->rom_analysis = std::move(result.analysis);
+        if(result.symbols) {
+            this->symbol_table = std::move(result.symbols);
+        }
+
+        // Disassembly needs to be redone with the new labels
+        if(result.labels_path.has_value()) {
+            GB_debugger_load_symbol_file(&this->gameboy, result.labels_path->string().c_str());
+            this->rom_generation++;
+        }
     }
 }
 
@@ -903,6 +1406,10 @@ std::string GameInstance::execute_command(const char *command) {
     
     // Execute
     auto logs = this->execute_command_without_mutex(cmd);
+
+    // A command can change just about anything
+    this->breakpoints_generation++;
+    this->bump_state_generations();
     
     // Unlock mutex
     this->mutex.unlock();
@@ -925,61 +1432,966 @@ std::string GameInstance::disassemble_without_mutex(std::uint16_t address, std::
 
 std::string GameInstance::disassemble_address(std::uint16_t address, std::uint8_t count) MAKE_GETTER(disassemble_without_mutex(address, count))
 
-std::size_t GameInstance::get_pixel_buffer_size_without_mutex() noexcept {
-    return GB_get_screen_width(&this->gameboy) * GB_get_screen_height(&this->gameboy);
-}
-bool GameInstance::set_up_sdl_audio(std::uint32_t sample_rate, std::uint32_t buffer_size) noexcept {
+std::string GameInstance::disassemble_address(std::uint16_t address, std::uint8_t count, MappedBanks &banks) {
     this->mutex.lock();
-    SDL_AudioSpec request = {}, result = {}, preferred = {};
-    request.format = AUDIO_S16SYS;
-    request.channels = 2;
-    request.userdata = this;
+    banks = this->get_mapped_banks_without_mutex();
+    auto result = this->disassemble_without_mutex(address, count);
+    this->mutex.unlock();
+    return result;
+}
 
-    SDL_GetAudioDeviceSpec(0, 0, &preferred);
-    request.freq = preferred.freq;
-    request.samples = preferred.samples;
+GameInstance::MappedBanks GameInstance::get_mapped_banks() noexcept MAKE_GETTER(this->get_mapped_banks_without_mutex())
+
+void GameInstance::publish_debug_snapshot() noexcept {
+    DebugSnapshot snapshot = {};
+    snapshot.cycle = this->get_cycle_count_without_mutex();
+    snapshot.frame = this->frame_count;
+    snapshot.af = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_AF);
+    snapshot.bc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_BC);
+    snapshot.de = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_DE);
+    snapshot.hl = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_HL);
+    snapshot.sp = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_SP);
+    snapshot.pc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_PC);
+    snapshot.ime = get_gb_ime(&this->gameboy);
+    snapshot.halted = get_gb_halted(&this->gameboy);
+    snapshot.interrupt_enable = GB_safe_read_memory(&this->gameboy, 0xFFFF);
+    snapshot.interrupt_flags = get_gb_io_register(&this->gameboy, GB_IO_IF);
+    snapshot.lcdc = get_gb_io_register(&this->gameboy, GB_IO_LCDC);
+    snapshot.stat = get_gb_io_register(&this->gameboy, GB_IO_STAT);
+    snapshot.ly = get_gb_io_register(&this->gameboy, GB_IO_LY);
+    snapshot.banks = this->get_mapped_banks_without_mutex();
+    this->debug_snapshot.store(snapshot);
+}
+
+void GameInstance::set_debug_snapshot_rate(std::uint32_t per_second) noexcept {
+    this->mutex.lock();
+    this->debug_snapshot_interval = per_second == 0 ? 0 : std::max<std::uint64_t>(CYCLES_PER_SECOND / per_second, 1);
+    this->next_debug_snapshot = this->cycle_count + this->debug_snapshot_interval;
+    this->mutex.unlock();
+}
 
-    int flags = 0;
+GameInstance::MappedBanks GameInstance::get_mapped_banks_without_mutex() noexcept {
+    MappedBanks banks = {};
+    std::size_t size;
+    banks.rom0 = get_gb_rom0_bank(&this->gameboy);
+    GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_ROM, &size, &banks.romx);
+    GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_VRAM, &size, &banks.vram);
+    GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_CART_RAM, &size, &banks.sram);
+    GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_RAM, &size, &banks.wram);
+    return banks;
+}
 
-    if(sample_rate != 0) {
-        request.freq = sample_rate;
-        flags |= SDL_AUDIO_ALLOW_FREQUENCY_CHANGE;
+std::uint16_t GameInstance::MappedBanks::bank_for_address(std::uint16_t address) const noexcept {
+    if(address < 0x4000) {
+        return this->rom0;
     }
-
-    if(buffer_size != 0) {
-        request.samples = buffer_size;
-        flags |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+    else if(address < 0x8000) {
+        return this->romx;
     }
+    else if(address < 0xA000) {
+        return this->vram;
+    }
+    else if(address < 0xC000) {
+        return this->sram;
+    }
+    else if((address >= 0xD000 && address < 0xE000) || (address >= 0xF000 && address < 0xFE00)) {
+        return this->wram;
+    }
+    else {
+        return 0;
+    }
+}
 
-    auto device = SDL_OpenAudioDevice(0, 0, &request, &result, flags);
-    if(device != 0) {
-        this->close_sdl_audio_device();
+std::uint8_t GameInstance::on_read_memory(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t data) noexcept {
+    auto *instance = resolve_instance(gameboy);
 
-        // Now...
-        this->set_current_sample_rate(result.freq);
-        this->sdl_audio_device = device;
-        this->sdl_audio_buffer_size = result.samples;
-        this->sample_buffer.reserve(this->current_sample_rate); // reserve one second
-        GB_set_sample_rate(&this->gameboy, this->current_sample_rate);
+    if(instance->watchpoint_flags && (instance->watchpoint_flags[address] & WatchpointType::WatchpointRead)) {
+        instance->check_watchpoint(address, data, WatchpointType::WatchpointRead);
     }
 
-    this->mutex.unlock();
-    return device > 0;
-}
+    // Opcode and operand fetches are read with PC already incremented past them; those are logged by on_execution()
+    if(instance->code_data_logging_enabled && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle && static_cast<std::uint16_t>(address + 1) != get_16_bit_gb_register(gameboy, SM83Register::SM83_REG_PC)) {
+        instance->log_code_data(address, CodeDataLogger::AccessData);
+    }
 
-int GameInstance::get_volume() noexcept MAKE_GETTER(this->volume)
-void GameInstance::set_volume(int volume) noexcept {
-    this->mutex.lock();
-    this->volume = std::min(100, std::max(0, volume)); // clamp from 0 to 100
-    this->volume_scale = std::pow(100.0, this->volume / 100.0) / 100.0 - 0.01 * (100.0 - this->volume) / 100.0; // convert between logarithmic volume and linear volume
-    this->mutex.unlock();
+    return data;
 }
 
-bool GameInstance::is_mono_forced() noexcept MAKE_GETTER(this->force_mono)
-void GameInstance::set_mono_forced(bool mono) noexcept MAKE_SETTER(this->force_mono = mono)
+bool GameInstance::on_write_memory(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t data) noexcept {
+    auto *instance = resolve_instance(gameboy);
 
-GameInstance::PixelBufferMode GameInstance::get_pixel_buffering_mode() noexcept MAKE_GETTER(this->pixel_buffer_mode)
-void GameInstance::set_pixel_buffering_mode(PixelBufferMode mode) noexcept MAKE_SETTER(this->pixel_buffer_mode = mode)
+    if(instance->write_tracking_enabled && address >= 0x8000) {
+        instance->page_write_generation[address >> 8].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if(instance->watchpoint_flags && (instance->watchpoint_flags[address] & WatchpointType::WatchpointWrite)) {
+        instance->check_watchpoint(address, data, WatchpointType::WatchpointWrite);
+    }
+
+    if(instance->timeline_enabled && instance->time_travel_phase == TimeTravelPhase::TimeTravelIdle) {
+        instance->record_timeline_write(address, data);
+    }
+
+    // MBC, VBK, SVBK, and boot ROM writes can change what is mapped (this is called before the write, so check it later)
+    if(address < 0x8000 || address == 0xFF4F || address == 0xFF50 || address == 0xFF70) {
+        instance->hook_banks_stale = true;
+    }
+
+    return true;
+}
+
+void GameInstance::on_execution(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t opcode) noexcept {
+    auto *instance = resolve_instance(gameboy);
+
+    // History being run through again when running backwards was already logged and profiled the first time
+    bool replaying = instance->time_travel_phase != TimeTravelPhase::TimeTravelIdle;
+
+    if(instance->code_data_logging_enabled && !replaying) {
+        instance->log_code_data(address, CodeDataLogger::AccessExecuted);
+        auto length = SM83::instruction_length(opcode);
+        for(std::uint8_t i = 1; i < length; i++) {
+            instance->log_code_data(static_cast<std::uint16_t>(address + i), CodeDataLogger::AccessOperand);
+        }
+    }
+
+    if(instance->call_graph_profiler_enabled && !replaying) {
+        if(instance->hook_banks_stale) {
+            instance->refresh_hook_banks();
+        }
+        auto sp = get_16_bit_gb_register(gameboy, SM83Register::SM83_REG_SP);
+        instance->call_graph_profiler.instruction(address, instance->hook_banks.bank_for_address(address), opcode, sp, instance->get_cycle_count_without_mutex());
+    }
+
+    if(instance->timeline_enabled && !replaying) {
+        instance->poll_timeline(address);
+    }
+
+    if(instance->trace_recording && !replaying) {
+        instance->record_trace(address, opcode);
+    }
+
+    if(instance->time_travel_enabled) {
+        auto position = instance->instructions_run++;
+        instance->instruction_run_this_step = true;
+
+        switch(instance->time_travel_phase) {
+            case TimeTravelPhase::TimeTravelIdle:
+                break;
+            case TimeTravelPhase::TimeTravelScanning:
+                // For reverse next, remember the last instruction run at the same depth or shallower
+                if(instance->time_travel_command == ReverseCommand::ReverseNext && get_16_bit_gb_register(gameboy, SM83Register::SM83_REG_SP) >= instance->time_travel_origin_sp) {
+                    instance->time_travel_candidate = std::pair<std::uint64_t, std::uint16_t>(position, address);
+                }
+                if(instance->instructions_run == instance->time_travel_scan_end) {
+                    GB_debugger_break(gameboy);
+                }
+                break;
+            case TimeTravelPhase::TimeTravelSeeking:
+                if(instance->instructions_run == instance->time_travel_target) {
+                    GB_debugger_break(gameboy);
+                }
+                break;
+        }
+    }
+}
+
+void GameInstance::poll_timeline(std::uint16_t address) noexcept {
+    auto interrupts = static_cast<std::uint8_t>(get_gb_io_register(&this->gameboy, GB_IO_IF) & 0x1F);
+    auto lcd_mode = static_cast<std::uint8_t>(get_gb_io_register(&this->gameboy, GB_IO_STAT) & 0x3);
+    if(interrupts == this->timeline_interrupts && lcd_mode == this->timeline_lcd_mode) {
+        return;
+    }
+
+    auto now = this->get_cycle_count_without_mutex();
+    auto line = get_gb_io_register(&this->gameboy, GB_IO_LY);
+
+    auto requested = interrupts & ~this->timeline_interrupts;
+    auto cleared = this->timeline_interrupts & ~interrupts;
+    for(std::uint8_t bit = 0; bit < 5; bit++) {
+        auto mask = 1 << bit;
+        if(requested & mask) {
+            this->timeline.record(now, line, Timeline::EventInterruptRequested, bit);
+            if(bit == 2) {
+                this->timeline.record(now, line, Timeline::EventTimerOverflow, 0);
+            }
+            else if(bit == 3) {
+                this->timeline.record(now, line, Timeline::EventSerialComplete, 0);
+            }
+        }
+
+        // Interrupts are acknowledged by jumping to their vector (otherwise the game cleared IF itself)
+        if((cleared & mask) && address == 0x40 + bit * 8) {
+            this->timeline.record(now, line, Timeline::EventInterruptServiced, bit);
+        }
+    }
+
+    if(lcd_mode != this->timeline_lcd_mode) {
+        this->timeline.record(now, line, Timeline::EventLCDMode, lcd_mode);
+    }
+
+    this->timeline_interrupts = interrupts;
+    this->timeline_lcd_mode = lcd_mode;
+}
+
+void GameInstance::record_timeline_write(std::uint16_t address, std::uint8_t data) noexcept {
+    Timeline::EventType type;
+    std::uint16_t value = data;
+
+    if(address >= 0x2000 && address < 0x4000) {
+        type = Timeline::EventROMBank;
+    }
+    else if(address >= 0x4000 && address < 0x6000) {
+        type = Timeline::EventRAMBank;
+    }
+    else if(address == 0xFF46) {
+        type = Timeline::EventOAMDMA;
+        value = static_cast<std::uint16_t>(data << 8);
+    }
+    else if(address == 0xFF55) {
+        type = (data & 0x80) ? Timeline::EventHDMA : Timeline::EventGDMA;
+        value = static_cast<std::uint16_t>((data & 0x7F) + 1);
+    }
+    else if(address == 0xFF02 && (data & 0x80)) {
+        type = Timeline::EventSerialStart;
+    }
+    else {
+        return;
+    }
+
+    this->timeline.record(this->get_cycle_count_without_mutex(), get_gb_io_register(&this->gameboy, GB_IO_LY), type, value);
+}
+
+void GameInstance::record_trace(std::uint16_t address, std::uint8_t opcode) noexcept {
+    if(this->hook_banks_stale) {
+        this->refresh_hook_banks();
+    }
+
+    TraceRecord record;
+    record.cycle = this->get_cycle_count_without_mutex();
+    record.frame = this->frame_count;
+    record.bank = this->hook_banks.bank_for_address(address);
+    record.pc = address;
+    record.sp = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_SP);
+    record.af = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_AF);
+    record.bc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_BC);
+    record.de = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_DE);
+    record.hl = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_HL);
+    record.opcode = opcode;
+
+    // If this fails (e.g. out of disk space), stop_trace_recording() will report it
+    this->trace_writer.append(record);
+}
+
+void GameInstance::update_memory_hooks() noexcept {
+    bool need_read_hook = this->code_data_logging_enabled || (this->watchpoint_types & WatchpointType::WatchpointRead);
+    bool need_write_hook = this->code_data_logging_enabled || this->call_graph_profiler_enabled || this->trace_recording || this->write_tracking_enabled || this->timeline_enabled || (this->watchpoint_types & WatchpointType::WatchpointWrite);
+    bool need_execution_hook = this->code_data_logging_enabled || this->call_graph_profiler_enabled || this->trace_recording || this->time_travel_enabled || this->timeline_enabled;
+    GB_set_read_memory_callback(&this->gameboy, need_read_hook ? GameInstance::on_read_memory : nullptr);
+    GB_set_write_memory_callback(&this->gameboy, need_write_hook ? GameInstance::on_write_memory : nullptr);
+    GB_set_execution_callback(&this->gameboy, need_execution_hook ? GameInstance::on_execution : nullptr);
+}
+
+void GameInstance::check_watchpoint(std::uint16_t address, std::uint8_t value, WatchpointType type) noexcept {
+    // Something's here, but we need to find out what since there may be a value condition
+    for(auto &w : this->watchpoints) {
+        if(!(w.type & type) || address < w.start || address > w.end || (w.value.has_value() && *w.value != value)) {
+            continue;
+        }
+
+        // Running through history again, this was already counted the first time, but reverse continue still needs to
+        // stop here to know it was hit
+        if(this->time_travel_phase != TimeTravelPhase::TimeTravelIdle) {
+            GB_debugger_break(&this->gameboy);
+            return;
+        }
+
+        auto &hit = this->last_watchpoint_hit.emplace();
+        hit.address = address;
+        hit.value = value;
+        hit.type = type;
+        hit.pc = get_gb_register(&this->gameboy, SM83Register::SM83_REG_PC);
+        hit.hit_number = ++this->watchpoint_hit_count;
+
+        // If we're already tracing, just keep going
+        if(this->current_break_and_trace_remaining > 0) {
+            return;
+        }
+
+        if(w.trace_count > 0) {
+            this->pending_watchpoint_trace = w;
+        }
+
+        // Break once the current instruction finishes
+        GB_debugger_break(&this->gameboy);
+        return;
+    }
+}
+
+void GameInstance::rebuild_watchpoint_index() noexcept {
+    this->watchpoint_types = 0;
+
+    if(this->watchpoints.empty()) {
+        this->watchpoint_flags.reset();
+    }
+    else {
+        if(!this->watchpoint_flags) {
+            this->watchpoint_flags = std::make_unique<std::uint8_t[]>(0x10000);
+        }
+        std::memset(this->watchpoint_flags.get(), 0, 0x10000);
+
+        for(auto &w : this->watchpoints) {
+            for(std::uint32_t a = w.start; a <= w.end; a++) {
+                this->watchpoint_flags[a] |= w.type;
+            }
+            this->watchpoint_types |= w.type;
+        }
+    }
+
+    this->update_memory_hooks();
+}
+
+void GameInstance::add_watchpoint(const Watchpoint &watchpoint) {
+    this->mutex.lock();
+    auto &w = this->watchpoints.emplace_back(watchpoint);
+    if(w.start > w.end) {
+        std::swap(w.start, w.end);
+    }
+    this->rebuild_watchpoint_index();
+    this->mutex.unlock();
+}
+
+std::vector<GameInstance::Watchpoint> GameInstance::get_watchpoints() MAKE_GETTER(this->watchpoints)
+
+void GameInstance::remove_watchpoint(std::size_t index) {
+    this->mutex.lock();
+    if(index < this->watchpoints.size()) {
+        this->watchpoints.erase(this->watchpoints.begin() + index);
+        this->rebuild_watchpoint_index();
+    }
+    this->mutex.unlock();
+}
+
+void GameInstance::remove_all_watchpoints() {
+    this->mutex.lock();
+    this->watchpoints.clear();
+    this->pending_watchpoint_trace = std::nullopt;
+    this->rebuild_watchpoint_index();
+    this->mutex.unlock();
+}
+
+std::optional<GameInstance::WatchpointHit> GameInstance::get_last_watchpoint_hit() MAKE_GETTER(this->last_watchpoint_hit)
+
+// Find where in the code/data log an address goes
+static inline bool code_data_location(std::uint16_t address, const GameInstance::MappedBanks &banks, CodeDataLogger::Region &region, std::size_t &offset) noexcept {
+    if(address < 0x4000) {
+        region = CodeDataLogger::RegionROM;
+        offset = banks.rom0 * 0x4000 + address;
+    }
+    else if(address < 0x8000) {
+        region = CodeDataLogger::RegionROM;
+        offset = banks.romx * 0x4000 + (address - 0x4000);
+    }
+    else if(address < 0xA000) {
+        region = CodeDataLogger::RegionVRAM;
+        offset = banks.vram * 0x2000 + (address - 0x8000);
+    }
+    else if(address < 0xC000) {
+        region = CodeDataLogger::RegionCartRAM;
+        offset = banks.sram * 0x2000 + (address - 0xA000);
+    }
+    else if(address < 0xFE00) {
+        // $E000-$FDFF mirrors $C000-$DDFF
+        region = CodeDataLogger::RegionWRAM;
+        offset = (address - 0xC000) & 0x1FFF;
+        if(offset >= 0x1000) {
+            offset = banks.wram * 0x1000 + (offset - 0x1000);
+        }
+    }
+    else if(address >= 0xFF80 && address < 0xFFFF) {
+        region = CodeDataLogger::RegionHRAM;
+        offset = address - 0xFF80;
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+void GameInstance::log_code_data(std::uint16_t address, CodeDataLogger::Access access) noexcept {
+    if(this->hook_banks_stale) {
+        this->refresh_hook_banks();
+    }
+
+    // The boot ROM isn't part of the cartridge
+    if(this->hook_boot_rom_mapped) {
+        return;
+    }
+
+    CodeDataLogger::Region region;
+    std::size_t offset;
+    if(code_data_location(address, this->hook_banks, region, offset)) {
+        this->code_data_logger.mark(region, offset, access);
+    }
+}
+
+void GameInstance::refresh_hook_banks() noexcept {
+    static const GB_direct_access_t ACCESS[] = {
+        GB_DIRECT_ACCESS_ROM,
+        GB_DIRECT_ACCESS_VRAM,
+        GB_DIRECT_ACCESS_CART_RAM,
+        GB_DIRECT_ACCESS_RAM,
+        GB_DIRECT_ACCESS_HRAM
+    };
+    static_assert(sizeof(ACCESS) / sizeof(ACCESS[0]) == CodeDataLogger::RegionCount);
+
+    // Sizes can change if the model changes
+    for(std::size_t r = 0; r < CodeDataLogger::RegionCount; r++) {
+        std::size_t size = 0;
+        std::uint16_t bank;
+        if(GB_get_direct_access(&this->gameboy, ACCESS[r], &size, &bank) == nullptr) {
+            size = 0;
+        }
+        this->code_data_logger.resize(static_cast<CodeDataLogger::Region>(r), size);
+    }
+
+    this->hook_banks = this->get_mapped_banks_without_mutex();
+    this->hook_boot_rom_mapped = !get_gb_boot_rom_finished(&this->gameboy);
+    this->hook_banks_stale = false;
+}
+
+void GameInstance::set_code_data_logging_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->code_data_logging_enabled != enabled) {
+        this->code_data_logging_enabled = enabled;
+        this->hook_banks_stale = true;
+        this->update_memory_hooks();
+    }
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_code_data_logging_enabled() noexcept MAKE_GETTER(this->code_data_logging_enabled)
+
+void GameInstance::clear_code_data_log() noexcept MAKE_SETTER(this->code_data_logger.clear())
+
+bool GameInstance::load_code_data_log(const std::filesystem::path &path) {
+    this->mutex.lock();
+    this->refresh_hook_banks(); // make sure the sizes are known so we can tell what lines up
+    bool result = this->code_data_logger.load(path);
+    this->mutex.unlock();
+    return result;
+}
+
+bool GameInstance::save_code_data_log(const std::filesystem::path &path) MAKE_GETTER(this->code_data_logger.save(path))
+
+void GameInstance::get_code_data_flags(std::uint16_t start, std::size_t length, const MappedBanks &banks, std::uint8_t *flags) {
+    this->mutex.lock();
+    for(std::size_t i = 0; i < length; i++) {
+        CodeDataLogger::Region region;
+        std::size_t offset;
+        flags[i] = code_data_location(static_cast<std::uint16_t>(start + i), banks, region, offset) ? this->code_data_logger.get(region, offset) : 0;
+    }
+    this->mutex.unlock();
+}
+
+void GameInstance::take_profiler_sample() {
+    // Callers (outermost first), then where we are now
+    auto &stack = this->profiler_stack;
+    stack.clear();
+
+    std::size_t depth = get_gb_backtrace_size(&this->gameboy);
+    for(std::size_t b = 1; b < depth; b++) {
+        stack.emplace_back(SamplingProfiler::make_location(get_gb_backtrace_bank(&this->gameboy, b), get_gb_backtrace_address(&this->gameboy, b)));
+    }
+
+    auto pc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_PC);
+    stack.emplace_back(SamplingProfiler::make_location(this->get_mapped_banks_without_mutex().bank_for_address(pc), pc));
+
+    this->sampling_profiler.sample(stack.data(), stack.size());
+
+    // If we're way behind (e.g. we were paused), don't try to catch up
+    this->next_profiler_sample = this->cycle_count + this->sampling_profiler_period;
+}
+
+void GameInstance::set_sampling_profiler_enabled(bool enabled, std::uint32_t period) noexcept {
+    this->mutex.lock();
+    this->sampling_profiler_enabled = enabled;
+    this->sampling_profiler_period = std::max(period, static_cast<std::uint32_t>(1));
+    this->next_profiler_sample = this->cycle_count + this->sampling_profiler_period;
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_sampling_profiler_enabled() noexcept MAKE_GETTER(this->sampling_profiler_enabled)
+
+void GameInstance::clear_sampling_profile() MAKE_SETTER(this->sampling_profiler.clear())
+
+SamplingProfiler::Profile GameInstance::get_sampling_profile() MAKE_GETTER(this->sampling_profiler.get_profile())
+
+std::shared_ptr<const SymbolTable> GameInstance::get_symbol_table() {
+    this->mutex.lock();
+    this->pick_up_background_loads();
+    auto symbol_table = this->symbol_table;
+    this->mutex.unlock();
+    return symbol_table;
+}
+
+void GameInstance::set_analysis_cache_directory(const std::filesystem::path &directory) MAKE_SETTER(this->analysis_cache_directory = directory)
+
+std::shared_ptr<const RomAnalysis> GameInstance::get_rom_analysis() {
+    this->mutex.lock();
+    this->pick_up_background_loads();
+    auto rom_analysis = this->rom_analysis;
+    this->mutex.unlock();
+    return rom_analysis;
+}
+
+void GameInstance::set_call_graph_profiler_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->call_graph_profiler_enabled != enabled) {
+        this->call_graph_profiler_enabled = enabled;
+        this->call_graph_profiler.reset_stack();
+        this->hook_banks_stale = true;
+        this->update_memory_hooks();
+    }
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_call_graph_profiler_enabled() noexcept MAKE_GETTER(this->call_graph_profiler_enabled)
+
+void GameInstance::clear_call_graph_profile() MAKE_SETTER(this->call_graph_profiler.clear())
+
+CallGraphProfiler::Profile GameInstance::get_call_graph_profile() MAKE_GETTER(this->call_graph_profiler.get_profile())
+
+void GameInstance::set_cpu_usage_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->cpu_usage_enabled != enabled) {
+        if(enabled) {
+            this->cpu_usage.reset();
+        }
+        this->cpu_usage_enabled = enabled;
+    }
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_cpu_usage_enabled() noexcept MAKE_GETTER(this->cpu_usage_enabled)
+
+void GameInstance::set_timeline_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->timeline_enabled != enabled) {
+        // Nothing is allocated until the timeline is first used
+        if(enabled) {
+            this->timeline.set_capacity(TIMELINE_FRAMES, TIMELINE_EVENTS_PER_FRAME);
+            this->timeline.begin_frame(this->frame_count, this->get_cycle_count_without_mutex());
+            this->timeline_interrupts = static_cast<std::uint8_t>(get_gb_io_register(&this->gameboy, GB_IO_IF) & 0x1F);
+            this->timeline_lcd_mode = static_cast<std::uint8_t>(get_gb_io_register(&this->gameboy, GB_IO_STAT) & 0x3);
+        }
+        this->timeline_enabled = enabled;
+        this->update_memory_hooks();
+    }
+    this->mutex.unlock();
+}
+
+void GameInstance::set_scanline_capture_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->scanline_capture_enabled != enabled) {
+        this->scanline_capture_enabled = enabled;
+        for(auto &capture : this->scanline_capture) {
+            for(auto &line : capture) {
+                line.captured = false;
+            }
+        }
+        GB_set_lcd_line_callback(&this->gameboy, enabled ? GameInstance::on_lcd_line : nullptr);
+    }
+    this->mutex.unlock();
+}
+
+GameInstance::ScanlineCapture GameInstance::get_scanline_capture() noexcept MAKE_GETTER(this->scanline_capture[this->scanline_capture_back ^ 1])
+
+// Fast hash for telling whether memory changed (not for anything that has to resist collisions on purpose)
+static std::uint64_t hash_memory(const void *data, std::size_t size, std::uint64_t hash = 0xCBF29CE484222325) noexcept {
+    auto *bytes = reinterpret_cast<const std::uint8_t *>(data);
+    std::size_t i = 0;
+    for(; i + sizeof(std::uint64_t) <= size; i += sizeof(std::uint64_t)) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15;
+        hash ^= hash >> 32;
+    }
+    for(; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+GameInstance::VideoHashes GameInstance::get_video_hashes() noexcept {
+    VideoHashes hashes = {};
+
+    this->mutex.lock();
+
+    std::size_t size = 0;
+    const auto *vram = reinterpret_cast<const std::uint8_t *>(GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_VRAM, &size, nullptr));
+    for(std::size_t bank = 0; bank < 2 && (bank + 1) * 0x2000 <= size; bank++) {
+        hashes.tiles[bank] = hash_memory(vram + bank * 0x2000, 0x1800);
+        hashes.tilemaps[bank] = hash_memory(vram + bank * 0x2000 + 0x1800, 0x800);
+    }
+
+    const auto *oam = GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_OAM, &size, nullptr);
+    hashes.oam = hash_memory(oam, std::min<std::size_t>(size, 0xA0));
+
+    // CGB palette memory, and then the colors they're drawn with (which also covers DMG palettes)
+    std::uint64_t palettes = 0xCBF29CE484222325;
+    if(GB_is_cgb(&this->gameboy)) {
+        const auto *bgp = GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_BGP, &size, nullptr);
+        palettes = hash_memory(bgp, size, palettes);
+        const auto *obp = GB_get_direct_access(&this->gameboy, GB_DIRECT_ACCESS_OBP, &size, nullptr);
+        palettes = hash_memory(obp, size, palettes);
+    }
+    for(unsigned char i = 0; i < 8; i++) {
+        palettes = hash_memory(get_gb_palette(&this->gameboy, GB_PALETTE_BACKGROUND, i), sizeof(std::uint32_t) * 4, palettes);
+        palettes = hash_memory(get_gb_palette(&this->gameboy, GB_PALETTE_OAM, i), sizeof(std::uint32_t) * 4, palettes);
+    }
+    hashes.palettes = palettes;
+
+    // Leave out STAT and LY since they change constantly without changing anything drawn
+    const std::uint8_t lcd_registers[] = {
+        get_gb_io_register(&this->gameboy, GB_IO_LCDC),
+        get_gb_io_register(&this->gameboy, GB_IO_SCY),
+        get_gb_io_register(&this->gameboy, GB_IO_SCX),
+        get_gb_io_register(&this->gameboy, GB_IO_BGP),
+        get_gb_io_register(&this->gameboy, GB_IO_OBP0),
+        get_gb_io_register(&this->gameboy, GB_IO_OBP1),
+        get_gb_io_register(&this->gameboy, GB_IO_WY),
+        get_gb_io_register(&this->gameboy, GB_IO_WX),
+        static_cast<std::uint8_t>(GB_is_cgb(&this->gameboy) | GB_is_cgb_in_cgb_mode(&this->gameboy) << 1)
+    };
+    hashes.lcd_registers = hash_memory(lcd_registers, sizeof(lcd_registers));
+
+    this->mutex.unlock();
+
+    return hashes;
+}
+
+bool GameInstance::is_timeline_enabled() noexcept MAKE_GETTER(this->timeline_enabled)
+
+std::vector<Timeline::Frame> GameInstance::get_timeline(std::size_t frames) MAKE_GETTER(this->timeline.get_frames(frames))
+
+bool GameInstance::start_trace_recording(const std::filesystem::path &path) {
+    this->mutex.lock();
+    bool result = this->trace_writer.open(path);
+    this->trace_recording = result;
+    this->hook_banks_stale = true;
+    this->update_memory_hooks();
+    this->mutex.unlock();
+    return result;
+}
+
+bool GameInstance::stop_trace_recording() {
+    this->mutex.lock();
+    bool result = this->trace_writer.close();
+    this->trace_recording = false;
+    this->update_memory_hooks();
+    this->mutex.unlock();
+    return result;
+}
+
+bool GameInstance::is_trace_recording() noexcept MAKE_GETTER(this->trace_recording)
+
+std::uint64_t GameInstance::get_trace_record_count() noexcept MAKE_GETTER(this->trace_writer.get_record_count())
+
+void GameInstance::set_time_travel_enabled(bool enabled) {
+    this->mutex.lock();
+    if(this->time_travel_enabled != enabled) {
+        this->time_travel_enabled = enabled;
+        this->instructions_run = 0;
+        this->clear_time_travel();
+        this->update_memory_hooks();
+    }
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_time_travel_enabled() noexcept MAKE_GETTER(this->time_travel_enabled)
+
+void GameInstance::set_time_travel_settings(std::uint32_t interval, std::size_t memory_limit) {
+    this->mutex.lock();
+    this->keyframe_interval = std::max(interval, static_cast<std::uint32_t>(1));
+    this->time_travel.set_memory_limit(memory_limit);
+    this->mutex.unlock();
+}
+
+bool GameInstance::reverse(ReverseCommand command) {
+    this->mutex.lock();
+
+    // Find the last keyframe before here
+    std::optional<std::size_t> keyframe;
+    if(this->time_travel_enabled && this->bp_paused && this->time_travel_phase == TimeTravelPhase::TimeTravelIdle && this->instructions_run > 0) {
+        keyframe = this->time_travel.find_keyframe(this->instructions_run - 1);
+    }
+    if(!keyframe.has_value()) {
+        this->mutex.unlock();
+        return false;
+    }
+
+    this->time_travel_started = clock::now();
+    this->time_travel_command = command;
+    this->time_travel_origin_sp = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_SP);
+    auto origin = this->instructions_run;
+
+    // Stepping back goes straight to the previous instruction. Everything else has to look for where to go first.
+    bool running;
+    if(command == ReverseCommand::ReverseStep) {
+        running = this->begin_time_travel_seek(*keyframe, origin - 1, std::nullopt);
+    }
+    else {
+        running = this->begin_time_travel_scan(*keyframe, origin);
+    }
+
+    if(running) {
+        this->continue_text = "continue";
+        this->bp_paused = false;
+        this->step_started = std::nullopt;
+    }
+    else {
+        this->finish_time_travel();
+    }
+
+    this->mutex.unlock();
+
+    if(running) {
+        this->breakpoint_condition.notify_one();
+    }
+
+    return true;
+}
+
+GameInstance::TimeTravelStatus GameInstance::get_time_travel_status() noexcept {
+    TimeTravelStatus status;
+    this->mutex.lock();
+    status.keyframes = this->time_travel.get_keyframe_count();
+    status.memory_usage = this->time_travel.get_memory_usage();
+    if(status.keyframes > 0 && this->time_travel_phase == TimeTravelPhase::TimeTravelIdle) {
+        status.history = this->instructions_run - this->time_travel.get_keyframe_position(0);
+    }
+    status.last_latency = this->time_travel_latency;
+    status.reversing = this->time_travel_phase != TimeTravelPhase::TimeTravelIdle;
+    this->mutex.unlock();
+    return status;
+}
+
+void GameInstance::take_keyframe() {
+    this->time_travel_state.resize(GB_get_save_state_size(&this->gameboy));
+    GB_save_state_to_buffer(&this->gameboy, this->time_travel_state.data());
+    this->time_travel.add_keyframe(this->instructions_run, this->cycle_count, this->frame_count, this->time_travel_state);
+    this->next_keyframe = this->instructions_run + this->keyframe_interval;
+}
+
+bool GameInstance::restore_keyframe(std::size_t index) {
+    if(!this->time_travel.get_keyframe(index, this->time_travel_state) || GB_load_state_from_buffer(&this->gameboy, this->time_travel_state.data(), this->time_travel_state.size()) != 0) {
+        return false;
+    }
+    this->instructions_run = this->time_travel.get_keyframe_position(index);
+
+    // Put the counters back too, or running forward to where we were would count everything since the keyframe twice
+    this->cycle_count = this->time_travel.get_keyframe_cycle_count(index);
+    this->frame_count = this->time_travel.get_keyframe_frame_count(index);
+    this->next_debug_snapshot = this->cycle_count;
+    this->next_profiler_sample = this->cycle_count + this->sampling_profiler_period;
+
+    // Same as bump_state_generations() except we keep our history
+    this->bump_execution_generations();
+    this->bump_all_page_write_generations();
+    this->hook_banks_stale = true;
+    this->call_graph_profiler.reset_stack();
+    return true;
+}
+
+void GameInstance::clear_time_travel() noexcept {
+    this->time_travel.clear();
+    this->time_travel_phase = TimeTravelPhase::TimeTravelIdle;
+    this->time_travel_candidate = std::nullopt;
+    this->time_travel_started = std::nullopt;
+    this->next_keyframe = this->instructions_run;
+}
+
+bool GameInstance::begin_time_travel_scan(std::size_t keyframe, std::uint64_t end) {
+    if(!this->restore_keyframe(keyframe)) {
+        return false;
+    }
+    this->time_travel_phase = TimeTravelPhase::TimeTravelScanning;
+    this->time_travel_scan_keyframe = keyframe;
+    this->time_travel_scan_end = end;
+    this->time_travel_candidate = std::nullopt;
+    return true;
+}
+
+bool GameInstance::begin_time_travel_seek(std::size_t keyframe, std::uint64_t target, std::optional<std::uint16_t> pc) {
+    // If the target is the keyframe itself, we're already there
+    if(!this->restore_keyframe(keyframe) || this->instructions_run >= target) {
+        return false;
+    }
+    this->time_travel_phase = TimeTravelPhase::TimeTravelSeeking;
+    this->time_travel_target = target;
+    this->time_travel_target_pc = pc;
+    return true;
+}
+
+const char *GameInstance::continue_time_travel() {
+    auto position = this->instructions_run;
+    auto pc = get_16_bit_gb_register(&this->gameboy, SM83Register::SM83_REG_PC);
+
+    if(this->time_travel_phase == TimeTravelPhase::TimeTravelScanning) {
+        // Stopped at a breakpoint or watchpoint on the way? Reverse continue wants the last one of these.
+        if(position < this->time_travel_scan_end) {
+            if(this->time_travel_command == ReverseCommand::ReverseContinue) {
+                this->time_travel_candidate = std::pair<std::uint64_t, std::uint16_t>(position, pc);
+            }
+            return "continue";
+        }
+
+        // Done scanning from this keyframe. Go to the last place found, if any.
+        if(this->time_travel_candidate.has_value()) {
+            auto [target, target_pc] = *this->time_travel_candidate;
+            if(this->begin_time_travel_seek(this->time_travel_scan_keyframe, target, target_pc)) {
+                return "continue";
+            }
+        }
+
+        // Otherwise, look from the keyframe before it, or stop at the oldest point we have if there isn't one
+        else if(this->time_travel_scan_keyframe > 0) {
+            auto keyframe = this->time_travel_scan_keyframe - 1;
+            if(this->begin_time_travel_scan(keyframe, this->time_travel.get_keyframe_position(keyframe + 1))) {
+                return "continue";
+            }
+        }
+        else {
+            this->restore_keyframe(0);
+        }
+    }
+    else if(this->time_travel_phase == TimeTravelPhase::TimeTravelSeeking) {
+        if(position < this->time_travel_target) {
+            return "continue";
+        }
+
+        // An interrupt can be dispatched without running an instruction, so step until we're at the right PC
+        if(position == this->time_travel_target && this->time_travel_target_pc.has_value() && pc != *this->time_travel_target_pc) {
+            return "step";
+        }
+    }
+
+    this->finish_time_travel();
+    return nullptr;
+}
+
+void GameInstance::finish_time_travel() {
+    this->time_travel_phase = TimeTravelPhase::TimeTravelIdle;
+    this->time_travel_candidate = std::nullopt;
+
+    // Anything after here hasn't happened yet (and might not, since the input may be different this time)
+    this->time_travel.truncate(this->instructions_run);
+    this->next_keyframe = this->instructions_run + this->keyframe_interval;
+
+    // Anything set off while running through history again was already handled the first time
+    this->pending_watchpoint_trace = std::nullopt;
+    this->bump_execution_generations();
+
+    if(this->time_travel_started.has_value()) {
+        this->time_travel_latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - *this->time_travel_started);
+        this->time_travel_started = std::nullopt;
+    }
+}
+
+std::uint64_t GameInstance::get_cycle_count_without_mutex() noexcept {
+    return this->cycle_count + get_gb_cycles_since_run(&this->gameboy);
+}
+
+void GameInstance::set_write_tracking_enabled(bool enabled) noexcept {
+    this->mutex.lock();
+    if(this->write_tracking_enabled != enabled) {
+        this->write_tracking_enabled = enabled;
+        this->update_memory_hooks();
+
+        // We don't know what was written while we weren't looking
+        if(enabled) {
+            this->bump_all_page_write_generations();
+        }
+    }
+    this->mutex.unlock();
+}
+
+std::uint32_t GameInstance::get_page_write_generation(std::uint8_t page) const noexcept {
+    return this->page_write_generation[page].load(std::memory_order_relaxed);
+}
+
+void GameInstance::bump_all_page_write_generations() noexcept {
+    for(auto &g : this->page_write_generation) {
+        g++;
+    }
+}
+
+// Writes from the debugger bypass the write hook, so anything tracking writes needs to be told about them here
+void GameInstance::note_debugger_write_without_mutex(std::uint16_t address, bool rom) noexcept {
+    this->page_write_generation[address >> 8]++;
+    this->memory_generation++;
+
+    // ROM is assumed not to change (e.g. the disassembler doesn't check page generations for it)
+    if(rom) {
+        this->rom_generation++;
+    }
+}
+
+std::size_t GameInstance::get_pixel_buffer_size_without_mutex() noexcept {
+    return GB_get_screen_width(&this->gameboy) * GB_get_screen_height(&this->gameboy);
+}
+bool GameInstance::set_up_sdl_audio(std::uint32_t sample_rate, std::uint32_t buffer_size) noexcept {
+    this->mutex.lock();
+    SDL_AudioSpec request = {}, result = {}, preferred = {};
+    request.format = AUDIO_S16SYS;
+    request.channels = 2;
+    request.userdata = this;
+
+    SDL_GetAudioDeviceSpec(0, 0, &preferred);
+    request.freq = preferred.freq;
+    request.samples = preferred.samples;
+
+    int flags = 0;
+
+    if(sample_rate != 0) {
+        request.freq = sample_rate;
+        flags |= SDL_AUDIO_ALLOW_FREQUENCY_CHANGE;
+    }
+
+    if(buffer_size != 0) {
+        request.samples = buffer_size;
+        flags |= SDL_AUDIO_ALLOW_SAMPLES_CHANGE;
+    }
+
+    auto device = SDL_OpenAudioDevice(0, 0, &request, &result, flags);
+    if(device != 0) {
+        this->close_sdl_audio_device();
+
+        // Now...
+        this->set_current_sample_rate(result.freq);
+        this->sdl_audio_device = device;
+        this->sdl_audio_buffer_size = result.samples;
+        this->sample_buffer.reserve(this->current_sample_rate); // reserve one second
+        GB_set_sample_rate(&this->gameboy, this->current_sample_rate);
+    }
+
+    this->mutex.unlock();
+    return device > 0;
+}
+
+int GameInstance::get_volume() noexcept MAKE_GETTER(this->volume)
+void GameInstance::set_volume(int volume) noexcept {
+    this->mutex.lock();
+    this->volume = std::min(100, std::max(0, volume)); // clamp from 0 to 100
+    this->volume_scale = std::pow(100.0, this->volume / 100.0) / 100.0 - 0.01 * (100.0 - this->volume) / 100.0; // convert between logarithmic volume and linear volume
+    this->mutex.unlock();
+}
+
+bool GameInstance::is_mono_forced() noexcept MAKE_GETTER(this->force_mono)
+void GameInstance::set_mono_forced(bool mono) noexcept MAKE_SETTER(this->force_mono = mono)
+
+GameInstance::PixelBufferMode GameInstance::get_pixel_buffering_mode() noexcept MAKE_GETTER(this->pixel_buffer_mode)
+void GameInstance::set_pixel_buffering_mode(PixelBufferMode mode) noexcept MAKE_SETTER(this->pixel_buffer_mode = mode)
 
 void GameInstance::set_rtc_mode(GB_rtc_mode_t mode) noexcept MAKE_SETTER(GB_set_rtc_mode(&this->gameboy, mode))
 
@@ -1031,6 +2443,7 @@ void GameInstance::break_and_trace_at(std::uint16_t address, std::size_t n, bool
     char command[512];
     std::snprintf(command, sizeof(command), "breakpoint $%04x", address);
     this->execute_command_without_mutex(malloc_string(command));
+    this->breakpoints_generation++;
 
     this->mutex.unlock();
 }
@@ -1041,8 +2454,137 @@ void GameInstance::break_at(std::uint16_t address) noexcept {
     char command[512];
     std::snprintf(command, sizeof(command), "breakpoint $%04x", address);
     this->execute_command_without_mutex(malloc_string(command));
+    this->breakpoints_generation++;
+
+    this->mutex.unlock();
+}
+
+bool GameInstance::add_simple_breakpoint(std::uint16_t address) noexcept {
+    this->mutex.lock();
+
+    std::size_t bp_count = get_gb_breakpoint_size(&this->gameboy);
+    for(std::size_t b = 0; b < bp_count; b++) {
+        if(get_gb_breakpoint_address(&this->gameboy, b) == address) {
+            this->mutex.unlock();
+            return false;
+        }
+    }
+
+    char command[512];
+    std::snprintf(command, sizeof(command), "breakpoint $%04x", address);
+    this->execute_command_without_mutex(malloc_string(command));
+    this->breakpoints_generation++;
+
+    this->mutex.unlock();
+    return true;
+}
+
+void GameInstance::remove_simple_breakpoint(std::uint16_t address) noexcept {
+    this->mutex.lock();
+
+    // Break-and-trace uses the same SameBoy breakpoint, so leave it if one was put there since
+    bool traced = std::any_of(this->break_and_trace_breakpoints.begin(), this->break_and_trace_breakpoints.end(), [&address](const auto &b) { return std::get<0>(b) == address; });
+    if(!traced) {
+        char command[512];
+        std::snprintf(command, sizeof(command), "delete $%04x", address);
+        this->execute_command_without_mutex(malloc_string(command));
+        this->breakpoints_generation++;
+    }
+
+    this->mutex.unlock();
+}
+
+bool GameInstance::add_conditional_breakpoint(const ConditionalBreakpoint &breakpoint, std::string &error) {
+    // Compile it before we lock anything (this also needs the mutex for the symbols)
+    CompiledBreakpoint compiled;
+    compiled.breakpoint = breakpoint;
+    compiled.breakpoint.hits = 0;
+    auto symbols = this->get_symbol_table();
+    if(!compiled.condition.compile(breakpoint.condition, error, symbols.get())) {
+        return false;
+    }
+
+    if(compiled.breakpoint.hit_mode != BreakpointHitMode::BreakAlways && compiled.breakpoint.hit_target == 0) {
+        error = "Hit count must be at least 1";
+        return false;
+    }
 
+    this->mutex.lock();
+    this->conditional_breakpoints.emplace_back(std::move(compiled));
+    this->rebuild_conditional_breakpoint_index();
+    this->breakpoints_generation++;
+    this->mutex.unlock();
+    return true;
+}
+
+std::vector<GameInstance::ConditionalBreakpoint> GameInstance::get_conditional_breakpoints() {
+    std::vector<ConditionalBreakpoint> breakpoints;
+    this->mutex.lock();
+    breakpoints.reserve(this->conditional_breakpoints.size());
+    for(auto &b : this->conditional_breakpoints) {
+        breakpoints.emplace_back(b.breakpoint);
+    }
     this->mutex.unlock();
+    return breakpoints;
+}
+
+void GameInstance::rebuild_conditional_breakpoint_index() noexcept {
+    if(this->conditional_breakpoints.empty()) {
+        this->conditional_breakpoint_flags.reset();
+        return;
+    }
+
+    if(!this->conditional_breakpoint_flags) {
+        this->conditional_breakpoint_flags = std::make_unique<bool[]>(0x10000);
+    }
+    std::fill_n(this->conditional_breakpoint_flags.get(), 0x10000, false);
+    for(auto &b : this->conditional_breakpoints) {
+        this->conditional_breakpoint_flags[b.breakpoint.address] = true;
+    }
+}
+
+// Will the next GB_run() service an interrupt rather than run the instruction at PC?
+bool GameInstance::interrupt_pending_without_mutex() noexcept {
+    return get_gb_ime(&this->gameboy) && (GB_safe_read_memory(&this->gameboy, 0xFFFF) & get_gb_io_register(&this->gameboy, GB_IO_IF) & 0x1F) != 0;
+}
+
+void GameInstance::check_conditional_breakpoints(std::uint16_t pc) noexcept {
+    auto state = this->get_condition_state();
+
+    bool should_break = false;
+    for(auto &b : this->conditional_breakpoints) {
+        if(b.breakpoint.address != pc || !b.condition.evaluate(state, GameInstance::read_memory_for_condition, &this->gameboy)) {
+            continue;
+        }
+
+        auto hits = ++b.breakpoint.hits;
+        auto target = b.breakpoint.hit_target;
+        switch(b.breakpoint.hit_mode) {
+            case BreakpointHitMode::BreakAlways:
+                should_break = true;
+                break;
+            case BreakpointHitMode::BreakOnHit:
+                should_break = should_break || hits == target;
+                break;
+            case BreakpointHitMode::BreakFromHit:
+                should_break = should_break || hits >= target;
+                break;
+            case BreakpointHitMode::BreakEveryHit:
+                should_break = should_break || hits % target == 0;
+                break;
+        }
+    }
+
+    if(should_break) {
+        GB_debugger_break(&this->gameboy);
+    }
+}
+
+bool GameInstance::conditional_breakpoint_matches(std::uint16_t pc) noexcept {
+    auto state = this->get_condition_state();
+    return std::any_of(this->conditional_breakpoints.begin(), this->conditional_breakpoints.end(), [&pc, &state, this](const CompiledBreakpoint &b) {
+        return b.breakpoint.address == pc && b.condition.evaluate(state, GameInstance::read_memory_for_condition, &this->gameboy);
+    });
 }
 
 std::optional<std::vector<GameInstance::BreakAndTraceResult>> GameInstance::pop_break_and_trace_results() {
@@ -1050,6 +2592,7 @@ std::optional<std::vector<GameInstance::BreakAndTraceResult>> GameInstance::pop_
     if(this->break_and_trace_results_ready_no_mutex()) {
         auto top = this->break_and_trace_result[0];
         this->break_and_trace_result.erase(this->break_and_trace_result.begin());
+        this->update_break_and_trace_results_available();
         this->mutex.unlock();
         return top;
     }
@@ -1078,6 +2621,10 @@ void GameInstance::remove_breakpoint(std::uint16_t breakpoint) noexcept {
         }
     }
 
+    std::erase_if(this->conditional_breakpoints, [&breakpoint](const CompiledBreakpoint &b) { return b.breakpoint.address == breakpoint; });
+    this->rebuild_conditional_breakpoint_index();
+
+    this->breakpoints_generation++;
     this->mutex.unlock();
 }
 
@@ -1087,6 +2634,9 @@ void GameInstance::remove_all_breakpoints() noexcept {
     this->mutex.lock();
     this->execute_command_without_mutex(malloc_string("delete"));
     this->break_and_trace_breakpoints.clear();
+    this->conditional_breakpoints.clear();
+    this->rebuild_conditional_breakpoint_index();
+    this->breakpoints_generation++;
     this->mutex.unlock();
 }
 
@@ -1115,12 +2665,20 @@ bool GameInstance::load_save_state(const std::filesystem::path &path) noexcept {
         original_model = model_before;
     }
 
+    this->bump_state_generations();
+
     // Done
     this->mutex.unlock();
     return success;
 }
 
-bool GameInstance::load_save_state(const std::vector<std::uint8_t> &state) noexcept MAKE_GETTER(GB_load_state_from_buffer(&this->gameboy, state.data(), state.size()) == 0)
+bool GameInstance::load_save_state(const std::vector<std::uint8_t> &state) noexcept {
+    this->mutex.lock();
+    auto success = GB_load_state_from_buffer(&this->gameboy, state.data(), state.size()) == 0;
+    this->bump_state_generations();
+    this->mutex.unlock();
+    return success;
+}
 
 void GameInstance::set_rapid_button_state(GB_key_t button, bool pressed) {
     this->rapid_button_bitfield = set_button_bitmask(this->rapid_button_bitfield, button, pressed);
@@ -1136,29 +2694,97 @@ void GameInstance::set_rewind(bool rewinding) noexcept MAKE_SETTER(this->rewindi
 
 void GameInstance::set_rewind_length(double seconds) noexcept MAKE_SETTER(GB_set_rewind_length(&this->gameboy, seconds))
 
-void color_block(GB_gameboy_s *gb, std::uint32_t *block, const std::uint8_t *tile_data, GB_palette_type_t palette_type, unsigned int palette_index, unsigned int stride = GameInstance::GB_TILESET_TILE_LENGTH) {
-    // Get palettes
-    auto *new_palette = get_gb_palette(gb, palette_type, palette_index);
-
-    // Go through each pixel in the tile and color it
-    for(std::size_t ty = 0; ty < GameInstance::GB_TILESET_TILE_LENGTH; ty++) {
-        for(std::size_t tx = 0, access_shift = GameInstance::GB_TILESET_TILE_LENGTH - 1; tx < GameInstance::GB_TILESET_TILE_LENGTH; tx++, access_shift--) {
-            auto &pixel = block[tx + ty * stride];
-            auto *tile_pixel = tile_data + ty * 2;
-
-            // Bit shift left-to-right - https://gbdev.io/pandocs/Tile_Data.html
-            // First byte is lower bit. Second byte is upper bit
-            std::uint8_t color_index_low = (tile_pixel[0] >> access_shift) & 0b1;
-            std::uint8_t color_index_high = (tile_pixel[1] >> access_shift) & 0b1;
+// Each row of a tile is two bytes: the first has the low bit of each pixel's color index and the second has the high bit,
+// leftmost pixel first (most significant bit) - https://gbdev.io/pandocs/Tile_Data.html
+#ifndef TILE_DECODE_SSE2
+// Without SSE2, these spread a byte out so each pixel gets its own byte (pixel x in bits x*8 through x*8+7), already shifted into
+// place for its plane, so a whole row's color indices are just TILE_ROW_LUT[0][low] | TILE_ROW_LUT[1][high].
+static constexpr const auto TILE_ROW_LUT = []() {
+    std::array<std::array<std::uint64_t, 256>, 2> lut = {};
+    for(unsigned int plane = 0; plane < 2; plane++) {
+        for(unsigned int byte = 0; byte < 256; byte++) {
+            for(unsigned int x = 0; x < GameInstance::GB_TILESET_TILE_LENGTH; x++) {
+                if(byte & (0x80 >> x)) {
+                    lut[plane][byte] |= static_cast<std::uint64_t>(1 << plane) << (x * 8);
+                }
+            }
+        }
+    }
+    return lut;
+}();
+#endif
+
+/**
+ * Decode tile data into pixels
+ *
+ * @param block     top-left pixel to write to
+ * @param tile_data tile data (16 bytes per 8 rows; 8x16 objects are two tiles back-to-back)
+ * @param palette   4 colors to use
+ * @param height    number of rows (8 or 16)
+ * @param flip_x    mirror horizontally
+ * @param flip_y    mirror vertically
+ * @param stride    pixels between the start of each row in block
+ */
+static void decode_tile(std::uint32_t *block, const std::uint8_t *tile_data, const std::uint32_t *palette, unsigned int height, bool flip_x, bool flip_y, unsigned int stride) noexcept {
+#ifdef TILE_DECODE_SSE2
+    // Rather than looking up each pixel's color, select it 4 pixels at a time: with each pixel's low and high bits as
+    // all-ones/all-zeros masks, its color is c0 ^ (low & c1) ^ (high & c2) ^ (low & high & c3).
+    auto c0 = _mm_set1_epi32(static_cast<int>(palette[0]));
+    auto c1 = _mm_set1_epi32(static_cast<int>(palette[1] ^ palette[0]));
+    auto c2 = _mm_set1_epi32(static_cast<int>(palette[2] ^ palette[0]));
+    auto c3 = _mm_set1_epi32(static_cast<int>(palette[3] ^ palette[2] ^ palette[1] ^ palette[0]));
+
+    // Bit of the row bytes for each pixel (leftmost is the highest bit unless flipped)
+    __m128i bits[2];
+    if(flip_x) {
+        bits[0] = _mm_setr_epi32(0x01, 0x02, 0x04, 0x08);
+        bits[1] = _mm_setr_epi32(0x10, 0x20, 0x40, 0x80);
+    }
+    else {
+        bits[0] = _mm_setr_epi32(0x80, 0x40, 0x20, 0x10);
+        bits[1] = _mm_setr_epi32(0x08, 0x04, 0x02, 0x01);
+    }
 
-            std::uint8_t color_index = color_index_low | (color_index_high << 1);
+    for(unsigned int ty = 0; ty < height; ty++) {
+        auto *row = tile_data + (flip_y ? height - 1 - ty : ty) * 2;
+        auto low_byte = _mm_set1_epi32(row[0]);
+        auto high_byte = _mm_set1_epi32(row[1]);
+        auto *pixel = block + ty * stride;
+        for(unsigned int half = 0; half < 2; half++) {
+            auto low = _mm_cmpeq_epi32(_mm_and_si128(low_byte, bits[half]), bits[half]);
+            auto high = _mm_cmpeq_epi32(_mm_and_si128(high_byte, bits[half]), bits[half]);
+            auto color = _mm_xor_si128(c0, _mm_and_si128(low, c1));
+            color = _mm_xor_si128(color, _mm_and_si128(high, c2));
+            color = _mm_xor_si128(color, _mm_and_si128(_mm_and_si128(low, high), c3));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(pixel + half * 4), color);
+        }
+    }
+#else
+    // Get the color indices of every row first...
+    std::uint64_t rows[GameInstance::GB_TILESET_TILE_LENGTH * 2];
+    assert(height <= sizeof(rows) / sizeof(rows[0]));
+    for(unsigned int ty = 0; ty < height; ty++) {
+        auto *row = tile_data + (flip_y ? height - 1 - ty : ty) * 2;
+        rows[ty] = TILE_ROW_LUT[0][row[0]] | TILE_ROW_LUT[1][row[1]];
+    }
 
-            pixel = new_palette[color_index];
+    // ...then look up the colors
+    unsigned int x_mask = flip_x ? GameInstance::GB_TILESET_TILE_LENGTH - 1 : 0;
+    for(unsigned int ty = 0; ty < height; ty++) {
+        auto *pixel = block + ty * stride;
+        auto indices = rows[ty];
+        for(unsigned int tx = 0; tx < GameInstance::GB_TILESET_TILE_LENGTH; tx++) {
+            pixel[tx] = palette[(indices >> ((tx ^ x_mask) * 8)) & 0b11];
         }
     }
+#endif
+}
+
+void color_block(GB_gameboy_s *gb, std::uint32_t *block, const std::uint8_t *tile_data, GB_palette_type_t palette_type, unsigned int palette_index, unsigned int stride = GameInstance::GB_TILESET_TILE_LENGTH) {
+    decode_tile(block, tile_data, get_gb_palette(gb, palette_type, palette_index), GameInstance::GB_TILESET_TILE_LENGTH, false, false, stride);
 }
 
-void GameInstance::draw_tileset(std::uint32_t *destination, GB_palette_type_t palette_type, std::uint8_t index) noexcept {
+void GameInstance::draw_tileset(std::uint32_t *destination, GB_palette_type_t palette_type, std::uint8_t index, TilesetInfo *info, std::uint64_t *tile_keys) noexcept {
     // Yes I know that SameBoy has GB_draw_tileset and it's quite good, but it does not implement
     // automatic palette detection (GB_PALETTE_AUTO does the same thing as GB_PALETTE_NONE).
 
@@ -1197,6 +2823,19 @@ void GameInstance::draw_tileset(std::uint32_t *destination, GB_palette_type_t pa
     // DMG only has one bank
     bool ignore_second_tileset_bank = !is_cgb;
 
+    // Skip the tile if it would come out the same as last time
+    auto unchanged = [&tile_keys, this](std::size_t i, const std::uint8_t *tile_data, GB_palette_type_t type, unsigned int palette_index) -> bool {
+        if(tile_keys == nullptr) {
+            return false;
+        }
+        auto key = hash_memory(tile_data, 0x10, hash_memory(get_gb_palette(&this->gameboy, type, palette_index), sizeof(std::uint32_t) * 4)) | 1; // never 0
+        if(tile_keys[i] == key) {
+            return true;
+        }
+        tile_keys[i] = key;
+        return false;
+    };
+
     // Do the thing
     if(palette_type == GB_palette_type_t::GB_PALETTE_AUTO) {
         for(auto i = 0; i < tile_count; i++) {
@@ -1209,7 +2848,10 @@ void GameInstance::draw_tileset(std::uint32_t *destination, GB_palette_type_t pa
             }
 
             // Go through each pixel in the tile and color it
-            color_block(&this->gameboy, block, tileset_banks[info.tile_bank] + info.tile_index * 0x10, info.accessed_palette_type, info.accessed_tile_palette_index, GB_TILESET_WIDTH);
+            auto *tile_data = tileset_banks[info.tile_bank] + info.tile_index * 0x10;
+            if(!unchanged(i, tile_data, info.accessed_palette_type, info.accessed_tile_palette_index)) {
+                color_block(&this->gameboy, block, tile_data, info.accessed_palette_type, info.accessed_tile_palette_index, GB_TILESET_WIDTH);
+            }
         }
     }
     else {
@@ -1223,12 +2865,19 @@ void GameInstance::draw_tileset(std::uint32_t *destination, GB_palette_type_t pa
             }
 
             // Go through each pixel in the tile and color it
-            color_block(&this->gameboy, block, tileset_banks[info.tile_bank] + info.tile_index * 0x10, palette_type, index, GB_TILESET_WIDTH);
+            auto *tile_data = tileset_banks[info.tile_bank] + info.tile_index * 0x10;
+            if(!unchanged(i, tile_data, palette_type, index)) {
+                color_block(&this->gameboy, block, tile_data, palette_type, index, GB_TILESET_WIDTH);
+            }
         }
     }
 
     #undef DEFINE_X_Y_BLOCK
 
+    if(info != nullptr) {
+        *info = ti;
+    }
+
     this->mutex.unlock();
 }
 
@@ -1236,6 +2885,182 @@ void GameInstance::draw_tilemap(std::uint32_t *destination, GB_map_type_t map_ty
 
 std::uint8_t GameInstance::read_memory(std::uint16_t address) noexcept MAKE_GETTER(GB_safe_read_memory(&this->gameboy, address))
 
+std::uint8_t *GameInstance::get_memory_region_without_mutex(MemoryRegion region, std::size_t &size, std::uint16_t &bank) noexcept {
+    static const GB_direct_access_t ACCESS[] = {
+        GB_DIRECT_ACCESS_ROM,
+        GB_DIRECT_ACCESS_VRAM,
+        GB_DIRECT_ACCESS_RAM,
+        GB_DIRECT_ACCESS_CART_RAM,
+        GB_DIRECT_ACCESS_OAM,
+        GB_DIRECT_ACCESS_HRAM,
+        GB_DIRECT_ACCESS_IO
+    };
+    static_assert(sizeof(ACCESS) / sizeof(ACCESS[0]) == MemoryRegion::MemoryRegionCount);
+
+    size = 0;
+    bank = 0;
+    auto *data = reinterpret_cast<std::uint8_t *>(GB_get_direct_access(&this->gameboy, ACCESS[region], &size, &bank));
+    if(data == nullptr) {
+        size = 0;
+    }
+    return data;
+}
+
+void GameInstance::read_memory_range(std::optional<std::uint16_t> bank, std::uint16_t start, std::size_t length, std::uint8_t *destination) noexcept {
+    this->mutex.lock();
+
+    // Look up each banked region once
+    struct BankedRegion {
+        std::uint8_t *data;
+        std::size_t size;
+        std::uint16_t mapped_bank;
+    } rom, vram, sram, wram;
+
+    if(bank.has_value()) {
+        rom.data = this->get_memory_region_without_mutex(MemoryRegion::MemoryRegionROM, rom.size, rom.mapped_bank);
+        vram.data = this->get_memory_region_without_mutex(MemoryRegion::MemoryRegionVRAM, vram.size, vram.mapped_bank);
+        sram.data = this->get_memory_region_without_mutex(MemoryRegion::MemoryRegionCartRAM, sram.size, sram.mapped_bank);
+        wram.data = this->get_memory_region_without_mutex(MemoryRegion::MemoryRegionWRAM, wram.size, wram.mapped_bank);
+    }
+
+    auto read_banked = [&bank](const BankedRegion &region, std::size_t bank_size, std::size_t offset) -> std::uint8_t {
+        std::size_t real_offset = static_cast<std::size_t>(*bank) * bank_size + offset;
+        return real_offset < region.size ? region.data[real_offset] : 0xFF;
+    };
+
+    for(std::size_t i = 0; i < length; i++) {
+        std::uint16_t address = static_cast<std::uint16_t>(start + i);
+
+        if(!bank.has_value()) {
+            destination[i] = GB_safe_read_memory(&this->gameboy, address);
+        }
+        else if(address >= 0x4000 && address < 0x8000) {
+            destination[i] = read_banked(rom, 0x4000, address - 0x4000);
+        }
+        else if(address >= 0x8000 && address < 0xA000) {
+            destination[i] = read_banked(vram, 0x2000, address - 0x8000);
+        }
+        else if(address >= 0xA000 && address < 0xC000) {
+            destination[i] = read_banked(sram, 0x2000, address - 0xA000);
+        }
+        else if(address >= 0xD000 && address < 0xE000) {
+            destination[i] = read_banked(wram, 0x1000, address - 0xD000);
+        }
+        else if(address >= 0xF000 && address < 0xFE00) {
+            destination[i] = read_banked(wram, 0x1000, address - 0xF000); // echo RAM
+        }
+        else {
+            destination[i] = GB_safe_read_memory(&this->gameboy, address);
+        }
+    }
+
+    this->mutex.unlock();
+}
+
+void GameInstance::write_memory_range(std::uint16_t start, const std::uint8_t *data, std::size_t length) noexcept {
+    this->mutex.lock();
+
+    auto banks = this->get_mapped_banks_without_mutex();
+
+    // Don't let our own writes trigger watchpoints
+    GB_set_write_memory_callback(&this->gameboy, nullptr);
+
+    for(std::size_t i = 0; i < length; i++) {
+        std::uint16_t address = static_cast<std::uint16_t>(start + i);
+
+        // Writing to ROM through the bus would go to the MBC, so patch the mapped bank instead
+        if(address < 0x8000) {
+            std::size_t offset = address < 0x4000 ? static_cast<std::size_t>(banks.rom0) * 0x4000 + address : static_cast<std::size_t>(banks.romx) * 0x4000 + (address - 0x4000);
+            this->write_memory_region_without_mutex(MemoryRegion::MemoryRegionROM, offset, data[i]);
+        }
+        else {
+            GB_write_memory(&this->gameboy, address, data[i]);
+            this->note_debugger_write_without_mutex(address, false);
+        }
+    }
+
+    // VBK/SVBK may have been written
+    this->hook_banks_stale = true;
+    this->update_memory_hooks();
+
+    this->mutex.unlock();
+}
+
+void GameInstance::snapshot_memory_region(MemoryRegion region, MemorySnapshot &snapshot) {
+    this->mutex.lock();
+
+    std::size_t size;
+    auto *data = this->get_memory_region_without_mutex(region, size, snapshot.mapped_bank);
+    snapshot.region = region;
+    snapshot.data.resize(size);
+    if(size > 0) {
+        std::memcpy(snapshot.data.data(), data, size);
+    }
+
+    this->mutex.unlock();
+}
+
+void GameInstance::write_memory_region(MemoryRegion region, std::size_t offset, std::uint8_t value) noexcept MAKE_SETTER(this->write_memory_region_without_mutex(region, offset, value))
+
+void GameInstance::write_memory_region_without_mutex(MemoryRegion region, std::size_t offset, std::uint8_t value) noexcept {
+    std::size_t size;
+    std::uint16_t bank;
+    auto *data = this->get_memory_region_without_mutex(region, size, bank);
+    if(offset < size) {
+        data[offset] = value;
+        this->note_debugger_write_without_mutex(memory_region_address(region, offset, bank), region == MemoryRegion::MemoryRegionROM);
+    }
+}
+
+std::uint16_t GameInstance::memory_region_address(MemoryRegion region, std::size_t offset, std::uint16_t &bank) noexcept {
+    switch(region) {
+        case MemoryRegion::MemoryRegionROM:
+            bank = offset / 0x4000;
+            return (bank == 0 ? 0x0000 : 0x4000) + offset % 0x4000;
+        case MemoryRegion::MemoryRegionVRAM:
+            bank = offset / 0x2000;
+            return 0x8000 + offset % 0x2000;
+        case MemoryRegion::MemoryRegionCartRAM:
+            bank = offset / 0x2000;
+            return 0xA000 + offset % 0x2000;
+        case MemoryRegion::MemoryRegionWRAM:
+            bank = offset / 0x1000;
+            return (bank == 0 ? 0xC000 : 0xD000) + offset % 0x1000;
+        case MemoryRegion::MemoryRegionOAM:
+            bank = 0;
+            return 0xFE00 + offset;
+        case MemoryRegion::MemoryRegionHRAM:
+            bank = 0;
+            return 0xFF80 + offset;
+        case MemoryRegion::MemoryRegionIO:
+            bank = 0;
+            return 0xFF00 + offset;
+        default:
+            std::terminate();
+    }
+}
+
+const char *GameInstance::memory_region_name(MemoryRegion region) noexcept {
+    switch(region) {
+        case MemoryRegion::MemoryRegionROM:
+            return "ROM";
+        case MemoryRegion::MemoryRegionVRAM:
+            return "VRAM";
+        case MemoryRegion::MemoryRegionCartRAM:
+            return "Cartridge RAM";
+        case MemoryRegion::MemoryRegionWRAM:
+            return "WRAM";
+        case MemoryRegion::MemoryRegionOAM:
+            return "OAM";
+        case MemoryRegion::MemoryRegionHRAM:
+            return "HRAM";
+        case MemoryRegion::MemoryRegionIO:
+            return "I/O Registers";
+        default:
+            std::terminate();
+    }
+}
+
 const uint32_t *GameInstance::get_palette(GB_palette_type_t palette_type, unsigned char palette_index) noexcept MAKE_GETTER(get_gb_palette(&this->gameboy, palette_type, palette_index))
 
 GameInstance::TilesetInfo GameInstance::get_tileset_info() noexcept MAKE_GETTER(this->get_tileset_info_without_mutex())
@@ -1433,38 +3258,14 @@ GameInstance::ObjectAttributeInfo GameInstance::get_object_attribute_info_withou
         // This flag
         object_info.bg_window_over_obj = (flags& 0b10000000) != 0;
 
-        // Color it
-        auto *first_half = object_info.pixel_data;
-        auto *second_half = first_half + sizeof(object_info.pixel_data) / sizeof(object_info.pixel_data[0]) / 2;
+        // Color it (8x16 objects are two tiles back-to-back, and flipping them vertically flips the whole thing)
         auto *tile = tileset_banks[object_info.tileset_bank] + 0x10 * object_info.tile;
-        color_block(&this->gameboy, first_half, tile, GB_palette_type_t::GB_PALETTE_OAM, object_info.palette);
+        decode_tile(object_info.pixel_data, tile, get_gb_palette(&this->gameboy, GB_palette_type_t::GB_PALETTE_OAM, object_info.palette), sprite_height, object_info.flip_x, object_info.flip_y, GB_TILESET_TILE_LENGTH);
 
-        // Color the second half too
-        if(sprite_height == 16) {
-            color_block(&this->gameboy, second_half, tile + 0x10, GB_palette_type_t::GB_PALETTE_OAM, object_info.palette);
-        }
-
-        // Or not!
-        else {
-            std::memset(second_half, 0, sizeof(object_info.pixel_data) / sizeof(object_info.pixel_data[0]) / 2);
-        }
-
-        // Flip X
-        if(object_info.flip_x) {
-            for(std::size_t y = 0; y < sprite_height; y++) {
-                for(std::size_t x = 0, sx = GB_TILESET_TILE_LENGTH - 1; x < GB_TILESET_TILE_LENGTH / 2; x++, sx--) {
-                    std::swap(object_info.pixel_data[y * GB_TILESET_TILE_LENGTH + x], object_info.pixel_data[y * GB_TILESET_TILE_LENGTH + sx]);
-                }
-            }
-        }
-
-        // Flip Y
-        if(object_info.flip_y) {
-            for(std::size_t x = 0; x < GB_TILESET_TILE_LENGTH; x++) {
-                for(std::size_t y = 0, sy = sprite_height - 1; y < sprite_height / 2; y++, sy--) {
-                    std::swap(object_info.pixel_data[y * GB_TILESET_TILE_LENGTH + x], object_info.pixel_data[sy * GB_TILESET_TILE_LENGTH + x]);
-                }
-            }
+        // Clear the second half if it's not used
+        if(sprite_height != 16) {
+            auto *second_half = object_info.pixel_data + sizeof(object_info.pixel_data) / sizeof(object_info.pixel_data[0]) / 2;
+            std::fill(second_half, std::end(object_info.pixel_data), 0);
         }
     }
 
@@ -1518,7 +3319,20 @@ void GameInstance::reset_to_original_model() noexcept {
     }
 }
 
-bool GameInstance::break_and_trace_results_ready() MAKE_GETTER(this->break_and_trace_results_ready_no_mutex())
+void GameInstance::begin_break_and_trace(std::size_t count, bool step_over, bool break_when_done) {
+    this->current_break_and_trace_remaining = count;
+    this->current_break_and_trace_step_over = step_over;
+    this->current_break_and_trace_break_when_done = break_when_done;
+    this->break_and_trace_result.emplace_back().reserve(count + 1);
+}
+
+bool GameInstance::break_and_trace_results_ready() noexcept {
+    return this->break_and_trace_results_available;
+}
+
+void GameInstance::update_break_and_trace_results_available() noexcept {
+    this->break_and_trace_results_available = this->break_and_trace_results_ready_no_mutex();
+}
 
 bool GameInstance::break_and_trace_results_ready_no_mutex() const noexcept {
     return (this->break_and_trace_result.size() > 1) || (this->break_and_trace_result.size() == 1 && this->current_break_and_trace_remaining == 0);
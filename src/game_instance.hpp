@@ -7,13 +7,30 @@ extern "C" {
 
 #include <string>
 #include <vector>
+#include <array>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <optional>
+#include <memory>
 #include <filesystem>
 #include <chrono>
+#include <future>
 #include <SDL2/SDL.h>
 
+#include "code_data_logger.hpp"
+#include "sampling_profiler.hpp"
+#include "call_graph_profiler.hpp"
+#include "timeline.hpp"
+#include "cpu_usage_meter.hpp"
+#include "symbol_table.hpp"
+#include "rom_analysis.hpp"
+#include "trace_file.hpp"
+#include "time_travel.hpp"
+#include "breakpoint_condition.hpp"
+#include "triple_buffer.hpp"
+#include "seqlock.hpp"
+
 class GameInstance {
 public: // all public functions assume the mutex is not locked
     GameInstance(GB_model_t model, GB_border_mode_t border);
@@ -211,6 +228,33 @@ public: // all public functions assume the mutex is not locked
      * @return backtrace addresses and string names
      */
     std::vector<std::pair<std::string, std::uint16_t>> get_backtrace();
+
+    struct Generations {
+        /** Incremented when breakpoints are added or removed */
+        std::uint64_t breakpoints;
+
+        /** Incremented when the backtrace may have changed */
+        std::uint64_t backtrace;
+
+        /** Incremented when registers may have changed */
+        std::uint64_t registers;
+
+        /** Incremented when memory may have been written to */
+        std::uint64_t memory;
+
+        /** Incremented when a ROM (and its symbols) is loaded */
+        std::uint64_t rom;
+
+        bool operator==(const Generations &) const = default;
+    };
+
+    /**
+     * Get the current generation counters. These can be compared against a previous result to determine whether or
+     * not something needs to be queried again. This does not lock the mutex.
+     *
+     * @return generation counters
+     */
+    Generations get_generations() const noexcept;
     
     /**
      * Get the current value of the given register
@@ -367,6 +411,108 @@ public: // all public functions assume the mutex is not locked
      */
     std::string disassemble_address(std::uint16_t address, std::uint8_t count);
 
+    struct MappedBanks {
+        /** Bank mapped to $0000-$3FFF */
+        std::uint16_t rom0;
+
+        /** Bank mapped to $4000-$7FFF */
+        std::uint16_t romx;
+
+        /** VRAM bank mapped to $8000-$9FFF */
+        std::uint16_t vram;
+
+        /** Cartridge RAM bank mapped to $A000-$BFFF */
+        std::uint16_t sram;
+
+        /** WRAM bank mapped to $D000-$DFFF (and its echo) */
+        std::uint16_t wram;
+
+        /**
+         * Get the bank mapped to the given address. Addresses that are not banked always return 0.
+         *
+         * @param  address address to check
+         * @return         bank
+         */
+        std::uint16_t bank_for_address(std::uint16_t address) const noexcept;
+    };
+
+    /**
+     * Disassemble the given address, also getting the banks that were mapped at the time
+     *
+     * @param  address address to disassemble
+     * @param  count   maximum instructions to disassemble
+     * @param  banks   set to the mapped banks
+     * @return         result of disassembly
+     */
+    std::string disassemble_address(std::uint16_t address, std::uint8_t count, MappedBanks &banks);
+
+    /**
+     * Get the currently mapped banks
+     *
+     * @return mapped banks
+     */
+    MappedBanks get_mapped_banks() noexcept;
+
+    // CPU and I/O state at a single point in time
+    struct DebugSnapshot {
+        /** Emulated cycles run when this was taken */
+        std::uint64_t cycle;
+
+        /** Frames run when this was taken */
+        std::uint32_t frame;
+
+        /** Registers */
+        std::uint16_t af, bc, de, hl, sp, pc;
+
+        /** Interrupt master enable and whether the CPU is halted */
+        bool ime, halted;
+
+        /** IE ($FFFF) and IF ($FF0F) */
+        std::uint8_t interrupt_enable, interrupt_flags;
+
+        /** LCDC ($FF40), STAT ($FF41), and LY ($FF44) */
+        std::uint8_t lcdc, stat, ly;
+
+        /** Banks that were mapped */
+        MappedBanks banks;
+    };
+
+    /**
+     * Get the most recently published snapshot of the CPU and I/O state. This does not lock the mutex, so it can be
+     * called while the game is running without slowing it down, and everything in it is from the same point in time.
+     *
+     * A snapshot is published whenever execution stops (or the state is otherwise changed by the debugger), and also
+     * periodically while running (see set_debug_snapshot_rate).
+     *
+     * @return snapshot
+     */
+    DebugSnapshot get_debug_snapshot() const noexcept { return this->debug_snapshot.load(); }
+
+    /**
+     * Set how many times per second (of emulated time) a snapshot is published while running
+     *
+     * @param per_second snapshots per second (0 to only publish them when execution stops)
+     */
+    void set_debug_snapshot_rate(std::uint32_t per_second) noexcept;
+
+    /**
+     * Enable or disable write tracking. When enabled, every write to memory at $8000-$FFFF increments the write
+     * generation of its 256-byte page. Enabling it also increments every page's generation since writes may have been
+     * missed while it was off.
+     *
+     * @param enabled enable tracking
+     */
+    void set_write_tracking_enabled(bool enabled) noexcept;
+
+    /**
+     * Get the write generation of the 256-byte page. Pages below $8000 (ROM) never change. This does not lock the
+     * mutex.
+     *
+     * @param  page page (address >> 8)
+     * @return      generation
+     */
+    std::uint32_t get_page_write_generation(std::uint8_t page) const noexcept;
+
     /**
      * Get the audio buffer size
      *
@@ -389,6 +535,34 @@ public: // all public functions assume the mutex is not locked
      */
     std::optional<std::uint16_t> evaluate_expression(const char *expression) noexcept;
 
+    /**
+     * Set the expressions to watch. They are compiled once here (see breakpoint_condition.hpp) and then evaluated
+     * together every frame and whenever execution state changes (e.g. on pause).
+     *
+     * @param expressions expressions to watch
+     * @return            error for each expression, or an empty string if it compiled
+     */
+    std::vector<std::string> set_watch_expressions(const std::vector<std::string> &expressions);
+
+    struct WatchValues {
+        /** Value of each watch expression, or nullopt if it didn't compile */
+        std::vector<std::optional<std::int32_t>> values;
+
+        /** Frame the values were taken on */
+        std::uint32_t frame = 0;
+
+        /** Incremented every time values are published */
+        std::uint64_t generation = 0;
+    };
+
+    /**
+     * Get the most recently evaluated watch values. This does not lock the mutex, and it must only be called from one
+     * thread (i.e. the UI thread).
+     *
+     * @return watch values (valid until the next call)
+     */
+    const WatchValues &get_watch_values() noexcept { return this->watch_values.front(); }
+
     /**
      * Set the real-time clock mode
      *
@@ -420,6 +594,69 @@ public: // all public functions assume the mutex is not locked
      */
     void unbreak(const char *command = "continue");
 
+    /**
+     * Run until PC reaches the given address (after running at least one instruction) without setting a breakpoint.
+     * This is checked before each instruction in the game loop, so it runs at full speed. Stopping for any other reason
+     * (a breakpoint, breaking manually, etc.) cancels it.
+     *
+     * If paused from a breakpoint, this continues. Otherwise, the game keeps running until it gets there.
+     *
+     * @param address address to stop at
+     */
+    void run_to_address(std::uint16_t address) noexcept;
+
+    /**
+     * Run the given number of frames (counted at each vblank) and then break, the same way as run_to_address
+     *
+     * @param frames frames to run
+     */
+    void run_frames(std::uint32_t frames) noexcept;
+
+    /**
+     * Run the given number of emulated cycles (as counted by SameBoy) and then break at the next instruction, the same
+     * way as run_to_address
+     *
+     * @param cycles cycles to run
+     */
+    void run_cycles(std::uint64_t cycles) noexcept;
+
+    /**
+     * Run until the given condition (in the same syntax as conditional breakpoints) is true before an instruction, the
+     * same way as run_to_address
+     *
+     * @param condition condition to stop at
+     * @param error     set to what's wrong with the condition if it can't be compiled
+     * @return          true if started
+     */
+    bool run_until(std::string_view condition, std::string &error);
+
+    struct StepLatency {
+        /** Round-trip time of the most recent step (from unbreak() until the emulator halted again) */
+        std::chrono::nanoseconds last = {};
+
+        /** Average round-trip time of all steps measured so far */
+        std::chrono::nanoseconds average = {};
+
+        /** Number of steps measured */
+        std::size_t count = 0;
+    };
+
+    /**
+     * Get the step round-trip latency. Only "step" and "next" are measured.
+     *
+     * @return step latency
+     */
+    StepLatency get_step_latency() noexcept;
+
+    /**
+     * Wait until emulation is paused from a breakpoint (including finishing a step). This wakes up as soon as it pauses
+     * rather than polling.
+     *
+     * @param timeout maximum time to wait
+     * @return        true if paused from a breakpoint
+     */
+    bool wait_for_breakpoint_pause(std::chrono::milliseconds timeout);
+
     /**
      * Set turbo mode. Ratio is a fraction (1.0 = 100%, 2.0 = 200%, etc.)
      *
@@ -459,6 +696,419 @@ public: // all public functions assume the mutex is not locked
      */
     void break_at(std::uint16_t address) noexcept;
 
+    /**
+     * Add a plain breakpoint at address unless there already is one. This is for things like the GDB server that need
+     * to take their breakpoints back out later without touching anyone else's.
+     *
+     * @param address address to breakpoint
+     * @return true if a breakpoint was added, false if one was already there
+     */
+    bool add_simple_breakpoint(std::uint16_t address) noexcept;
+
+    /**
+     * Remove a plain breakpoint added with add_simple_breakpoint(), leaving conditional and break-and-trace breakpoints
+     * at the same address alone
+     *
+     * @param address address of the breakpoint
+     */
+    void remove_simple_breakpoint(std::uint16_t address) noexcept;
+
+    enum BreakpointHitMode {
+        /** Break every time the condition is met */
+        BreakAlways,
+
+        /** Break only the nth time the condition is met */
+        BreakOnHit,
+
+        /** Break every time the condition is met from the nth time onward */
+        BreakFromHit,
+
+        /** Break every nth time the condition is met */
+        BreakEveryHit
+    };
+
+    struct ConditionalBreakpoint {
+        /** Address to break at */
+        std::uint16_t address;
+
+        /** Condition (see breakpoint_condition.hpp), or empty to just use the hit count */
+        std::string condition;
+
+        /** When to break based on the hit count */
+        BreakpointHitMode hit_mode = BreakpointHitMode::BreakAlways;
+
+        /** Hit count used by hit_mode (n) */
+        std::uint64_t hit_target = 0;
+
+        /** Number of times the address was reached with the condition met */
+        std::uint64_t hits = 0;
+    };
+
+    /**
+     * Add a breakpoint with a condition and/or a hit count. The condition is compiled once here and then checked
+     * natively whenever the address is reached.
+     *
+     * @param breakpoint breakpoint to add (hits is ignored)
+     * @param error      set to what's wrong with the condition if it fails to compile
+     * @return           true if added
+     */
+    bool add_conditional_breakpoint(const ConditionalBreakpoint &breakpoint, std::string &error);
+
+    /**
+     * Get all conditional breakpoints (these are also included in get_breakpoints())
+     *
+     * @return conditional breakpoints
+     */
+    std::vector<ConditionalBreakpoint> get_conditional_breakpoints();
+
+    enum WatchpointType : std::uint8_t {
+        /** Trigger when memory is read */
+        WatchpointRead = 1,
+
+        /** Trigger when memory is written */
+        WatchpointWrite = 2,
+
+        /** Trigger when memory is read or written */
+        WatchpointAccess = WatchpointRead | WatchpointWrite
+    };
+
+    struct Watchpoint {
+        /** First address to watch */
+        std::uint16_t start;
+
+        /** Last address to watch (inclusive) */
+        std::uint16_t end;
+
+        /** What kind of access triggers it */
+        WatchpointType type;
+
+        /** If set, only trigger if the value read or written is this */
+        std::optional<std::uint8_t> value;
+
+        /** If nonzero, break and trace this many instructions when hit rather than just breaking */
+        std::size_t trace_count = 0;
+
+        /** If tracing, step over calls */
+        bool trace_step_over = false;
+
+        /** If tracing, stop execution on completion */
+        bool trace_break_when_done = false;
+    };
+
+    struct WatchpointHit {
+        /** Address accessed */
+        std::uint16_t address;
+
+        /** Value read or written */
+        std::uint8_t value;
+
+        /** Either WatchpointRead or WatchpointWrite */
+        WatchpointType type;
+
+        /** Value of PC at the time of the access (this may point partway into the instruction that accessed it) */
+        std::uint16_t pc;
+
+        /** Total number of watchpoint hits so far, including this one */
+        std::uint64_t hit_number;
+    };
+
+    /**
+     * Add a watchpoint
+     *
+     * @param watchpoint watchpoint to add
+     */
+    void add_watchpoint(const Watchpoint &watchpoint);
+
+    /**
+     * Get all watchpoints
+     *
+     * @return watchpoints
+     */
+    std::vector<Watchpoint> get_watchpoints();
+
+    /**
+     * Remove the watchpoint at the index (as given by get_watchpoints())
+     *
+     * @param index index of the watchpoint
+     */
+    void remove_watchpoint(std::size_t index);
+
+    /**
+     * Remove all watchpoints
+     */
+    void remove_all_watchpoints();
+
+    /**
+     * Get the most recent watchpoint hit
+     *
+     * @return watchpoint hit, if any watchpoint has been hit
+     */
+    std::optional<WatchpointHit> get_last_watchpoint_hit();
+
+    /**
+     * Enable or disable code/data logging. While enabled, every executed opcode, operand, and data read is recorded for
+     * the byte of ROM or RAM (in whatever bank was mapped) it came from. Nothing is recorded while the boot ROM runs.
+     *
+     * @param enabled enable logging
+     */
+    void set_code_data_logging_enabled(bool enabled) noexcept;
+
+    /**
+     * Get whether or not code/data logging is enabled
+     *
+     * @return true if enabled
+     */
+    bool is_code_data_logging_enabled() noexcept;
+
+    /**
+     * Clear everything that was logged
+     */
+    void clear_code_data_log() noexcept;
+
+    /**
+     * Load a code/data log, merging it with what was logged so far
+     *
+     * @param  path path to the log
+     * @return      true if successful
+     */
+    bool load_code_data_log(const std::filesystem::path &path);
+
+    /**
+     * Save the code/data log
+     *
+     * @param  path path to save to
+     * @return      true if successful
+     */
+    bool save_code_data_log(const std::filesystem::path &path);
+
+    /**
+     * Get the logged CodeDataLogger::Flag bits for a range of addresses
+     *
+     * @param start  first address
+     * @param length number of addresses (wraps around at $FFFF)
+     * @param banks  banks to look up the addresses in
+     * @param flags  receives one byte of flags per address
+     */
+    void get_code_data_flags(std::uint16_t start, std::size_t length, const MappedBanks &banks, std::uint8_t *flags);
+
+    /**
+     * Enable or disable the sampling profiler. While enabled, the PC and call stack are sampled every so often.
+     *
+     * @param enabled enable sampling
+     * @param period  emulated cycles (as counted by SameBoy) between samples
+     */
+    void set_sampling_profiler_enabled(bool enabled, std::uint32_t period = 1024) noexcept;
+
+    /**
+     * Get whether or not the sampling profiler is enabled
+     *
+     * @return true if enabled
+     */
+    bool is_sampling_profiler_enabled() noexcept;
+
+    /**
+     * Throw out all samples taken so far
+     */
+    void clear_sampling_profile();
+
+    /**
+     * Get a copy of everything the sampling profiler has sampled so far
+     *
+     * @return profile
+     */
+    SamplingProfiler::Profile get_sampling_profile();
+
+    /**
+     * Get the symbols loaded with the ROM. The table is never modified once loaded, so it can be used without locking.
+     * Symbols are loaded in the background, so this will be empty until they're done loading.
+     *
+     * @return symbol table
+     */
+    std::shared_ptr<const SymbolTable> get_symbol_table();
+
+    /**
+     * Set the directory to cache ROM analysis in. Generated labels are only given to SameBoy if this is set.
+     *
+     * @param directory directory to use
+     */
+    void set_analysis_cache_directory(const std::filesystem::path &directory);
+
+    /**
+     * Get the static analysis of the loaded ROM. Once it's done, generated labels are also added to the symbol table.
+     * ROMs are analyzed in the background, so this will be nullptr until it's done.
+     *
+     * @return analysis
+     */
+    std::shared_ptr<const RomAnalysis> get_rom_analysis();
+
+    /**
+     * Enable or disable the call graph profiler. While enabled, every call, RST, and interrupt is timed until it returns.
+     *
+     * @param enabled enable profiling
+     */
+    void set_call_graph_profiler_enabled(bool enabled) noexcept;
+
+    /**
+     * Get whether or not the call graph profiler is enabled
+     *
+     * @return true if enabled
+     */
+    bool is_call_graph_profiler_enabled() noexcept;
+
+    /**
+     * Throw out everything the call graph profiler has recorded
+     */
+    void clear_call_graph_profile();
+
+    /**
+     * Get a copy of everything the call graph profiler has recorded so far
+     *
+     * @return profile
+     */
+    CallGraphProfiler::Profile get_call_graph_profile();
+
+    /**
+     * Enable or disable the hardware event timeline. While enabled, interrupts, LCD mode changes, DMA, bank switches,
+     * timer overflows, and serial transfers are recorded with the cycle and scanline they happened on for the last few
+     * frames. Frames start at vblank.
+     *
+     * @param enabled enable recording
+     */
+    void set_timeline_enabled(bool enabled) noexcept;
+
+    /**
+     * Get whether or not the hardware event timeline is enabled
+     *
+     * @return true if enabled
+     */
+    bool is_timeline_enabled() noexcept;
+
+    /**
+     * Get the most recently recorded frames of the timeline
+     *
+     * @param  frames maximum number of frames to get
+     * @return        frames, oldest first
+     */
+    std::vector<Timeline::Frame> get_timeline(std::size_t frames);
+
+    /**
+     * Enable or disable the CPU usage meter. While enabled, each frame's cycles are split into running, halted, and
+     * time spent in each interrupt handler. Turning it on throws out what was measured before.
+     *
+     * @param enabled enable the meter
+     */
+    void set_cpu_usage_enabled(bool enabled) noexcept;
+
+    /**
+     * Get whether or not the CPU usage meter is enabled
+     *
+     * @return true if enabled
+     */
+    bool is_cpu_usage_enabled() noexcept;
+
+    /**
+     * Get the CPU usage of the last few frames. This does not lock the mutex.
+     *
+     * @return usage history
+     */
+    CPUUsageMeter::History get_cpu_usage() const noexcept { return this->cpu_usage.get_history(); }
+
+    /**
+     * Start recording every instruction run to a trace file (see trace_file.hpp), stopping any trace already recording
+     *
+     * @param path path to write to
+     * @return     true if the file could be opened
+     */
+    bool start_trace_recording(const std::filesystem::path &path);
+
+    /**
+     * Stop recording a trace, writing out the rest of it
+     *
+     * @return true if the whole trace was written successfully
+     */
+    bool stop_trace_recording();
+
+    /**
+     * Get whether or not a trace is being recorded
+     *
+     * @return true if recording
+     */
+    bool is_trace_recording() noexcept;
+
+    /**
+     * Get the number of instructions recorded to the current trace
+     *
+     * @return instruction count
+     */
+    std::uint64_t get_trace_record_count() noexcept;
+
+    /**
+     * Set whether or not to keep history for reverse debugging (see time_travel.hpp). Turning it on or off clears it.
+     *
+     * @param enabled enable time travel
+     */
+    void set_time_travel_enabled(bool enabled);
+
+    /**
+     * Get whether or not history is kept for reverse debugging
+     *
+     * @return true if enabled
+     */
+    bool is_time_travel_enabled() noexcept;
+
+    /**
+     * Set how often keyframes are taken and how much memory they can use. Shorter intervals make reversing faster but use
+     * more memory (so less history fits).
+     *
+     * @param interval     instructions between keyframes
+     * @param memory_limit memory limit in bytes
+     */
+    void set_time_travel_settings(std::uint32_t interval, std::size_t memory_limit);
+
+    enum ReverseCommand {
+        /** Go back one instruction */
+        ReverseStep,
+
+        /** Go back one instruction, skipping over calls (the last instruction run at the same stack depth or shallower) */
+        ReverseNext,
+
+        /** Go back to the last time a breakpoint or watchpoint was hit */
+        ReverseContinue
+    };
+
+    /**
+     * Run backwards. This only works if paused from a breakpoint and there is history to go back through. If nothing is
+     * found to stop at, this stops at the oldest point in history.
+     *
+     * @param command command
+     * @return        true if started
+     */
+    bool reverse(ReverseCommand command);
+
+    struct TimeTravelStatus {
+        /** Number of keyframes kept */
+        std::size_t keyframes = 0;
+
+        /** Memory used by keyframes */
+        std::size_t memory_usage = 0;
+
+        /** Instructions that can be stepped back through */
+        std::uint64_t history = 0;
+
+        /** Round-trip time of the most recent reverse command (from reverse() until the emulator halted again) */
+        std::chrono::nanoseconds last_latency = {};
+
+        /** Currently running backwards */
+        bool reversing = false;
+    };
+
+    /**
+     * Get the time travel status
+     *
+     * @return status
+     */
+    TimeTravelStatus get_time_travel_status() noexcept;
+
     struct BreakAndTraceResult {
         std::uint8_t a,b,c,d,e,f,h,l;
         bool step_over;
@@ -468,11 +1118,11 @@ public: // all public functions assume the mutex is not locked
     };
 
     /**
-     * Get whether or not we can use our tracing results
+     * Get whether or not we can use our tracing results. This does not lock the mutex.
      *
      * @return true if ready, false if not
      */
-    bool break_and_trace_results_ready();
+    bool break_and_trace_results_ready() noexcept;
 
     /**
      * Get the break and trace results
@@ -563,14 +1213,22 @@ public: // all public functions assume the mutex is not locked
                                        GB_TILESET_BLOCK_HEIGHT = GB_TILESET_HEIGHT / GB_TILESET_TILE_LENGTH,
                                        GB_PRINTER_WIDTH = 160;
 
+    struct TilesetInfo;
+
     /**
      * Draw the tileset to the given pointer. The pointer must be big enough to hold GB_TILESET_WIDTH*GB_TILESET_HEIGHT 32-bit pixels.
      *
+     * If tile_keys is given, it must hold GB_TILESET_BLOCK_WIDTH*GB_TILESET_BLOCK_HEIGHT keys (all zero the first time
+     * or whenever the destination was cleared), and only tiles whose data or colors changed since the last call with
+     * the same keys and destination are drawn.
+     *
      * @param destination  destination array
      * @param palette_type palette type
      * @param index        palette index
+     * @param info         if not null, set to the tileset info the tiles were drawn with
+     * @param tile_keys    if not null, keys of what was last drawn for each tile
      */
-    void draw_tileset(std::uint32_t *destination, GB_palette_type_t palette_type, std::uint8_t index) noexcept;
+    void draw_tileset(std::uint32_t *destination, GB_palette_type_t palette_type, std::uint8_t index, TilesetInfo *info = nullptr, std::uint64_t *tile_keys = nullptr) noexcept;
 
     static const constexpr std::size_t GB_TILEMAP_WIDTH = 256, GB_TILEMAP_HEIGHT = 256;
 
@@ -583,6 +1241,62 @@ public: // all public functions assume the mutex is not locked
      */
     void draw_tilemap(std::uint32_t *destination, GB_map_type_t map_type, GB_tileset_type_t tileset_type) noexcept;
 
+    static const constexpr std::size_t GB_SCREEN_LINES = 144;
+
+    struct ScanlineRegisters {
+        /** The line was drawn (it won't be if the LCD was off) */
+        bool captured;
+
+        std::uint8_t lcdc, scy, scx, wy, wx, bgp, obp0, obp1;
+
+        /** CGB palette indices (BCPS/OCPS) */
+        std::uint8_t bgpi, obpi;
+
+        bool operator==(const ScanlineRegisters &) const = default;
+    };
+    using ScanlineCapture = std::array<ScanlineRegisters, GB_SCREEN_LINES>;
+
+    /**
+     * Enable or disable capturing the LCD registers at the start of every line
+     *
+     * @param enabled enable capturing
+     */
+    void set_scanline_capture_enabled(bool enabled) noexcept;
+
+    /**
+     * Get the LCD registers as they were for each line of the last completed frame
+     *
+     * @return registers for each line
+     */
+    ScanlineCapture get_scanline_capture() noexcept;
+
+    // Hashes of what the VRAM viewer draws, so it can tell when something needs to be redrawn
+    struct VideoHashes {
+        /** Tile data ($8000-$97FF) of each VRAM bank */
+        std::uint64_t tiles[2];
+
+        /** Tilemaps ($9800-$9FFF) of each VRAM bank (bank 1 holds CGB attributes) */
+        std::uint64_t tilemaps[2];
+
+        /** Object attribute memory */
+        std::uint64_t oam;
+
+        /** Background and object palettes (raw and as drawn) */
+        std::uint64_t palettes;
+
+        /** LCDC, scroll, window position, and DMG palette registers (plus whether it's in CGB mode) */
+        std::uint64_t lcd_registers;
+
+        bool operator==(const VideoHashes &) const = default;
+    };
+
+    /**
+     * Hash VRAM, OAM, palettes, and the LCD registers. This only takes a few microseconds.
+     *
+     * @return hashes
+     */
+    VideoHashes get_video_hashes() noexcept;
+
     /**
      * Get the memory at the address
      *
@@ -591,6 +1305,85 @@ public: // all public functions assume the mutex is not locked
      */
     std::uint8_t read_memory(std::uint16_t address) noexcept;
 
+    /**
+     * Read a range of memory under a single lock. Reads do not have side effects.
+     *
+     * @param bank        if set, banked areas (ROMX, VRAM, cart RAM, WRAMX) are read from this bank instead of the mapped one
+     * @param start       address to start reading at
+     * @param length      number of bytes to read (wraps around at $FFFF)
+     * @param destination buffer to read into (must be at least length bytes)
+     */
+    void read_memory_range(std::optional<std::uint16_t> bank, std::uint16_t start, std::size_t length, std::uint8_t *destination) noexcept;
+
+    /**
+     * Write a range of memory under a single lock. ROM is patched in place (rather than writing to the MBC), and
+     * everything else is written like the CPU would write it, except watchpoints aren't triggered.
+     *
+     * @param start  address to start writing at
+     * @param data   data to write
+     * @param length number of bytes to write (wraps around at $FFFF)
+     */
+    void write_memory_range(std::uint16_t start, const std::uint8_t *data, std::size_t length) noexcept;
+
+    enum MemoryRegion {
+        MemoryRegionROM,
+        MemoryRegionVRAM,
+        MemoryRegionWRAM,
+        MemoryRegionCartRAM,
+        MemoryRegionOAM,
+        MemoryRegionHRAM,
+        MemoryRegionIO,
+
+        MemoryRegionCount
+    };
+
+    struct MemorySnapshot {
+        /** Region this is a snapshot of */
+        MemoryRegion region;
+
+        /** Contents of the entire region, including all banks */
+        std::vector<std::uint8_t> data;
+
+        /** Bank mapped at the time of the snapshot */
+        std::uint16_t mapped_bank;
+    };
+
+    /**
+     * Copy an entire memory region under a single lock. The snapshot's buffer is reused if it is large enough, so
+     * passing the same snapshot in repeatedly will not allocate.
+     *
+     * @param region   region to copy
+     * @param snapshot snapshot to write to
+     */
+    void snapshot_memory_region(MemoryRegion region, MemorySnapshot &snapshot);
+
+    /**
+     * Write directly to a memory region, bypassing the memory map (so ROM can be written to)
+     *
+     * @param region region to write to
+     * @param offset offset in the region
+     * @param value  value to write
+     */
+    void write_memory_region(MemoryRegion region, std::size_t offset, std::uint8_t value) noexcept;
+
+    /**
+     * Get the address and bank an offset in a region appears at
+     *
+     * @param region region
+     * @param offset offset in the region
+     * @param bank   set to the bank the offset is in
+     * @return       address on the memory map
+     */
+    static std::uint16_t memory_region_address(MemoryRegion region, std::size_t offset, std::uint16_t &bank) noexcept;
+
+    /**
+     * Get the name of a region
+     *
+     * @param region region
+     * @return       name
+     */
+    static const char *memory_region_name(MemoryRegion region) noexcept;
+
     /**
      * Get the palete colors. There are 4 colors.
      *
@@ -777,6 +1570,29 @@ private: // all private functions assume the mutex is locked by the caller
     bool current_break_and_trace_step_over = false;
     bool current_break_and_trace_break_when_done = false;
     bool break_and_trace_results_ready_no_mutex() const noexcept;
+    void begin_break_and_trace(std::size_t count, bool step_over, bool break_when_done);
+    std::atomic_bool break_and_trace_results_available = false;
+    void update_break_and_trace_results_available() noexcept;
+
+    // Generation counters (0 is never used so callers can use it to mean "not yet queried")
+    std::atomic<std::uint64_t> breakpoints_generation = 1;
+    std::atomic<std::uint64_t> backtrace_generation = 1;
+    std::atomic<std::uint64_t> registers_generation = 1;
+    std::atomic<std::uint64_t> memory_generation = 1;
+    std::atomic<std::uint64_t> rom_generation = 1;
+
+    // Increment every generation counter that executing code could affect
+    void bump_execution_generations() noexcept;
+
+    // Same as above, but for things that replace the state wholesale (loading states, resetting, etc.)
+    void bump_state_generations() noexcept;
+
+    // Debug snapshot (only written with the mutex held, but read without it)
+    static constexpr const std::uint64_t CYCLES_PER_SECOND = 4194304; // single speed; double speed publishes twice as often
+    Seqlock<DebugSnapshot> debug_snapshot;
+    std::uint64_t debug_snapshot_interval = CYCLES_PER_SECOND / 60; // cycles between snapshots while running (0 = never)
+    std::uint64_t next_debug_snapshot = 0;
+    void publish_debug_snapshot() noexcept;
 
     // SDL audio device
     std::optional<SDL_AudioDeviceID> sdl_audio_device;
@@ -817,6 +1633,17 @@ private: // all private functions assume the mutex is locked by the caller
     
     // Command to end the breakpoint
     std::optional<std::string> continue_text;
+
+    // Signalled when continue_text is set or the loop is finishing so the paused emulation thread can wake up immediately
+    std::condition_variable breakpoint_condition;
+
+    // Signalled when the emulation thread pauses from a breakpoint so anything waiting on it can wake up immediately
+    std::condition_variable breakpoint_pause_condition;
+
+    // Step latency measurement
+    std::optional<clock::time_point> step_started;
+    StepLatency step_latency;
+    std::chrono::nanoseconds step_latency_total = {};
     
     // Frame time information
     float frame_rate = 0.0;
@@ -838,7 +1665,179 @@ private: // all private functions assume the mutex is locked by the caller
     
     // Input requested (basically used for breakpoints)
     static char *on_input_requested(GB_gameboy_s *gameboy);
-    
+
+    // Memory hooks. These are only installed while something needs them since they are called for every access.
+    static std::uint8_t on_read_memory(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t data) noexcept;
+    static bool on_write_memory(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t data) noexcept;
+    void update_memory_hooks() noexcept;
+
+    // Watchpoints. The flags hold the WatchpointType of every watchpoint covering each address so checking an access is a single lookup.
+    std::vector<Watchpoint> watchpoints;
+    std::unique_ptr<std::uint8_t[]> watchpoint_flags;
+    std::uint8_t watchpoint_types = 0;
+    std::optional<WatchpointHit> last_watchpoint_hit;
+    std::uint64_t watchpoint_hit_count = 0;
+    std::optional<Watchpoint> pending_watchpoint_trace;
+    void rebuild_watchpoint_index() noexcept;
+    void check_watchpoint(std::uint16_t address, std::uint8_t value, WatchpointType type) noexcept;
+
+    // Write tracking
+    bool write_tracking_enabled = false;
+    std::atomic<std::uint32_t> page_write_generation[0x100] = {};
+    void bump_all_page_write_generations() noexcept;
+    void note_debugger_write_without_mutex(std::uint16_t address, bool rom) noexcept;
+    void write_memory_region_without_mutex(MemoryRegion region, std::size_t offset, std::uint8_t value) noexcept;
+
+    // Execution hook
+    static void on_execution(GB_gameboy_s *gameboy, std::uint16_t address, std::uint8_t opcode) noexcept;
+
+    // Banks mapped as far as the hooks are concerned. These are cached since they only change on MBC/VBK/SVBK writes
+    // or state changes. Refreshing these also keeps the code/data log sized to the current model/cartridge.
+    MappedBanks hook_banks = {};
+    bool hook_banks_stale = true;
+    bool hook_boot_rom_mapped = false;
+    void refresh_hook_banks() noexcept;
+
+    // Code/data logging
+    bool code_data_logging_enabled = false;
+    CodeDataLogger code_data_logger;
+    void log_code_data(std::uint16_t address, CodeDataLogger::Access access) noexcept;
+
+    // Call graph profiler
+    bool call_graph_profiler_enabled = false;
+    CallGraphProfiler call_graph_profiler;
+
+    // Per-line LCD registers, written to the back buffer while drawing and swapped at vblank
+    static void on_lcd_line(GB_gameboy_s *gameboy, std::uint8_t line) noexcept;
+    bool scanline_capture_enabled = false;
+    ScanlineCapture scanline_capture[2] = {};
+    std::size_t scanline_capture_back = 0;
+
+    // Hardware event timeline (interrupts and LCD modes are polled before each instruction, so anything that happens
+    // while halted shows up when the CPU wakes up)
+    static constexpr const std::size_t TIMELINE_FRAMES = 60;
+    static constexpr const std::size_t TIMELINE_EVENTS_PER_FRAME = 4096;
+    bool timeline_enabled = false;
+    Timeline timeline;
+    std::uint8_t timeline_interrupts = 0;
+    std::uint8_t timeline_lcd_mode = 0;
+    void poll_timeline(std::uint16_t address) noexcept;
+    void record_timeline_write(std::uint16_t address, std::uint8_t data) noexcept;
+
+    // CPU usage meter (fed from the game loop, so it doesn't need any hooks)
+    bool cpu_usage_enabled = false;
+    CPUUsageMeter cpu_usage;
+
+    // Trace recording (written out as it goes)
+    bool trace_recording = false;
+    TraceWriter trace_writer;
+    void record_trace(std::uint16_t address, std::uint8_t opcode) noexcept;
+
+    // Registers and memory for evaluating compiled expressions
+    BreakpointCondition::State get_condition_state() noexcept;
+    static std::uint8_t read_memory_for_condition(void *gameboy, std::uint16_t address) noexcept;
+
+    // Watch expressions (evaluated all at once and handed to the UI without locking)
+    std::vector<std::optional<BreakpointCondition>> watch_expressions;
+    TripleBuffer<WatchValues> watch_values;
+    std::uint64_t watch_values_generation = 0;
+    void evaluate_watches() noexcept;
+
+    // Conditional breakpoints (these are checked by us before each GB_run() rather than by SameBoy)
+    struct CompiledBreakpoint {
+        ConditionalBreakpoint breakpoint;
+        BreakpointCondition condition;
+    };
+    std::vector<CompiledBreakpoint> conditional_breakpoints;
+    std::unique_ptr<bool[]> conditional_breakpoint_flags; // indexed by address; null if there are none
+    void check_conditional_breakpoints(std::uint16_t pc) noexcept;
+    bool conditional_breakpoint_matches(std::uint16_t pc) noexcept;
+    bool interrupt_pending_without_mutex() noexcept;
+    void rebuild_conditional_breakpoint_index() noexcept;
+
+    // Where run_to_address(), run_frames(), etc. stop (also checked by us before each GB_run())
+    enum RunTarget {
+        RunTargetNone,
+        RunTargetAddress,
+        RunTargetFrame,
+        RunTargetCycle,
+        RunTargetCondition
+    };
+    RunTarget run_target = RunTargetNone;
+    std::uint64_t run_target_value = 0; // address, frame, or cycle to stop at
+    std::uint64_t run_target_started = 0; // cycle it started on (so addresses and conditions need at least one instruction)
+    std::optional<BreakpointCondition> run_target_condition;
+    void begin_run_target_without_mutex(RunTarget target, std::uint64_t value) noexcept;
+    bool run_target_reached() noexcept;
+
+    // Time travel. Positions are the number of instructions run since it was enabled, which (unlike cycles) can be
+    // landed on exactly when running forward again.
+    bool time_travel_enabled = false;
+    TimeTravel time_travel;
+    std::uint64_t instructions_run = 0;
+    std::uint64_t next_keyframe = 0;
+    std::uint32_t keyframe_interval = 16384;
+    bool instruction_run_this_step = false; // keyframes are only taken after a GB_run() that ran something so positions are unique
+    std::vector<std::uint8_t> time_travel_state;
+    void take_keyframe();
+    bool restore_keyframe(std::size_t index);
+    void clear_time_travel() noexcept;
+
+    // Running backwards is done by scanning forward from a keyframe for the last place to stop at before where we
+    // started (going to the keyframe before that if nothing is found), then seeking to it.
+    enum TimeTravelPhase {
+        TimeTravelIdle,
+        TimeTravelScanning,
+        TimeTravelSeeking
+    };
+    TimeTravelPhase time_travel_phase = TimeTravelIdle;
+    ReverseCommand time_travel_command = ReverseCommand::ReverseStep;
+    std::uint16_t time_travel_origin_sp = 0;
+    std::size_t time_travel_scan_keyframe = 0;
+    std::uint64_t time_travel_scan_end = 0;
+    std::optional<std::pair<std::uint64_t, std::uint16_t>> time_travel_candidate; // position, PC
+    std::uint64_t time_travel_target = 0;
+    std::optional<std::uint16_t> time_travel_target_pc;
+    std::optional<clock::time_point> time_travel_started;
+    std::chrono::nanoseconds time_travel_latency = {};
+    bool begin_time_travel_scan(std::size_t keyframe, std::uint64_t end);
+    bool begin_time_travel_seek(std::size_t keyframe, std::uint64_t target, std::optional<std::uint16_t> pc);
+    const char *continue_time_travel();
+    void finish_time_travel();
+
+    // Sampling profiler
+    bool sampling_profiler_enabled = false;
+    std::uint32_t sampling_profiler_period = 1024;
+    std::uint64_t next_profiler_sample = 0;
+    SamplingProfiler sampling_profiler;
+    std::vector<std::uint32_t> profiler_stack;
+    void take_profiler_sample();
+
+    // Emulated cycles run since the instance was created (as of the last GB_run() call), and as of right now
+    std::uint64_t cycle_count = 0;
+    std::uint64_t get_cycle_count_without_mutex() noexcept;
+
+    // Frames run since the instance was created
+    std::uint32_t frame_count = 0;
+
+    // Symbols loaded with the ROM (and symbols being loaded, if any)
+    std::shared_ptr<const SymbolTable> symbol_table = std::make_shared<SymbolTable>();
+    std::shared_future<std::shared_ptr<const SymbolTable>> pending_symbol_table;
+
+    // Static analysis of the ROM (done after the symbols are loaded, since it won't label anything that has a symbol)
+    struct RomAnalysisResult {
+        std::shared_ptr<const RomAnalysis> analysis;
+        std::shared_ptr<const SymbolTable> symbols; // symbols with the generated labels
+        std::optional<std::filesystem::path> labels_path;
+    };
+    std::optional<std::filesystem::path> analysis_cache_directory;
+    std::shared_ptr<const RomAnalysis> rom_analysis;
+    std::future<RomAnalysisResult> pending_rom_analysis;
+    std::shared_ptr<std::atomic_bool> cancel_rom_analysis;
+    void begin_rom_analysis(const std::optional<std::filesystem::path> &symbol_path);
+    void cancel_rom_analysis_if_running() noexcept;
+    void pick_up_background_loads();
+
     // Audio
     static void on_sample(GB_gameboy_s *gameboy, GB_sample_t *sample);
     bool audio_enabled = false;
@@ -903,6 +1902,12 @@ private: // all private functions assume the mutex is locked by the caller
     // Disassemble without that mutex
     std::string disassemble_without_mutex(std::uint16_t address, std::uint8_t count);
 
+    // Get mapped banks without the mutex
+    MappedBanks get_mapped_banks_without_mutex() noexcept;
+
+    // Get a pointer to the region and its size without the mutex
+    std::uint8_t *get_memory_region_without_mutex(MemoryRegion region, std::size_t &size, std::uint16_t &bank) noexcept;
+
     // Get the backtrace without a mutex
     std::vector<std::uint16_t> get_breakpoints_without_mutex();
 
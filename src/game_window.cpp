@@ -10,6 +10,7 @@
 #include <filesystem>
 #include <QFontDatabase>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <cstring>
 #include <QKeyEvent>
 #include <QApplication>
@@ -19,6 +20,7 @@
 #include <QCheckBox>
 #include <bit>
 #include <QMimeData>
+#include <QStandardPaths>
 #include "printer.hpp"
 #include "edit_advanced_game_boy_model_dialog.hpp"
 #include "edit_speed_control_settings_dialog.hpp"
@@ -26,12 +28,18 @@
 #include <QLabel>
 
 #include "vram_viewer.hpp"
+#include "memory_viewer.hpp"
+#include "call_graph_viewer.hpp"
+#include "timeline_viewer.hpp"
+#include "trace_diff.hpp"
+#include "gdb_server.hpp"
 #include "input_device.hpp"
 
 #define SETTINGS_VOLUME "volume"
 #define SETTINGS_SCALE "scale"
 #define SETTINGS_SCALING_FILTER "scale_filter"
 #define SETTINGS_SHOW_FPS "show_fps"
+#define SETTINGS_CODE_DATA_LOGGING "code_data_logging"
 #define SETTINGS_MONO "mono"
 #define SETTINGS_MUTE "mute"
 #define SETTINGS_RECENT_ROMS "recent_roms"
@@ -356,6 +364,11 @@ GameWindow::GameWindow() {
     this->instance->set_pixel_buffering_mode(static_cast<GameInstance::PixelBufferMode>(settings.value(SETTINGS_BUFFER_MODE, instance->get_pixel_buffering_mode()).toInt()));
     this->instance->set_rewind_length(this->rewind_length);
 
+    auto cache_location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(!cache_location.isEmpty()) {
+        this->instance->set_analysis_cache_directory(std::filesystem::path(cache_location.toStdString()) / "analysis");
+    }
+
     // Set window title and enable drag-n-dropping files
     this->setAcceptDrops(true);
     this->setWindowTitle("SuperDUX");
@@ -746,6 +759,55 @@ GameWindow::GameWindow() {
     connect(this->show_vram_viewer, &QAction::triggered, this->vram_viewer_window, &VRAMViewer::activateWindow);
     this->show_vram_viewer->setEnabled(false);
 
+    // And the memory viewer
+    this->memory_viewer_window = new MemoryViewer(this);
+    this->show_memory_viewer = debug_menu->addAction("Show Memory Viewer");
+    connect(this->show_memory_viewer, &QAction::triggered, this->memory_viewer_window, &MemoryViewer::show);
+    connect(this->show_memory_viewer, &QAction::triggered, this->memory_viewer_window, &MemoryViewer::activateWindow);
+    this->show_memory_viewer->setEnabled(false);
+
+    // And the call graph profiler
+    this->call_graph_viewer_window = new CallGraphViewer(this);
+    this->show_call_graph_viewer = debug_menu->addAction("Show Call Graph Profiler");
+    connect(this->show_call_graph_viewer, &QAction::triggered, this->call_graph_viewer_window, &CallGraphViewer::show);
+    connect(this->show_call_graph_viewer, &QAction::triggered, this->call_graph_viewer_window, &CallGraphViewer::activateWindow);
+    this->show_call_graph_viewer->setEnabled(false);
+
+    // And the timeline
+    this->timeline_viewer_window = new TimelineViewer(this);
+    this->show_timeline_viewer = debug_menu->addAction("Show Timeline");
+    connect(this->show_timeline_viewer, &QAction::triggered, this->timeline_viewer_window, &TimelineViewer::show);
+    connect(this->show_timeline_viewer, &QAction::triggered, this->timeline_viewer_window, &TimelineViewer::activateWindow);
+    this->show_timeline_viewer->setEnabled(false);
+
+    // Code/data logging
+    debug_menu->addSeparator();
+    this->record_code_data_log = debug_menu->addAction("Record Code/Data Log");
+    this->record_code_data_log->setCheckable(true);
+    this->record_code_data_log->setChecked(settings.value(SETTINGS_CODE_DATA_LOGGING, false).toBool());
+    this->instance->set_code_data_logging_enabled(this->record_code_data_log->isChecked());
+    connect(this->record_code_data_log, &QAction::triggered, this, &GameWindow::action_toggle_code_data_logging);
+    this->clear_code_data_log = debug_menu->addAction("Clear Code/Data Log");
+    connect(this->clear_code_data_log, &QAction::triggered, this, &GameWindow::action_clear_code_data_log);
+
+    // Instruction traces
+    debug_menu->addSeparator();
+    this->record_trace = debug_menu->addAction("Record Instruction Trace...");
+    this->record_trace->setCheckable(true);
+    connect(this->record_trace, &QAction::triggered, this, &GameWindow::action_toggle_trace_recording);
+    auto *convert_trace = debug_menu->addAction("Convert Instruction Trace to CSV...");
+    connect(convert_trace, &QAction::triggered, this, &GameWindow::action_convert_trace);
+    auto *compare_traces = debug_menu->addAction("Compare Instruction Traces...");
+    connect(compare_traces, &QAction::triggered, this, &GameWindow::action_compare_traces);
+
+    // Remote debugging
+    debug_menu->addSeparator();
+    this->gdb_server = std::make_unique<GDBServer>(*this->instance);
+    this->gdb_server_action = debug_menu->addAction("GDB Server...");
+    this->gdb_server_action->setCheckable(true);
+    this->gdb_server_action->setEnabled(false);
+    connect(this->gdb_server_action, &QAction::triggered, this, &GameWindow::action_toggle_gdb_server);
+
     // Now, set this
     this->set_pixel_view_scaling(this->scaling);
 
@@ -1007,6 +1069,11 @@ void GameWindow::load_rom(const char *rom_path) noexcept {
 
     // Success!
     if(r == 0) {
+        // Pick up where we left off with the code/data log
+        if(this->record_code_data_log->isChecked()) {
+            this->load_code_data_log();
+        }
+
         // Start the thread
         if(!instance_thread.joinable()) {
             instance_thread = std::thread(GameInstance::start_game_loop, this->instance.get());
@@ -1015,6 +1082,10 @@ void GameWindow::load_rom(const char *rom_path) noexcept {
         // Enable these options
         this->show_debugger->setEnabled(true);
         this->show_vram_viewer->setEnabled(true);
+        this->show_memory_viewer->setEnabled(true);
+        this->show_call_graph_viewer->setEnabled(true);
+        this->show_timeline_viewer->setEnabled(true);
+        this->gdb_server_action->setEnabled(true);
         this->save_state_menu->setEnabled(true);
         this->save_sram_now->setEnabled(true);
         this->show_printer->setEnabled(true);
@@ -1240,6 +1311,9 @@ void GameWindow::game_loop() {
     this->redraw_pixel_buffer();
     this->debugger_window->refresh_view();
     this->vram_viewer_window->refresh_view();
+    this->memory_viewer_window->refresh_view();
+    this->call_graph_viewer_window->refresh_view();
+    this->timeline_viewer_window->refresh_view();
     this->printer_window->refresh_view();
 
     SDL_Event event;
@@ -1475,6 +1549,10 @@ void GameWindow::action_hiding_menu() noexcept {
 
 bool GameWindow::save_if_loaded() noexcept {
     if(this->instance->is_rom_loaded()) {
+        if(this->record_code_data_log->isChecked()) {
+            this->save_code_data_log();
+        }
+
         if(this->instance->save_sram(this->save_path) == 0) {
             print_debug_message("Saved cartridge RAM to %s\n", save_path.string().c_str());
             return true;
@@ -1537,6 +1615,9 @@ void GameWindow::set_loading_other_roms_enabled(bool enabled) noexcept {
 }
 
 GameWindow::~GameWindow() {
+    // Disconnect any debugger before the game goes away
+    this->gdb_server.reset();
+
     if(this->instance_thread.joinable()) {
         this->instance->end_game_loop();
         this->instance_thread.join();
@@ -1552,6 +1633,7 @@ void GameWindow::closeEvent(QCloseEvent *) {
     settings.setValue(SETTINGS_VOLUME, this->instance->get_volume());
     settings.setValue(SETTINGS_SCALE, this->scaling);
     settings.setValue(SETTINGS_SHOW_FPS, this->show_fps);
+    settings.setValue(SETTINGS_CODE_DATA_LOGGING, this->record_code_data_log->isChecked());
     settings.setValue(SETTINGS_MONO, this->instance->is_mono_forced());
     settings.setValue(SETTINGS_MUTE, !this->instance->is_audio_enabled());
     settings.setValue(SETTINGS_RECENT_ROMS, this->recent_roms);
@@ -1780,6 +1862,219 @@ std::filesystem::path GameWindow::get_save_state_path(int index) const {
     return std::filesystem::path(this->save_path).replace_extension(extension);
 }
 
+std::filesystem::path GameWindow::get_code_data_log_path() const {
+    return std::filesystem::path(this->save_path).replace_extension(".cdl");
+}
+
+void GameWindow::load_code_data_log() {
+    auto path = this->get_code_data_log_path();
+    if(!std::filesystem::exists(path)) {
+        return;
+    }
+
+    if(this->instance->load_code_data_log(path)) {
+        print_debug_message("Loaded code/data log from %s\n", path.string().c_str());
+    }
+    else {
+        print_debug_message("Failed to load %s\n", path.string().c_str());
+    }
+}
+
+void GameWindow::save_code_data_log() {
+    auto path = this->get_code_data_log_path();
+    if(this->instance->save_code_data_log(path)) {
+        print_debug_message("Saved code/data log to %s\n", path.string().c_str());
+    }
+    else {
+        print_debug_message("Failed to save %s\n", path.string().c_str());
+    }
+}
+
+void GameWindow::action_toggle_code_data_logging() {
+    bool enabled = this->record_code_data_log->isChecked();
+    bool loaded = this->instance->is_rom_loaded();
+
+    // Write out what we have when stopping, or merge in what was previously recorded when starting
+    if(!enabled && loaded) {
+        this->save_code_data_log();
+    }
+    this->instance->set_code_data_logging_enabled(enabled);
+    if(enabled && loaded) {
+        this->load_code_data_log();
+    }
+}
+
+void GameWindow::action_clear_code_data_log() {
+    this->instance->clear_code_data_log();
+}
+
+void GameWindow::action_toggle_trace_recording() {
+    // Stop if we're recording
+    if(this->instance->is_trace_recording()) {
+        auto count = this->instance->get_trace_record_count();
+        this->record_trace->setChecked(false);
+        if(!this->instance->stop_trace_recording()) {
+            QMessageBox(QMessageBox::Icon::Critical, "Failed to save trace", "The trace could not be completely written. It may be truncated.").exec();
+            return;
+        }
+
+        char message[256];
+        std::snprintf(message, sizeof(message), "Recorded %llu instructions", static_cast<unsigned long long>(count));
+        this->show_status_text(message);
+        return;
+    }
+
+    // Otherwise, start
+    this->record_trace->setChecked(false);
+
+    QFileDialog qfd;
+    qfd.setWindowTitle("Record an Instruction Trace");
+    qfd.setNameFilters(QStringList { "SuperDUX Trace (*.sdxtrace)" });
+    qfd.setDefaultSuffix(".sdxtrace");
+    qfd.setAcceptMode(QFileDialog::AcceptSave);
+    if(qfd.exec() != QDialog::DialogCode::Accepted) {
+        return;
+    }
+
+    auto path = std::filesystem::path(qfd.selectedFiles().at(0).toStdString());
+    if(!this->instance->start_trace_recording(path)) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to record trace", QString("Failed to open ") + path.string().c_str() + " for writing.").exec();
+        return;
+    }
+
+    this->record_trace->setChecked(true);
+}
+
+void GameWindow::action_convert_trace() {
+    QFileDialog open_dialog;
+    open_dialog.setWindowTitle("Select an Instruction Trace");
+    open_dialog.setNameFilters(QStringList { "SuperDUX Trace (*.sdxtrace)" });
+    open_dialog.setFileMode(QFileDialog::FileMode::ExistingFile);
+    if(open_dialog.exec() != QDialog::DialogCode::Accepted) {
+        return;
+    }
+
+    auto input = std::filesystem::path(open_dialog.selectedFiles().at(0).toStdString());
+    TraceReader reader;
+    if(!reader.open(input)) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to open trace", QString(input.string().c_str()) + " is not a valid trace.").exec();
+        return;
+    }
+
+    QFileDialog save_dialog;
+    save_dialog.setWindowTitle("Save a CSV");
+    save_dialog.setNameFilters(QStringList { "Comma-Separated Values (*.csv)" });
+    save_dialog.setDefaultSuffix(".csv");
+    save_dialog.setAcceptMode(QFileDialog::AcceptSave);
+    if(save_dialog.exec() != QDialog::DialogCode::Accepted) {
+        return;
+    }
+
+    auto output = std::filesystem::path(save_dialog.selectedFiles().at(0).toStdString());
+    if(!reader.export_csv(output)) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to save", QString("Failed to write ") + output.string().c_str() + ".").exec();
+    }
+}
+
+void GameWindow::action_compare_traces() {
+    std::unique_ptr<TraceDiff::Source> traces[2];
+    for(auto &trace : traces) {
+        QFileDialog open_dialog;
+        open_dialog.setWindowTitle(&trace == traces ? "Select the First Trace" : "Select the Second Trace");
+        open_dialog.setNameFilters(QStringList { "Instruction Traces (*.sdxtrace *.csv)" });
+        open_dialog.setFileMode(QFileDialog::FileMode::ExistingFile);
+        if(open_dialog.exec() != QDialog::DialogCode::Accepted) {
+            return;
+        }
+
+        auto input = std::filesystem::path(open_dialog.selectedFiles().at(0).toStdString());
+        trace = TraceDiff::open(input);
+        if(!trace) {
+            QMessageBox(QMessageBox::Icon::Critical, "Failed to open trace", QString(input.string().c_str()) + " is not a valid trace.").exec();
+            return;
+        }
+    }
+
+    auto result = TraceDiff::compare(*traces[0], *traces[1]);
+
+    // List the first few differences
+    static constexpr const std::size_t MAX_LISTED = 10;
+    QString text;
+    char line[256];
+    if(result.regions.empty()) {
+        std::snprintf(line, sizeof(line), "The traces match (%llu instructions).", static_cast<unsigned long long>(result.a_records));
+        text = line;
+    }
+    else {
+        std::snprintf(line, sizeof(line), "Found %zu difference%s%s. The first trace has %llu instructions and the second has %llu.\n",
+                      result.regions.size(),
+                      result.regions.size() == 1 ? "" : "s",
+                      result.truncated ? " before giving up" : "",
+                      static_cast<unsigned long long>(result.a_records),
+                      static_cast<unsigned long long>(result.b_records));
+        text = line;
+
+        for(std::size_t i = 0; i < result.regions.size() && i < MAX_LISTED; i++) {
+            auto &r = result.regions[i];
+            std::snprintf(line, sizeof(line), "\n#%llu ($%04x, %llu instructions) vs. #%llu ($%04x, %llu instructions)%s",
+                          static_cast<unsigned long long>(r.a_start), r.a_first.pc, static_cast<unsigned long long>(r.a_length),
+                          static_cast<unsigned long long>(r.b_start), r.b_first.pc, static_cast<unsigned long long>(r.b_length),
+                          r.resynced ? "" : " - never match again");
+            text += line;
+        }
+        if(result.regions.size() > MAX_LISTED) {
+            text += "\n...";
+        }
+    }
+
+    QMessageBox(QMessageBox::Icon::Information, "Trace Comparison", text, QMessageBox::StandardButton::Ok).exec();
+}
+
+void GameWindow::action_toggle_gdb_server() {
+    // Stop if we're running
+    if(this->gdb_server->is_running()) {
+        this->gdb_server->stop();
+        this->gdb_server_action->setChecked(false);
+        this->show_status_text("Stopped GDB server");
+        return;
+    }
+
+    // Otherwise, start
+    this->gdb_server_action->setChecked(false);
+
+    bool ok;
+    auto address = QInputDialog::getText(this, "Start GDB Server", "Port to listen on (localhost only), or unix:PATH for a Unix domain socket:", QLineEdit::Normal, this->gdb_server_address, &ok).trimmed();
+    if(!ok || address.isEmpty()) {
+        return;
+    }
+
+    std::string error;
+    bool started;
+    if(address.startsWith("unix:")) {
+        started = this->gdb_server->start_unix(std::filesystem::path(address.mid(5).toStdString()), error);
+    }
+    else {
+        auto port = address.toUInt(&ok);
+        if(!ok || port == 0 || port > UINT16_MAX) {
+            QMessageBox(QMessageBox::Icon::Critical, "Invalid Port", "The port must be a number from 1 to 65535.", QMessageBox::StandardButton::Ok).exec();
+            return;
+        }
+        started = this->gdb_server->start_tcp(static_cast<std::uint16_t>(port), error);
+    }
+
+    if(!started) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to Start GDB Server", error.c_str(), QMessageBox::StandardButton::Ok).exec();
+        return;
+    }
+
+    this->gdb_server_address = address;
+    this->gdb_server_action->setChecked(true);
+
+    char message[256];
+    std::snprintf(message, sizeof(message), "GDB server listening on %s", address.toUtf8().data());
+    this->show_status_text(message);
+}
+
 void GameWindow::action_create_save_state() {
     // Nope!
     if(!this->save_states_allowed()) {
@@ -30,6 +30,10 @@ class Debugger;
 class EditAdvancedGameBoyModelDialog;
 class EditSpeedControlSettingsDialog;
 class VRAMViewer;
+class MemoryViewer;
+class CallGraphViewer;
+class TimelineViewer;
+class GDBServer;
 
 class GameWindow : public QMainWindow {
     Q_OBJECT
@@ -37,6 +41,7 @@ class GameWindow : public QMainWindow {
     friend Debugger;
     friend EditAdvancedGameBoyModelDialog;
     friend EditSpeedControlSettingsDialog;
+    friend MemoryViewer;
 
 public:
     enum ScalingFilter {
@@ -197,6 +202,16 @@ private:
     QAction *exit_without_saving;
     bool save_if_loaded() noexcept;
 
+    // Code/data log (kept next to the save file)
+    QAction *record_code_data_log;
+    QAction *clear_code_data_log;
+    std::filesystem::path get_code_data_log_path() const;
+    void load_code_data_log();
+    void save_code_data_log();
+
+    // Instruction trace recording
+    QAction *record_trace;
+
     // Debugging
     QAction *show_debugger;
     Debugger *debugger_window;
@@ -205,6 +220,23 @@ private:
     QAction *show_vram_viewer;
     VRAMViewer *vram_viewer_window;
 
+    // Memory viewing
+    QAction *show_memory_viewer;
+    MemoryViewer *memory_viewer_window;
+
+    // Call graph profiling
+    QAction *show_call_graph_viewer;
+    CallGraphViewer *call_graph_viewer_window;
+
+    // Hardware event timeline
+    QAction *show_timeline_viewer;
+    TimelineViewer *timeline_viewer_window;
+
+    // GDB remote debugging
+    QAction *gdb_server_action;
+    std::unique_ptr<GDBServer> gdb_server;
+    QString gdb_server_address = "1234";
+
     // Recent ROMs
     QStringList recent_roms;
     QMenu *recent_roms_menu;
@@ -252,6 +284,12 @@ private slots:
     void action_set_scaling() noexcept;
     void action_set_scale_filter() noexcept;
     void action_toggle_showing_fps() noexcept;
+    void action_toggle_code_data_logging();
+    void action_clear_code_data_log();
+    void action_toggle_trace_recording();
+    void action_convert_trace();
+    void action_compare_traces();
+    void action_toggle_gdb_server();
     void action_toggle_pause() noexcept;
     void action_open_rom() noexcept;
     void action_open_recent_rom();
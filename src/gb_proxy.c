@@ -20,6 +20,9 @@ uint32_t get_gb_backtrace_size(const struct GB_gameboy_s *gb) {
 uint16_t get_gb_backtrace_address(const struct GB_gameboy_s *gb, uint32_t bt) {
     return gb->backtrace_returns[bt].addr;
 }
+uint16_t get_gb_backtrace_bank(const struct GB_gameboy_s *gb, uint32_t bt) {
+    return gb->backtrace_returns[bt].bank;
+}
 
 uint32_t get_gb_breakpoint_size(const struct GB_gameboy_s *gb) {
     return gb->n_breakpoints;
@@ -59,6 +62,34 @@ const uint32_t *get_gb_palette(struct GB_gameboy_s *gb, GB_palette_type_t palett
     return palette + 4 * (palette_index % 8);
 }
 
+uint16_t get_gb_rom0_bank(const struct GB_gameboy_s *gb) {
+    return gb->mbc_rom0_bank;
+}
+
+bool get_gb_boot_rom_finished(const struct GB_gameboy_s *gb) {
+    return gb->boot_rom_finished;
+}
+
+uint32_t get_gb_cycles_since_run(const struct GB_gameboy_s *gb) {
+    return gb->cycles_since_run;
+}
+
+bool get_gb_halted(const struct GB_gameboy_s *gb) {
+    return gb->halted;
+}
+
+bool get_gb_stopped(const struct GB_gameboy_s *gb) {
+    return gb->stopped;
+}
+
+bool get_gb_ime(const struct GB_gameboy_s *gb) {
+    return gb->ime;
+}
+
+uint8_t get_gb_io_register(const struct GB_gameboy_s *gb, uint8_t reg) {
+    return gb->io_registers[reg & 0x7F];
+}
+
 void skip_sgb_intro_animation(struct GB_gameboy_s *gb) {
     gb->sgb->intro_animation = 1000;
 }
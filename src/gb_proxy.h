@@ -15,6 +15,9 @@ uint32_t get_gb_backtrace_size(const struct GB_gameboy_s *gb);
 // Then get their addresses
 uint16_t get_gb_backtrace_address(const struct GB_gameboy_s *gb, uint32_t bt);
 
+// And their banks
+uint16_t get_gb_backtrace_bank(const struct GB_gameboy_s *gb, uint32_t bt);
+
 // Get the # of breakpoints
 uint32_t get_gb_breakpoint_size(const struct GB_gameboy_s *gb);
 
@@ -24,6 +27,27 @@ uint16_t get_gb_breakpoint_address(const struct GB_gameboy_s *gb, uint32_t bt);
 // Get a pointer to the palette
 const uint32_t *get_gb_palette(struct GB_gameboy_s *gb, GB_palette_type_t palette_type, unsigned char palette_index);
 
+// Get the ROM bank mapped to $0000-$3FFF (this is not always 0 on some multicarts)
+uint16_t get_gb_rom0_bank(const struct GB_gameboy_s *gb);
+
+// Get whether the boot ROM has finished (and is no longer mapped)
+bool get_gb_boot_rom_finished(const struct GB_gameboy_s *gb);
+
+// Get the number of cycles run so far in the current GB_run() call
+uint32_t get_gb_cycles_since_run(const struct GB_gameboy_s *gb);
+
+// Get whether the CPU is halted
+bool get_gb_halted(const struct GB_gameboy_s *gb);
+
+// Get whether the CPU is stopped (STOP)
+bool get_gb_stopped(const struct GB_gameboy_s *gb);
+
+// Get whether interrupts are enabled (IME)
+bool get_gb_ime(const struct GB_gameboy_s *gb);
+
+// Get the value of an I/O register ($FF00-$FF7F) without any side effects of reading it
+uint8_t get_gb_io_register(const struct GB_gameboy_s *gb, uint8_t reg);
+
 // Skip the SGB intro animation
 void skip_sgb_intro_animation(struct GB_gameboy_s *gb);
 
@@ -0,0 +1,723 @@
+#include "gdb_server.hpp"
+#include "game_instance.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
+// Largest packet we accept or send (GDB sizes its memory reads and writes to fit)
+static constexpr const std::size_t PACKET_SIZE = 0x1000;
+static constexpr const std::size_t MAX_MEMORY_TRANSFER = (PACKET_SIZE - 32) / 2;
+
+// GDB's z80 register layout is af, bc, de, hl, sp, pc, ix, iy, af', bc', de', hl', ir. The SM83 only has the first six.
+static constexpr const GameInstance::SM83Register REGISTERS[] = {
+    GameInstance::SM83Register::SM83_REG_AF,
+    GameInstance::SM83Register::SM83_REG_BC,
+    GameInstance::SM83Register::SM83_REG_DE,
+    GameInstance::SM83Register::SM83_REG_HL,
+    GameInstance::SM83Register::SM83_REG_SP,
+    GameInstance::SM83Register::SM83_REG_PC
+};
+static constexpr const std::size_t REAL_REGISTER_COUNT = sizeof(REGISTERS) / sizeof(REGISTERS[0]);
+static constexpr const std::size_t REGISTER_COUNT = 13;
+
+// How long to wait on a socket before checking if we're stopping
+static constexpr const int POLL_INTERVAL_MS = 100;
+
+// How long to wait for the game to stop before checking for an interrupt from the client
+static constexpr const std::chrono::milliseconds INTERRUPT_CHECK_INTERVAL(50);
+
+#ifdef _WIN32
+static SOCKET native(std::intptr_t socket) noexcept { return static_cast<SOCKET>(socket); }
+#else
+static int native(std::intptr_t socket) noexcept { return static_cast<int>(socket); }
+#endif
+
+static void close_socket(std::intptr_t socket) noexcept {
+#ifdef _WIN32
+    closesocket(native(socket));
+#else
+    close(native(socket));
+#endif
+}
+
+static bool wait_readable(std::intptr_t socket, int timeout_ms) noexcept {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(native(socket), &set);
+
+    timeval timeout;
+    timeout.tv_sec = timeout_ms / 1000;
+    timeout.tv_usec = (timeout_ms % 1000) * 1000;
+    return select(static_cast<int>(socket + 1), &set, nullptr, nullptr, &timeout) > 0;
+}
+
+static int hex_digit(char c) noexcept {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    else if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    else if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// Parse a hex number, advancing past it
+static bool parse_hex(const char *&text, std::uint32_t &value) noexcept {
+    value = 0;
+    auto *start = text;
+    for(int digit; (digit = hex_digit(*text)) >= 0; text++) {
+        value = value << 4 | static_cast<std::uint32_t>(digit);
+    }
+    return text != start;
+}
+
+static bool parse_hex_bytes(const char *text, std::size_t count, std::uint8_t *bytes) noexcept {
+    for(std::size_t i = 0; i < count; i++) {
+        auto high = hex_digit(text[i * 2]);
+        auto low = high < 0 ? -1 : hex_digit(text[i * 2 + 1]);
+        if(low < 0) {
+            return false;
+        }
+        bytes[i] = static_cast<std::uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+// Decode binary data from an X packet ('}' escapes the next byte, XORed with 0x20), returning how many bytes it holds
+static std::size_t parse_binary_bytes(const char *text, const char *end, std::size_t max_count, std::uint8_t *bytes) noexcept {
+    std::size_t count = 0;
+    while(text < end && count < max_count) {
+        auto c = static_cast<std::uint8_t>(*text++);
+        if(c == '}') {
+            if(text == end) {
+                break;
+            }
+            c = static_cast<std::uint8_t>(*text++) ^ 0x20;
+        }
+        bytes[count++] = c;
+    }
+    return count;
+}
+
+static void append_hex_bytes(std::string &text, const std::uint8_t *bytes, std::size_t count) {
+    static const char DIGITS[] = "0123456789abcdef";
+    for(std::size_t i = 0; i < count; i++) {
+        text += DIGITS[bytes[i] >> 4];
+        text += DIGITS[bytes[i] & 0xF];
+    }
+}
+
+static void append_register(std::string &text, std::uint16_t value) {
+    std::uint8_t bytes[2] = { static_cast<std::uint8_t>(value), static_cast<std::uint8_t>(value >> 8) };
+    append_hex_bytes(text, bytes, sizeof(bytes));
+}
+
+GDBServer::GDBServer(GameInstance &instance) : instance(instance) {}
+
+GDBServer::~GDBServer() {
+    this->stop();
+}
+
+bool GDBServer::start_tcp(std::uint16_t port, std::string &error) {
+    this->stop();
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if(WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        error = "Failed to initialize Winsock";
+        return false;
+    }
+    this->winsock_initialized = true;
+#endif
+
+    auto s = static_cast<Socket>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP));
+    if(s == NO_SOCKET) {
+        error = "Failed to create a socket";
+        this->stop();
+        return false;
+    }
+
+    int yes = 1;
+    setsockopt(native(s), SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char *>(&yes), sizeof(yes));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(native(s), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        error = "Failed to bind to port " + std::to_string(port) + " (is something else using it?)";
+        close_socket(s);
+        this->stop();
+        return false;
+    }
+
+    return this->start_listening(s, error);
+}
+
+bool GDBServer::start_unix(const std::filesystem::path &path, std::string &error) {
+    this->stop();
+
+#ifdef _WIN32
+    (void)path;
+    error = "Unix domain sockets are not supported on Windows";
+    return false;
+#else
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    auto path_string = path.string();
+    if(path_string.empty() || path_string.size() >= sizeof(address.sun_path)) {
+        error = "The socket path is too long";
+        return false;
+    }
+    std::memcpy(address.sun_path, path_string.c_str(), path_string.size() + 1);
+
+    auto s = static_cast<Socket>(socket(AF_UNIX, SOCK_STREAM, 0));
+    if(s == NO_SOCKET) {
+        error = "Failed to create a socket";
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if(bind(native(s), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        error = "Failed to bind to " + path_string;
+        close_socket(s);
+        return false;
+    }
+
+    this->unix_socket_path = path;
+    return this->start_listening(s, error);
+#endif
+}
+
+bool GDBServer::start_listening(Socket socket, std::string &error) {
+    if(listen(native(socket), 1) != 0) {
+        error = "Failed to listen on the socket";
+        close_socket(socket);
+        this->stop();
+        return false;
+    }
+
+    this->listen_socket = socket;
+    this->stopping = false;
+    this->server_thread = std::thread(&GDBServer::serve, this);
+    return true;
+}
+
+void GDBServer::stop() {
+    this->stopping = true;
+    if(this->server_thread.joinable()) {
+        this->server_thread.join();
+    }
+
+    if(this->listen_socket != NO_SOCKET) {
+        close_socket(this->listen_socket);
+        this->listen_socket = NO_SOCKET;
+    }
+
+#ifdef _WIN32
+    if(this->winsock_initialized) {
+        WSACleanup();
+        this->winsock_initialized = false;
+    }
+#endif
+
+    if(!this->unix_socket_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(this->unix_socket_path, ec);
+        this->unix_socket_path.clear();
+    }
+}
+
+void GDBServer::serve() {
+    while(!this->stopping) {
+        if(!wait_readable(this->listen_socket, POLL_INTERVAL_MS)) {
+            continue;
+        }
+
+        auto client = static_cast<Socket>(accept(native(this->listen_socket), nullptr, nullptr));
+        if(client == NO_SOCKET) {
+            continue;
+        }
+
+        // Every step is a round trip, so don't let Nagle's algorithm hold onto replies (fails harmlessly for Unix sockets)
+        int yes = 1;
+        setsockopt(native(client), IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char *>(&yes), sizeof(yes));
+
+        this->client = client;
+        this->serve_client();
+        close_socket(client);
+        this->client = NO_SOCKET;
+    }
+}
+
+void GDBServer::serve_client() {
+    this->client_connected = true;
+    this->client_closed = false;
+    this->no_ack = false;
+    this->input.clear();
+    this->last_packet.clear();
+    this->owned_breakpoints.clear();
+    this->owned_watchpoints.clear();
+
+    // GDB expects the target to be stopped when it connects
+    if(!this->instance.is_paused_from_breakpoint()) {
+        this->instance.break_immediately();
+    }
+    this->last_stop_reply = this->wait_for_stop();
+
+    while(!this->stopping && !this->client_closed) {
+        if(this->receive(POLL_INTERVAL_MS)) {
+            this->process_input();
+        }
+    }
+
+    // Take out any breakpoints GDB left behind and let the game keep going without us
+    for(auto address : this->owned_breakpoints) {
+        this->instance.remove_simple_breakpoint(address);
+    }
+    this->owned_breakpoints.clear();
+    for(auto &watchpoint : this->owned_watchpoints) {
+        this->remove_owned_watchpoint(watchpoint);
+    }
+    this->owned_watchpoints.clear();
+    this->instance.unbreak();
+    this->client_connected = false;
+}
+
+bool GDBServer::receive(int timeout_ms) {
+    if(!wait_readable(this->client, timeout_ms)) {
+        return false;
+    }
+
+    char buffer[4096];
+    auto received = recv(native(this->client), buffer, sizeof(buffer), 0);
+    if(received <= 0) {
+        this->client_closed = true;
+        return false;
+    }
+
+    this->input.append(buffer, static_cast<std::size_t>(received));
+    return true;
+}
+
+void GDBServer::process_input() {
+    while(!this->input.empty() && !this->client_closed) {
+        auto c = this->input[0];
+
+        // Acknowledgements (resend on a negative one)
+        if(c == '+' || c == '-') {
+            this->input.erase(0, 1);
+            if(c == '-' && !this->last_packet.empty()) {
+                this->send_raw(this->last_packet);
+            }
+            continue;
+        }
+
+        // Interrupt (only matters while running, which wait_for_stop() handles)
+        if(c == '\x03' || c != '$') {
+            this->input.erase(0, 1);
+            continue;
+        }
+
+        // Wait for the rest of the packet and its checksum
+        auto end = this->input.find('#');
+        if(end == std::string::npos || end + 2 >= this->input.size()) {
+            if(this->input.size() > PACKET_SIZE * 2) {
+                this->input.clear(); // garbage
+            }
+            return;
+        }
+
+        auto packet = this->input.substr(1, end - 1);
+        std::uint8_t checksum = 0;
+        bool checksum_valid = parse_hex_bytes(this->input.c_str() + end + 1, 1, &checksum);
+        this->input.erase(0, end + 3);
+
+        if(!this->no_ack) {
+            std::uint8_t sum = 0;
+            for(auto p : packet) {
+                sum += static_cast<std::uint8_t>(p);
+            }
+            if(!checksum_valid || sum != checksum) {
+                this->send_raw("-");
+                continue;
+            }
+            this->send_raw("+");
+        }
+
+        // Kill doesn't get a reply
+        if(packet == "k") {
+            this->client_closed = true;
+            break;
+        }
+
+        this->send_packet(this->handle_packet(packet));
+
+        if(packet == "QStartNoAckMode") {
+            this->no_ack = true;
+        }
+    }
+}
+
+void GDBServer::send_packet(const std::string &payload) {
+    std::uint8_t sum = 0;
+    for(auto p : payload) {
+        sum += static_cast<std::uint8_t>(p);
+    }
+
+    char checksum[4];
+    std::snprintf(checksum, sizeof(checksum), "#%02x", sum);
+
+    this->last_packet.clear();
+    this->last_packet.reserve(payload.size() + 4);
+    this->last_packet += '$';
+    this->last_packet += payload;
+    this->last_packet += checksum;
+    this->send_raw(this->last_packet);
+}
+
+void GDBServer::send_raw(const std::string &data) {
+#ifdef MSG_NOSIGNAL
+    static constexpr const int FLAGS = MSG_NOSIGNAL;
+#else
+    static constexpr const int FLAGS = 0;
+#endif
+
+    std::size_t sent = 0;
+    while(sent < data.size() && !this->client_closed) {
+        auto result = send(native(this->client), data.data() + sent, static_cast<int>(data.size() - sent), FLAGS);
+        if(result <= 0) {
+            this->client_closed = true;
+            return;
+        }
+        sent += static_cast<std::size_t>(result);
+    }
+}
+
+std::string GDBServer::handle_packet(const std::string &packet) {
+    if(packet.empty()) {
+        return "";
+    }
+
+    const char *args = packet.c_str() + 1;
+    std::uint32_t number, value, length;
+    std::string reply;
+
+    switch(packet[0]) {
+        case '?':
+            return this->last_stop_reply;
+
+        case 'g':
+            for(std::size_t r = 0; r < REGISTER_COUNT; r++) {
+                append_register(reply, r < REAL_REGISTER_COUNT ? this->instance.get_register_value(REGISTERS[r]) : 0);
+            }
+            return reply;
+
+        case 'G': {
+            std::uint8_t bytes[REAL_REGISTER_COUNT * 2];
+            if(packet.size() < 1 + sizeof(bytes) * 2 || !parse_hex_bytes(args, sizeof(bytes), bytes)) {
+                return "E01";
+            }
+            for(std::size_t r = 0; r < REAL_REGISTER_COUNT; r++) {
+                this->instance.set_register_value(REGISTERS[r], static_cast<std::uint16_t>(bytes[r * 2] | bytes[r * 2 + 1] << 8));
+            }
+            return "OK";
+        }
+
+        case 'p':
+            if(!parse_hex(args, number) || number >= REGISTER_COUNT) {
+                return "E01";
+            }
+            append_register(reply, number < REAL_REGISTER_COUNT ? this->instance.get_register_value(REGISTERS[number]) : 0);
+            return reply;
+
+        case 'P': {
+            std::uint8_t bytes[2];
+            if(!parse_hex(args, number) || *args++ != '=' || !parse_hex_bytes(args, sizeof(bytes), bytes) || number >= REGISTER_COUNT) {
+                return "E01";
+            }
+            if(number < REAL_REGISTER_COUNT) {
+                this->instance.set_register_value(REGISTERS[number], static_cast<std::uint16_t>(bytes[0] | bytes[1] << 8));
+            }
+            return "OK";
+        }
+
+        case 'm': {
+            if(!parse_hex(args, value) || *args++ != ',' || !parse_hex(args, length)) {
+                return "E01";
+            }
+            length = std::min<std::uint32_t>(length, MAX_MEMORY_TRANSFER);
+
+            // All of it is read at once so GDB sees a consistent view
+            std::uint8_t bytes[MAX_MEMORY_TRANSFER];
+            this->instance.read_memory_range(std::nullopt, static_cast<std::uint16_t>(value), length, bytes);
+            append_hex_bytes(reply, bytes, length);
+            return reply;
+        }
+
+        case 'M': {
+            if(!parse_hex(args, value) || *args++ != ',' || !parse_hex(args, length) || *args++ != ':' || length > MAX_MEMORY_TRANSFER) {
+                return "E01";
+            }
+
+            std::uint8_t bytes[MAX_MEMORY_TRANSFER];
+            if(std::strlen(args) < length * 2 || !parse_hex_bytes(args, length, bytes)) {
+                return "E01";
+            }
+            this->instance.write_memory_range(static_cast<std::uint16_t>(value), bytes, length);
+            return "OK";
+        }
+
+        // Same as M but the data is binary (GDB also sends an empty one to see if we support it)
+        case 'X': {
+            if(!parse_hex(args, value) || *args++ != ',' || !parse_hex(args, length) || *args++ != ':' || length > PACKET_SIZE) {
+                return "E01";
+            }
+
+            std::uint8_t bytes[PACKET_SIZE];
+            if(parse_binary_bytes(args, packet.c_str() + packet.size(), length, bytes) != length) {
+                return "E01";
+            }
+            this->instance.write_memory_range(static_cast<std::uint16_t>(value), bytes, length);
+            return "OK";
+        }
+
+        case 'Z':
+        case 'z':
+            return this->update_breakpoint(packet, packet[0] == 'Z');
+
+        case 'c':
+            return this->resume("continue", args);
+
+        case 's':
+            return this->resume("step", args);
+
+        // Signals are ignored
+        case 'C':
+        case 'S': {
+            auto *address = std::strchr(args, ';');
+            return this->resume(packet[0] == 'C' ? "continue" : "step", address ? address + 1 : "");
+        }
+
+        case 'v':
+            if(packet == "vCont?") {
+                return "vCont;c;C;s;S";
+            }
+            if(packet.rfind("vCont;", 0) == 0 && packet.size() > 6) {
+                // There's only one thread, so the first action is the one that applies
+                switch(packet[6]) {
+                    case 'c':
+                    case 'C':
+                        return this->resume("continue", "");
+                    case 's':
+                    case 'S':
+                        return this->resume("step", "");
+                    default:
+                        return "E01";
+                }
+            }
+            return "";
+
+        case 'q':
+            if(packet.rfind("qSupported", 0) == 0) {
+                char supported[64];
+                std::snprintf(supported, sizeof(supported), "PacketSize=%zx;QStartNoAckMode+", PACKET_SIZE);
+                return supported;
+            }
+            if(packet == "qAttached") {
+                return "1";
+            }
+            if(packet == "qC") {
+                return "QC1";
+            }
+            if(packet == "qfThreadInfo") {
+                return "m1";
+            }
+            if(packet == "qsThreadInfo") {
+                return "l";
+            }
+            if(packet == "qOffsets") {
+                return "Text=0;Data=0;Bss=0";
+            }
+            return "";
+
+        case 'Q':
+            return packet == "QStartNoAckMode" ? "OK" : "";
+
+        // There's only one thread
+        case 'H':
+        case 'T':
+            return "OK";
+
+        case 'D':
+            this->client_closed = true;
+            return "OK";
+
+        default:
+            return "";
+    }
+}
+
+std::string GDBServer::update_breakpoint(const std::string &packet, bool insert) {
+    const char *args = packet.c_str() + 1;
+    std::uint32_t type, address, kind;
+    if(!parse_hex(args, type) || *args++ != ',' || !parse_hex(args, address) || *args++ != ',' || !parse_hex(args, kind) || address > 0xFFFF) {
+        return "E01";
+    }
+
+    GameInstance::WatchpointType watchpoint_type;
+    switch(type) {
+        // Software and hardware breakpoints are the same thing here
+        case 0:
+        case 1:
+        {
+            // Only take out breakpoints we put in, so the user's own breakpoints at the same address survive
+            auto breakpoint_address = static_cast<std::uint16_t>(address);
+            auto owned = std::find(this->owned_breakpoints.begin(), this->owned_breakpoints.end(), breakpoint_address);
+            if(insert) {
+                if(owned == this->owned_breakpoints.end() && this->instance.add_simple_breakpoint(breakpoint_address)) {
+                    this->owned_breakpoints.emplace_back(breakpoint_address);
+                }
+            }
+            else if(owned != this->owned_breakpoints.end()) {
+                this->owned_breakpoints.erase(owned);
+                this->instance.remove_simple_breakpoint(breakpoint_address);
+            }
+            return "OK";
+        }
+
+        case 2:
+            watchpoint_type = GameInstance::WatchpointType::WatchpointWrite;
+            break;
+        case 3:
+            watchpoint_type = GameInstance::WatchpointType::WatchpointRead;
+            break;
+        case 4:
+            watchpoint_type = GameInstance::WatchpointType::WatchpointAccess;
+            break;
+        default:
+            return "";
+    }
+
+    OwnedWatchpoint watchpoint;
+    watchpoint.start = static_cast<std::uint16_t>(address);
+    watchpoint.end = static_cast<std::uint16_t>(std::min<std::uint32_t>(address + std::max<std::uint32_t>(kind, 1) - 1, 0xFFFF));
+    watchpoint.type = watchpoint_type;
+
+    // Same as breakpoints, only take out watchpoints we put in
+    auto owned = std::find_if(this->owned_watchpoints.begin(), this->owned_watchpoints.end(), [&watchpoint](const OwnedWatchpoint &w) {
+        return w.start == watchpoint.start && w.end == watchpoint.end && w.type == watchpoint.type;
+    });
+    if(insert) {
+        if(owned == this->owned_watchpoints.end()) {
+            GameInstance::Watchpoint w = {};
+            w.start = watchpoint.start;
+            w.end = watchpoint.end;
+            w.type = watchpoint_type;
+            this->instance.add_watchpoint(w);
+            this->owned_watchpoints.emplace_back(watchpoint);
+        }
+    }
+    else if(owned != this->owned_watchpoints.end()) {
+        this->owned_watchpoints.erase(owned);
+        this->remove_owned_watchpoint(watchpoint);
+    }
+    return "OK";
+}
+
+void GDBServer::remove_owned_watchpoint(const OwnedWatchpoint &watchpoint) {
+    // Indices can change if the user edits watchpoints, so find it again (it may be gone already if they removed it)
+    auto watchpoints = this->instance.get_watchpoints();
+    for(std::size_t i = 0; i < watchpoints.size(); i++) {
+        auto &w = watchpoints[i];
+        if(w.start == watchpoint.start && w.end == watchpoint.end && w.type == watchpoint.type && !w.value.has_value() && w.trace_count == 0) {
+            this->instance.remove_watchpoint(i);
+            return;
+        }
+    }
+}
+
+std::string GDBServer::resume(const char *command, const std::string &address) {
+    // Something else (e.g. the debugger window) may have let it keep running
+    if(!this->instance.is_paused_from_breakpoint()) {
+        this->instance.break_immediately();
+        if(this->wait_for_stop().empty()) {
+            return "";
+        }
+    }
+
+    if(!address.empty()) {
+        const char *text = address.c_str();
+        std::uint32_t pc;
+        if(!parse_hex(text, pc) || pc > 0xFFFF) {
+            return "E01";
+        }
+        this->instance.set_register_value(GameInstance::SM83Register::SM83_REG_PC, static_cast<std::uint16_t>(pc));
+    }
+
+    auto hit_before = this->instance.get_last_watchpoint_hit();
+    auto hits_before = hit_before.has_value() ? hit_before->hit_number : 0;
+
+    this->instance.unbreak(command);
+    auto reply = this->wait_for_stop();
+    if(reply.empty()) {
+        return reply;
+    }
+
+    // Tell GDB if a watchpoint is why we stopped
+    auto hit = this->instance.get_last_watchpoint_hit();
+    if(hit.has_value() && hit->hit_number != hits_before) {
+        const char *kind = hit->type == GameInstance::WatchpointType::WatchpointWrite ? "watch" : "rwatch";
+        for(auto &w : this->instance.get_watchpoints()) {
+            if(w.type == GameInstance::WatchpointType::WatchpointAccess && hit->address >= w.start && hit->address <= w.end) {
+                kind = "awatch";
+                break;
+            }
+        }
+
+        char stop_reply[64];
+        std::snprintf(stop_reply, sizeof(stop_reply), "T05%s:%04x;", kind, hit->address);
+        reply = stop_reply;
+    }
+
+    this->last_stop_reply = reply;
+    return reply;
+}
+
+std::string GDBServer::wait_for_stop() {
+    while(!this->stopping && !this->client_closed) {
+        if(this->instance.wait_for_breakpoint_pause(INTERRUPT_CHECK_INTERVAL)) {
+            return "S05";
+        }
+
+        // GDB sends ^C to interrupt
+        if(this->receive(0)) {
+            auto interrupt = this->input.find('\x03');
+            if(interrupt != std::string::npos) {
+                this->input.erase(interrupt, 1);
+                this->instance.break_immediately();
+            }
+        }
+    }
+    return "";
+}
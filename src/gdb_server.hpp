@@ -0,0 +1,109 @@
+#ifndef GDB_SERVER_HPP
+#define GDB_SERVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+#include <vector>
+
+class GameInstance;
+
+// GDB remote serial protocol server, so GDB (or anything else that speaks the protocol) can debug the game
+//
+// Registers are reported using GDB's z80 register layout (af, bc, de, hl, sp, pc, then the z80-only ones as zero), so
+// GDB should be used with "set architecture z80". Only one client is served at a time, and it only listens on localhost
+// or a Unix domain socket.
+class GDBServer {
+public:
+    GDBServer(GameInstance &instance);
+    ~GDBServer();
+
+    GDBServer(const GDBServer &) = delete;
+    GDBServer &operator=(const GDBServer &) = delete;
+
+    /**
+     * Start listening on a TCP port on localhost, stopping the server first if it's running
+     *
+     * @param  port  port to listen on
+     * @param  error set to what went wrong if it couldn't start
+     * @return       true if listening
+     */
+    bool start_tcp(std::uint16_t port, std::string &error);
+
+    /**
+     * Start listening on a Unix domain socket, stopping the server first if it's running
+     *
+     * @param  path  path of the socket (replaced if it exists)
+     * @param  error set to what went wrong if it couldn't start
+     * @return       true if listening
+     */
+    bool start_unix(const std::filesystem::path &path, std::string &error);
+
+    /**
+     * Stop the server, disconnecting the client if one is connected. The game is left running.
+     */
+    void stop();
+
+    /**
+     * Get whether the server is listening
+     *
+     * @return true if listening
+     */
+    bool is_running() const noexcept { return this->listen_socket != NO_SOCKET; }
+
+    /**
+     * Get whether a client is connected
+     *
+     * @return true if connected
+     */
+    bool is_connected() const noexcept { return this->client_connected; }
+
+private:
+    using Socket = std::intptr_t;
+    static constexpr const Socket NO_SOCKET = -1;
+
+    GameInstance &instance;
+    Socket listen_socket = NO_SOCKET;
+    std::filesystem::path unix_socket_path;
+    std::thread server_thread;
+    std::atomic_bool stopping = false;
+    std::atomic_bool client_connected = false;
+
+#ifdef _WIN32
+    bool winsock_initialized = false;
+#endif
+
+    // Per-connection state
+    Socket client = NO_SOCKET;
+    std::string input;
+    std::string last_packet;
+    bool no_ack = false;
+    bool client_closed = false;
+    std::string last_stop_reply = "S05";
+    std::vector<std::uint16_t> owned_breakpoints; // ones we added (not ones the user already had there)
+
+    // Same for watchpoints
+    struct OwnedWatchpoint {
+        std::uint16_t start;
+        std::uint16_t end;
+        std::uint8_t type; // GameInstance::WatchpointType
+    };
+    std::vector<OwnedWatchpoint> owned_watchpoints;
+
+    bool start_listening(Socket socket, std::string &error);
+    void serve();
+    void serve_client();
+    bool receive(int timeout_ms);
+    void process_input();
+    void send_packet(const std::string &payload);
+    void send_raw(const std::string &data);
+    std::string handle_packet(const std::string &packet);
+    std::string resume(const char *command, const std::string &address);
+    std::string wait_for_stop();
+    std::string update_breakpoint(const std::string &packet, bool insert);
+    void remove_owned_watchpoint(const OwnedWatchpoint &watchpoint);
+};
+
+#endif
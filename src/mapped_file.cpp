@@ -0,0 +1,92 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    this->close();
+}
+
+bool MappedFile::open(const std::filesystem::path &path) {
+    this->close();
+
+#ifdef _WIN32
+    auto file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    this->file_handle = file;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        this->close();
+        return false;
+    }
+
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mapping) {
+        this->close();
+        return false;
+    }
+    this->mapping_handle = mapping;
+
+    auto *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(!view) {
+        this->close();
+        return false;
+    }
+    this->contents = reinterpret_cast<const std::uint8_t *>(view);
+    this->contents_size = static_cast<std::size_t>(size.QuadPart);
+    return true;
+#else
+    int fd = ::open(path.string().c_str(), O_RDONLY);
+    if(fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    auto *view = mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(view == MAP_FAILED) {
+        return false;
+    }
+    this->contents = reinterpret_cast<const std::uint8_t *>(view);
+    this->contents_size = static_cast<std::size_t>(st.st_size);
+    return true;
+#endif
+}
+
+void MappedFile::close() noexcept {
+#ifdef _WIN32
+    if(this->contents) {
+        UnmapViewOfFile(this->contents);
+    }
+    if(this->mapping_handle) {
+        CloseHandle(this->mapping_handle);
+        this->mapping_handle = nullptr;
+    }
+    if(this->file_handle) {
+        CloseHandle(this->file_handle);
+        this->file_handle = nullptr;
+    }
+#else
+    if(this->contents) {
+        munmap(const_cast<std::uint8_t *>(this->contents), this->contents_size);
+    }
+#endif
+
+    this->contents = nullptr;
+    this->contents_size = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * Map a file, unmapping any file already mapped
+     *
+     * @param  path path to the file
+     * @return      true if successful (empty files can't be mapped)
+     */
+    bool open(const std::filesystem::path &path);
+
+    /**
+     * Unmap the file
+     */
+    void close() noexcept;
+
+    /**
+     * Get the contents of the file
+     *
+     * @return pointer to the contents, or nullptr if nothing is mapped
+     */
+    const std::uint8_t *data() const noexcept { return this->contents; }
+
+    /**
+     * Get the size of the file
+     *
+     * @return size in bytes
+     */
+    std::size_t size() const noexcept { return this->contents_size; }
+
+private:
+    const std::uint8_t *contents = nullptr;
+    std::size_t contents_size = 0;
+
+#ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,270 @@
+#include "memory_search.hpp"
+#include "mapped_file.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+// Small buffers aren't worth starting threads for
+static constexpr const std::size_t MIN_CHUNK_SIZE = 256 * 1024;
+
+static int hex_digit(char c) noexcept {
+    if(c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    else if(c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    else if(c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+bool MemorySearch::CharacterTable::load(const std::filesystem::path &path) {
+    this->entries.clear();
+    this->longest = 0;
+
+    MappedFile file;
+    if(!file.open(path)) {
+        return false;
+    }
+
+    std::string_view contents(reinterpret_cast<const char *>(file.data()), file.size());
+    while(!contents.empty()) {
+        auto line_end = contents.find('\n');
+        auto line = contents.substr(0, line_end);
+        contents = line_end == std::string_view::npos ? std::string_view() : contents.substr(line_end + 1);
+
+        if(!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        // End and line break markers (/XX= and *XX=) are entries like any other as far as searching goes
+        if(!line.empty() && (line.front() == '/' || line.front() == '*')) {
+            line.remove_prefix(1);
+        }
+
+        auto equals = line.find('=');
+        if(equals == std::string_view::npos || equals == 0 || equals % 2 != 0 || equals + 1 == line.size()) {
+            continue;
+        }
+
+        std::vector<std::uint8_t> bytes;
+        bool valid = true;
+        for(std::size_t i = 0; i < equals; i += 2) {
+            auto high = hex_digit(line[i]), low = hex_digit(line[i + 1]);
+            if(high < 0 || low < 0) {
+                valid = false;
+                break;
+            }
+            bytes.emplace_back(static_cast<std::uint8_t>(high << 4 | low));
+        }
+        if(!valid) {
+            continue;
+        }
+
+        // If text is in the table more than once, the first one wins
+        auto text = std::string(line.substr(equals + 1));
+        this->longest = std::max(this->longest, text.size());
+        this->entries.try_emplace(std::move(text), std::move(bytes));
+    }
+
+    return !this->entries.empty();
+}
+
+bool MemorySearch::CharacterTable::encode(std::string_view text, std::vector<std::uint8_t> &bytes) const {
+    bytes.clear();
+
+    std::string key;
+    while(!text.empty()) {
+        bool found = false;
+        for(auto length = std::min(this->longest, text.size()); length > 0; length--) {
+            key.assign(text.substr(0, length));
+            auto entry = this->entries.find(key);
+            if(entry != this->entries.end()) {
+                bytes.insert(bytes.end(), entry->second.begin(), entry->second.end());
+                text.remove_prefix(length);
+                found = true;
+                break;
+            }
+        }
+        if(!found) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool MemorySearch::parse_bytes(std::string_view text, Pattern &pattern, std::string &error) {
+    pattern.bytes.clear();
+    pattern.mask.clear();
+
+    for(std::size_t i = 0; i < text.size();) {
+        auto c = text[i];
+        if(c == ' ' || c == '\t' || c == ',') {
+            i++;
+            continue;
+        }
+        if(c == '$') {
+            i++;
+            continue;
+        }
+
+        if(i + 1 >= text.size() || text[i + 1] == ' ') {
+            error = "Bytes must be written as two hex digits each (e.g. \"3E ?? EA\")";
+            return false;
+        }
+
+        if(c == '?' && text[i + 1] == '?') {
+            pattern.bytes.emplace_back(0);
+            pattern.mask.emplace_back(0);
+        }
+        else {
+            auto high = hex_digit(c), low = hex_digit(text[i + 1]);
+            if(high < 0 || low < 0) {
+                error = "\"" + std::string(text.substr(i, 2)) + "\" is not a hex byte or ?? wildcard";
+                return false;
+            }
+            pattern.bytes.emplace_back(static_cast<std::uint8_t>(high << 4 | low));
+            pattern.mask.emplace_back(0xFF);
+        }
+        i += 2;
+    }
+
+    if(pattern.bytes.empty()) {
+        error = "Nothing to search for";
+        return false;
+    }
+    if(std::find(pattern.mask.begin(), pattern.mask.end(), 0xFF) == pattern.mask.end()) {
+        error = "The pattern can't be all wildcards";
+        return false;
+    }
+
+    return true;
+}
+
+MemorySearch::Pattern MemorySearch::make_u16(std::uint16_t value, bool big_endian) {
+    Pattern pattern;
+    auto low = static_cast<std::uint8_t>(value), high = static_cast<std::uint8_t>(value >> 8);
+    pattern.bytes = big_endian ? std::vector<std::uint8_t> { high, low } : std::vector<std::uint8_t> { low, high };
+    pattern.mask = { 0xFF, 0xFF };
+    return pattern;
+}
+
+bool MemorySearch::make_text(std::string_view text, const CharacterTable *table, Pattern &pattern, std::string &error) {
+    pattern.bytes.clear();
+    pattern.mask.clear();
+
+    if(text.empty()) {
+        error = "Nothing to search for";
+        return false;
+    }
+
+    if(table) {
+        if(!table->encode(text, pattern.bytes)) {
+            error = "The text has characters that aren't in the character table";
+            return false;
+        }
+    }
+    else {
+        for(auto c : text) {
+            if(static_cast<unsigned char>(c) >= 0x80) {
+                error = "The text isn't ASCII (load a character table to search for other characters)";
+                return false;
+            }
+            pattern.bytes.emplace_back(static_cast<std::uint8_t>(c));
+        }
+    }
+
+    pattern.mask.assign(pattern.bytes.size(), 0xFF);
+    return true;
+}
+
+// Find matches starting in [start, end)
+static void find_in_chunk(const std::uint8_t *data, std::size_t size, std::size_t start, std::size_t end, const MemorySearch::Pattern &pattern, std::size_t anchor, bool exact, std::size_t max_results, std::vector<std::size_t> &results) {
+    auto length = pattern.bytes.size();
+    if(length > size) {
+        return;
+    }
+    end = std::min(end, size - length + 1);
+
+    auto anchor_byte = pattern.bytes[anchor];
+    auto *search = data + start + anchor;
+    auto *search_end = data + end + anchor;
+
+    while(search < search_end) {
+        auto *hit = static_cast<const std::uint8_t *>(std::memchr(search, anchor_byte, search_end - search));
+        if(hit == nullptr) {
+            break;
+        }
+
+        auto *candidate = hit - anchor;
+        bool match;
+        if(exact) {
+            match = std::memcmp(candidate, pattern.bytes.data(), length) == 0;
+        }
+        else {
+            match = true;
+            for(std::size_t i = 0; i < length; i++) {
+                if((candidate[i] & pattern.mask[i]) != pattern.bytes[i]) {
+                    match = false;
+                    break;
+                }
+            }
+        }
+
+        if(match) {
+            results.emplace_back(static_cast<std::size_t>(candidate - data));
+            if(results.size() >= max_results) {
+                break;
+            }
+        }
+        search = hit + 1;
+    }
+}
+
+std::vector<std::size_t> MemorySearch::find(const std::uint8_t *data, std::size_t size, const Pattern &pattern, std::size_t max_results, std::size_t threads) {
+    std::vector<std::size_t> results;
+    if(pattern.bytes.empty() || pattern.bytes.size() != pattern.mask.size() || size < pattern.bytes.size() || max_results == 0) {
+        return results;
+    }
+
+    // memchr() for a byte that has to match
+    auto anchor = static_cast<std::size_t>(std::find(pattern.mask.begin(), pattern.mask.end(), 0xFF) - pattern.mask.begin());
+    if(anchor == pattern.mask.size()) {
+        return results;
+    }
+    bool exact = std::all_of(pattern.mask.begin(), pattern.mask.end(), [](std::uint8_t m) { return m == 0xFF; });
+
+    if(threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    auto chunk_count = std::max<std::size_t>(std::min(threads, size / MIN_CHUNK_SIZE), 1);
+    auto chunk_size = (size + chunk_count - 1) / chunk_count;
+
+    if(chunk_count == 1) {
+        find_in_chunk(data, size, 0, size, pattern, anchor, exact, max_results, results);
+        return results;
+    }
+
+    // Each chunk is capped on its own, then they're put together in order
+    std::vector<std::vector<std::size_t>> chunk_results(chunk_count);
+    std::vector<std::thread> workers;
+    for(std::size_t c = 0; c < chunk_count; c++) {
+        workers.emplace_back(find_in_chunk, data, size, c * chunk_size, std::min((c + 1) * chunk_size, size), std::cref(pattern), anchor, exact, max_results, std::ref(chunk_results[c]));
+    }
+    for(auto &w : workers) {
+        w.join();
+    }
+
+    for(auto &r : chunk_results) {
+        auto remaining = max_results - results.size();
+        results.insert(results.end(), r.begin(), r.begin() + static_cast<std::ptrdiff_t>(std::min(remaining, r.size())));
+        if(results.size() >= max_results) {
+            break;
+        }
+    }
+    return results;
+}
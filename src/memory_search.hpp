@@ -0,0 +1,92 @@
+#ifndef MEMORY_SEARCH_HPP
+#define MEMORY_SEARCH_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+// Searching memory for byte patterns. Patterns can have wildcards, so searches find candidates by looking for one byte
+// of the pattern with memchr() (which is vectorized in any decent C library) and only compare the rest of the pattern
+// there. Big buffers (e.g. ROM) are split into chunks which are searched on separate threads.
+namespace MemorySearch {
+    struct Pattern {
+        /** Bytes to match */
+        std::vector<std::uint8_t> bytes;
+
+        /** 0xFF where the byte has to match, 0x00 for wildcards */
+        std::vector<std::uint8_t> mask;
+    };
+
+    // Maps bytes to text for games that don't use ASCII, loaded from a .tbl file ("XX=text" per line)
+    class CharacterTable {
+    public:
+        /**
+         * Load a table, replacing anything already loaded
+         *
+         * @param  path path to the table
+         * @return      true if the table was read and had at least one entry
+         */
+        bool load(const std::filesystem::path &path);
+
+        /**
+         * Encode text, matching the longest entry at each point
+         *
+         * @param  text  text to encode (UTF-8)
+         * @param  bytes set to the encoded text
+         * @return       true if every character could be encoded
+         */
+        bool encode(std::string_view text, std::vector<std::uint8_t> &bytes) const;
+
+    private:
+        std::unordered_map<std::string, std::vector<std::uint8_t>> entries;
+        std::size_t longest = 0;
+    };
+
+    /**
+     * Parse hex bytes with wildcards (e.g. "3E ?? EA 00 20")
+     *
+     * @param  text    text to parse
+     * @param  pattern set to the pattern
+     * @param  error   set to what's wrong if it can't be parsed
+     * @return         true if successful
+     */
+    bool parse_bytes(std::string_view text, Pattern &pattern, std::string &error);
+
+    /**
+     * Make a pattern for a 16-bit value
+     *
+     * @param  value      value to find
+     * @param  big_endian store the high byte first
+     * @return            pattern
+     */
+    Pattern make_u16(std::uint16_t value, bool big_endian);
+
+    /**
+     * Make a pattern for text
+     *
+     * @param  text    text to find (UTF-8)
+     * @param  table   character table to encode with (ASCII if nullptr)
+     * @param  pattern set to the pattern
+     * @param  error   set to what's wrong if it can't be encoded
+     * @return         true if successful
+     */
+    bool make_text(std::string_view text, const CharacterTable *table, Pattern &pattern, std::string &error);
+
+    /**
+     * Find every occurrence of a pattern
+     *
+     * @param  data        data to search
+     * @param  size        size of the data
+     * @param  pattern     pattern to find
+     * @param  max_results stop after this many
+     * @param  threads     number of threads to use (0 = one per core)
+     * @return             offsets of each match, in order
+     */
+    std::vector<std::size_t> find(const std::uint8_t *data, std::size_t size, const Pattern &pattern, std::size_t max_results, std::size_t threads = 0);
+}
+
+#endif
@@ -0,0 +1,456 @@
+#include "memory_viewer.hpp"
+
+#include <QAbstractScrollArea>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QLabel>
+#include <QPainter>
+#include <QScrollBar>
+#include <QMouseEvent>
+#include <QKeyEvent>
+#include <QFontDatabase>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QInputDialog>
+#include <QMessageBox>
+#include <QStatusBar>
+
+#include <cstring>
+
+#include "game_window.hpp"
+#include "memory_viewer_search_dialog.hpp"
+
+static constexpr const std::size_t BYTES_PER_ROW = 16;
+static constexpr const std::size_t ADDRESS_COLUMN_CHARACTERS = 10; // "BBB:AAAA" plus some spacing
+static constexpr const std::size_t ASCII_COLUMN_START = ADDRESS_COLUMN_CHARACTERS + BYTES_PER_ROW * 3 + 1;
+static constexpr const std::uint8_t CHANGE_HIGHLIGHT_REFRESHES = 30; // half a second at 60 Hz
+
+class MemoryViewer::HexView : public QAbstractScrollArea {
+public:
+    HexView(QWidget *parent, MemoryViewer *viewer) : QAbstractScrollArea(parent), viewer(viewer) {
+        auto font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+        font.setPixelSize(14);
+        this->setFont(font);
+        this->viewport()->setFont(font);
+        this->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+        this->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+        this->setMinimumWidth(this->row_width() + this->verticalScrollBar()->sizeHint().width() + this->frameWidth() * 2);
+        this->setMinimumHeight(400);
+        this->setFocusPolicy(Qt::StrongFocus);
+    }
+
+    void update_scroll_bar() {
+        auto rows = (this->viewer->snapshot.data.size() + BYTES_PER_ROW - 1) / BYTES_PER_ROW;
+        auto visible = this->visible_rows();
+        auto *bar = this->verticalScrollBar();
+        bar->setRange(0, static_cast<int>(rows > visible ? rows - visible : 0));
+        bar->setPageStep(static_cast<int>(visible));
+    }
+
+    void scroll_to_offset(std::size_t offset) {
+        auto row = static_cast<int>(offset / BYTES_PER_ROW);
+        auto visible = static_cast<int>(this->visible_rows());
+        auto *bar = this->verticalScrollBar();
+        if(row < bar->value() || row >= bar->value() + visible) {
+            bar->setValue(row - visible / 2);
+        }
+    }
+
+    std::size_t visible_rows() const {
+        return static_cast<std::size_t>(std::max(1, this->viewport()->height() / this->row_height()));
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override {
+        QPainter painter(this->viewport());
+        auto palette = this->palette();
+        painter.fillRect(this->viewport()->rect(), palette.color(QPalette::Base));
+
+        auto &data = this->viewer->snapshot.data;
+        auto &highlight = this->viewer->change_highlight;
+        auto char_width = this->char_width();
+        auto row_height = this->row_height();
+        auto ascent = this->fontMetrics().ascent();
+
+        auto text_color = palette.color(QPalette::Text);
+        auto location_color = palette.color(QPalette::Disabled, QPalette::Text);
+        auto selected_bg = palette.color(QPalette::Highlight);
+        auto selected_fg = palette.color(QPalette::HighlightedText);
+        QColor changed_bg(255, 64, 64);
+
+        // Only draw what's on screen
+        std::size_t first_row = static_cast<std::size_t>(this->verticalScrollBar()->value());
+        std::size_t row_count = this->visible_rows() + 1;
+        char text[8];
+
+        for(std::size_t r = 0; r < row_count; r++) {
+            std::size_t row_offset = (first_row + r) * BYTES_PER_ROW;
+            if(row_offset >= data.size()) {
+                break;
+            }
+
+            int y = static_cast<int>(r) * row_height;
+            painter.setPen(location_color);
+            painter.drawText(0, y + ascent, this->viewer->format_location(row_offset));
+
+            for(std::size_t c = 0; c < BYTES_PER_ROW && row_offset + c < data.size(); c++) {
+                auto offset = row_offset + c;
+                auto value = data[offset];
+                int hex_x = static_cast<int>(ADDRESS_COLUMN_CHARACTERS + c * 3) * char_width;
+                int ascii_x = static_cast<int>(ASCII_COLUMN_START + c) * char_width;
+
+                // Highlight the selected byte, or if it changed recently, highlight it (fading as it gets older)
+                if(this->viewer->selected_offset == offset) {
+                    painter.fillRect(hex_x, y, char_width * 2, row_height, selected_bg);
+                    painter.fillRect(ascii_x, y, char_width, row_height, selected_bg);
+                    painter.setPen(selected_fg);
+                }
+                else {
+                    if(offset < highlight.size() && highlight[offset] > 0) {
+                        auto color = changed_bg;
+                        color.setAlpha(255 * highlight[offset] / CHANGE_HIGHLIGHT_REFRESHES);
+                        painter.fillRect(hex_x, y, char_width * 2, row_height, color);
+                        painter.fillRect(ascii_x, y, char_width, row_height, color);
+                    }
+                    painter.setPen(text_color);
+                }
+
+                std::snprintf(text, sizeof(text), "%02X", value);
+                painter.drawText(hex_x, y + ascent, text);
+
+                text[0] = (value >= 0x20 && value < 0x7F) ? static_cast<char>(value) : '.';
+                text[1] = 0;
+                painter.drawText(ascii_x, y + ascent, text);
+            }
+        }
+    }
+
+    void resizeEvent(QResizeEvent *event) override {
+        QAbstractScrollArea::resizeEvent(event);
+        this->update_scroll_bar();
+    }
+
+    void mousePressEvent(QMouseEvent *event) override {
+        auto offset = this->offset_at(event->pos());
+        if(offset.has_value()) {
+            this->viewer->select_offset(*offset);
+        }
+    }
+
+    void mouseDoubleClickEvent(QMouseEvent *event) override {
+        auto offset = this->offset_at(event->pos());
+        if(offset.has_value()) {
+            this->viewer->edit_offset(*offset);
+        }
+    }
+
+    void keyPressEvent(QKeyEvent *event) override {
+        auto &selected = this->viewer->selected_offset;
+        auto size = this->viewer->snapshot.data.size();
+        if(!selected.has_value() || size == 0) {
+            QAbstractScrollArea::keyPressEvent(event);
+            return;
+        }
+
+        std::size_t offset = *selected;
+        switch(event->key()) {
+            case Qt::Key::Key_Left:
+                offset -= std::min<std::size_t>(offset, 1);
+                break;
+            case Qt::Key::Key_Right:
+                offset = std::min(size - 1, offset + 1);
+                break;
+            case Qt::Key::Key_Up:
+                offset -= std::min(offset, BYTES_PER_ROW);
+                break;
+            case Qt::Key::Key_Down:
+                offset = std::min(size - 1, offset + BYTES_PER_ROW);
+                break;
+            case Qt::Key::Key_Return:
+            case Qt::Key::Key_Enter:
+                this->viewer->edit_offset(offset);
+                return;
+            default:
+                QAbstractScrollArea::keyPressEvent(event);
+                return;
+        }
+
+        this->viewer->select_offset(offset);
+        this->scroll_to_offset(offset);
+    }
+
+private:
+    MemoryViewer *viewer;
+
+    int char_width() const {
+        return this->fontMetrics().horizontalAdvance('0');
+    }
+
+    int row_height() const {
+        return this->fontMetrics().height();
+    }
+
+    int row_width() const {
+        return static_cast<int>(ASCII_COLUMN_START + BYTES_PER_ROW + 1) * this->char_width();
+    }
+
+    std::optional<std::size_t> offset_at(const QPoint &point) const {
+        auto column = static_cast<std::size_t>(std::max(0, point.x() / this->char_width()));
+        auto row = static_cast<std::size_t>(std::max(0, point.y() / this->row_height())) + static_cast<std::size_t>(this->verticalScrollBar()->value());
+
+        std::size_t byte;
+        if(column >= ADDRESS_COLUMN_CHARACTERS && column < ADDRESS_COLUMN_CHARACTERS + BYTES_PER_ROW * 3) {
+            byte = (column - ADDRESS_COLUMN_CHARACTERS) / 3;
+        }
+        else if(column >= ASCII_COLUMN_START && column < ASCII_COLUMN_START + BYTES_PER_ROW) {
+            byte = column - ASCII_COLUMN_START;
+        }
+        else {
+            return std::nullopt;
+        }
+
+        auto offset = row * BYTES_PER_ROW + byte;
+        if(offset >= this->viewer->snapshot.data.size()) {
+            return std::nullopt;
+        }
+        return offset;
+    }
+};
+
+MemoryViewer::MemoryViewer(GameWindow *window) : QMainWindow(window), window(window) {
+    this->setWindowTitle("Memory Viewer");
+
+    auto *central_widget = new QWidget(this);
+    auto *layout = new QVBoxLayout(central_widget);
+    central_widget->setLayout(layout);
+
+    // Region and go-to box
+    auto *top_widget = new QWidget(central_widget);
+    auto *top_layout = new QHBoxLayout(top_widget);
+    top_layout->setContentsMargins(0,0,0,0);
+    top_widget->setLayout(top_layout);
+
+    top_layout->addWidget(new QLabel("Region:", top_widget));
+    this->region_box = new QComboBox(top_widget);
+    for(int r = 0; r < GameInstance::MemoryRegion::MemoryRegionCount; r++) {
+        this->region_box->addItem(GameInstance::memory_region_name(static_cast<GameInstance::MemoryRegion>(r)), r);
+    }
+    this->region_box->setCurrentIndex(GameInstance::MemoryRegion::MemoryRegionWRAM);
+    top_layout->addWidget(this->region_box);
+    connect(this->region_box, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &MemoryViewer::region_changed);
+
+    top_layout->addStretch(1);
+    top_layout->addWidget(new QLabel("Go to offset:", top_widget));
+    this->go_to_box = new QLineEdit(top_widget);
+    this->go_to_box->setPlaceholderText("hex offset");
+    this->go_to_box->setMaximumWidth(120);
+    top_layout->addWidget(this->go_to_box);
+    connect(this->go_to_box, &QLineEdit::returnPressed, this, &MemoryViewer::go_to_entered);
+
+    auto *search_button = new QPushButton("Search...", top_widget);
+    search_button->setToolTip("Search ROM and RAM for bytes, values, or text");
+    connect(search_button, &QPushButton::clicked, this, &MemoryViewer::action_search);
+    top_layout->addWidget(search_button);
+
+    layout->addWidget(top_widget);
+
+    this->hex_view = new HexView(central_widget, this);
+    layout->addWidget(this->hex_view);
+
+    this->setCentralWidget(central_widget);
+
+    this->status_label = new QLabel(this);
+    this->statusBar()->addWidget(this->status_label);
+}
+
+MemoryViewer::~MemoryViewer() {}
+
+GameInstance::MemoryRegion MemoryViewer::get_region() const {
+    return static_cast<GameInstance::MemoryRegion>(this->region_box->currentData().toInt());
+}
+
+void MemoryViewer::refresh_view() {
+    if(this->isHidden()) {
+        return;
+    }
+
+    // Update at 60 Hz
+    auto now = std::chrono::steady_clock::now();
+    if(now - this->last_update < std::chrono::microseconds(1000000 / 60)) {
+        return;
+    }
+    this->last_update = now;
+
+    this->take_snapshot();
+}
+
+void MemoryViewer::take_snapshot() {
+    auto &instance = this->window->get_instance();
+    auto region = this->get_region();
+
+    // ROM is big and rarely changes, so only copy it again when it actually did
+    if(region == GameInstance::MemoryRegion::MemoryRegionROM) {
+        auto rom_generation = instance.get_generations().rom;
+        if(!this->snapshot_stale && rom_generation == this->snapshot_rom_generation && this->snapshot.region == region) {
+            return;
+        }
+        this->snapshot_rom_generation = rom_generation;
+    }
+
+    // Keep the old one around to compare against
+    bool same_region = !this->snapshot_stale && this->snapshot.region == region;
+    std::swap(this->previous_data, this->snapshot.data);
+    instance.snapshot_memory_region(region, this->snapshot);
+    this->snapshot_stale = false;
+
+    auto size = this->snapshot.data.size();
+    if(this->change_highlight.size() != size) {
+        this->change_highlight.assign(size, 0);
+    }
+
+    // Age out old highlights and highlight anything that changed since last time. Compare in chunks first since most memory doesn't change between frames.
+    bool anything_highlighted = false;
+    for(auto &h : this->change_highlight) {
+        if(h > 0) {
+            h--;
+            anything_highlighted = true;
+        }
+    }
+
+    if(same_region && this->previous_data.size() == size) {
+        static constexpr const std::size_t CHUNK_SIZE = 64;
+        auto *current = this->snapshot.data.data();
+        auto *previous = this->previous_data.data();
+        for(std::size_t chunk = 0; chunk < size; chunk += CHUNK_SIZE) {
+            auto chunk_length = std::min(CHUNK_SIZE, size - chunk);
+            if(std::memcmp(current + chunk, previous + chunk, chunk_length) == 0) {
+                continue;
+            }
+            for(std::size_t i = chunk; i < chunk + chunk_length; i++) {
+                if(current[i] != previous[i]) {
+                    this->change_highlight[i] = CHANGE_HIGHLIGHT_REFRESHES;
+                    anything_highlighted = true;
+                }
+            }
+        }
+    }
+
+    if(!same_region) {
+        this->hex_view->update_scroll_bar();
+        anything_highlighted = true;
+    }
+
+    // Don't bother repainting if nothing visibly changed
+    if(anything_highlighted) {
+        this->hex_view->viewport()->update();
+        this->update_status();
+    }
+}
+
+void MemoryViewer::region_changed() {
+    this->selected_offset = std::nullopt;
+    this->snapshot_stale = true;
+    this->change_highlight.clear();
+    this->take_snapshot();
+    this->hex_view->verticalScrollBar()->setValue(0);
+}
+
+void MemoryViewer::go_to(GameInstance::MemoryRegion region, std::size_t offset) {
+    if(this->get_region() != region) {
+        this->region_box->setCurrentIndex(region);
+    }
+    else {
+        this->take_snapshot();
+    }
+
+    if(offset < this->snapshot.data.size()) {
+        this->select_offset(offset);
+        this->hex_view->scroll_to_offset(offset);
+    }
+
+    this->show();
+    this->activateWindow();
+}
+
+void MemoryViewer::go_to_entered() {
+    bool ok;
+    auto offset = this->go_to_box->text().trimmed().remove('$').toULongLong(&ok, 16);
+    if(!ok || offset >= this->snapshot.data.size()) {
+        QMessageBox(QMessageBox::Icon::Critical, "Invalid Offset", "The offset must be a hexadecimal number within the region.", QMessageBox::StandardButton::Ok).exec();
+        return;
+    }
+    this->go_to(this->get_region(), static_cast<std::size_t>(offset));
+}
+
+void MemoryViewer::action_search() {
+    if(this->search_dialog == nullptr) {
+        this->search_dialog = new SearchDialog(this);
+    }
+    this->search_dialog->show();
+    this->search_dialog->activateWindow();
+}
+
+void MemoryViewer::select_offset(std::size_t offset) {
+    this->selected_offset = offset;
+    this->update_status();
+    this->hex_view->viewport()->update();
+}
+
+void MemoryViewer::edit_offset(std::size_t offset) {
+    if(offset >= this->snapshot.data.size()) {
+        return;
+    }
+
+    this->select_offset(offset);
+
+    char current_value[8];
+    std::snprintf(current_value, sizeof(current_value), "%02X", this->snapshot.data[offset]);
+
+    bool ok;
+    auto text = QInputDialog::getText(this, "Edit Byte", QString("New value for ") + this->format_location(offset) + " (hex):", QLineEdit::Normal, current_value, &ok);
+    if(!ok) {
+        return;
+    }
+
+    auto value = text.trimmed().remove('$').toUInt(&ok, 16);
+    if(!ok || value > 0xFF) {
+        QMessageBox(QMessageBox::Icon::Critical, "Invalid Value", "The value must be a hexadecimal number from 00 to FF.", QMessageBox::StandardButton::Ok).exec();
+        return;
+    }
+
+    this->window->get_instance().write_memory_region(this->get_region(), offset, static_cast<std::uint8_t>(value));
+    this->snapshot_stale = this->get_region() == GameInstance::MemoryRegion::MemoryRegionROM; // ROM isn't copied again unless we say so
+    this->take_snapshot();
+}
+
+QString MemoryViewer::format_location(std::size_t offset) const {
+    std::uint16_t bank;
+    auto address = GameInstance::memory_region_address(this->snapshot.region, offset, bank);
+
+    char location[16];
+    std::snprintf(location, sizeof(location), "%02X:%04X", bank, address);
+    return location;
+}
+
+void MemoryViewer::update_status() {
+    if(!this->selected_offset.has_value() || *this->selected_offset >= this->snapshot.data.size()) {
+        this->status_label->clear();
+        return;
+    }
+
+    auto offset = *this->selected_offset;
+    auto value = this->snapshot.data[offset];
+
+    char status[128];
+    std::snprintf(status, sizeof(status), "Offset $%06zX (%s) = $%02X (%u)", offset, this->format_location(offset).toUtf8().data(), value, value);
+    this->status_label->setText(status);
+}
+
+void MemoryViewer::closeEvent(QCloseEvent *) {
+    // Free up memory (the ROM can be pretty big)
+    this->snapshot.data = {};
+    this->previous_data = {};
+    this->change_highlight = {};
+    this->snapshot_stale = true;
+}
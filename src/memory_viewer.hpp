@@ -0,0 +1,73 @@
+#ifndef MEMORY_VIEWER_HPP
+#define MEMORY_VIEWER_HPP
+
+#include <QMainWindow>
+
+#include <vector>
+#include <optional>
+#include <chrono>
+
+#include "game_instance.hpp"
+
+class GameWindow;
+class QComboBox;
+class QLineEdit;
+class QLabel;
+
+class MemoryViewer : public QMainWindow {
+    Q_OBJECT
+
+public:
+    MemoryViewer(GameWindow *window);
+    ~MemoryViewer() override;
+
+    /** Refresh the information in view */
+    void refresh_view();
+
+    /**
+     * Show the given offset of a region
+     *
+     * @param region region to show
+     * @param offset offset in the region
+     */
+    void go_to(GameInstance::MemoryRegion region, std::size_t offset);
+
+private:
+    class HexView;
+    class SearchDialog;
+
+    GameWindow *window;
+    HexView *hex_view;
+    QComboBox *region_box;
+    QLineEdit *go_to_box;
+    QLabel *status_label;
+    SearchDialog *search_dialog = nullptr;
+
+    // Current and previous snapshot of the region we're showing
+    GameInstance::MemorySnapshot snapshot = {};
+    std::vector<std::uint8_t> previous_data;
+
+    // How many more refreshes each byte stays highlighted for after it changes
+    std::vector<std::uint8_t> change_highlight;
+
+    std::optional<std::size_t> selected_offset;
+
+    // ROM only changes if a new ROM is loaded or we edit it, so it doesn't need to be copied every time
+    std::uint64_t snapshot_rom_generation = 0;
+    bool snapshot_stale = true;
+
+    std::chrono::steady_clock::time_point last_update = {};
+
+    GameInstance::MemoryRegion get_region() const;
+    void take_snapshot();
+    void region_changed();
+    void go_to_entered();
+    void action_search();
+    void select_offset(std::size_t offset);
+    void edit_offset(std::size_t offset);
+    void update_status();
+    QString format_location(std::size_t offset) const;
+    void closeEvent(QCloseEvent *) override;
+};
+
+#endif
@@ -0,0 +1,340 @@
+#include "memory_viewer_search_dialog.hpp"
+
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QComboBox>
+#include <QLineEdit>
+#include <QLabel>
+#include <QCheckBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QFontDatabase>
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QFileInfo>
+
+#include <chrono>
+
+#include "game_window.hpp"
+
+// Showing more than this isn't useful and makes the table slow
+static constexpr const std::size_t MAX_RESULTS = 10000;
+
+// Bytes shown next to each result
+static constexpr const std::size_t PREVIEW_BYTES = 16;
+
+enum SearchMode {
+    SearchBytes,
+    SearchU16LE,
+    SearchU16BE,
+    SearchText
+};
+
+enum ResultColumn {
+    ColumnRegion,
+    ColumnLocation,
+    ColumnOffset,
+    ColumnPreview,
+    ColumnCount
+};
+
+MemoryViewer::SearchDialog::SearchDialog(MemoryViewer *viewer) : QDialog(viewer), viewer(viewer) {
+    this->setWindowTitle("Search Memory");
+
+    auto *layout = new QVBoxLayout(this);
+    this->setLayout(layout);
+
+    // What to search for
+    auto *query_widget = new QWidget(this);
+    auto *query_layout = new QHBoxLayout(query_widget);
+    query_layout->setContentsMargins(0,0,0,0);
+    query_widget->setLayout(query_layout);
+
+    this->mode_box = new QComboBox(query_widget);
+    this->mode_box->addItem("Bytes", SearchMode::SearchBytes);
+    this->mode_box->addItem("16-bit (little endian)", SearchMode::SearchU16LE);
+    this->mode_box->addItem("16-bit (big endian)", SearchMode::SearchU16BE);
+    this->mode_box->addItem("Text", SearchMode::SearchText);
+    connect(this->mode_box, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &SearchDialog::mode_changed);
+    query_layout->addWidget(this->mode_box);
+
+    this->query_box = new QLineEdit(query_widget);
+    this->query_box->setMinimumWidth(240);
+    connect(this->query_box, &QLineEdit::returnPressed, this, &SearchDialog::action_search);
+    query_layout->addWidget(this->query_box, 1);
+
+    auto *search_button = new QPushButton("Search", query_widget);
+    connect(search_button, &QPushButton::clicked, this, &SearchDialog::action_search);
+    query_layout->addWidget(search_button);
+
+    layout->addWidget(query_widget);
+
+    // Character table for text
+    auto *table_widget = new QWidget(this);
+    auto *table_layout = new QHBoxLayout(table_widget);
+    table_layout->setContentsMargins(0,0,0,0);
+    table_widget->setLayout(table_layout);
+
+    this->table_label = new QLabel("Character table: ASCII", table_widget);
+    table_layout->addWidget(this->table_label, 1);
+
+    auto *load_table_button = new QPushButton("Load Table...", table_widget);
+    load_table_button->setToolTip("Load a .tbl file (lines of XX=text) for games that don't store text as ASCII");
+    connect(load_table_button, &QPushButton::clicked, this, &SearchDialog::action_load_table);
+    table_layout->addWidget(load_table_button);
+
+    auto *ascii_button = new QPushButton("Use ASCII", table_widget);
+    connect(ascii_button, &QPushButton::clicked, this, [this]() {
+        this->character_table.reset();
+        this->table_label->setText("Character table: ASCII");
+    });
+    table_layout->addWidget(ascii_button);
+
+    layout->addWidget(table_widget);
+
+    // Where to search
+    auto *region_widget = new QWidget(this);
+    auto *region_layout = new QHBoxLayout(region_widget);
+    region_layout->setContentsMargins(0,0,0,0);
+    region_widget->setLayout(region_layout);
+
+    region_layout->addWidget(new QLabel("Search in:", region_widget));
+    for(int r = 0; r < GameInstance::MemoryRegion::MemoryRegionCount; r++) {
+        auto region = static_cast<GameInstance::MemoryRegion>(r);
+        auto *box = new QCheckBox(GameInstance::memory_region_name(region), region_widget);
+        box->setChecked(region == GameInstance::MemoryRegion::MemoryRegionROM ||
+                        region == GameInstance::MemoryRegion::MemoryRegionCartRAM ||
+                        region == GameInstance::MemoryRegion::MemoryRegionWRAM ||
+                        region == GameInstance::MemoryRegion::MemoryRegionVRAM);
+        region_layout->addWidget(box);
+        this->region_boxes.emplace_back(box);
+    }
+    region_layout->addStretch(1);
+
+    layout->addWidget(region_widget);
+
+    // Results
+    this->results_table = new QTableWidget(0, ResultColumn::ColumnCount, this);
+    this->results_table->setHorizontalHeaderLabels({"Region", "Location", "Offset", "Bytes"});
+    this->results_table->horizontalHeader()->setSectionResizeMode(ResultColumn::ColumnPreview, QHeaderView::Stretch);
+    this->results_table->verticalHeader()->setVisible(false);
+    this->results_table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    this->results_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    this->results_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->results_table->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    this->results_table->setMinimumSize(640, 320);
+    connect(this->results_table, &QTableWidget::cellDoubleClicked, this, &SearchDialog::action_show_result);
+    connect(this->results_table, &QTableWidget::itemSelectionChanged, this, [this]() {
+        std::uint16_t address;
+        this->disassemble_button->setEnabled(this->can_disassemble(this->selected_result(), address));
+    });
+    layout->addWidget(this->results_table);
+
+    // Actions
+    auto *button_widget = new QWidget(this);
+    auto *button_layout = new QHBoxLayout(button_widget);
+    button_layout->setContentsMargins(0,0,0,0);
+    button_widget->setLayout(button_layout);
+
+    this->status_label = new QLabel(button_widget);
+    button_layout->addWidget(this->status_label, 1);
+
+    auto *show_button = new QPushButton("Show in Memory Viewer", button_widget);
+    connect(show_button, &QPushButton::clicked, this, &SearchDialog::action_show_result);
+    button_layout->addWidget(show_button);
+
+    this->disassemble_button = new QPushButton("Show in Disassembler", button_widget);
+    this->disassemble_button->setToolTip("Disassemble at this address (the bank needs to be mapped in for switchable ROM banks)");
+    this->disassemble_button->setEnabled(false);
+    connect(this->disassemble_button, &QPushButton::clicked, this, &SearchDialog::action_disassemble_result);
+    button_layout->addWidget(this->disassemble_button);
+
+    layout->addWidget(button_widget);
+
+    this->mode_changed();
+}
+
+void MemoryViewer::SearchDialog::mode_changed() {
+    switch(this->mode_box->currentData().toInt()) {
+        case SearchMode::SearchBytes:
+            this->query_box->setPlaceholderText("hex bytes, ?? = any byte (e.g. 3E ?? EA 00 20)");
+            break;
+        case SearchMode::SearchU16LE:
+        case SearchMode::SearchU16BE:
+            this->query_box->setPlaceholderText("hex value (e.g. 4000)");
+            break;
+        case SearchMode::SearchText:
+            this->query_box->setPlaceholderText("text");
+            break;
+    }
+}
+
+bool MemoryViewer::SearchDialog::make_pattern(MemorySearch::Pattern &pattern) {
+    auto query = this->query_box->text();
+    std::string error;
+    bool ok = false;
+
+    switch(this->mode_box->currentData().toInt()) {
+        case SearchMode::SearchBytes:
+            ok = MemorySearch::parse_bytes(query.toStdString(), pattern, error);
+            break;
+        case SearchMode::SearchU16LE:
+        case SearchMode::SearchU16BE: {
+            auto value = query.trimmed().remove('$').toUInt(&ok, 16);
+            if(!ok || value > UINT16_MAX) {
+                ok = false;
+                error = "The value must be a hexadecimal number from 0 to FFFF";
+                break;
+            }
+            pattern = MemorySearch::make_u16(static_cast<std::uint16_t>(value), this->mode_box->currentData().toInt() == SearchMode::SearchU16BE);
+            break;
+        }
+        case SearchMode::SearchText:
+            ok = MemorySearch::make_text(query.toStdString(), this->character_table.has_value() ? &*this->character_table : nullptr, pattern, error);
+            break;
+    }
+
+    if(!ok) {
+        QMessageBox(QMessageBox::Icon::Critical, "Invalid Search", error.c_str(), QMessageBox::StandardButton::Ok).exec();
+    }
+    return ok;
+}
+
+void MemoryViewer::SearchDialog::action_search() {
+    MemorySearch::Pattern pattern;
+    if(!this->make_pattern(pattern)) {
+        return;
+    }
+
+    auto &instance = this->viewer->window->get_instance();
+    auto start = std::chrono::steady_clock::now();
+
+    // Search a copy of each region so the game can keep running
+    struct RegionMatches {
+        GameInstance::MemorySnapshot snapshot;
+        std::vector<std::size_t> offsets;
+    };
+    std::vector<RegionMatches> matches;
+    std::size_t total = 0;
+
+    for(std::size_t r = 0; r < this->region_boxes.size() && total < MAX_RESULTS; r++) {
+        if(!this->region_boxes[r]->isChecked()) {
+            continue;
+        }
+
+        auto &m = matches.emplace_back();
+        instance.snapshot_memory_region(static_cast<GameInstance::MemoryRegion>(r), m.snapshot);
+        m.offsets = MemorySearch::find(m.snapshot.data.data(), m.snapshot.data.size(), pattern, MAX_RESULTS - total);
+        total += m.offsets.size();
+    }
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // Show them
+    this->results.clear();
+    this->results.reserve(total);
+    this->results_table->setRowCount(0);
+    this->results_table->setRowCount(static_cast<int>(total));
+
+    int row = 0;
+    for(auto &m : matches) {
+        auto &data = m.snapshot.data;
+        for(auto offset : m.offsets) {
+            this->results.emplace_back(Result { m.snapshot.region, offset });
+
+            std::uint16_t bank;
+            auto address = GameInstance::memory_region_address(m.snapshot.region, offset, bank);
+
+            char location[16];
+            std::snprintf(location, sizeof(location), "%02X:%04X", bank, address);
+
+            char offset_text[16];
+            std::snprintf(offset_text, sizeof(offset_text), "$%06zX", offset);
+
+            char preview[PREVIEW_BYTES * 3 + 1] = {};
+            auto preview_end = std::min(data.size(), offset + PREVIEW_BYTES);
+            for(auto i = offset; i < preview_end; i++) {
+                std::snprintf(preview + (i - offset) * 3, 4, "%02X ", data[i]);
+            }
+
+            this->results_table->setItem(row, ResultColumn::ColumnRegion, new QTableWidgetItem(GameInstance::memory_region_name(m.snapshot.region)));
+            this->results_table->setItem(row, ResultColumn::ColumnLocation, new QTableWidgetItem(location));
+            this->results_table->setItem(row, ResultColumn::ColumnOffset, new QTableWidgetItem(offset_text));
+            this->results_table->setItem(row, ResultColumn::ColumnPreview, new QTableWidgetItem(QString(preview).trimmed()));
+            row++;
+        }
+    }
+    this->results_table->resizeColumnsToContents();
+
+    char status[128];
+    std::snprintf(status, sizeof(status), "%zu result%s%s in %.1f ms", total, total == 1 ? "" : "s", total >= MAX_RESULTS ? " (stopped at the limit)" : "", elapsed);
+    this->status_label->setText(status);
+}
+
+void MemoryViewer::SearchDialog::action_load_table() {
+    QFileDialog file_dialog;
+    file_dialog.setFileMode(QFileDialog::FileMode::ExistingFile);
+    file_dialog.setNameFilters(QStringList { "Character tables (*.tbl)", "All files (*)" });
+    file_dialog.setWindowTitle("Load Character Table");
+
+    if(file_dialog.exec() != QFileDialog::Accepted) {
+        return;
+    }
+
+    auto path = file_dialog.selectedFiles()[0];
+    MemorySearch::CharacterTable table;
+    if(!table.load(path.toStdString())) {
+        QMessageBox(QMessageBox::Icon::Critical, "Failed to Load Table", "The file could not be read or has no entries.", QMessageBox::StandardButton::Ok).exec();
+        return;
+    }
+
+    this->character_table = std::move(table);
+    this->table_label->setText(QString("Character table: ") + QFileInfo(path).fileName());
+    this->mode_box->setCurrentIndex(this->mode_box->findData(SearchMode::SearchText));
+}
+
+const MemoryViewer::SearchDialog::Result *MemoryViewer::SearchDialog::selected_result() const {
+    auto row = this->results_table->currentRow();
+    if(row < 0 || static_cast<std::size_t>(row) >= this->results.size() || this->results_table->selectedItems().isEmpty()) {
+        return nullptr;
+    }
+    return &this->results[row];
+}
+
+void MemoryViewer::SearchDialog::action_show_result() {
+    auto *result = this->selected_result();
+    if(result) {
+        this->viewer->go_to(result->region, result->offset);
+        this->viewer->activateWindow();
+    }
+}
+
+bool MemoryViewer::SearchDialog::can_disassemble(const Result *result, std::uint16_t &address) {
+    if(!result || result->region != GameInstance::MemoryRegion::MemoryRegionROM) {
+        return false;
+    }
+
+    // The disassembler shows whatever is mapped in, so the result's bank has to be the one that's mapped
+    std::uint16_t bank;
+    address = GameInstance::memory_region_address(result->region, result->offset, bank);
+    auto banks = this->viewer->window->get_instance().get_mapped_banks();
+    return bank == (address < 0x4000 ? banks.rom0 : banks.romx);
+}
+
+void MemoryViewer::SearchDialog::action_disassemble_result() {
+    auto *result = this->selected_result();
+    if(!result || result->region != GameInstance::MemoryRegion::MemoryRegionROM) {
+        return;
+    }
+
+    // The bank may have been switched out since this was selected
+    std::uint16_t address;
+    if(!this->can_disassemble(result, address)) {
+        QMessageBox(QMessageBox::Icon::Critical, "Bank Not Mapped", "This result is in a ROM bank that isn't currently mapped in, so it can't be disassembled.", QMessageBox::StandardButton::Ok).exec();
+        this->disassemble_button->setEnabled(false);
+        return;
+    }
+
+    this->viewer->window->debugger_window->go_to_address(address);
+}
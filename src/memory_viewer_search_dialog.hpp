@@ -0,0 +1,51 @@
+#ifndef MEMORY_VIEWER_SEARCH_DIALOG_HPP
+#define MEMORY_VIEWER_SEARCH_DIALOG_HPP
+
+#include <QDialog>
+
+#include <vector>
+#include <optional>
+
+#include "memory_viewer.hpp"
+#include "memory_search.hpp"
+
+class QComboBox;
+class QLineEdit;
+class QLabel;
+class QCheckBox;
+class QPushButton;
+class QTableWidget;
+
+class MemoryViewer::SearchDialog : public QDialog {
+public:
+    SearchDialog(MemoryViewer *viewer);
+
+private:
+    struct Result {
+        GameInstance::MemoryRegion region;
+        std::size_t offset;
+    };
+
+    MemoryViewer *viewer;
+    QComboBox *mode_box;
+    QLineEdit *query_box;
+    QLabel *table_label;
+    std::vector<QCheckBox *> region_boxes;
+    QTableWidget *results_table;
+    QPushButton *disassemble_button;
+    QLabel *status_label;
+
+    std::optional<MemorySearch::CharacterTable> character_table;
+    std::vector<Result> results;
+
+    bool make_pattern(MemorySearch::Pattern &pattern);
+    void action_search();
+    void action_load_table();
+    void action_show_result();
+    void action_disassemble_result();
+    void mode_changed();
+    const Result *selected_result() const;
+    bool can_disassemble(const Result *result, std::uint16_t &address);
+};
+
+#endif
@@ -0,0 +1,674 @@
+#include "rom_analysis.hpp"
+#include "symbol_table.hpp"
+#include "mapped_file.hpp"
+#include "zero_rle.hpp"
+#include "sm83.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+
+static constexpr const char ANALYSIS_MAGIC[8] = { 'S', 'D', 'X', 'A', 'N', 'L', 'Y', 'S' };
+static constexpr const std::uint32_t ANALYSIS_VERSION = 1;
+
+static constexpr const std::size_t HEADER_SIZE = 40;      // magic, version, reserved, ROM hash, ROM size, compressed flags size
+static constexpr const std::size_t FUNCTION_SIZE = 8;     // bank, address, end
+static constexpr const std::size_t XREF_SIZE = 9;         // bank, address, from bank, from address, kind
+
+// How far into a called function to look for it popping the return address and jumping to something based on it
+static constexpr const int JUMP_TABLE_SEARCH_LENGTH = 12;
+static constexpr const std::size_t MAX_JUMP_TABLE_ENTRIES = 256;
+
+static void write_le(std::uint8_t *output, std::uint64_t value, std::size_t bytes) noexcept {
+    for(std::size_t i = 0; i < bytes; i++) {
+        output[i] = static_cast<std::uint8_t>(value >> (i * 8));
+    }
+}
+
+static std::uint64_t read_le(const std::uint8_t *input, std::size_t bytes) noexcept {
+    std::uint64_t value = 0;
+    for(std::size_t i = 0; i < bytes; i++) {
+        value |= static_cast<std::uint64_t>(input[i]) << (i * 8);
+    }
+    return value;
+}
+
+static bool is_invalid_opcode(std::uint8_t opcode) noexcept {
+    switch(opcode) {
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED: case 0xF4: case 0xFC: case 0xFD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Bank 0 is ROM0 ($0000-$3FFF), and every other bank is ROMX ($4000-$7FFF)
+static std::size_t rom_offset(std::size_t bank, std::uint16_t address) noexcept {
+    return bank == 0 ? address : bank * RomAnalysis::BANK_SIZE + (address - 0x4000);
+}
+
+static std::uint32_t sort_key(std::uint16_t bank, std::uint16_t address) noexcept {
+    return static_cast<std::uint32_t>(bank) << 16 | address;
+}
+
+// Bank that a ROM address is referred to by (0 for ROM0 and anything outside of ROM)
+static std::uint16_t normalize_bank(std::uint16_t bank, std::uint16_t address) noexcept {
+    if(address < 0x4000 || address >= 0x8000) {
+        return 0;
+    }
+    return bank == 0 ? 1 : bank;
+}
+
+// Walks code in one bank, queuing anything it finds in other banks to be walked in the next round
+class RomAnalysis::BankWalker {
+public:
+    struct WorkItem {
+        std::uint16_t address;
+
+        /** Bank last switched to in ROM0 (-1 if unknown) */
+        std::int32_t switched_bank;
+
+        /** Called (rather than jumped to) */
+        bool function;
+    };
+
+    struct OutgoingItem {
+        std::size_t bank;
+        WorkItem item;
+    };
+
+    BankWalker(const std::uint8_t *rom, std::size_t size, std::size_t bank_count, std::uint8_t *flags, const std::atomic_bool *cancel) noexcept :
+        rom(rom), size(size), bank_count(bank_count), flags(flags), cancel(cancel) {}
+
+    std::vector<Xref> xrefs;
+    std::vector<OutgoingItem> outgoing;
+
+    void walk(std::size_t bank, std::vector<WorkItem> &work) {
+        while(!work.empty()) {
+            if(this->cancel && this->cancel->load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            auto item = work.back();
+            work.pop_back();
+            this->walk_from(bank, item, work);
+        }
+    }
+
+private:
+    const std::uint8_t *rom;
+    std::size_t size;
+    std::size_t bank_count;
+    std::uint8_t *flags;
+    const std::atomic_bool *cancel;
+    std::unordered_map<std::uint32_t, bool> dispatchers;
+
+    bool in_bank(std::size_t bank, std::uint32_t address) const noexcept {
+        return bank == 0 ? address < 0x4000 : (address >= 0x4000 && address < 0x8000);
+    }
+
+    // Find what bank a target will be in (-1 if it can't be known)
+    std::int32_t target_bank(std::size_t bank, std::uint16_t target, std::int32_t switched_bank) const noexcept {
+        std::int32_t result;
+        if(target < 0x4000) {
+            result = 0;
+        }
+        else if(target >= 0x8000) {
+            return -1;
+        }
+        else if(bank != 0) {
+            result = static_cast<std::int32_t>(bank);
+        }
+        else if(this->bank_count <= 2) {
+            result = 1;
+        }
+        else if(switched_bank >= 0) {
+            result = switched_bank == 0 ? 1 : switched_bank;
+        }
+        else {
+            return -1;
+        }
+
+        return static_cast<std::size_t>(result) < this->bank_count ? result : -1;
+    }
+
+    void add_target(std::size_t bank, std::uint16_t from, std::uint16_t target, XrefKind kind, std::int32_t switched_bank, std::vector<WorkItem> &work) {
+        auto destination = this->target_bank(bank, target, switched_bank);
+        if(destination < 0) {
+            return;
+        }
+
+        this->xrefs.emplace_back(Xref { static_cast<std::uint16_t>(destination), target, static_cast<std::uint16_t>(bank), from, kind });
+
+        // Code in ROM0 called from ROMX runs with that bank switched in
+        WorkItem item = { target, bank != 0 ? static_cast<std::int32_t>(bank) : switched_bank, kind == XrefCall };
+        if(static_cast<std::size_t>(destination) == bank) {
+            work.emplace_back(item);
+        }
+        else {
+            this->outgoing.emplace_back(OutgoingItem { static_cast<std::size_t>(destination), item });
+        }
+    }
+
+    // Check if a function pops its return address and jumps based on it, meaning it's followed by a table of pointers
+    // rather than code (e.g. rst $28 / dw Function1, Function2, ...)
+    bool is_dispatcher(std::size_t bank, std::uint16_t target) {
+        auto key = sort_key(static_cast<std::uint16_t>(bank), target);
+        auto cached = this->dispatchers.find(key);
+        if(cached != this->dispatchers.end()) {
+            return cached->second;
+        }
+
+        bool popped = false;
+        bool result = false;
+        std::uint32_t address = target;
+        for(int i = 0; i < JUMP_TABLE_SEARCH_LENGTH && this->in_bank(bank, address); i++) {
+            auto offset = rom_offset(bank, static_cast<std::uint16_t>(address));
+            if(offset >= this->size) {
+                break;
+            }
+
+            auto opcode = this->rom[offset];
+            if(opcode == 0xE1) { // pop hl
+                popped = true;
+            }
+            else if(opcode == 0xE9) { // jp hl
+                result = popped;
+                break;
+            }
+            else if(is_invalid_opcode(opcode) || opcode == 0x18 || opcode == 0xC3 || opcode == 0xC9 || opcode == 0xD9 || opcode == 0xCD || (opcode & 0xC7) == 0xC7) {
+                break;
+            }
+            address += SM83::instruction_length(opcode);
+        }
+
+        this->dispatchers.emplace(key, result);
+        return result;
+    }
+
+    void read_jump_table(std::size_t bank, std::uint16_t start, std::int32_t switched_bank, std::vector<WorkItem> &work) {
+        // Tables end when an entry stops looking like a pointer or we reach code that the table points to
+        std::uint32_t end = bank == 0 ? 0x4000 : 0x8000;
+        std::uint32_t address = start;
+        for(std::size_t i = 0; i < MAX_JUMP_TABLE_ENTRIES && address + 2 <= end; i++, address += 2) {
+            auto offset = rom_offset(bank, static_cast<std::uint16_t>(address));
+            if(offset + 2 > this->size || (this->flags[offset] | this->flags[offset + 1]) & (FlagCode | FlagOperand)) {
+                break;
+            }
+
+            auto entry = static_cast<std::uint16_t>(this->rom[offset] | this->rom[offset + 1] << 8);
+            auto destination = this->target_bank(bank, entry, switched_bank);
+            if(entry < 0x100 || destination < 0) {
+                break;
+            }
+
+            this->flags[offset] |= FlagData;
+            this->flags[offset + 1] |= FlagData;
+            this->add_target(bank, static_cast<std::uint16_t>(address), entry, XrefJumpTable, switched_bank, work);
+
+            if(static_cast<std::size_t>(destination) == bank && entry > address && entry < end) {
+                end = entry;
+            }
+        }
+    }
+
+    void walk_from(std::size_t bank, const WorkItem &item, std::vector<WorkItem> &work) {
+        std::uint32_t pc = item.address;
+        auto switched_bank = item.switched_bank;
+        std::int32_t last_a = -1;
+        std::int32_t last_hl = -1;
+
+        if(item.function && this->in_bank(bank, pc)) {
+            auto offset = rom_offset(bank, item.address);
+            if(offset < this->size && !(this->flags[offset] & (FlagOperand | FlagData))) {
+                this->flags[offset] |= FlagFunction;
+            }
+        }
+
+        while(this->in_bank(bank, pc)) {
+            auto offset = rom_offset(bank, static_cast<std::uint16_t>(pc));
+            if(offset >= this->size || this->flags[offset] & (FlagCode | FlagOperand | FlagData)) {
+                break;
+            }
+
+            auto opcode = this->rom[offset];
+            auto length = SM83::instruction_length(opcode);
+            if(is_invalid_opcode(opcode) || !this->in_bank(bank, pc + length - 1) || offset + length > this->size) {
+                break;
+            }
+
+            this->flags[offset] |= FlagCode;
+            for(std::size_t i = 1; i < length; i++) {
+                this->flags[offset + i] |= FlagOperand;
+            }
+
+            auto from = static_cast<std::uint16_t>(pc);
+            auto next = static_cast<std::uint16_t>(pc + length);
+            auto operand8 = length > 1 ? this->rom[offset + 1] : 0;
+            auto operand16 = static_cast<std::uint16_t>(length > 2 ? operand8 | this->rom[offset + 2] << 8 : 0);
+            auto relative = static_cast<std::uint16_t>(next + static_cast<std::int8_t>(operand8));
+            pc = next;
+
+            // Track ld a, n / ld [$2000-$3FFF], a and ld hl, $2000-$3FFF / ld [hl], n to know where calls into ROMX go
+            auto previous_a = last_a;
+            auto previous_hl = last_hl;
+            last_a = -1;
+            last_hl = -1;
+
+            switch(opcode) {
+                case 0x3E: // ld a, n
+                    last_a = operand8;
+                    break;
+                case 0x21: // ld hl, nn
+                    last_hl = operand16;
+                    break;
+                case 0x36: // ld [hl], n
+                    if(previous_hl >= 0x2000 && previous_hl < 0x4000) {
+                        switched_bank = operand8;
+                    }
+                    break;
+                case 0xEA: // ld [nn], a
+                    if(operand16 >= 0x2000 && operand16 < 0x4000 && previous_a >= 0) {
+                        switched_bank = previous_a;
+                    }
+                    this->add_data_reference(bank, from, operand16, XrefWrite);
+                    break;
+                case 0x08: // ld [nn], sp
+                    this->add_data_reference(bank, from, operand16, XrefWrite);
+                    break;
+                case 0xFA: // ld a, [nn]
+                    this->add_data_reference(bank, from, operand16, XrefRead);
+                    break;
+                case 0xE0: // ldh [n], a
+                    this->add_data_reference(bank, from, static_cast<std::uint16_t>(0xFF00 | operand8), XrefWrite);
+                    break;
+                case 0xF0: // ldh a, [n]
+                    this->add_data_reference(bank, from, static_cast<std::uint16_t>(0xFF00 | operand8), XrefRead);
+                    break;
+
+                case 0x18: // jr
+                    this->add_target(bank, from, relative, XrefBranch, switched_bank, work);
+                    return;
+                case 0x20: case 0x28: case 0x30: case 0x38: // jr cc
+                    this->add_target(bank, from, relative, XrefBranch, switched_bank, work);
+                    break;
+
+                case 0xC3: // jp
+                    this->add_target(bank, from, operand16, XrefJump, switched_bank, work);
+                    return;
+                case 0xC2: case 0xCA: case 0xD2: case 0xDA: // jp cc
+                    this->add_target(bank, from, operand16, XrefJump, switched_bank, work);
+                    break;
+
+                case 0xCD: case 0xC4: case 0xCC: case 0xD4: case 0xDC: // call
+                case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF: { // rst
+                    auto target = (opcode & 0xC7) == 0xC7 ? static_cast<std::uint16_t>(opcode & 0x38) : operand16;
+                    this->add_target(bank, from, target, XrefCall, switched_bank, work);
+
+                    auto destination = this->target_bank(bank, target, switched_bank);
+                    if(destination >= 0 && this->is_dispatcher(static_cast<std::size_t>(destination), target)) {
+                        this->read_jump_table(bank, next, switched_bank, work);
+                        return;
+                    }
+                    break;
+                }
+
+                case 0xC9: case 0xD9: case 0xE9: // ret, reti, jp hl
+                    return;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    void add_data_reference(std::size_t bank, std::uint16_t from, std::uint16_t address, XrefKind kind) {
+        // Reads from ROMX are in the current bank; everything else doesn't have one
+        std::uint16_t target_bank = address >= 0x4000 && address < 0x8000 && bank != 0 ? static_cast<std::uint16_t>(bank) : 0;
+        this->xrefs.emplace_back(Xref { target_bank, address, static_cast<std::uint16_t>(bank), from, kind });
+    }
+};
+
+std::shared_ptr<RomAnalysis> RomAnalysis::analyze(const std::uint8_t *rom, std::size_t size, const SymbolTable *symbols, const std::atomic_bool *cancel, std::size_t threads) {
+    auto analysis = std::make_shared<RomAnalysis>();
+    analysis->rom_hash = hash_rom(rom, size);
+    analysis->flags.assign(size, 0);
+
+    auto bank_count = std::max<std::size_t>((size + BANK_SIZE - 1) / BANK_SIZE, 1);
+    std::vector<std::vector<BankWalker::WorkItem>> pending(bank_count);
+
+    // Entry point and interrupt vectors
+    if(size >= 0x150) {
+        for(std::uint16_t address : { 0x100, 0x40, 0x48, 0x50, 0x58, 0x60 }) {
+            pending[0].emplace_back(BankWalker::WorkItem { address, -1, true });
+        }
+    }
+
+    if(threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    std::vector<BankWalker> walkers;
+    walkers.reserve(threads);
+    for(std::size_t i = 0; i < threads; i++) {
+        walkers.emplace_back(rom, size, bank_count, analysis->flags.data(), cancel);
+    }
+
+    std::vector<std::size_t> banks;
+    while(true) {
+        banks.clear();
+        for(std::size_t b = 0; b < bank_count; b++) {
+            if(!pending[b].empty()) {
+                banks.emplace_back(b);
+            }
+        }
+        if(banks.empty()) {
+            break;
+        }
+
+        // Each bank is taken by exactly one thread, so nothing writes to the same flags at once
+        std::atomic<std::size_t> next_bank = 0;
+        auto work = [&](BankWalker &walker) {
+            for(std::size_t i; (i = next_bank.fetch_add(1, std::memory_order_relaxed)) < banks.size();) {
+                walker.walk(banks[i], pending[banks[i]]);
+            }
+        };
+
+        std::vector<std::thread> workers;
+        auto worker_count = std::min(threads, banks.size());
+        for(std::size_t t = 1; t < worker_count; t++) {
+            workers.emplace_back(work, std::ref(walkers[t]));
+        }
+        work(walkers[0]);
+        for(auto &t : workers) {
+            t.join();
+        }
+
+        if(cancel && cancel->load(std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        for(auto &walker : walkers) {
+            for(auto &o : walker.outgoing) {
+                pending[o.bank].emplace_back(o.item);
+            }
+            walker.outgoing.clear();
+        }
+    }
+
+    // Gather references
+    for(auto &walker : walkers) {
+        analysis->xrefs.insert(analysis->xrefs.end(), walker.xrefs.begin(), walker.xrefs.end());
+    }
+    auto xref_less = [](const Xref &a, const Xref &b) {
+        auto a_key = sort_key(a.bank, a.address), b_key = sort_key(b.bank, b.address);
+        if(a_key != b_key) {
+            return a_key < b_key;
+        }
+        auto a_from = sort_key(a.from_bank, a.from_address), b_from = sort_key(b.from_bank, b.from_address);
+        return a_from != b_from ? a_from < b_from : a.kind < b.kind;
+    };
+    std::sort(analysis->xrefs.begin(), analysis->xrefs.end(), xref_less);
+    analysis->xrefs.erase(std::unique(analysis->xrefs.begin(), analysis->xrefs.end(), [](const Xref &a, const Xref &b) {
+        return a.bank == b.bank && a.address == b.address && a.from_bank == b.from_bank && a.from_address == b.from_address && a.kind == b.kind;
+    }), analysis->xrefs.end());
+
+    // Functions run until the code does or another function starts
+    for(std::size_t b = 0; b < bank_count; b++) {
+        auto base = b * BANK_SIZE;
+        auto end = std::min(base + BANK_SIZE, size);
+        std::uint16_t base_address = b == 0 ? 0x0000 : 0x4000;
+        for(std::size_t o = base; o < end; o++) {
+            if(!(analysis->flags[o] & FlagFunction)) {
+                continue;
+            }
+            auto f = o + 1;
+            while(f < end && (analysis->flags[f] & (FlagCode | FlagOperand)) && !(analysis->flags[f] & FlagFunction)) {
+                f++;
+            }
+            analysis->functions.emplace_back(Function {
+                static_cast<std::uint16_t>(b),
+                static_cast<std::uint16_t>(base_address + (o - base)),
+                static_cast<std::uint32_t>(base_address + (f - base))
+            });
+        }
+    }
+
+    analysis->generate_labels(symbols);
+    return analysis;
+}
+
+void RomAnalysis::generate_labels(const SymbolTable *symbols) {
+    this->labels.clear();
+
+    // Name anything that's called (or is a function) Call_, jumped to Jump_, and branched to jr_
+    enum Rank { RankBranch, RankJump, RankCall };
+    std::vector<std::pair<std::uint32_t, Rank>> targets;
+    for(auto &x : this->xrefs) {
+        if(x.address >= 0x8000) {
+            continue;
+        }
+        switch(x.kind) {
+            case XrefCall:
+                targets.emplace_back(sort_key(x.bank, x.address), RankCall);
+                break;
+            case XrefJump:
+            case XrefJumpTable:
+                targets.emplace_back(sort_key(x.bank, x.address), RankJump);
+                break;
+            case XrefBranch:
+                targets.emplace_back(sort_key(x.bank, x.address), RankBranch);
+                break;
+            default:
+                break;
+        }
+    }
+    for(auto &f : this->functions) {
+        targets.emplace_back(sort_key(f.bank, f.address), RankCall);
+    }
+    std::sort(targets.begin(), targets.end());
+
+    static constexpr const char *PREFIXES[] = { "jr", "Jump", "Call" };
+    for(std::size_t i = 0; i < targets.size();) {
+        auto key = targets[i].first;
+        auto rank = targets[i].second;
+        for(; i < targets.size() && targets[i].first == key; i++) {
+            rank = std::max(rank, targets[i].second);
+        }
+
+        auto bank = static_cast<std::uint16_t>(key >> 16);
+        auto address = static_cast<std::uint16_t>(key);
+        if(symbols) {
+            auto *existing = symbols->find(bank, address, false);
+            if(existing && existing->address == address) {
+                continue;
+            }
+        }
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "%s_%03x_%04x", PREFIXES[rank], bank, address);
+        this->labels.emplace_back(Label { bank, address, name });
+    }
+}
+
+std::uint64_t RomAnalysis::hash_rom(const std::uint8_t *rom, std::size_t size) noexcept {
+    // FNV-1a
+    std::uint64_t hash = 0xCBF29CE484222325;
+    for(std::size_t i = 0; i < size; i++) {
+        hash = (hash ^ rom[i]) * 0x100000001B3;
+    }
+    return hash;
+}
+
+std::uint8_t RomAnalysis::get_flags(std::uint16_t bank, std::uint16_t address) const noexcept {
+    if(address >= 0x8000) {
+        return 0;
+    }
+    auto offset = rom_offset(normalize_bank(bank, address), address);
+    return offset < this->flags.size() ? this->flags[offset] : 0;
+}
+
+const RomAnalysis::Function *RomAnalysis::find_function(std::uint16_t bank, std::uint16_t address) const noexcept {
+    if(address >= 0x8000) {
+        return nullptr;
+    }
+    bank = normalize_bank(bank, address);
+
+    auto key = sort_key(bank, address);
+    auto after = std::upper_bound(this->functions.begin(), this->functions.end(), key, [](std::uint32_t key, const Function &f) {
+        return key < sort_key(f.bank, f.address);
+    });
+    if(after == this->functions.begin()) {
+        return nullptr;
+    }
+
+    auto &function = *(after - 1);
+    return function.bank == bank && address < function.end ? &function : nullptr;
+}
+
+std::vector<RomAnalysis::Xref> RomAnalysis::get_references_to(std::uint16_t bank, std::uint16_t address) const {
+    auto key = sort_key(normalize_bank(bank, address), address);
+    auto first = std::lower_bound(this->xrefs.begin(), this->xrefs.end(), key, [](const Xref &x, std::uint32_t key) {
+        return sort_key(x.bank, x.address) < key;
+    });
+
+    std::vector<Xref> references;
+    for(auto i = first; i != this->xrefs.end() && sort_key(i->bank, i->address) == key; i++) {
+        references.emplace_back(*i);
+    }
+    return references;
+}
+
+bool RomAnalysis::save(const std::filesystem::path &path) const {
+    std::vector<std::uint8_t> compressed_flags;
+    zero_rle_compress(this->flags.data(), this->flags.size(), compressed_flags);
+
+    std::vector<std::uint8_t> data(HEADER_SIZE);
+    std::memcpy(data.data(), ANALYSIS_MAGIC, sizeof(ANALYSIS_MAGIC));
+    write_le(data.data() + 8, ANALYSIS_VERSION, 4);
+    write_le(data.data() + 12, 0, 4);
+    write_le(data.data() + 16, this->rom_hash, 8);
+    write_le(data.data() + 24, this->flags.size(), 8);
+    write_le(data.data() + 32, compressed_flags.size(), 8);
+    data.insert(data.end(), compressed_flags.begin(), compressed_flags.end());
+
+    auto offset = data.size();
+    data.resize(offset + 4 + this->functions.size() * FUNCTION_SIZE);
+    write_le(data.data() + offset, this->functions.size(), 4);
+    offset += 4;
+    for(auto &f : this->functions) {
+        write_le(data.data() + offset, f.bank, 2);
+        write_le(data.data() + offset + 2, f.address, 2);
+        write_le(data.data() + offset + 4, f.end, 4);
+        offset += FUNCTION_SIZE;
+    }
+
+    data.resize(offset + 4 + this->xrefs.size() * XREF_SIZE);
+    write_le(data.data() + offset, this->xrefs.size(), 4);
+    offset += 4;
+    for(auto &x : this->xrefs) {
+        write_le(data.data() + offset, x.bank, 2);
+        write_le(data.data() + offset + 2, x.address, 2);
+        write_le(data.data() + offset + 4, x.from_bank, 2);
+        write_le(data.data() + offset + 6, x.from_address, 2);
+        data[offset + 8] = x.kind;
+        offset += XREF_SIZE;
+    }
+
+    std::FILE *f = std::fopen(path.string().c_str(), "wb");
+    if(!f) {
+        return false;
+    }
+    bool success = std::fwrite(data.data(), 1, data.size(), f) == data.size();
+    success = std::fclose(f) == 0 && success;
+    if(!success) {
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+    }
+    return success;
+}
+
+std::shared_ptr<RomAnalysis> RomAnalysis::load(const std::filesystem::path &path, std::uint64_t hash, const SymbolTable *symbols) {
+    MappedFile file;
+    if(!file.open(path) || file.size() < HEADER_SIZE) {
+        return nullptr;
+    }
+
+    const auto *data = file.data();
+    auto size = file.size();
+    if(std::memcmp(data, ANALYSIS_MAGIC, sizeof(ANALYSIS_MAGIC)) != 0 || read_le(data + 8, 4) != ANALYSIS_VERSION || read_le(data + 16, 8) != hash) {
+        return nullptr;
+    }
+
+    auto rom_size = read_le(data + 24, 8);
+    auto compressed_size = read_le(data + 32, 8);
+    if(compressed_size > size - HEADER_SIZE || rom_size > 0x1000000) {
+        return nullptr;
+    }
+
+    auto analysis = std::make_shared<RomAnalysis>();
+    analysis->rom_hash = hash;
+    analysis->flags.resize(rom_size);
+    if(!zero_rle_decompress(data + HEADER_SIZE, compressed_size, analysis->flags.data(), rom_size)) {
+        return nullptr;
+    }
+
+    std::size_t offset = HEADER_SIZE + compressed_size;
+    if(size - offset < 4) {
+        return nullptr;
+    }
+    auto function_count = read_le(data + offset, 4);
+    offset += 4;
+    if((size - offset) / FUNCTION_SIZE < function_count) {
+        return nullptr;
+    }
+    analysis->functions.reserve(function_count);
+    for(std::size_t i = 0; i < function_count; i++, offset += FUNCTION_SIZE) {
+        analysis->functions.emplace_back(Function {
+            static_cast<std::uint16_t>(read_le(data + offset, 2)),
+            static_cast<std::uint16_t>(read_le(data + offset + 2, 2)),
+            static_cast<std::uint32_t>(read_le(data + offset + 4, 4))
+        });
+    }
+
+    if(size - offset < 4) {
+        return nullptr;
+    }
+    auto xref_count = read_le(data + offset, 4);
+    offset += 4;
+    if((size - offset) / XREF_SIZE < xref_count) {
+        return nullptr;
+    }
+    analysis->xrefs.reserve(xref_count);
+    for(std::size_t i = 0; i < xref_count; i++, offset += XREF_SIZE) {
+        if(data[offset + 8] > XrefWrite) {
+            return nullptr;
+        }
+        analysis->xrefs.emplace_back(Xref {
+            static_cast<std::uint16_t>(read_le(data + offset, 2)),
+            static_cast<std::uint16_t>(read_le(data + offset + 2, 2)),
+            static_cast<std::uint16_t>(read_le(data + offset + 4, 2)),
+            static_cast<std::uint16_t>(read_le(data + offset + 6, 2)),
+            static_cast<XrefKind>(data[offset + 8])
+        });
+    }
+
+    // Labels depend on what symbols were loaded this time
+    analysis->generate_labels(symbols);
+    return analysis;
+}
+
+bool RomAnalysis::save_labels(const std::filesystem::path &path) const {
+    std::FILE *f = std::fopen(path.string().c_str(), "w");
+    if(!f) {
+        return false;
+    }
+
+    std::fprintf(f, "; Generated by SuperDUX\n");
+    for(auto &l : this->labels) {
+        std::fprintf(f, "%02x:%04x %s\n", l.bank, l.address, l.name.c_str());
+    }
+
+    return std::fclose(f) == 0;
+}
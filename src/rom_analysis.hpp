@@ -0,0 +1,181 @@
+#ifndef ROM_ANALYSIS_HPP
+#define ROM_ANALYSIS_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <filesystem>
+
+class SymbolTable;
+
+// Static analysis of a whole ROM. Control flow is followed from the entry point and interrupt vectors (and anything
+// called, jumped to, or listed in a jump table from there) to find what's code, where functions are, and what refers to
+// what. Unnamed targets get generated labels in the same style as mgbdis (Call_000_1234, Jump_000_1234, jr_000_1234).
+//
+// Each bank is only ever walked by one thread at a time, so banks are analyzed in parallel in rounds: each round walks
+// everything found for each bank in the last round, and anything it finds in other banks is queued for the next one.
+// Calls into $4000-$7FFF from bank 0 only go anywhere if the bank was just switched (ld a, n / ld [$2000-$3FFF], a).
+class RomAnalysis {
+public:
+    static constexpr const std::size_t BANK_SIZE = 0x4000;
+
+    enum Flag : std::uint8_t {
+        /** First byte of an instruction */
+        FlagCode = 1,
+
+        /** Operand of an instruction */
+        FlagOperand = 2,
+
+        /** Part of a jump table */
+        FlagData = 4,
+
+        /** Start of a function */
+        FlagFunction = 8
+    };
+
+    enum XrefKind : std::uint8_t {
+        XrefCall,
+        XrefJump,
+        XrefBranch,
+        XrefJumpTable,
+        XrefRead,
+        XrefWrite
+    };
+
+    struct Function {
+        std::uint16_t bank;
+        std::uint16_t address;
+
+        /** Address after the last byte of code running on from the start (stopping at the next function) */
+        std::uint32_t end;
+    };
+
+    struct Xref {
+        /** Address referred to (bank is 0 for anything outside of ROM) */
+        std::uint16_t bank;
+        std::uint16_t address;
+
+        /** Instruction referring to it */
+        std::uint16_t from_bank;
+        std::uint16_t from_address;
+
+        XrefKind kind;
+    };
+
+    struct Label {
+        std::uint16_t bank;
+        std::uint16_t address;
+        std::string name;
+    };
+
+    /**
+     * Analyze a ROM
+     *
+     * @param  rom     ROM data
+     * @param  size    ROM size
+     * @param  symbols symbols that already exist (these won't get generated labels; optional)
+     * @param  cancel  set to stop early (optional)
+     * @param  threads number of threads to use (0 = one per core)
+     * @return         analysis, or nullptr if cancelled
+     */
+    static std::shared_ptr<RomAnalysis> analyze(const std::uint8_t *rom, std::size_t size, const SymbolTable *symbols, const std::atomic_bool *cancel = nullptr, std::size_t threads = 0);
+
+    /**
+     * Hash a ROM for caching
+     *
+     * @param  rom  ROM data
+     * @param  size ROM size
+     * @return      hash
+     */
+    static std::uint64_t hash_rom(const std::uint8_t *rom, std::size_t size) noexcept;
+
+    /**
+     * Load a cached analysis
+     *
+     * @param  path    path to the cache
+     * @param  hash    hash of the ROM it must be for
+     * @param  symbols symbols that already exist (used to generate labels)
+     * @return         analysis, or nullptr if it couldn't be loaded or is for a different ROM
+     */
+    static std::shared_ptr<RomAnalysis> load(const std::filesystem::path &path, std::uint64_t hash, const SymbolTable *symbols);
+
+    /**
+     * Save the analysis to be loaded later
+     *
+     * @param  path path to save to
+     * @return      true if successful
+     */
+    bool save(const std::filesystem::path &path) const;
+
+    /**
+     * Write the generated labels as an RGBDS-style .sym file
+     *
+     * @param  path path to save to
+     * @return      true if successful
+     */
+    bool save_labels(const std::filesystem::path &path) const;
+
+    /**
+     * Get the flags of a byte of ROM
+     *
+     * @param  bank    bank
+     * @param  address address ($0000-$7FFF)
+     * @return         flags, or 0 if outside of the ROM
+     */
+    std::uint8_t get_flags(std::uint16_t bank, std::uint16_t address) const noexcept;
+
+    /**
+     * Find the function an address is in
+     *
+     * @param  bank    bank
+     * @param  address address
+     * @return         function, or nullptr if it isn't in one
+     */
+    const Function *find_function(std::uint16_t bank, std::uint16_t address) const noexcept;
+
+    /**
+     * Get everything that refers to an address
+     *
+     * @param  bank    bank (0 for anything outside of ROM)
+     * @param  address address
+     * @return         references
+     */
+    std::vector<Xref> get_references_to(std::uint16_t bank, std::uint16_t address) const;
+
+    /**
+     * Get all functions, sorted by bank and address
+     *
+     * @return functions
+     */
+    const std::vector<Function> &get_functions() const noexcept { return this->functions; }
+
+    /**
+     * Get the generated labels, sorted by bank and address
+     *
+     * @return labels
+     */
+    const std::vector<Label> &get_labels() const noexcept { return this->labels; }
+
+    /**
+     * Get the hash of the ROM this is for
+     *
+     * @return hash
+     */
+    std::uint64_t get_rom_hash() const noexcept { return this->rom_hash; }
+
+private:
+    std::uint64_t rom_hash = 0;
+    std::vector<std::uint8_t> flags;  // one per byte of ROM
+    std::vector<Function> functions;  // sorted by bank and address
+    std::vector<Xref> xrefs;          // sorted by what they refer to
+    std::vector<Label> labels;
+
+    void generate_labels(const SymbolTable *symbols);
+
+    class BankWalker;
+};
+
+#endif
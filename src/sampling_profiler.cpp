@@ -0,0 +1,184 @@
+#include "sampling_profiler.hpp"
+#include "symbol_table.hpp"
+
+#include <cstdio>
+#include <algorithm>
+#include <map>
+#include <exception>
+
+SamplingProfiler::SamplingProfiler() {
+    this->clear();
+}
+
+void SamplingProfiler::sample(const std::uint32_t *stack, std::size_t depth) {
+    std::uint32_t node = 0;
+
+    for(std::size_t i = 0; i < depth; i++) {
+        std::uint64_t key = static_cast<std::uint64_t>(node) << 32 | stack[i];
+        auto child = this->children.find(key);
+        if(child != this->children.end()) {
+            node = child->second;
+        }
+        else {
+            auto index = static_cast<std::uint32_t>(this->profile.nodes.size());
+            this->profile.nodes.emplace_back(Node { node, stack[i], 0 });
+            this->children.emplace(key, index);
+            node = index;
+        }
+    }
+
+    this->profile.nodes[node].samples++;
+    this->profile.total_samples++;
+}
+
+void SamplingProfiler::clear() {
+    this->profile.nodes.clear();
+    this->profile.nodes.emplace_back(Node { 0, 0, 0 });
+    this->profile.total_samples = 0;
+    this->children.clear();
+}
+
+// Resolve each node to the function it's in
+static void resolve_functions(const SamplingProfiler::Profile &profile, const SymbolTable *symbols, std::vector<SamplingProfiler::FunctionStats> &functions, std::vector<std::size_t> &node_functions) {
+    std::unordered_map<std::uint32_t, std::size_t> location_functions;
+    std::unordered_map<std::string, std::size_t> name_functions;
+
+    node_functions.resize(profile.nodes.size());
+    for(std::size_t n = 1; n < profile.nodes.size(); n++) {
+        auto location = profile.nodes[n].location;
+        auto known = location_functions.find(location);
+        if(known != location_functions.end()) {
+            node_functions[n] = known->second;
+            continue;
+        }
+
+        std::uint16_t bank = location >> 16;
+        std::uint16_t address = location & 0xFFFF;
+        const SymbolTable::Symbol *symbol = symbols ? symbols->find(bank, address, true) : nullptr;
+
+        std::string name;
+        if(symbol) {
+            name = std::string(symbol->name);
+            bank = symbol->bank;
+            address = symbol->address;
+        }
+        else {
+            char unnamed[16];
+            std::snprintf(unnamed, sizeof(unnamed), "$%02x:%04x", bank, address);
+            name = unnamed;
+        }
+
+        auto [function, inserted] = name_functions.try_emplace(name, functions.size());
+        if(inserted) {
+            functions.emplace_back(SamplingProfiler::FunctionStats { std::move(name), bank, address, 0, 0 });
+        }
+        location_functions.emplace(location, function->second);
+        node_functions[n] = function->second;
+    }
+}
+
+std::vector<SamplingProfiler::FunctionStats> SamplingProfiler::get_function_stats(const Profile &profile, const SymbolTable *symbols) {
+    std::vector<FunctionStats> functions;
+    std::vector<std::size_t> node_functions;
+    resolve_functions(profile, symbols, functions, node_functions);
+
+    // Walk up from every stack that was sampled, counting each function once even if it's in there more than once
+    std::vector<std::size_t> seen;
+    for(std::size_t n = 1; n < profile.nodes.size(); n++) {
+        auto samples = profile.nodes[n].samples;
+        if(samples == 0) {
+            continue;
+        }
+
+        functions[node_functions[n]].self_samples += samples;
+
+        seen.clear();
+        for(std::size_t i = n; i != 0; i = profile.nodes[i].parent) {
+            auto function = node_functions[i];
+            if(std::find(seen.begin(), seen.end(), function) == seen.end()) {
+                seen.emplace_back(function);
+                functions[function].inclusive_samples += samples;
+            }
+        }
+    }
+
+    std::stable_sort(functions.begin(), functions.end(), [](const FunctionStats &a, const FunctionStats &b) {
+        return a.self_samples > b.self_samples;
+    });
+
+    return functions;
+}
+
+bool SamplingProfiler::write_report(const Profile &profile, const SymbolTable *symbols, ReportType type, const std::filesystem::path &path) {
+    std::FILE *f = std::fopen(path.string().c_str(), "w");
+    if(!f) {
+        return false;
+    }
+
+    switch(type) {
+        case ReportType::ReportFlat:
+        case ReportType::ReportInclusive: {
+            auto functions = get_function_stats(profile, symbols);
+            if(type == ReportType::ReportInclusive) {
+                std::stable_sort(functions.begin(), functions.end(), [](const FunctionStats &a, const FunctionStats &b) {
+                    return a.inclusive_samples > b.inclusive_samples;
+                });
+            }
+
+            double total = std::max(profile.total_samples, static_cast<std::uint64_t>(1));
+            std::fprintf(f, "%llu samples\n\n", static_cast<unsigned long long>(profile.total_samples));
+            std::fprintf(f, "  self%%     self  total%%    total  function\n");
+            for(auto &function : functions) {
+                std::fprintf(f, "%6.2f %8llu %6.2f %8llu  %s ($%02x:%04x)\n",
+                             function.self_samples * 100.0 / total,
+                             static_cast<unsigned long long>(function.self_samples),
+                             function.inclusive_samples * 100.0 / total,
+                             static_cast<unsigned long long>(function.inclusive_samples),
+                             function.name.c_str(),
+                             function.bank,
+                             function.address);
+            }
+            break;
+        }
+
+        case ReportType::ReportFolded: {
+            std::vector<FunctionStats> functions;
+            std::vector<std::size_t> node_functions;
+            resolve_functions(profile, symbols, functions, node_functions);
+
+            // Different call sites in the same function fold into one stack
+            std::map<std::string, std::uint64_t> stacks;
+            std::vector<std::size_t> path;
+            for(std::size_t n = 1; n < profile.nodes.size(); n++) {
+                auto samples = profile.nodes[n].samples;
+                if(samples == 0) {
+                    continue;
+                }
+
+                path.clear();
+                for(std::size_t i = n; i != 0; i = profile.nodes[i].parent) {
+                    path.emplace_back(node_functions[i]);
+                }
+
+                std::string stack;
+                for(auto i = path.rbegin(); i != path.rend(); i++) {
+                    if(!stack.empty()) {
+                        stack += ';';
+                    }
+                    stack += functions[*i].name;
+                }
+                stacks[stack] += samples;
+            }
+
+            for(auto &[stack, samples] : stacks) {
+                std::fprintf(f, "%s %llu\n", stack.c_str(), static_cast<unsigned long long>(samples));
+            }
+            break;
+        }
+
+        default:
+            std::terminate();
+    }
+
+    return std::fclose(f) == 0;
+}
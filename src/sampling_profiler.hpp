@@ -0,0 +1,122 @@
+#ifndef SAMPLING_PROFILER_HPP
+#define SAMPLING_PROFILER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+class SymbolTable;
+
+// Counts how many times each call stack was seen. Stacks are stored as a tree (each node is a location with a parent) so
+// taking a sample never allocates unless that stack has never been seen before.
+class SamplingProfiler {
+public:
+    /**
+     * Pack a bank and address into a location
+     *
+     * @param  bank    bank
+     * @param  address address
+     * @return         location
+     */
+    static constexpr std::uint32_t make_location(std::uint16_t bank, std::uint16_t address) noexcept {
+        return static_cast<std::uint32_t>(bank) << 16 | address;
+    }
+
+    struct Node {
+        /** Index of the parent node (the root node, which is always index 0, is its own parent) */
+        std::uint32_t parent;
+
+        /** Location of this frame (the call site for callers, or the PC for the innermost frame) */
+        std::uint32_t location;
+
+        /** Samples taken with exactly this stack */
+        std::uint64_t samples;
+    };
+
+    struct Profile {
+        /** Every stack seen. Parents always come before their children. */
+        std::vector<Node> nodes;
+
+        /** Total number of samples */
+        std::uint64_t total_samples = 0;
+    };
+
+    SamplingProfiler();
+
+    /**
+     * Record a sample
+     *
+     * @param stack locations from the outermost caller to the PC
+     * @param depth number of locations
+     */
+    void sample(const std::uint32_t *stack, std::size_t depth);
+
+    /**
+     * Throw out all samples
+     */
+    void clear();
+
+    /**
+     * Get everything sampled so far
+     *
+     * @return profile
+     */
+    const Profile &get_profile() const noexcept { return this->profile; }
+
+    struct FunctionStats {
+        /** Name of the function (or its address if there is no symbol for it) */
+        std::string name;
+
+        /** Bank and address of the function (or the first location seen in it if there is no symbol) */
+        std::uint16_t bank;
+        std::uint16_t address;
+
+        /** Samples taken while in this function */
+        std::uint64_t self_samples;
+
+        /** Samples taken while in this function or anything it called */
+        std::uint64_t inclusive_samples;
+    };
+
+    /**
+     * Total up samples by function
+     *
+     * @param  profile profile to total up
+     * @param  symbols symbols to resolve functions with (can be null)
+     * @return         stats for every function seen, sorted by self samples (highest first)
+     */
+    static std::vector<FunctionStats> get_function_stats(const Profile &profile, const SymbolTable *symbols);
+
+    enum ReportType {
+        /** Functions sorted by self samples */
+        ReportFlat,
+
+        /** Functions sorted by inclusive samples */
+        ReportInclusive,
+
+        /** One line per stack ("outer;inner count") for flame graph tools */
+        ReportFolded
+    };
+
+    /**
+     * Write a report to a file
+     *
+     * @param  profile profile to write
+     * @param  symbols symbols to resolve functions with (can be null)
+     * @param  type    type of report
+     * @param  path    path to write to
+     * @return         true if successful
+     */
+    static bool write_report(const Profile &profile, const SymbolTable *symbols, ReportType type, const std::filesystem::path &path);
+
+private:
+    Profile profile;
+
+    // (parent << 32 | location) -> node index
+    std::unordered_map<std::uint64_t, std::uint32_t> children;
+};
+
+#endif
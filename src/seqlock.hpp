@@ -0,0 +1,92 @@
+#ifndef SEQLOCK_HPP
+#define SEQLOCK_HPP
+
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Publishes a value from one writer to any number of readers without readers ever blocking the writer
+//
+// The writer makes the sequence odd, copies the value in, then makes it even again. Readers copy the value out and
+// retry if the sequence was odd or changed while they were copying, so they always get a complete copy of one write.
+// The value is stored as relaxed atomic words so racing with the writer is well-defined.
+//
+// Only one thread may write at a time (the caller has to make sure of that, e.g. by holding a mutex).
+template<typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock values must be trivially copyable");
+
+public:
+    Seqlock() noexcept {
+        this->store(T {});
+    }
+
+    /**
+     * Publish a new value
+     *
+     * @param value value to publish
+     */
+    void store(const T &value) noexcept {
+        Words words = {};
+        std::memcpy(words.data(), &value, sizeof(T));
+
+        auto sequence = this->sequence.load(std::memory_order_relaxed);
+        this->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        for(std::size_t i = 0; i < WORD_COUNT; i++) {
+            this->words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        this->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /**
+     * Get a copy of the most recently published value
+     *
+     * @return value
+     */
+    T load() const noexcept {
+        Words words;
+        while(true) {
+            auto before = this->sequence.load(std::memory_order_acquire);
+            if(before & 1) {
+                continue; // being written
+            }
+
+            for(std::size_t i = 0; i < WORD_COUNT; i++) {
+                words[i] = this->words[i].load(std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(this->sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+
+        T value;
+        std::memcpy(&value, words.data(), sizeof(T));
+        return value;
+    }
+
+    /**
+     * Get the number of values published so far. This can be compared against a previous result to see if anything new
+     * was published.
+     *
+     * @return number of values published
+     */
+    std::uint32_t get_publish_count() const noexcept {
+        return this->sequence.load(std::memory_order_acquire) / 2;
+    }
+
+private:
+    static constexpr const std::size_t WORD_COUNT = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    using Words = std::array<std::uint64_t, WORD_COUNT>;
+
+    std::atomic<std::uint32_t> sequence = 0;
+    std::array<std::atomic<std::uint64_t>, WORD_COUNT> words = {};
+};
+
+#endif
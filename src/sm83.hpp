@@ -0,0 +1,40 @@
+#ifndef SM83_HPP
+#define SM83_HPP
+
+#include <cstdint>
+
+namespace SM83 {
+    /**
+     * Get the length of the instruction with the given opcode, including its operands. CB-prefixed instructions are
+     * always two bytes long.
+     *
+     * @param  opcode first byte of the instruction
+     * @return        length in bytes (1-3)
+     */
+    constexpr std::uint8_t instruction_length(std::uint8_t opcode) noexcept {
+        switch(opcode) {
+            // d8/r8/a8 operands
+            case 0x06: case 0x0E: case 0x16: case 0x1E: case 0x26: case 0x2E: case 0x36: case 0x3E: // LD r, d8
+            case 0x18: case 0x20: case 0x28: case 0x30: case 0x38:                                  // JR
+            case 0xC6: case 0xCE: case 0xD6: case 0xDE: case 0xE6: case 0xEE: case 0xF6: case 0xFE: // ALU A, d8
+            case 0xE0: case 0xF0:                                                                   // LDH
+            case 0xE8: case 0xF8:                                                                   // ADD SP / LD HL, SP+r8
+            case 0xCB:                                                                              // prefix
+            case 0x10:                                                                              // STOP
+                return 2;
+
+            // d16/a16 operands
+            case 0x01: case 0x11: case 0x21: case 0x31:                                             // LD rr, d16
+            case 0x08:                                                                              // LD (a16), SP
+            case 0xC2: case 0xC3: case 0xCA: case 0xD2: case 0xDA:                                  // JP
+            case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:                                  // CALL
+            case 0xEA: case 0xFA:                                                                   // LD (a16), A / LD A, (a16)
+                return 3;
+
+            default:
+                return 1;
+        }
+    }
+}
+
+#endif
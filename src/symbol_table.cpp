@@ -0,0 +1,225 @@
+#include "symbol_table.hpp"
+
+#include "mapped_file.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+// Symbols only apply to the area of memory they're in (e.g. a WRAMX symbol in bank 1 has nothing to do with ROMX bank 1)
+static int memory_area(std::uint16_t address) noexcept {
+    if(address < 0x4000) {
+        return 0;
+    }
+    else if(address < 0x8000) {
+        return 1;
+    }
+    else if(address < 0xA000) {
+        return 2;
+    }
+    else if(address < 0xC000) {
+        return 3;
+    }
+    else if(address < 0xD000) {
+        return 4;
+    }
+    else if(address < 0xE000) {
+        return 5;
+    }
+    else if(address < 0xFF80) {
+        return 6;
+    }
+    else {
+        return 7;
+    }
+}
+
+static bool is_space(std::uint8_t c) noexcept {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+// Parse a hex number, advancing past it
+static bool parse_hex(const std::uint8_t *&i, const std::uint8_t *end, unsigned long &value) noexcept {
+    auto *start = i;
+    value = 0;
+    for(; i < end; i++) {
+        int digit;
+        if(*i >= '0' && *i <= '9') {
+            digit = *i - '0';
+        }
+        else if(*i >= 'a' && *i <= 'f') {
+            digit = *i - 'a' + 10;
+        }
+        else if(*i >= 'A' && *i <= 'F') {
+            digit = *i - 'A' + 10;
+        }
+        else {
+            break;
+        }
+        if(value > 0xFFFF) {
+            return false;
+        }
+        value = value << 4 | static_cast<unsigned long>(digit);
+    }
+    return i != start && value <= 0xFFFF;
+}
+
+void SymbolTable::clear() noexcept {
+    this->by_name.clear();
+    this->banks.clear();
+    this->names.clear();
+    this->symbol_count = 0;
+}
+
+// Names can't be pointed to until they're all in the buffer (it may move while growing), so hold offsets for now
+struct ParsedSymbol {
+    std::uint16_t bank;
+    std::uint16_t address;
+    std::uint32_t name_offset;
+    std::uint32_t name_length;
+};
+
+static bool parse_file(const std::filesystem::path &path, std::string &names, std::vector<ParsedSymbol> &parsed) {
+    MappedFile file;
+    if(!file.open(path)) {
+        // An empty file is still a valid (if useless) symbol file
+        return std::filesystem::exists(path);
+    }
+
+    const auto *data = file.data();
+    const auto *data_end = data + file.size();
+    for(const auto *line = data; line < data_end;) {
+        const auto *line_end = static_cast<const std::uint8_t *>(std::memchr(line, '\n', data_end - line));
+        if(!line_end) {
+            line_end = data_end;
+        }
+
+        // Comments
+        const auto *comment = static_cast<const std::uint8_t *>(std::memchr(line, ';', line_end - line));
+        const auto *end = comment ? comment : line_end;
+        const auto *i = line;
+        line = line_end + 1;
+
+        // BB:AAAA
+        unsigned long bank, address;
+        if(!parse_hex(i, end, bank) || i == end || *i != ':') {
+            continue;
+        }
+        i++;
+        if(!parse_hex(i, end, address) || i == end || !is_space(*i)) {
+            continue;
+        }
+
+        // Name
+        while(i < end && is_space(*i)) {
+            i++;
+        }
+        const auto *name_end = i;
+        while(name_end < end && !is_space(*name_end)) {
+            name_end++;
+        }
+        if(name_end == i) {
+            continue;
+        }
+
+        parsed.emplace_back(ParsedSymbol { static_cast<std::uint16_t>(bank), static_cast<std::uint16_t>(address), static_cast<std::uint32_t>(names.size()), static_cast<std::uint32_t>(name_end - i) });
+        names.append(reinterpret_cast<const char *>(i), name_end - i);
+    }
+
+    return true;
+}
+
+bool SymbolTable::load(const std::filesystem::path &path) {
+    return this->load(std::vector<std::filesystem::path> { path });
+}
+
+bool SymbolTable::load(const std::vector<std::filesystem::path> &paths) {
+    this->clear();
+
+    std::vector<ParsedSymbol> parsed;
+    bool success = true;
+    for(auto &path : paths) {
+        success = parse_file(path, this->names, parsed) && success;
+    }
+
+    // Put them in their banks
+    for(auto &p : parsed) {
+        if(p.bank >= this->banks.size()) {
+            this->banks.resize(p.bank + 1);
+        }
+
+        auto &symbol = this->banks[p.bank].emplace_back();
+        symbol.bank = p.bank;
+        symbol.address = p.address;
+        symbol.name = std::string_view(this->names.data() + p.name_offset, p.name_length);
+        symbol.local = symbol.name.find('.') != std::string_view::npos;
+    }
+    this->symbol_count = parsed.size();
+
+    // Sort them so we can search. If two symbols share an address, prefer functions over local labels.
+    for(auto &bank : this->banks) {
+        std::stable_sort(bank.begin(), bank.end(), [](const Symbol &a, const Symbol &b) {
+            if(a.address != b.address) {
+                return a.address < b.address;
+            }
+            return !a.local && b.local;
+        });
+    }
+
+    // Index the names (the first definition wins if a name is somehow defined twice)
+    this->by_name.reserve(this->symbol_count);
+    for(auto &bank : this->banks) {
+        for(auto &symbol : bank) {
+            this->by_name.try_emplace(symbol.name, &symbol);
+        }
+    }
+
+    return success;
+}
+
+const SymbolTable::Symbol *SymbolTable::find(std::uint16_t bank, std::uint16_t address, bool functions_only) const noexcept {
+    if(bank >= this->banks.size()) {
+        return nullptr;
+    }
+
+    // Find the first symbol after this address, then go back
+    auto &symbols = this->banks[bank];
+    auto after = std::upper_bound(symbols.begin(), symbols.end(), address, [](std::uint16_t address, const Symbol &symbol) {
+        return address < symbol.address;
+    });
+
+    auto area = memory_area(address);
+    for(auto i = after; i != symbols.begin();) {
+        auto &symbol = *--i;
+        if(memory_area(symbol.address) != area) {
+            break;
+        }
+        if(!functions_only || !symbol.local) {
+            return &symbol;
+        }
+    }
+
+    return nullptr;
+}
+
+const SymbolTable::Symbol *SymbolTable::lookup(std::string_view name) const noexcept {
+    auto symbol = this->by_name.find(name);
+    return symbol == this->by_name.end() ? nullptr : symbol->second;
+}
+
+std::string SymbolTable::describe(std::uint16_t bank, std::uint16_t address, bool functions_only) const {
+    char description[512];
+    auto *symbol = this->find(bank, address, functions_only);
+
+    if(symbol == nullptr) {
+        std::snprintf(description, sizeof(description), "$%02x:%04x", bank, address);
+    }
+    else if(functions_only || symbol->address == address) {
+        return std::string(symbol->name);
+    }
+    else {
+        std::snprintf(description, sizeof(description), "%.*s+$%x", static_cast<int>(symbol->name.size()), symbol->name.data(), address - symbol->address);
+    }
+
+    return description;
+}
@@ -0,0 +1,103 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+// Symbols from an RGBDS-style .sym file ("BB:AAAA Name" per line). Symbols are kept in a sorted array per bank so
+// addresses can be resolved to the nearest symbol at or before them with a binary search, and names are hashed so
+// labels can be looked up directly. All names share one buffer, so even huge .sym files take very few allocations.
+class SymbolTable {
+public:
+    SymbolTable() = default;
+
+    // Names point into this table, so it can't be copied
+    SymbolTable(const SymbolTable &) = delete;
+    SymbolTable &operator=(const SymbolTable &) = delete;
+
+    struct Symbol {
+        /** Bank of the symbol */
+        std::uint16_t bank;
+
+        /** Address of the symbol */
+        std::uint16_t address;
+
+        /** Local labels (Function.label) belong to the function before them */
+        bool local;
+
+        /** Name of the symbol (valid as long as the table is) */
+        std::string_view name;
+    };
+
+    /**
+     * Load symbols from a .sym file, replacing any already loaded
+     *
+     * @param  path path to the file
+     * @return      true if the file could be read
+     */
+    bool load(const std::filesystem::path &path);
+
+    /**
+     * Load symbols from several .sym files into one table, replacing any already loaded
+     *
+     * @param  paths paths to the files
+     * @return       true if every file could be read
+     */
+    bool load(const std::vector<std::filesystem::path> &paths);
+
+    /**
+     * Get whether any symbols are loaded
+     *
+     * @return true if there are no symbols
+     */
+    bool empty() const noexcept { return this->symbol_count == 0; }
+
+    /**
+     * Get the number of symbols loaded
+     *
+     * @return symbol count
+     */
+    std::size_t size() const noexcept { return this->symbol_count; }
+
+    /**
+     * Find the symbol at or before an address in the same bank and memory area
+     *
+     * @param  bank           bank of the address
+     * @param  address        address
+     * @param  functions_only skip local labels
+     * @return                symbol, or nullptr if there isn't one
+     */
+    const Symbol *find(std::uint16_t bank, std::uint16_t address, bool functions_only) const noexcept;
+
+    /**
+     * Look up a symbol by name
+     *
+     * @param  name name of the symbol (case sensitive)
+     * @return      symbol, or nullptr if there isn't one
+     */
+    const Symbol *lookup(std::string_view name) const noexcept;
+
+    /**
+     * Describe an address as "Symbol", "Symbol+$XX", or "$BB:AAAA" if there is no symbol for it
+     *
+     * @param  bank           bank of the address
+     * @param  address        address
+     * @param  functions_only only use functions (not local labels) and leave off the offset
+     * @return                description
+     */
+    std::string describe(std::uint16_t bank, std::uint16_t address, bool functions_only) const;
+
+private:
+    std::string names;                                          // every name, back to back
+    std::vector<std::vector<Symbol>> banks;                     // symbols by bank, sorted by address
+    std::unordered_map<std::string_view, const Symbol *> by_name;
+    std::size_t symbol_count = 0;
+
+    void clear() noexcept;
+};
+
+#endif
@@ -0,0 +1,168 @@
+#include "time_travel.hpp"
+#include "zero_rle.hpp"
+
+#include <algorithm>
+
+void TimeTravel::set_memory_limit(std::size_t bytes) {
+    this->memory_limit = bytes;
+    this->enforce_memory_limit();
+}
+
+void TimeTravel::clear() noexcept {
+    this->keyframes.clear();
+    this->inputs.clear();
+    this->memory_usage = 0;
+    this->full_keyframe_state.clear();
+    this->keyframes_since_full = 0;
+}
+
+void TimeTravel::add_keyframe(std::uint64_t position, std::uint64_t cycle_count, std::uint32_t frame_count, const std::vector<std::uint8_t> &state) {
+    auto &keyframe = this->keyframes.emplace_back();
+    keyframe.position = position;
+    keyframe.cycle_count = cycle_count;
+    keyframe.frame_count = frame_count;
+    keyframe.size = state.size();
+
+    // Store it in full every so often (or if the state size changed, which happens if the model changed)
+    keyframe.full = this->keyframes_since_full == 0 || this->full_keyframe_state.size() != state.size();
+    if(keyframe.full) {
+        this->full_keyframe_state = state;
+        this->keyframes_since_full = 0;
+        zero_rle_compress(state.data(), state.size(), keyframe.data);
+    }
+    else {
+        this->scratch.resize(state.size());
+        for(std::size_t i = 0; i < state.size(); i++) {
+            this->scratch[i] = state[i] ^ this->full_keyframe_state[i];
+        }
+        zero_rle_compress(this->scratch.data(), this->scratch.size(), keyframe.data);
+    }
+    keyframe.data.shrink_to_fit();
+    this->keyframes_since_full = (this->keyframes_since_full + 1) % KEYFRAMES_PER_FULL_KEYFRAME;
+
+    this->memory_usage += keyframe.data.size();
+    this->enforce_memory_limit();
+}
+
+void TimeTravel::enforce_memory_limit() {
+    // Drop the oldest full keyframe along with everything XORed against it, but never the last one we have
+    while(this->memory_usage > this->memory_limit && !this->keyframes.empty()) {
+        auto next_full = std::find_if(this->keyframes.begin() + 1, this->keyframes.end(), [](const Keyframe &k) { return k.full; });
+        if(next_full == this->keyframes.end()) {
+            break;
+        }
+
+        for(auto k = this->keyframes.begin(); k != next_full; k++) {
+            this->memory_usage -= k->data.size();
+        }
+        this->keyframes.erase(this->keyframes.begin(), next_full);
+    }
+
+    // Inputs before the oldest keyframe can't be replayed, but we still need to know what the input was at it
+    if(!this->keyframes.empty()) {
+        auto oldest = this->keyframes.front().position;
+        auto first_needed = std::upper_bound(this->inputs.begin(), this->inputs.end(), oldest, [](std::uint64_t position, const std::pair<std::uint64_t, std::uint8_t> &input) {
+            return position < input.first;
+        });
+        if(first_needed != this->inputs.begin()) {
+            this->inputs.erase(this->inputs.begin(), first_needed - 1);
+        }
+    }
+}
+
+std::optional<std::size_t> TimeTravel::find_keyframe(std::uint64_t position) const noexcept {
+    auto after = std::upper_bound(this->keyframes.begin(), this->keyframes.end(), position, [](std::uint64_t position, const Keyframe &keyframe) {
+        return position < keyframe.position;
+    });
+    if(after == this->keyframes.begin()) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(after - this->keyframes.begin()) - 1;
+}
+
+bool TimeTravel::get_keyframe(std::size_t index, std::vector<std::uint8_t> &state) const {
+    auto &keyframe = this->keyframes[index];
+    state.resize(keyframe.size);
+    if(!zero_rle_decompress(keyframe.data.data(), keyframe.data.size(), state.data(), state.size())) {
+        return false;
+    }
+
+    if(keyframe.full) {
+        return true;
+    }
+
+    // Find the full keyframe this was XORed against
+    std::size_t full = index;
+    while(!this->keyframes[full].full) {
+        if(full == 0) {
+            return false;
+        }
+        full--;
+    }
+
+    auto &full_keyframe = this->keyframes[full];
+    if(full_keyframe.size != keyframe.size) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> full_state(full_keyframe.size);
+    if(!zero_rle_decompress(full_keyframe.data.data(), full_keyframe.data.size(), full_state.data(), full_state.size())) {
+        return false;
+    }
+    for(std::size_t i = 0; i < state.size(); i++) {
+        state[i] ^= full_state[i];
+    }
+
+    return true;
+}
+
+void TimeTravel::truncate(std::uint64_t position) {
+    while(!this->keyframes.empty() && this->keyframes.back().position > position) {
+        this->memory_usage -= this->keyframes.back().data.size();
+        this->keyframes.pop_back();
+    }
+
+    auto after = std::upper_bound(this->inputs.begin(), this->inputs.end(), position, [](std::uint64_t position, const std::pair<std::uint64_t, std::uint8_t> &input) {
+        return position < input.first;
+    });
+    this->inputs.erase(after, this->inputs.end());
+
+    // Pick up where the last full keyframe left off so the next keyframe can be XORed against it
+    this->full_keyframe_state.clear();
+    this->keyframes_since_full = 0;
+    for(std::size_t i = this->keyframes.size(); i > 0; i--) {
+        if(this->keyframes[i - 1].full) {
+            if(this->get_keyframe(i - 1, this->full_keyframe_state)) {
+                this->keyframes_since_full = (this->keyframes.size() - (i - 1)) % KEYFRAMES_PER_FULL_KEYFRAME;
+            }
+            else {
+                this->full_keyframe_state.clear();
+            }
+            break;
+        }
+    }
+}
+
+void TimeTravel::record_input(std::uint64_t position, std::uint8_t input) {
+    if(!this->inputs.empty() && this->inputs.back().second == input) {
+        return;
+    }
+
+    // Only one input per position is kept (the last one set before the instruction ran)
+    if(!this->inputs.empty() && this->inputs.back().first == position) {
+        this->inputs.back().second = input;
+    }
+    else {
+        this->inputs.emplace_back(position, input);
+    }
+}
+
+std::uint8_t TimeTravel::get_input(std::uint64_t position) const noexcept {
+    auto after = std::upper_bound(this->inputs.begin(), this->inputs.end(), position, [](std::uint64_t position, const std::pair<std::uint64_t, std::uint8_t> &input) {
+        return position < input.first;
+    });
+    if(after == this->inputs.begin()) {
+        return 0;
+    }
+    return (after - 1)->second;
+}
@@ -0,0 +1,145 @@
+#ifndef TIME_TRAVEL_HPP
+#define TIME_TRAVEL_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+#include <optional>
+
+// History for reverse debugging. Keyframes are save states taken every so many instructions, kept in a ring that drops
+// the oldest ones once it goes over its memory limit. Any earlier point can then be reached by loading the nearest
+// keyframe before it and running forward again with the same inputs (which are logged alongside the keyframes).
+//
+// Most keyframes are XORed against the last full keyframe before they're compressed, since most of the state (VRAM,
+// most of WRAM, etc.) barely changes between them.
+class TimeTravel {
+public:
+    /** Every nth keyframe is stored in full and the rest are stored as differences from it */
+    static constexpr const std::size_t KEYFRAMES_PER_FULL_KEYFRAME = 16;
+
+    /**
+     * Set the memory limit. The oldest keyframes are dropped if this is exceeded.
+     *
+     * @param bytes limit in bytes
+     */
+    void set_memory_limit(std::size_t bytes);
+
+    /**
+     * Throw out all keyframes and inputs
+     */
+    void clear() noexcept;
+
+    /**
+     * Add a keyframe. This must be after any keyframe already added.
+     *
+     * @param position    instructions run when the state was saved
+     * @param cycle_count cycles run when the state was saved
+     * @param frame_count frames run when the state was saved
+     * @param state       save state
+     */
+    void add_keyframe(std::uint64_t position, std::uint64_t cycle_count, std::uint32_t frame_count, const std::vector<std::uint8_t> &state);
+
+    /**
+     * Find the last keyframe at or before a position
+     *
+     * @param  position position
+     * @return          index of the keyframe, if any
+     */
+    std::optional<std::size_t> find_keyframe(std::uint64_t position) const noexcept;
+
+    /**
+     * Get the position of a keyframe
+     *
+     * @param  index index of the keyframe
+     * @return       position
+     */
+    std::uint64_t get_keyframe_position(std::size_t index) const noexcept { return this->keyframes[index].position; }
+
+    /**
+     * Get the cycles run as of a keyframe (save states don't include our own counters, so they're kept here)
+     *
+     * @param  index index of the keyframe
+     * @return       cycle count
+     */
+    std::uint64_t get_keyframe_cycle_count(std::size_t index) const noexcept { return this->keyframes[index].cycle_count; }
+
+    /**
+     * Get the frames run as of a keyframe
+     *
+     * @param  index index of the keyframe
+     * @return       frame count
+     */
+    std::uint32_t get_keyframe_frame_count(std::size_t index) const noexcept { return this->keyframes[index].frame_count; }
+
+    /**
+     * Decompress a keyframe
+     *
+     * @param  index index of the keyframe
+     * @param  state save state output
+     * @return       true if successful
+     */
+    bool get_keyframe(std::size_t index, std::vector<std::uint8_t> &state) const;
+
+    /**
+     * Throw out everything after a position (e.g. because we went back to it and are now running something different)
+     *
+     * @param position position to keep everything at or before
+     */
+    void truncate(std::uint64_t position);
+
+    /**
+     * Log the input at a position if it changed
+     *
+     * @param position position
+     * @param input    input
+     */
+    void record_input(std::uint64_t position, std::uint8_t input);
+
+    /**
+     * Get what the input was at a position
+     *
+     * @param  position position
+     * @return          input (0 if nothing was logged before it)
+     */
+    std::uint8_t get_input(std::uint64_t position) const noexcept;
+
+    /**
+     * Get the number of keyframes
+     *
+     * @return keyframe count
+     */
+    std::size_t get_keyframe_count() const noexcept { return this->keyframes.size(); }
+
+    /**
+     * Get the memory used by compressed keyframes
+     *
+     * @return bytes used
+     */
+    std::size_t get_memory_usage() const noexcept { return this->memory_usage; }
+
+private:
+    struct Keyframe {
+        std::uint64_t position;
+        std::uint64_t cycle_count;
+        std::uint32_t frame_count;
+        bool full;                         // otherwise, XORed against the last full keyframe before it
+        std::size_t size;                  // size when decompressed
+        std::vector<std::uint8_t> data;    // compressed
+    };
+
+    std::deque<Keyframe> keyframes;
+    std::vector<std::pair<std::uint64_t, std::uint8_t>> inputs; // sorted by position
+    std::size_t memory_usage = 0;
+    std::size_t memory_limit = 64 * 1024 * 1024;
+
+    // Last full keyframe (uncompressed) so new keyframes can be XORed against it
+    std::vector<std::uint8_t> full_keyframe_state;
+    std::size_t keyframes_since_full = 0;
+
+    std::vector<std::uint8_t> scratch;
+
+    void enforce_memory_limit();
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "timeline.hpp"
+
+#include <algorithm>
+
+void Timeline::set_capacity(std::size_t frames, std::size_t events_per_frame) {
+    // Keep one extra frame for the one being recorded
+    this->frames = std::vector<Frame>(std::max<std::size_t>(frames, 1) + 1);
+    this->events_per_frame = events_per_frame;
+    for(auto &f : this->frames) {
+        f.events.reserve(events_per_frame);
+    }
+    this->clear();
+}
+
+void Timeline::begin_frame(std::uint32_t number, std::uint64_t now) {
+    // Anything recorded before the first frame started is only part of a frame, so it's thrown out
+    if(this->started) {
+        auto &previous = this->frames[this->current];
+        previous.cycles = static_cast<std::uint32_t>(now - this->frame_start);
+
+        this->current = (this->current + 1) % this->frames.size();
+        this->finished = std::min(this->finished + 1, this->frames.size() - 1);
+    }
+    this->started = true;
+    this->frame_start = now;
+
+    auto &frame = this->frames[this->current];
+    frame.number = number;
+    frame.cycles = 0;
+    frame.dropped = 0;
+    frame.events.clear();
+}
+
+std::vector<Timeline::Frame> Timeline::get_frames(std::size_t count) const {
+    count = std::min(count, this->finished);
+
+    std::vector<Frame> result;
+    result.reserve(count);
+    for(std::size_t i = count; i > 0; i--) {
+        auto index = (this->current + this->frames.size() - i) % this->frames.size();
+        result.emplace_back(this->frames[index]);
+    }
+    return result;
+}
+
+void Timeline::clear() noexcept {
+    for(auto &f : this->frames) {
+        f.number = 0;
+        f.cycles = 0;
+        f.dropped = 0;
+        f.events.clear();
+    }
+    this->current = 0;
+    this->finished = 0;
+    this->started = false;
+}
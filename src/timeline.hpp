@@ -0,0 +1,130 @@
+#ifndef TIMELINE_HPP
+#define TIMELINE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Records hardware events (interrupts, LCD modes, DMA, bank switches, etc.) with the cycle and scanline they happened
+// on. Events are kept per frame in a ring of the last few frames, and each frame holds a fixed number of events, so
+// memory use is bounded no matter what the game does. Once everything is allocated, recording never allocates.
+class Timeline {
+public:
+    enum EventType : std::uint8_t {
+        /** An interrupt was requested (value is the bit in IF) */
+        EventInterruptRequested,
+
+        /** An interrupt was serviced (value is the bit in IF) */
+        EventInterruptServiced,
+
+        /** The LCD changed modes (value is the mode) */
+        EventLCDMode,
+
+        /** OAM DMA was started (value is the source address) */
+        EventOAMDMA,
+
+        /** HDMA was started (value is the number of 16 byte blocks) */
+        EventHDMA,
+
+        /** GDMA was run (value is the number of 16 byte blocks) */
+        EventGDMA,
+
+        /** The ROM bank was switched (value is what was written) */
+        EventROMBank,
+
+        /** The cartridge RAM bank was switched (value is what was written) */
+        EventRAMBank,
+
+        /** The timer overflowed */
+        EventTimerOverflow,
+
+        /** A serial transfer was started (value is what was written to SC) */
+        EventSerialStart,
+
+        /** A serial transfer completed */
+        EventSerialComplete,
+
+        EventTypeCount
+    };
+
+    struct Event {
+        /** Cycles since the start of the frame */
+        std::uint32_t cycle;
+
+        /** Scanline (LY) */
+        std::uint8_t line;
+
+        EventType type;
+        std::uint16_t value;
+    };
+
+    struct Frame {
+        /** Frame number */
+        std::uint32_t number = 0;
+
+        /** Length of the frame in cycles */
+        std::uint32_t cycles = 0;
+
+        /** Events that didn't fit */
+        std::uint32_t dropped = 0;
+
+        /** Events in the order they happened */
+        std::vector<Event> events;
+    };
+
+    /**
+     * Set how much to keep. This clears everything recorded.
+     *
+     * @param frames           number of frames to keep
+     * @param events_per_frame number of events to keep per frame
+     */
+    void set_capacity(std::size_t frames, std::size_t events_per_frame);
+
+    /**
+     * Call at the start of every frame
+     *
+     * @param number frame number
+     * @param now    current cycle count
+     */
+    void begin_frame(std::uint32_t number, std::uint64_t now);
+
+    /**
+     * Record an event in the current frame
+     *
+     * @param now   current cycle count
+     * @param line  current scanline
+     * @param type  type of event
+     * @param value value of the event (see EventType)
+     */
+    void record(std::uint64_t now, std::uint8_t line, EventType type, std::uint16_t value) noexcept {
+        auto &frame = this->frames[this->current];
+        if(frame.events.size() == this->events_per_frame) {
+            frame.dropped++;
+            return;
+        }
+        frame.events.emplace_back(Event { static_cast<std::uint32_t>(now - this->frame_start), line, type, value });
+    }
+
+    /**
+     * Get the most recently finished frames
+     *
+     * @param  count maximum number of frames to get
+     * @return       frames, oldest first
+     */
+    std::vector<Frame> get_frames(std::size_t count) const;
+
+    /**
+     * Throw out everything recorded
+     */
+    void clear() noexcept;
+
+private:
+    std::vector<Frame> frames = std::vector<Frame>(1);
+    std::size_t events_per_frame = 0;
+    std::size_t current = 0;
+    std::size_t finished = 0; // number of frames finished (up to the size of the ring)
+    std::uint64_t frame_start = 0;
+    bool started = false;
+};
+
+#endif
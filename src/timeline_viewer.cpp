@@ -0,0 +1,343 @@
+#include "timeline_viewer.hpp"
+
+#include <QCheckBox>
+#include <QSpinBox>
+#include <QLabel>
+#include <QPainter>
+#include <QScrollArea>
+#include <QToolTip>
+#include <QMouseEvent>
+#include <QCursor>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QStatusBar>
+#include <QFontDatabase>
+
+#include <cstdio>
+#include <algorithm>
+
+#include "game_window.hpp"
+
+static constexpr const int LABEL_WIDTH = 72;
+static constexpr const int MODE_HEIGHT = 12;
+static constexpr const int LANE_HEIGHT = 10;
+static constexpr const int LANE_COUNT = 4;
+static constexpr const int FRAME_HEIGHT = MODE_HEIGHT + LANE_HEIGHT * LANE_COUNT;
+static constexpr const int FRAME_SPACING = 6;
+
+static const char *INTERRUPT_NAMES[] = { "VBlank", "STAT", "Timer", "Serial", "Joypad" };
+
+static QColor mode_color(int mode) {
+    switch(mode) {
+        case 0: return QColor(160, 160, 160); // HBlank
+        case 1: return QColor(96, 128, 224);  // VBlank
+        case 2: return QColor(96, 192, 96);   // OAM scan
+        default: return QColor(240, 160, 64); // drawing
+    }
+}
+
+static QColor interrupt_color(int bit) {
+    static const QColor COLORS[] = { QColor(32, 64, 224), QColor(32, 160, 32), QColor(224, 128, 0), QColor(160, 32, 160), QColor(96, 96, 96) };
+    return COLORS[bit % 5];
+}
+
+// Which lane (below the LCD mode band) an event is drawn in, or -1 for the mode band itself
+static int lane_for_event(Timeline::EventType type) {
+    switch(type) {
+        case Timeline::EventInterruptRequested:
+        case Timeline::EventInterruptServiced:
+            return 0;
+        case Timeline::EventOAMDMA:
+        case Timeline::EventHDMA:
+        case Timeline::EventGDMA:
+            return 1;
+        case Timeline::EventROMBank:
+        case Timeline::EventRAMBank:
+            return 2;
+        case Timeline::EventTimerOverflow:
+        case Timeline::EventSerialStart:
+        case Timeline::EventSerialComplete:
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+static QString describe_event(const Timeline::Event &event) {
+    char description[128];
+    switch(event.type) {
+        case Timeline::EventInterruptRequested:
+            std::snprintf(description, sizeof(description), "%s interrupt requested", INTERRUPT_NAMES[event.value % 5]);
+            break;
+        case Timeline::EventInterruptServiced:
+            std::snprintf(description, sizeof(description), "%s interrupt serviced", INTERRUPT_NAMES[event.value % 5]);
+            break;
+        case Timeline::EventLCDMode:
+            std::snprintf(description, sizeof(description), "LCD mode %u", event.value);
+            break;
+        case Timeline::EventOAMDMA:
+            std::snprintf(description, sizeof(description), "OAM DMA from $%04x", event.value);
+            break;
+        case Timeline::EventHDMA:
+            std::snprintf(description, sizeof(description), "HDMA of %u bytes", event.value * 16);
+            break;
+        case Timeline::EventGDMA:
+            std::snprintf(description, sizeof(description), "GDMA of %u bytes", event.value * 16);
+            break;
+        case Timeline::EventROMBank:
+            std::snprintf(description, sizeof(description), "ROM bank write ($%02x)", event.value);
+            break;
+        case Timeline::EventRAMBank:
+            std::snprintf(description, sizeof(description), "RAM bank write ($%02x)", event.value);
+            break;
+        case Timeline::EventTimerOverflow:
+            std::snprintf(description, sizeof(description), "Timer overflow");
+            break;
+        case Timeline::EventSerialStart:
+            std::snprintf(description, sizeof(description), "Serial transfer started (SC=$%02x)", event.value);
+            break;
+        case Timeline::EventSerialComplete:
+            std::snprintf(description, sizeof(description), "Serial transfer complete");
+            break;
+        default:
+            std::snprintf(description, sizeof(description), "Unknown event");
+            break;
+    }
+
+    char text[192];
+    std::snprintf(text, sizeof(text), "%6u (LY %3u): %s", event.cycle, event.line, description);
+    return text;
+}
+
+class TimelineView : public QWidget {
+public:
+    TimelineView(QWidget *parent, TimelineViewer *viewer) : QWidget(parent), viewer(viewer) {
+        this->setMouseTracking(true);
+        this->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    }
+
+    void update_size() {
+        auto count = static_cast<int>(this->viewer->frames.size());
+        this->setMinimumSize(LABEL_WIDTH + 640, std::max(count, 1) * (FRAME_HEIGHT + FRAME_SPACING));
+        this->update();
+    }
+
+protected:
+    void paintEvent(QPaintEvent *) override {
+        QPainter painter(this);
+        auto palette = this->palette();
+        painter.fillRect(this->rect(), palette.color(QPalette::Base));
+
+        auto width = this->width() - LABEL_WIDTH;
+        auto ascent = this->fontMetrics().ascent();
+        char label[32];
+
+        int y = 0;
+        for(auto &frame : this->viewer->frames) {
+            double scale = frame.cycles > 0 ? static_cast<double>(width) / frame.cycles : 0.0;
+            auto x_for = [&](std::uint32_t cycle) { return LABEL_WIDTH + static_cast<int>(cycle * scale); };
+
+            painter.setPen(palette.color(QPalette::Text));
+            std::snprintf(label, sizeof(label), "%u", frame.number);
+            painter.drawText(4, y + ascent, label);
+            if(frame.dropped > 0) {
+                std::snprintf(label, sizeof(label), "+%u", frame.dropped);
+                painter.setPen(Qt::red);
+                painter.drawText(4, y + ascent * 2, label);
+            }
+
+            // Frames start at vblank, so that's the mode until we see otherwise
+            int mode = 1;
+            int mode_start = LABEL_WIDTH;
+            for(auto &event : frame.events) {
+                auto x = x_for(event.cycle);
+                if(event.type == Timeline::EventLCDMode) {
+                    painter.fillRect(mode_start, y, x - mode_start, MODE_HEIGHT, mode_color(mode));
+                    mode = event.value;
+                    mode_start = x;
+                    continue;
+                }
+
+                auto lane = lane_for_event(event.type);
+                if(lane < 0) {
+                    continue;
+                }
+                auto lane_y = y + MODE_HEIGHT + lane * LANE_HEIGHT;
+
+                QColor color;
+                int height = LANE_HEIGHT - 1;
+                switch(event.type) {
+                    case Timeline::EventInterruptRequested:
+                        color = interrupt_color(event.value);
+                        height /= 2;
+                        break;
+                    case Timeline::EventInterruptServiced:
+                        color = interrupt_color(event.value);
+                        break;
+                    case Timeline::EventOAMDMA:
+                    case Timeline::EventHDMA:
+                    case Timeline::EventGDMA:
+                        // DMA while the PPU is drawing is usually a bug
+                        color = mode == 3 ? QColor(Qt::red) : QColor(128, 64, 192);
+                        break;
+                    case Timeline::EventROMBank:
+                        color = QColor(160, 128, 0);
+                        break;
+                    case Timeline::EventRAMBank:
+                        color = QColor(0, 128, 128);
+                        break;
+                    default:
+                        color = palette.color(QPalette::Text);
+                        break;
+                }
+                painter.fillRect(x, lane_y, 2, height, color);
+            }
+            painter.fillRect(mode_start, y, LABEL_WIDTH + width - mode_start, MODE_HEIGHT, mode_color(mode));
+
+            y += FRAME_HEIGHT + FRAME_SPACING;
+        }
+    }
+
+    void mouseMoveEvent(QMouseEvent *) override {
+        auto position = this->mapFromGlobal(QCursor::pos());
+        auto &frames = this->viewer->frames;
+        auto index = position.y() / (FRAME_HEIGHT + FRAME_SPACING);
+        if(position.x() < LABEL_WIDTH || index < 0 || index >= static_cast<int>(frames.size())) {
+            QToolTip::hideText();
+            return;
+        }
+
+        // Show everything within a few pixels of the cursor
+        auto &frame = frames[index];
+        auto width = this->width() - LABEL_WIDTH;
+        if(width <= 0 || frame.cycles == 0) {
+            return;
+        }
+        double cycles_per_pixel = static_cast<double>(frame.cycles) / width;
+        double cycle = (position.x() - LABEL_WIDTH) * cycles_per_pixel;
+        double range = cycles_per_pixel * 3;
+
+        QString text;
+        int shown = 0;
+        for(auto &event : frame.events) {
+            if(event.cycle + range < cycle || event.cycle > cycle + range) {
+                continue;
+            }
+            if(++shown > 16) {
+                text += "\n...";
+                break;
+            }
+            if(!text.isEmpty()) {
+                text += "\n";
+            }
+            text += describe_event(event);
+        }
+
+        if(text.isEmpty()) {
+            QToolTip::hideText();
+        }
+        else {
+            QToolTip::showText(QCursor::pos(), text, this);
+        }
+    }
+
+private:
+    TimelineViewer *viewer;
+};
+
+TimelineViewer::TimelineViewer(GameWindow *window) : QMainWindow(window), window(window) {
+    this->setWindowTitle("Timeline");
+
+    auto *central_widget = new QWidget(this);
+    auto *layout = new QVBoxLayout(central_widget);
+    central_widget->setLayout(layout);
+
+    // Record and number of frames
+    auto *top_widget = new QWidget(central_widget);
+    auto *top_layout = new QHBoxLayout(top_widget);
+    top_layout->setContentsMargins(0,0,0,0);
+    top_widget->setLayout(top_layout);
+
+    this->record_box = new QCheckBox("Record", top_widget);
+    this->record_box->setToolTip("Record interrupts, LCD modes, DMA, bank switches, timer overflows, and serial transfers. This slows down emulation.");
+    connect(this->record_box, &QCheckBox::clicked, this, &TimelineViewer::action_toggle_recording);
+    top_layout->addWidget(this->record_box);
+
+    top_layout->addWidget(new QLabel("Frames:", top_widget));
+    this->frame_count = new QSpinBox(top_widget);
+    this->frame_count->setRange(1, 60);
+    this->frame_count->setValue(8);
+    connect(this->frame_count, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &TimelineViewer::refresh_frames);
+    top_layout->addWidget(this->frame_count);
+    top_layout->addStretch(1);
+
+    layout->addWidget(top_widget);
+
+    // Frames
+    auto *scroll_area = new QScrollArea(central_widget);
+    this->view = new TimelineView(scroll_area, this);
+    scroll_area->setWidget(this->view);
+    scroll_area->setWidgetResizable(true);
+    scroll_area->setMinimumSize(LABEL_WIDTH + 680, 400);
+    layout->addWidget(scroll_area);
+
+    // Legend
+    auto swatch = [](const QColor &color, const char *name) {
+        return QString("<span style=\"color:%1\">&#9632;</span> %2&nbsp;&nbsp;").arg(color.name(), name);
+    };
+    QString legend = swatch(mode_color(0), "HBlank") + swatch(mode_color(1), "VBlank") + swatch(mode_color(2), "OAM scan") + swatch(mode_color(3), "Drawing") + "| ";
+    for(int i = 0; i < 5; i++) {
+        legend += swatch(interrupt_color(i), INTERRUPT_NAMES[i]);
+    }
+    legend += "<br/>Lanes: interrupts (short = requested, tall = serviced), DMA (red = during drawing), bank switches, timer/serial";
+    auto *legend_label = new QLabel(legend, central_widget);
+    legend_label->setTextFormat(Qt::RichText);
+    layout->addWidget(legend_label);
+
+    this->setCentralWidget(central_widget);
+
+    this->status_label = new QLabel(this);
+    this->statusBar()->addWidget(this->status_label);
+}
+
+TimelineViewer::~TimelineViewer() {}
+
+void TimelineViewer::showEvent(QShowEvent *) {
+    this->record_box->setChecked(this->window->get_instance().is_timeline_enabled());
+    this->refresh_frames();
+}
+
+void TimelineViewer::refresh_view() {
+    if(this->isHidden() || !this->record_box->isChecked()) {
+        return;
+    }
+
+    // Update at 10 Hz (nobody can follow it any faster)
+    auto now = std::chrono::steady_clock::now();
+    if(now - this->last_update < std::chrono::milliseconds(100)) {
+        return;
+    }
+
+    this->refresh_frames();
+}
+
+void TimelineViewer::action_toggle_recording() {
+    this->window->get_instance().set_timeline_enabled(this->record_box->isChecked());
+}
+
+void TimelineViewer::refresh_frames() {
+    this->last_update = std::chrono::steady_clock::now();
+    this->frames = this->window->get_instance().get_timeline(static_cast<std::size_t>(this->frame_count->value()));
+    this->view->update_size();
+
+    std::size_t events = 0;
+    std::size_t dropped = 0;
+    for(auto &f : this->frames) {
+        events += f.events.size();
+        dropped += f.dropped;
+    }
+
+    char status[128];
+    std::snprintf(status, sizeof(status), "%zu frames, %zu events, %zu dropped (too many in one frame)", this->frames.size(), events, dropped);
+    this->status_label->setText(status);
+}
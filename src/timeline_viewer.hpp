@@ -0,0 +1,44 @@
+#ifndef TIMELINE_VIEWER_HPP
+#define TIMELINE_VIEWER_HPP
+
+#include <QMainWindow>
+
+#include <chrono>
+#include <vector>
+
+#include "timeline.hpp"
+
+class GameWindow;
+class QCheckBox;
+class QSpinBox;
+class QLabel;
+class TimelineView;
+
+class TimelineViewer : public QMainWindow {
+    Q_OBJECT
+
+    friend TimelineView;
+
+public:
+    TimelineViewer(GameWindow *window);
+    ~TimelineViewer() override;
+
+    /** Refresh the information in view */
+    void refresh_view();
+
+private:
+    GameWindow *window;
+    QCheckBox *record_box;
+    QSpinBox *frame_count;
+    TimelineView *view;
+    QLabel *status_label;
+
+    std::vector<Timeline::Frame> frames;
+    std::chrono::steady_clock::time_point last_update = {};
+
+    void action_toggle_recording();
+    void refresh_frames();
+    void showEvent(QShowEvent *) override;
+};
+
+#endif
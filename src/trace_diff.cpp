@@ -0,0 +1,355 @@
+#include "trace_diff.hpp"
+#include "trace_file.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+
+// Reads a .sdxtrace
+class TraceFileSource : public TraceDiff::Source {
+public:
+    bool open(const std::filesystem::path &path) {
+        return this->reader.open(path);
+    }
+
+    bool next(TraceDiff::Entry &entry) override {
+        TraceRecord record;
+        if(this->index >= this->reader.size() || !this->reader.get(this->index, record)) {
+            return false;
+        }
+        this->index++;
+        entry = { record.pc, record.sp, record.af, record.bc, record.de, record.hl };
+        return true;
+    }
+
+private:
+    TraceReader reader;
+    std::uint64_t index = 0;
+};
+
+// Reads a CSV with a header naming at least the pc, sp, af, bc, de, and hl columns (other columns are ignored)
+class CSVSource : public TraceDiff::Source {
+public:
+    ~CSVSource() override {
+        if(this->file) {
+            std::fclose(this->file);
+        }
+    }
+
+    bool open(const std::filesystem::path &path) {
+        this->file = std::fopen(path.string().c_str(), "r");
+        if(!this->file) {
+            return false;
+        }
+
+        std::string header;
+        if(!this->read_line(header)) {
+            return false;
+        }
+
+        static const char *const COLUMN_NAMES[] = { "pc", "sp", "af", "bc", "de", "hl" };
+        std::vector<std::string> fields;
+        split(header, fields);
+        for(std::size_t c = 0; c < sizeof(COLUMN_NAMES) / sizeof(*COLUMN_NAMES); c++) {
+            auto column = std::find(fields.begin(), fields.end(), COLUMN_NAMES[c]);
+            if(column == fields.end()) {
+                return false;
+            }
+            this->columns[c] = static_cast<std::size_t>(column - fields.begin());
+        }
+
+        return true;
+    }
+
+    bool next(TraceDiff::Entry &entry) override {
+        std::string line;
+        while(this->read_line(line)) {
+            if(line.empty()) {
+                continue;
+            }
+
+            split(line, this->fields);
+            std::uint16_t values[6];
+            bool valid = true;
+            for(std::size_t c = 0; c < 6 && valid; c++) {
+                valid = this->columns[c] < this->fields.size() && parse_hex(this->fields[this->columns[c]], values[c]);
+            }
+            if(!valid) {
+                return false;
+            }
+
+            entry = { values[0], values[1], values[2], values[3], values[4], values[5] };
+            return true;
+        }
+        return false;
+    }
+
+private:
+    std::FILE *file = nullptr;
+    std::size_t columns[6] = {};
+    std::vector<std::string> fields;
+
+    bool read_line(std::string &line) {
+        line.clear();
+
+        char buffer[512];
+        while(std::fgets(buffer, sizeof(buffer), this->file)) {
+            line += buffer;
+            if(!line.empty() && line.back() == '\n') {
+                break;
+            }
+        }
+        if(line.empty()) {
+            return false;
+        }
+
+        while(!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        return true;
+    }
+
+    // Split on commas that aren't in quotes (instructions have commas in them)
+    static void split(const std::string &line, std::vector<std::string> &fields) {
+        fields.clear();
+        fields.emplace_back();
+
+        bool quoted = false;
+        for(auto c : line) {
+            if(c == '"') {
+                quoted = !quoted;
+            }
+            else if(c == ',' && !quoted) {
+                fields.emplace_back();
+            }
+            else {
+                fields.back() += c;
+            }
+        }
+    }
+
+    static bool parse_hex(const std::string &field, std::uint16_t &value) {
+        auto *start = field.c_str();
+        if(*start == '$') {
+            start++;
+        }
+
+        char *end;
+        auto v = std::strtoul(start, &end, 16);
+        if(end == start || *end != 0 || v > UINT16_MAX) {
+            return false;
+        }
+        value = static_cast<std::uint16_t>(v);
+        return true;
+    }
+};
+
+std::unique_ptr<TraceDiff::Source> TraceDiff::open(const std::filesystem::path &path) {
+    auto extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if(extension == ".csv") {
+        auto source = std::make_unique<CSVSource>();
+        return source->open(path) ? std::move(source) : nullptr;
+    }
+    else {
+        auto source = std::make_unique<TraceFileSource>();
+        return source->open(path) ? std::move(source) : nullptr;
+    }
+}
+
+static std::uint64_t hash_entry(const TraceDiff::Entry &entry) noexcept {
+    std::uint64_t h = static_cast<std::uint64_t>(entry.pc) | static_cast<std::uint64_t>(entry.sp) << 16 | static_cast<std::uint64_t>(entry.af) << 32 | static_cast<std::uint64_t>(entry.bc) << 48;
+    h ^= (static_cast<std::uint64_t>(entry.de) | static_cast<std::uint64_t>(entry.hl) << 16) * 0x9E3779B97F4A7C15ULL;
+
+    // splitmix64 finalizer so nearby values don't give nearby hashes
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+// Records read from a source but not consumed yet
+struct Lookahead {
+    Lookahead(TraceDiff::Source &source) : source(source) {}
+
+    TraceDiff::Source &source;
+    std::deque<TraceDiff::Entry> entries;
+    std::uint64_t first_index = 0; // index of entries.front() in the trace
+    bool finished = false;
+
+    // Read until there are at least count entries (unless the trace ends first)
+    bool fill(std::size_t count) {
+        TraceDiff::Entry entry;
+        while(this->entries.size() < count && !this->finished) {
+            if(this->source.next(entry)) {
+                this->entries.emplace_back(entry);
+            }
+            else {
+                this->finished = true;
+            }
+        }
+        return this->entries.size() >= count;
+    }
+
+    void consume(std::size_t count) {
+        this->entries.erase(this->entries.begin(), this->entries.begin() + static_cast<std::ptrdiff_t>(count));
+        this->first_index += count;
+    }
+
+    // Consume everything left, returning how many records that was
+    std::uint64_t consume_all() {
+        std::uint64_t count = this->entries.size();
+        this->entries.clear();
+
+        TraceDiff::Entry entry;
+        while(!this->finished) {
+            if(this->source.next(entry)) {
+                count++;
+            }
+            else {
+                this->finished = true;
+            }
+        }
+
+        this->first_index += count;
+        return count;
+    }
+};
+
+// Hash of every window of the given length, computed as a polynomial rolling hash
+static void window_hashes(const std::deque<TraceDiff::Entry> &entries, std::size_t window, std::vector<std::uint64_t> &hashes) {
+    static constexpr const std::uint64_t BASE = 0x100000001B3ULL;
+
+    hashes.clear();
+    if(entries.size() < window) {
+        return;
+    }
+
+    std::uint64_t base_power = 1; // BASE^(window - 1)
+    for(std::size_t i = 1; i < window; i++) {
+        base_power *= BASE;
+    }
+
+    std::uint64_t hash = 0;
+    for(std::size_t i = 0; i < window; i++) {
+        hash = hash * BASE + hash_entry(entries[i]);
+    }
+    hashes.emplace_back(hash);
+
+    for(std::size_t i = window; i < entries.size(); i++) {
+        hash = (hash - hash_entry(entries[i - window]) * base_power) * BASE + hash_entry(entries[i]);
+        hashes.emplace_back(hash);
+    }
+}
+
+static bool windows_match(const std::deque<TraceDiff::Entry> &a, std::size_t a_start, const std::deque<TraceDiff::Entry> &b, std::size_t b_start, std::size_t window) {
+    for(std::size_t i = 0; i < window; i++) {
+        if(a[a_start + i] != b[b_start + i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TraceDiff::Result TraceDiff::compare(Source &a_source, Source &b_source, std::size_t max_regions, std::size_t window, std::size_t lookahead) {
+    Result result;
+    Lookahead a { a_source }, b { b_source };
+
+    window = std::max<std::size_t>(window, 1);
+    lookahead = std::max(lookahead, window);
+
+    std::vector<std::uint64_t> a_hashes, b_hashes;
+    std::unordered_map<std::uint64_t, std::size_t> b_windows;
+
+    while(true) {
+        // Go in step while they match
+        while(a.fill(1) && b.fill(1) && a.entries.front() == b.entries.front()) {
+            a.consume(1);
+            b.consume(1);
+        }
+
+        bool a_empty = a.entries.empty(), b_empty = b.entries.empty();
+        if(a_empty && b_empty) {
+            break;
+        }
+
+        if(result.regions.size() >= max_regions) {
+            result.truncated = true;
+            break;
+        }
+
+        auto &region = result.regions.emplace_back();
+        region.a_start = a.first_index;
+        region.b_start = b.first_index;
+        region.a_first = a_empty ? Entry {} : a.entries.front();
+        region.b_first = b_empty ? Entry {} : b.entries.front();
+
+        // Find the closest point (fewest records skipped in total) where they line up again
+        std::size_t best_a = 0, best_b = 0;
+        bool found = false;
+
+        if(!a_empty && !b_empty) {
+            a.fill(lookahead);
+            b.fill(lookahead);
+            window_hashes(a.entries, window, a_hashes);
+            window_hashes(b.entries, window, b_hashes);
+
+            b_windows.clear();
+            for(std::size_t k = 0; k < b_hashes.size(); k++) {
+                b_windows.try_emplace(b_hashes[k], k);
+            }
+
+            std::size_t best = SIZE_MAX;
+            for(std::size_t j = 0; j < a_hashes.size() && j < best; j++) {
+                auto k = b_windows.find(a_hashes[j]);
+                if(k == b_windows.end() || j + k->second >= best || !windows_match(a.entries, j, b.entries, k->second, window)) {
+                    continue;
+                }
+                best = j + k->second;
+                best_a = j;
+                best_b = k->second;
+                found = true;
+            }
+
+            // Too close to the end for a whole window, but the traces may still end the same way
+            if(a.finished && b.finished) {
+                auto a_size = a.entries.size(), b_size = b.entries.size();
+                for(auto length = std::min({ window - 1, a_size, b_size }); length > 0; length--) {
+                    auto j = a_size - length, k = b_size - length;
+                    if(j + k < best && windows_match(a.entries, j, b.entries, k, length)) {
+                        best = j + k;
+                        best_a = j;
+                        best_b = k;
+                        found = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        region.resynced = found;
+        if(found) {
+            region.a_length = best_a;
+            region.b_length = best_b;
+            a.consume(best_a);
+            b.consume(best_b);
+        }
+        else {
+            region.a_length = a.consume_all();
+            region.b_length = b.consume_all();
+            break;
+        }
+    }
+
+    result.a_records = a.first_index;
+    result.b_records = b.first_index;
+    return result;
+}
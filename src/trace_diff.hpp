@@ -0,0 +1,95 @@
+#ifndef TRACE_DIFF_HPP
+#define TRACE_DIFF_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <memory>
+#include <filesystem>
+
+// Finds where two instruction traces stop doing the same thing
+//
+// Both traces are read in step until their records differ. From there, the next few thousand records of each are
+// hashed in sliding windows, and the closest point where a window of one trace shows up in the other is where they
+// line up again. Only that lookahead is ever held in memory, so traces of any length can be compared.
+class TraceDiff {
+public:
+    struct Entry {
+        std::uint16_t pc, sp, af, bc, de, hl;
+
+        bool operator==(const Entry &other) const noexcept {
+            return this->pc == other.pc && this->sp == other.sp && this->af == other.af && this->bc == other.bc && this->de == other.de && this->hl == other.hl;
+        }
+        bool operator!=(const Entry &other) const noexcept {
+            return !(*this == other);
+        }
+    };
+
+    // Reads a trace one record at a time
+    class Source {
+    public:
+        virtual ~Source() = default;
+
+        /**
+         * Read the next record
+         *
+         * @param  entry set to the record
+         * @return       true if there was a record, false at the end
+         */
+        virtual bool next(Entry &entry) = 0;
+    };
+
+    /**
+     * Open a trace file: a .sdxtrace, or a CSV exported from break-and-trace results or converted from a .sdxtrace
+     *
+     * @param  path path to the trace
+     * @return      source, or nullptr if it isn't a trace
+     */
+    static std::unique_ptr<Source> open(const std::filesystem::path &path);
+
+    // Records that don't line up between the traces
+    struct Region {
+        /** Index and number of records in the first trace */
+        std::uint64_t a_start, a_length;
+
+        /** Index and number of records in the second trace */
+        std::uint64_t b_start, b_length;
+
+        /** First record of each in the region (if it has any) */
+        Entry a_first, b_first;
+
+        /** False if the traces never lined up again (the region runs to the end of both) */
+        bool resynced;
+    };
+
+    struct Result {
+        /** Records read from each trace */
+        std::uint64_t a_records = 0, b_records = 0;
+
+        /** Everything that differs, in order */
+        std::vector<Region> regions;
+
+        /** True if it stopped early because there were too many regions */
+        bool truncated = false;
+    };
+
+    // Records that have to match for the traces to count as lined up again
+    static constexpr const std::size_t DEFAULT_WINDOW = 16;
+
+    // How many records past a divergence to look for where they line up again
+    static constexpr const std::size_t DEFAULT_LOOKAHEAD = 65536;
+
+    /**
+     * Compare two traces
+     *
+     * @param  a           first trace
+     * @param  b           second trace
+     * @param  max_regions stop after finding this many regions
+     * @param  window      records that have to match to line up again
+     * @param  lookahead   records to look ahead for where they line up again
+     * @return             result
+     */
+    static Result compare(Source &a, Source &b, std::size_t max_regions = 1000, std::size_t window = DEFAULT_WINDOW, std::size_t lookahead = DEFAULT_LOOKAHEAD);
+};
+
+#endif
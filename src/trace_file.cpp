@@ -0,0 +1,453 @@
+#include "trace_file.hpp"
+#include "zero_rle.hpp"
+
+#include <cstring>
+#include <algorithm>
+
+static constexpr const char TRACE_MAGIC[8] = { 'S', 'D', 'X', 'T', 'R', 'A', 'C', 'E' };
+static constexpr const char TRACE_INDEX_MAGIC[8] = { 'S', 'D', 'X', 'T', 'I', 'D', 'X', 0 };
+static constexpr const std::uint32_t TRACE_VERSION = 1;
+
+static constexpr const std::size_t HEADER_SIZE = 24;       // magic, version, record size, records per block, reserved
+static constexpr const std::size_t BLOCK_HEADER_SIZE = 8;  // compressed size, record count
+static constexpr const std::size_t INDEX_ENTRY_SIZE = 48;  // see TraceBlockInfo
+static constexpr const std::size_t FOOTER_SIZE = 32;       // index offset, block count, record count, magic
+static constexpr const std::size_t RECORD_SIZE = 27;       // see encode_record
+
+static void write_le(std::uint8_t *output, std::uint64_t value, std::size_t bytes) noexcept {
+    for(std::size_t i = 0; i < bytes; i++) {
+        output[i] = static_cast<std::uint8_t>(value >> (i * 8));
+    }
+}
+
+static std::uint64_t read_le(const std::uint8_t *input, std::size_t bytes) noexcept {
+    std::uint64_t value = 0;
+    for(std::size_t i = 0; i < bytes; i++) {
+        value |= static_cast<std::uint64_t>(input[i]) << (i * 8);
+    }
+    return value;
+}
+
+// Write the difference between a record and the one before it. Fields wrap, so this is always reversible.
+static void encode_record(const TraceRecord &record, const TraceRecord &previous, std::uint8_t *output) noexcept {
+    write_le(output + 0, record.cycle - previous.cycle, 8);
+    write_le(output + 8, record.frame - previous.frame, 4);
+    write_le(output + 12, static_cast<std::uint16_t>(record.bank - previous.bank), 2);
+    write_le(output + 14, static_cast<std::uint16_t>(record.pc - previous.pc), 2);
+    write_le(output + 16, static_cast<std::uint16_t>(record.sp - previous.sp), 2);
+    write_le(output + 18, static_cast<std::uint16_t>(record.af - previous.af), 2);
+    write_le(output + 20, static_cast<std::uint16_t>(record.bc - previous.bc), 2);
+    write_le(output + 22, static_cast<std::uint16_t>(record.de - previous.de), 2);
+    write_le(output + 24, static_cast<std::uint16_t>(record.hl - previous.hl), 2);
+    output[26] = static_cast<std::uint8_t>(record.opcode - previous.opcode);
+}
+
+static void decode_record(const std::uint8_t *input, const TraceRecord &previous, TraceRecord &record) noexcept {
+    record.cycle = previous.cycle + read_le(input + 0, 8);
+    record.frame = static_cast<std::uint32_t>(previous.frame + read_le(input + 8, 4));
+    record.bank = static_cast<std::uint16_t>(previous.bank + read_le(input + 12, 2));
+    record.pc = static_cast<std::uint16_t>(previous.pc + read_le(input + 14, 2));
+    record.sp = static_cast<std::uint16_t>(previous.sp + read_le(input + 16, 2));
+    record.af = static_cast<std::uint16_t>(previous.af + read_le(input + 18, 2));
+    record.bc = static_cast<std::uint16_t>(previous.bc + read_le(input + 20, 2));
+    record.de = static_cast<std::uint16_t>(previous.de + read_le(input + 22, 2));
+    record.hl = static_cast<std::uint16_t>(previous.hl + read_le(input + 24, 2));
+    record.opcode = static_cast<std::uint8_t>(previous.opcode + input[26]);
+}
+
+static TraceBlockInfo describe_block(const std::vector<TraceRecord> &records, std::uint64_t offset, std::uint32_t size) noexcept {
+    TraceBlockInfo info = {};
+    info.offset = offset;
+    info.size = size;
+    info.records = static_cast<std::uint32_t>(records.size());
+    info.first_cycle = records.front().cycle;
+    info.last_cycle = records.back().cycle;
+    info.first_frame = records.front().frame;
+    info.last_frame = records.back().frame;
+    for(auto &r : records) {
+        info.pc_pages |= static_cast<std::uint64_t>(1) << (r.pc >> 10);
+    }
+    return info;
+}
+
+TraceWriter::~TraceWriter() {
+    this->close();
+}
+
+bool TraceWriter::open(const std::filesystem::path &path) {
+    this->close();
+
+    this->file = std::fopen(path.string().c_str(), "wb");
+    if(!this->file) {
+        return false;
+    }
+
+    this->failed = false;
+    this->offset = 0;
+    this->record_count = 0;
+    this->block.clear();
+    this->block.reserve(TRACE_RECORDS_PER_BLOCK);
+    this->index.clear();
+
+    std::uint8_t header[HEADER_SIZE] = {};
+    std::memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    write_le(header + 8, TRACE_VERSION, 4);
+    write_le(header + 12, RECORD_SIZE, 4);
+    write_le(header + 16, TRACE_RECORDS_PER_BLOCK, 4);
+    return this->write(header, sizeof(header));
+}
+
+bool TraceWriter::write(const void *data, std::size_t size) {
+    if(this->failed || std::fwrite(data, 1, size, this->file) != size) {
+        this->failed = true;
+        return false;
+    }
+    this->offset += size;
+    return true;
+}
+
+bool TraceWriter::append(const TraceRecord &record) {
+    if(!this->file || this->failed) {
+        return false;
+    }
+
+    this->block.emplace_back(record);
+    this->record_count++;
+
+    if(this->block.size() == TRACE_RECORDS_PER_BLOCK) {
+        return this->flush_block();
+    }
+    return true;
+}
+
+bool TraceWriter::flush_block() {
+    if(this->block.empty()) {
+        return true;
+    }
+
+    // Each block starts from zero so it can be decoded on its own
+    std::uint8_t raw[RECORD_SIZE];
+    TraceRecord previous = {};
+    this->buffer.clear();
+    this->buffer.resize(BLOCK_HEADER_SIZE);
+    for(auto &r : this->block) {
+        encode_record(r, previous, raw);
+        zero_rle_compress(raw, sizeof(raw), this->buffer);
+        previous = r;
+    }
+
+    auto size = static_cast<std::uint32_t>(this->buffer.size() - BLOCK_HEADER_SIZE);
+    write_le(this->buffer.data(), size, 4);
+    write_le(this->buffer.data() + 4, this->block.size(), 4);
+
+    this->index.emplace_back(describe_block(this->block, this->offset, size));
+    this->block.clear();
+    return this->write(this->buffer.data(), this->buffer.size());
+}
+
+bool TraceWriter::close() {
+    if(!this->file) {
+        return false;
+    }
+
+    this->flush_block();
+
+    // Write the index, then the footer so the reader can find it
+    auto index_offset = this->offset;
+    std::uint8_t entry[INDEX_ENTRY_SIZE];
+    for(auto &b : this->index) {
+        write_le(entry + 0, b.offset, 8);
+        write_le(entry + 8, b.size, 4);
+        write_le(entry + 12, b.records, 4);
+        write_le(entry + 16, b.first_cycle, 8);
+        write_le(entry + 24, b.last_cycle, 8);
+        write_le(entry + 32, b.first_frame, 4);
+        write_le(entry + 36, b.last_frame, 4);
+        write_le(entry + 40, b.pc_pages, 8);
+        this->write(entry, sizeof(entry));
+    }
+
+    std::uint8_t footer[FOOTER_SIZE];
+    write_le(footer + 0, index_offset, 8);
+    write_le(footer + 8, this->index.size(), 8);
+    write_le(footer + 16, this->record_count, 8);
+    std::memcpy(footer + 24, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC));
+    this->write(footer, sizeof(footer));
+
+    bool success = !this->failed;
+    success = (std::fclose(this->file) == 0) && success;
+    this->file = nullptr;
+    this->index = {};
+    this->block = {};
+    this->buffer = {};
+    return success;
+}
+
+TraceReader::~TraceReader() {
+    this->close();
+}
+
+bool TraceReader::open(const std::filesystem::path &path) {
+    this->close();
+
+    if(!this->file.open(path)) {
+        return false;
+    }
+    this->data = this->file.data();
+    this->data_size = this->file.size();
+
+    // Check the header
+    if(this->data_size < HEADER_SIZE ||
+       std::memcmp(this->data, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+       read_le(this->data + 8, 4) != TRACE_VERSION ||
+       read_le(this->data + 12, 4) != RECORD_SIZE) {
+        this->close();
+        return false;
+    }
+
+    if(!this->read_index() && !this->recover_index()) {
+        this->close();
+        return false;
+    }
+
+    // Get where each block starts so records can be found by index
+    this->block_starts.clear();
+    this->block_starts.reserve(this->blocks.size());
+    this->record_count = 0;
+    for(auto &b : this->blocks) {
+        this->block_starts.emplace_back(this->record_count);
+        this->record_count += b.records;
+    }
+
+    return true;
+}
+
+void TraceReader::close() noexcept {
+    this->file.close();
+    this->data = nullptr;
+    this->data_size = 0;
+    this->blocks = {};
+    this->block_starts = {};
+    this->record_count = 0;
+    this->cached_block = std::nullopt;
+    this->cached_records = {};
+}
+
+bool TraceReader::read_index() {
+    if(this->data_size < HEADER_SIZE + FOOTER_SIZE) {
+        return false;
+    }
+
+    const auto *footer = this->data + this->data_size - FOOTER_SIZE;
+    if(std::memcmp(footer + 24, TRACE_INDEX_MAGIC, sizeof(TRACE_INDEX_MAGIC)) != 0) {
+        return false;
+    }
+
+    auto index_offset = read_le(footer + 0, 8);
+    auto block_count = read_le(footer + 8, 8);
+    auto index_end = this->data_size - FOOTER_SIZE;
+    if(index_offset > index_end || (index_end - index_offset) / INDEX_ENTRY_SIZE != block_count) {
+        return false;
+    }
+
+    this->blocks.clear();
+    this->blocks.reserve(block_count);
+    for(std::uint64_t i = 0; i < block_count; i++) {
+        const auto *entry = this->data + index_offset + i * INDEX_ENTRY_SIZE;
+        auto &b = this->blocks.emplace_back();
+        b.offset = read_le(entry + 0, 8);
+        b.size = static_cast<std::uint32_t>(read_le(entry + 8, 4));
+        b.records = static_cast<std::uint32_t>(read_le(entry + 12, 4));
+        b.first_cycle = read_le(entry + 16, 8);
+        b.last_cycle = read_le(entry + 24, 8);
+        b.first_frame = static_cast<std::uint32_t>(read_le(entry + 32, 4));
+        b.last_frame = static_cast<std::uint32_t>(read_le(entry + 36, 4));
+        b.pc_pages = read_le(entry + 40, 8);
+
+        if(b.offset < HEADER_SIZE || b.offset + BLOCK_HEADER_SIZE + b.size > index_offset || b.records == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool TraceReader::recover_index() {
+    this->blocks.clear();
+
+    // Walk the blocks until we run out of file (or hit one that was only partially written)
+    std::uint64_t offset = HEADER_SIZE;
+    while(offset + BLOCK_HEADER_SIZE <= this->data_size) {
+        auto size = static_cast<std::uint32_t>(read_le(this->data + offset, 4));
+        auto records = static_cast<std::uint32_t>(read_le(this->data + offset + 4, 4));
+        if(records == 0 || records > TRACE_RECORDS_PER_BLOCK || offset + BLOCK_HEADER_SIZE + size > this->data_size) {
+            break;
+        }
+
+        auto &b = this->blocks.emplace_back();
+        b.offset = offset;
+        b.size = size;
+        b.records = records;
+
+        this->cached_block = std::nullopt;
+        auto *decoded = this->decode_block(this->blocks.size() - 1);
+        if(!decoded) {
+            this->blocks.pop_back();
+            break;
+        }
+        b = describe_block(*decoded, offset, size);
+
+        offset += BLOCK_HEADER_SIZE + size;
+    }
+
+    this->cached_block = std::nullopt;
+    return !this->blocks.empty();
+}
+
+const std::vector<TraceRecord> *TraceReader::decode_block(std::size_t block) {
+    if(this->cached_block == block) {
+        return &this->cached_records;
+    }
+
+    auto &b = this->blocks[block];
+    std::vector<std::uint8_t> raw(static_cast<std::size_t>(b.records) * RECORD_SIZE);
+    if(!zero_rle_decompress(this->data + b.offset + BLOCK_HEADER_SIZE, b.size, raw.data(), raw.size())) {
+        this->cached_block = std::nullopt;
+        return nullptr;
+    }
+
+    this->cached_records.resize(b.records);
+    TraceRecord previous = {};
+    for(std::size_t r = 0; r < b.records; r++) {
+        decode_record(raw.data() + r * RECORD_SIZE, previous, this->cached_records[r]);
+        previous = this->cached_records[r];
+    }
+
+    this->cached_block = block;
+    return &this->cached_records;
+}
+
+std::size_t TraceReader::block_for_record(std::uint64_t index) const noexcept {
+    auto block = std::upper_bound(this->block_starts.begin(), this->block_starts.end(), index);
+    return static_cast<std::size_t>(block - this->block_starts.begin()) - 1;
+}
+
+bool TraceReader::get(std::uint64_t index, TraceRecord &record) {
+    if(index >= this->record_count) {
+        return false;
+    }
+
+    auto block = this->block_for_record(index);
+    auto *records = this->decode_block(block);
+    if(!records) {
+        return false;
+    }
+
+    record = (*records)[index - this->block_starts[block]];
+    return true;
+}
+
+std::optional<std::uint64_t> TraceReader::find_cycle(std::uint64_t cycle) {
+    auto block = std::lower_bound(this->blocks.begin(), this->blocks.end(), cycle, [](const TraceBlockInfo &b, std::uint64_t cycle) {
+        return b.last_cycle < cycle;
+    });
+    if(block == this->blocks.end()) {
+        return std::nullopt;
+    }
+
+    // Decoding is needed to find the exact record, but the index is usually good enough to narrow it down
+    auto b = static_cast<std::size_t>(block - this->blocks.begin());
+    auto *records = this->decode_block(b);
+    if(!records) {
+        return std::nullopt;
+    }
+    auto record = std::lower_bound(records->begin(), records->end(), cycle, [](const TraceRecord &r, std::uint64_t cycle) {
+        return r.cycle < cycle;
+    });
+    return this->block_starts[b] + static_cast<std::uint64_t>(record - records->begin());
+}
+
+std::optional<std::uint64_t> TraceReader::find_frame(std::uint32_t frame) {
+    auto block = std::lower_bound(this->blocks.begin(), this->blocks.end(), frame, [](const TraceBlockInfo &b, std::uint32_t frame) {
+        return b.last_frame < frame;
+    });
+    if(block == this->blocks.end()) {
+        return std::nullopt;
+    }
+
+    auto b = static_cast<std::size_t>(block - this->blocks.begin());
+    auto *records = this->decode_block(b);
+    if(!records) {
+        return std::nullopt;
+    }
+    auto record = std::lower_bound(records->begin(), records->end(), frame, [](const TraceRecord &r, std::uint32_t frame) {
+        return r.frame < frame;
+    });
+    return this->block_starts[b] + static_cast<std::uint64_t>(record - records->begin());
+}
+
+std::optional<std::uint64_t> TraceReader::find_pc(std::uint16_t pc, std::uint64_t start) {
+    if(start >= this->record_count) {
+        return std::nullopt;
+    }
+
+    auto page = static_cast<std::uint64_t>(1) << (pc >> 10);
+    for(auto b = this->block_for_record(start); b < this->blocks.size(); b++) {
+        if(!(this->blocks[b].pc_pages & page)) {
+            continue;
+        }
+
+        auto *records = this->decode_block(b);
+        if(!records) {
+            return std::nullopt;
+        }
+
+        auto first = this->block_starts[b];
+        for(std::size_t r = start > first ? static_cast<std::size_t>(start - first) : 0; r < records->size(); r++) {
+            if((*records)[r].pc == pc) {
+                return first + r;
+            }
+        }
+    }
+
+    return std::nullopt;
+}
+
+bool TraceReader::export_csv(const std::filesystem::path &path) {
+    std::FILE *f = std::fopen(path.string().c_str(), "w");
+    if(!f) {
+        return false;
+    }
+
+    std::fprintf(f, "cycle,frame,bank,pc,opcode,af,bc,de,hl,sp,carry,halfcarry,subtract,zero\n");
+
+    bool success = true;
+    for(std::size_t b = 0; b < this->blocks.size() && success; b++) {
+        auto *records = this->decode_block(b);
+        if(!records) {
+            success = false;
+            break;
+        }
+
+        for(auto &r : *records) {
+            std::fprintf(f, "%llu,%u,$%02x,$%04x,$%02x,$%04x,$%04x,$%04x,$%04x,$%04x,%i,%i,%i,%i\n",
+                            static_cast<unsigned long long>(r.cycle),
+                            r.frame,
+                            r.bank,
+                            r.pc,
+                            r.opcode,
+                            r.af,
+                            r.bc,
+                            r.de,
+                            r.hl,
+                            r.sp,
+                            (r.af & 0x10) != 0,
+                            (r.af & 0x20) != 0,
+                            (r.af & 0x40) != 0,
+                            (r.af & 0x80) != 0);
+        }
+    }
+
+    success = (std::fclose(f) == 0) && success;
+    return success;
+}
@@ -0,0 +1,218 @@
+#ifndef TRACE_FILE_HPP
+#define TRACE_FILE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <optional>
+#include <filesystem>
+
+#include "mapped_file.hpp"
+
+// Binary instruction traces (.sdxtrace)
+//
+// Records are fixed-width and grouped into blocks of TRACE_RECORDS_PER_BLOCK. Within a block, each record is stored as
+// the difference from the one before it, and runs of zero bytes are run-length encoded. Since most instructions only
+// change PC, the cycle count, and a register or two, most of every record compresses away. An index at the end of the
+// file lists each block's offset, cycle/frame range, and which parts of the address space PC was in, so a reader can
+// find a record without decoding anything but the block it's in.
+
+struct TraceRecord {
+    /** Emulated cycle count before the instruction ran */
+    std::uint64_t cycle;
+
+    /** Frame count before the instruction ran */
+    std::uint32_t frame;
+
+    /** Bank and address of the instruction */
+    std::uint16_t bank;
+    std::uint16_t pc;
+
+    /** Registers before the instruction ran */
+    std::uint16_t sp, af, bc, de, hl;
+
+    /** Opcode of the instruction */
+    std::uint8_t opcode;
+};
+
+struct TraceBlockInfo {
+    /** Offset of the block in the file */
+    std::uint64_t offset;
+
+    /** Size of the block's compressed data */
+    std::uint32_t size;
+
+    /** Records in the block */
+    std::uint32_t records;
+
+    /** Cycle range of the block (inclusive) */
+    std::uint64_t first_cycle, last_cycle;
+
+    /** Frame range of the block (inclusive) */
+    std::uint32_t first_frame, last_frame;
+
+    /** Bit n is set if PC was between n * 1 KiB and (n + 1) * 1 KiB at some point in the block */
+    std::uint64_t pc_pages;
+};
+
+static constexpr const std::size_t TRACE_RECORDS_PER_BLOCK = 4096;
+
+// Streams records to a trace file as they're appended. Only one block is ever held in memory.
+class TraceWriter {
+public:
+    TraceWriter() = default;
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter &) = delete;
+    TraceWriter &operator=(const TraceWriter &) = delete;
+
+    /**
+     * Start writing a trace, replacing the file if it exists
+     *
+     * @param  path path to write to
+     * @return      true if the file could be opened
+     */
+    bool open(const std::filesystem::path &path);
+
+    /**
+     * Append a record
+     *
+     * @param  record record to append
+     * @return        true if successful (false if not open or a write failed)
+     */
+    bool append(const TraceRecord &record);
+
+    /**
+     * Write out the last block and the index, then close the file
+     *
+     * @return true if everything was written successfully
+     */
+    bool close();
+
+    /**
+     * Get whether a trace is being written
+     *
+     * @return true if open
+     */
+    bool is_open() const noexcept { return this->file != nullptr; }
+
+    /**
+     * Get the number of records appended so far
+     *
+     * @return record count
+     */
+    std::uint64_t get_record_count() const noexcept { return this->record_count; }
+
+private:
+    std::FILE *file = nullptr;
+    bool failed = false;
+    std::uint64_t offset = 0;
+    std::uint64_t record_count = 0;
+    std::vector<TraceRecord> block;
+    std::vector<TraceBlockInfo> index;
+    std::vector<std::uint8_t> buffer;
+
+    bool write(const void *data, std::size_t size);
+    bool flush_block();
+};
+
+// Reads a trace file by memory mapping it, so opening a trace is instant regardless of how big it is. Traces whose index
+// was never written (e.g. the emulator crashed while tracing) are recovered by scanning the blocks instead.
+class TraceReader {
+public:
+    TraceReader() = default;
+    ~TraceReader();
+
+    TraceReader(const TraceReader &) = delete;
+    TraceReader &operator=(const TraceReader &) = delete;
+
+    /**
+     * Open a trace, closing any trace already open
+     *
+     * @param  path path to the trace
+     * @return      true if the file is a valid trace
+     */
+    bool open(const std::filesystem::path &path);
+
+    /**
+     * Close the trace
+     */
+    void close() noexcept;
+
+    /**
+     * Get the number of records in the trace
+     *
+     * @return record count
+     */
+    std::uint64_t size() const noexcept { return this->record_count; }
+
+    /**
+     * Get the block index
+     *
+     * @return blocks in order
+     */
+    const std::vector<TraceBlockInfo> &get_blocks() const noexcept { return this->blocks; }
+
+    /**
+     * Read a record
+     *
+     * @param  index  index of the record
+     * @param  record record to write to
+     * @return        true if successful
+     */
+    bool get(std::uint64_t index, TraceRecord &record);
+
+    /**
+     * Find the first record at or after a cycle
+     *
+     * @param  cycle cycle to find
+     * @return       index of the record, if any
+     */
+    std::optional<std::uint64_t> find_cycle(std::uint64_t cycle);
+
+    /**
+     * Find the first record in a frame (or the first one after it if nothing ran during it)
+     *
+     * @param  frame frame to find
+     * @return       index of the record, if any
+     */
+    std::optional<std::uint64_t> find_frame(std::uint32_t frame);
+
+    /**
+     * Find the next record at an address, skipping blocks that PC never came near
+     *
+     * @param  pc    address to find
+     * @param  start index to start searching at
+     * @return       index of the record, if any
+     */
+    std::optional<std::uint64_t> find_pc(std::uint16_t pc, std::uint64_t start);
+
+    /**
+     * Write the trace to a CSV file
+     *
+     * @param  path path to write to
+     * @return      true if successful
+     */
+    bool export_csv(const std::filesystem::path &path);
+
+private:
+    MappedFile file;
+    const std::uint8_t *data = nullptr;
+    std::size_t data_size = 0;
+
+    std::vector<TraceBlockInfo> blocks;
+    std::vector<std::uint64_t> block_starts; // index of the first record of each block
+    std::uint64_t record_count = 0;
+
+    // Last block decoded
+    std::optional<std::size_t> cached_block;
+    std::vector<TraceRecord> cached_records;
+
+    bool read_index();
+    bool recover_index();
+    const std::vector<TraceRecord> *decode_block(std::size_t block);
+    std::size_t block_for_record(std::uint64_t index) const noexcept;
+};
+
+#endif
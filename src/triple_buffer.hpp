@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+
+// Passes the latest copy of something from one writer thread to one reader thread without either of them ever waiting.
+// The writer fills in the back buffer and publishes it, and the reader picks up whatever was published last. Buffers
+// are reused, so once they've grown to size nothing is allocated.
+template<typename T> class TripleBuffer {
+public:
+    /**
+     * Get the buffer to write to. Only the writer may call this.
+     *
+     * @return back buffer
+     */
+    T &back() noexcept { return this->buffers[this->back_index]; }
+
+    /**
+     * Publish the back buffer, swapping in a new one to write to. Only the writer may call this.
+     */
+    void publish() noexcept {
+        auto previous = this->middle.exchange(this->back_index | FRESH, std::memory_order_acq_rel);
+        this->back_index = previous & INDEX_MASK;
+    }
+
+    /**
+     * Get the most recently published buffer. Only the reader may call this, and the reference is valid until the
+     * next call.
+     *
+     * @return front buffer
+     */
+    const T &front() noexcept {
+        if(this->middle.load(std::memory_order_relaxed) & FRESH) {
+            auto previous = this->middle.exchange(this->front_index, std::memory_order_acq_rel);
+            this->front_index = previous & INDEX_MASK;
+        }
+        return this->buffers[this->front_index];
+    }
+
+private:
+    static constexpr const unsigned INDEX_MASK = 3;
+    static constexpr const unsigned FRESH = 4;
+
+    T buffers[3] = {};
+    std::atomic<unsigned> middle = 1;
+    unsigned back_index = 0;
+    unsigned front_index = 2;
+};
+
+#endif
@@ -13,6 +13,11 @@
 #include <QFontDatabase>
 #include <QScrollBar>
 #include <QScrollArea>
+#include <QTableWidget>
+#include <QHeaderView>
+
+#include <algorithm>
+#include <cstring>
 
 #include "settings.hpp"
 #include "game_window.hpp"
@@ -520,6 +525,27 @@ VRAMViewer::VRAMViewer(GameWindow *window) : QMainWindow(window), window(window)
     this->gb_palette_view_frame->setLayout(gb_palette_view_frame_layout);
     this->gb_tab_view->addTab(this->gb_palette_view_frame, "Palettes");
 
+    // And the LCD registers for each line
+    this->gb_raster_view_frame = new QWidget(this->gb_tab_view);
+    auto *gb_raster_view_frame_layout = new QVBoxLayout(this->gb_raster_view_frame);
+    this->raster_table = new QTableWidget(static_cast<int>(GameInstance::GB_SCREEN_LINES), RASTER_COLUMN_COUNT, this->gb_raster_view_frame);
+    this->raster_table->setHorizontalHeaderLabels({"LCDC", "SCY", "SCX", "WY", "WX", "BGP", "OBP0", "OBP1", "BCPS", "OCPS"});
+    this->raster_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    this->raster_table->setFont(table_font);
+    this->raster_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    for(int row = 0; row < this->raster_table->rowCount(); row++) {
+        this->raster_table->setVerticalHeaderItem(row, new QTableWidgetItem(QString::number(row)));
+        for(int column = 0; column < RASTER_COLUMN_COUNT; column++) {
+            auto *item = new QTableWidgetItem();
+            item->setTextAlignment(Qt::AlignCenter);
+            this->raster_table->setItem(row, column, item);
+        }
+    }
+    gb_raster_view_frame_layout->addWidget(this->raster_table);
+    gb_raster_view_frame_layout->addWidget(new QLabel("Registers at the start of each line of the last frame. Changes from the line above are highlighted.", this->gb_raster_view_frame));
+    this->gb_raster_view_frame->setLayout(gb_raster_view_frame_layout);
+    this->gb_tab_view->addTab(this->gb_raster_view_frame, "Raster");
+
     this->setFixedWidth(this->sizeHint().width());
 }
 
@@ -529,12 +555,21 @@ VRAMViewer::~VRAMViewer() {
     settings.setValue(SETTING_SHOW_GRID, this->gb_show_tileset_grid->isChecked());
 }
 
+void VRAMViewer::showEvent(QShowEvent *) {
+    this->window->get_instance().set_scanline_capture_enabled(true);
+}
+
+void VRAMViewer::hideEvent(QHideEvent *) {
+    this->window->get_instance().set_scanline_capture_enabled(false);
+}
+
 void VRAMViewer::refresh_view() {
     if(this->isHidden()) {
         return;
     }
 
     this->cgb_colors = this->window->get_instance().is_game_boy_color();
+    this->video_hashes = this->window->get_instance().get_video_hashes();
     this->redraw_tileset_palette();
     this->was_cgb_colors = this->cgb_colors;
 }
@@ -544,6 +579,48 @@ void VRAMViewer::redraw_tileset_palette() noexcept {
     this->redraw_tileset();
     this->redraw_oam_data();
     this->redraw_palette();
+    this->redraw_raster();
+}
+
+void VRAMViewer::redraw_raster() noexcept {
+    if(this->gb_raster_view_frame->isHidden()) {
+        return;
+    }
+
+    auto capture = this->window->get_instance().get_scanline_capture();
+    if(this->raster_shown.has_value() && std::memcmp(capture.data(), this->raster_shown->data(), sizeof(capture)) == 0) {
+        return;
+    }
+    this->raster_shown = capture;
+
+    auto values = [](const GameInstance::ScanlineRegisters &r) -> std::array<std::uint8_t, RASTER_COLUMN_COUNT> {
+        return { r.lcdc, r.scy, r.scx, r.wy, r.wx, r.bgp, r.obp0, r.obp1, r.bgpi, r.obpi };
+    };
+
+    auto highlight = this->palette().color(QPalette::Highlight);
+    highlight.setAlpha(96);
+
+    const GameInstance::ScanlineRegisters *previous = nullptr;
+    for(std::size_t line = 0; line < capture.size(); line++) {
+        auto &registers = capture[line];
+        auto current = values(registers);
+        for(int column = 0; column < RASTER_COLUMN_COUNT; column++) {
+            auto *item = this->raster_table->item(static_cast<int>(line), column);
+            if(!registers.captured) {
+                item->setText("--");
+                item->setBackground(QBrush());
+                continue;
+            }
+
+            char text[4];
+            std::snprintf(text, sizeof(text), "$%02X", current[column]);
+            item->setText(text);
+
+            bool changed = previous != nullptr && values(*previous)[column] != current[column];
+            item->setBackground(changed ? QBrush(highlight) : QBrush());
+        }
+        previous = registers.captured ? &registers : nullptr;
+    }
 }
 
 void VRAMViewer::redraw_oam_data() noexcept {
@@ -551,6 +628,14 @@ void VRAMViewer::redraw_oam_data() noexcept {
         return;
     }
 
+    // Objects are drawn from OAM, tile data, palettes, and LCDC (for 8x16 objects)
+    auto key = this->video_hashes;
+    std::fill(std::begin(key.tilemaps), std::end(key.tilemaps), 0);
+    if(this->oam_shown == key) {
+        return;
+    }
+    this->oam_shown = key;
+
     auto oam = this->window->get_instance().get_object_attribute_info();
     bool double_resolution = oam.height == 16; // 8x16
 
@@ -560,15 +645,15 @@ void VRAMViewer::redraw_oam_data() noexcept {
         format_label(object.info, object_data, o);
 
         static_assert(sizeof(object.sprite_pixel_data) == sizeof(object_data.pixel_data));
-        if(double_resolution) {
-            std::memcpy(object.sprite_pixel_data, object_data.pixel_data, sizeof(object_data.pixel_data));
-        }
-        else {
-            std::memcpy(object.sprite_pixel_data, object_data.pixel_data, sizeof(object_data.pixel_data) / 2);
-            std::memset(reinterpret_cast<std::byte *>(object.sprite_pixel_data) + sizeof(object_data.pixel_data) / 2, 0, sizeof(object_data.pixel_data) / 2);
+        if(!double_resolution) {
+            std::memset(reinterpret_cast<std::byte *>(object_data.pixel_data) + sizeof(object_data.pixel_data) / 2, 0, sizeof(object_data.pixel_data) / 2);
         }
 
-        object.pixmap->setPixmap(QPixmap::fromImage(object.image));
+        // Only convert the objects whose pixels actually changed
+        if(std::memcmp(object.sprite_pixel_data, object_data.pixel_data, sizeof(object_data.pixel_data)) != 0) {
+            std::memcpy(object.sprite_pixel_data, object_data.pixel_data, sizeof(object_data.pixel_data));
+            object.pixmap->setPixmap(QPixmap::fromImage(object.image));
+        }
         object.frame->setEnabled(object_data.on_screen);
     }
 }
@@ -582,86 +667,113 @@ void VRAMViewer::redraw_tilemap() noexcept {
     auto tilemap_index = this->tilemap_map_type->currentIndex();
     auto tilemap_type = static_cast<GB_map_type_t>(this->tilemap_map_type->currentData().toInt());
 
-    auto lcdc = instance.read_memory(0xFF40);
+    // Grab LCDC through WX in one go
+    std::uint8_t lcd_registers[0xFF4C - 0xFF40];
+    instance.read_memory_range(std::nullopt, 0xFF40, sizeof(lcd_registers), lcd_registers);
+    auto lcdc = lcd_registers[0xFF40 - 0xFF40];
 
     // Showing screen
     if(tilemap_index == 1) {
         tilemap_type = (lcdc & 0b1000000) ? GB_map_type_t::GB_MAP_9C00 : GB_map_type_t::GB_MAP_9800; // LCDC
     }
 
-    instance.draw_tilemap(this->gb_tilemap_image_data, tilemap_type, static_cast<GB_tileset_type_t>(this->tilemap_tileset_type->currentData().toInt()));
+    auto tileset_type = static_cast<GB_tileset_type_t>(this->tilemap_tileset_type->currentData().toInt());
 
-    // Show the viewport?
+    // Games can change scrolling and the window mid-frame, so the viewport goes by what each line was actually drawn with
+    std::optional<GameInstance::ScanlineCapture> viewport;
     if(this->gb_tilemap_show_viewport_box->isChecked()) {
-        std::size_t top_y, bottom_y, left_x, right_x;
+        viewport = instance.get_scanline_capture();
+    }
 
-        if(tilemap_index == 1) {
-            auto wx = instance.read_memory(0xFF4B);
-            auto wy = instance.read_memory(0xFF4A);
-            top_y = GameInstance::GB_TILEMAP_HEIGHT - 1;
-            left_x = GameInstance::GB_TILEMAP_WIDTH - 1;
-
-            // Check if the window is visible
-            if((lcdc & 0b100000) && wx <= 166 && wy <= 143) {
-                right_x = 167 - wx;
-                bottom_y = 144 - wy;
-            }
-            else {
-                bottom_y = 0;
-                right_x = 0;
-            }
-        }
-        else {
-            auto scx = instance.read_memory(0xFF43); // SCX
-            auto scy = instance.read_memory(0xFF42); // SCY
+    // Skip it if nothing it's drawn from changed
+    TilemapKey key = {
+        { this->video_hashes.tiles[0], this->video_hashes.tiles[1] },
+        { this->video_hashes.tilemaps[0], this->video_hashes.tilemaps[1] },
+        this->video_hashes.palettes,
+        this->video_hashes.lcd_registers,
+        tilemap_index,
+        static_cast<int>(tilemap_type),
+        static_cast<int>(tileset_type),
+        viewport
+    };
+    if(this->tilemap_shown == key) {
+        return;
+    }
+    this->tilemap_shown = key;
 
-            top_y = (scy - 1) % GameInstance::GB_TILEMAP_HEIGHT;
-            bottom_y = (scy + 144) % GameInstance::GB_TILEMAP_HEIGHT;
+    instance.draw_tilemap(this->gb_tilemap_image_data, tilemap_type, tileset_type);
 
-            left_x = (scx - 1) % GameInstance::GB_TILEMAP_WIDTH;
-            right_x = (scx + 160) % GameInstance::GB_TILEMAP_WIDTH;
+    // Show the viewport?
+    if(viewport.has_value()) {
+        auto &capture = *viewport;
+        if(std::none_of(capture.begin(), capture.end(), [](const GameInstance::ScanlineRegisters &r) { return r.captured; })) {
+            for(auto &r : capture) {
+                r.captured = true;
+                r.lcdc = lcdc;
+                r.scy = lcd_registers[0xFF42 - 0xFF40];
+                r.scx = lcd_registers[0xFF43 - 0xFF40];
+                r.wy = lcd_registers[0xFF4A - 0xFF40];
+                r.wx = lcd_registers[0xFF4B - 0xFF40];
+            }
         }
 
-        auto *tilemap_data = this->gb_tilemap_image_data;
-
-        auto invert_color = [&tilemap_data, &left_x, &right_x, &top_y, &bottom_y](std::uint8_t x, std::uint8_t y) {
-            auto &color = tilemap_data[x + y * GameInstance::GB_TILEMAP_WIDTH];
+        // Mark the outline first, since neighboring lines' edges overlap and each pixel should only be inverted once
+        std::vector<bool> outline(GameInstance::GB_TILEMAP_WIDTH * GameInstance::GB_TILEMAP_HEIGHT);
+        auto mark = [&outline](int x, int y) {
+            auto wrapped_x = static_cast<std::size_t>(x) % GameInstance::GB_TILEMAP_WIDTH;
+            auto wrapped_y = static_cast<std::size_t>(y) % GameInstance::GB_TILEMAP_HEIGHT;
+            outline[wrapped_x + wrapped_y * GameInstance::GB_TILEMAP_WIDTH] = true;
+        };
 
-            if(x == GameInstance::GB_TILEMAP_WIDTH - 1 && x == left_x) {
-                return;
+        if(tilemap_index == 1) {
+            // The window has its own line counter which only advances on lines the window is shown on
+            int window_line = 0;
+            int right_x = 0;
+            for(std::size_t line = 0; line < capture.size(); line++) {
+                auto &r = capture[line];
+                if(!r.captured || !(r.lcdc & 0b100000) || r.wy > line || r.wx > 166) {
+                    continue;
+                }
+                right_x = 167 - r.wx;
+                mark(right_x, window_line);
+                window_line++;
             }
-
-            if(x == 0 && x == right_x) {
-                return;
+            if(window_line > 0) {
+                for(int x = 0; x <= right_x; x++) {
+                    mark(x, window_line);
+                }
             }
-
-            if(y == GameInstance::GB_TILEMAP_HEIGHT - 1 && y == top_y) {
-                return;
+        }
+        else {
+            const GameInstance::ScanlineRegisters *first = nullptr, *last = nullptr;
+            std::size_t first_line = 0, last_line = 0;
+            for(std::size_t line = 0; line < capture.size(); line++) {
+                auto &r = capture[line];
+                if(!r.captured) {
+                    continue;
+                }
+                mark(r.scx - 1, r.scy + static_cast<int>(line));
+                mark(r.scx + 160, r.scy + static_cast<int>(line));
+                if(first == nullptr) {
+                    first = &r;
+                    first_line = line;
+                }
+                last = &r;
+                last_line = line;
             }
-
-            if(y == 0 && y == bottom_y) {
-                return;
+            if(first != nullptr) {
+                for(int x = -1; x <= 160; x++) {
+                    mark(first->scx + x, first->scy + static_cast<int>(first_line) - 1);
+                    mark(last->scx + x, last->scy + static_cast<int>(last_line) + 1);
+                }
             }
-
-            color = grid_pixel(color);
-        };
-
-        // Draw the sides
-        for(std::uint8_t x = left_x; x != (right_x + 1) % GameInstance::GB_TILEMAP_HEIGHT; x++) {
-            invert_color(x, top_y);
-            invert_color(x, bottom_y);
         }
 
-        for(std::uint8_t y = top_y; y != (bottom_y + 1) % GameInstance::GB_TILEMAP_WIDTH; y++) {
-            invert_color(left_x, y);
-            invert_color(right_x, y);
+        for(std::size_t i = 0; i < outline.size(); i++) {
+            if(outline[i]) {
+                this->gb_tilemap_image_data[i] = grid_pixel(this->gb_tilemap_image_data[i]);
+            }
         }
-
-        // Invert the colors since they were double inverted by the above for() loops
-        invert_color(left_x, top_y);
-        invert_color(right_x, top_y);
-        invert_color(left_x, bottom_y);
-        invert_color(right_x, bottom_y);
     }
 
     // Draw it
@@ -671,14 +783,29 @@ void VRAMViewer::redraw_tilemap() noexcept {
 void VRAMViewer::redraw_tileset() noexcept {
     if(this->cgb_colors != this->was_cgb_colors && !this->cgb_colors) {
         std::memset(this->gb_tileset_image_data, 0, sizeof(this->gb_tileset_image_data)); // initialize this region so we don't see uninitialized/unused data such as if we switch between CGB and DMG
+        std::memset(this->gb_tileset_tile_keys, 0, sizeof(this->gb_tileset_tile_keys));
     }
 
     auto type = static_cast<GB_palette_type_t>(this->tileset_palette_type->currentData().toInt());
 
+    // Skip it if nothing it's drawn from changed (the tileset goes by the tilemaps and OAM to work out palettes, so
+    // that's everything)
+    TilesetKey key = {
+        this->video_hashes,
+        static_cast<int>(type),
+        this->tileset_palette_index->value(),
+        this->gb_show_tileset_grid->isChecked(),
+        this->moused_over_tile_index,
+        this->cgb_colors
+    };
+    if(this->tileset_shown == key) {
+        return;
+    }
+    this->tileset_shown = key;
+
     auto &instance = this->window->get_instance();
-    instance.draw_tileset(this->gb_tileset_image_data, static_cast<GB_palette_type_t>(this->tileset_palette_type->currentData().toInt()), this->tileset_palette_index->value());
+    instance.draw_tileset(this->gb_tileset_image_data, type, this->tileset_palette_index->value(), &this->tileset_info, this->gb_tileset_tile_keys);
     this->gb_tileset_pixmap->setPixmap(QPixmap::fromImage(this->gb_tileset_image));
-    this->tileset_info = instance.get_tileset_info();
 
     // update the grid
     if(this->gb_show_tileset_grid->isChecked()) {
@@ -871,6 +998,13 @@ void VRAMViewer::redraw_palette() noexcept {
         return;
     }
 
+    // Nor if nothing changed
+    PaletteKey key = { this->video_hashes.palettes, this->cgb_colors, this->moused_over_palette, this->moused_over_palette_index };
+    if(this->palette_shown == key) {
+        return;
+    }
+    this->palette_shown = key;
+
     std::uint16_t buffer[4];
 
     auto &instance = this->window->get_instance();
@@ -13,6 +13,7 @@ class QSpinBox;
 class QComboBox;
 class QLabel;
 class QFrame;
+class QTableWidget;
 
 #include "game_instance.hpp"
 
@@ -43,7 +44,11 @@ private:
     void update_palette(PaletteViewData &palette, GB_palette_type_t type, std::size_t index, const std::uint16_t *raw_colors = nullptr);
 
     QTabWidget *gb_tab_view;
-    QWidget *gb_tilemap_view_frame, *gb_oam_view_frame, *gb_palette_view_frame;
+
+    // Hashes of everything the views are drawn from, fetched once per refresh; each view only redraws if what it was
+    // last drawn with changed
+    GameInstance::VideoHashes video_hashes = {};
+    QWidget *gb_tilemap_view_frame, *gb_oam_view_frame, *gb_palette_view_frame, *gb_raster_view_frame;
 
     // Tileset
     std::uint32_t gb_tileset_image_data[GameInstance::GB_TILESET_WIDTH * GameInstance::GB_TILESET_HEIGHT] = {};
@@ -55,6 +60,17 @@ private:
     QGraphicsPixmapItem *gb_tileset_grid_pixelmap;
     QCheckBox *gb_show_tileset_grid;
     QImage gb_tileset_image;
+    std::uint64_t gb_tileset_tile_keys[GameInstance::GB_TILESET_BLOCK_WIDTH * GameInstance::GB_TILESET_BLOCK_HEIGHT] = {};
+    struct TilesetKey {
+        GameInstance::VideoHashes hashes;
+        int palette_type;
+        int palette_index;
+        bool show_grid;
+        std::optional<std::uint16_t> moused_over_tile_index;
+        bool cgb_colors;
+        bool operator==(const TilesetKey &) const = default;
+    };
+    std::optional<TilesetKey> tileset_shown;
     void redraw_tileset() noexcept;
 
     QLabel *tileset_palette_index_label;
@@ -86,6 +102,18 @@ private:
     QImage gb_tilemap_image;
     std::uint32_t gb_tilemap_image_data[GameInstance::GB_TILEMAP_WIDTH * GameInstance::GB_TILEMAP_HEIGHT] = {};
     QCheckBox *gb_tilemap_show_viewport_box;
+    struct TilemapKey {
+        std::uint64_t tiles[2];
+        std::uint64_t tilemaps[2];
+        std::uint64_t palettes;
+        std::uint64_t lcd_registers;
+        int map_index;
+        int map_type;
+        int tileset_type;
+        std::optional<GameInstance::ScanlineCapture> viewport;
+        bool operator==(const TilemapKey &) const = default;
+    };
+    std::optional<TilemapKey> tilemap_shown;
     void redraw_tilemap() noexcept;
     QComboBox *tilemap_map_type, *tilemap_tileset_type;
 
@@ -101,6 +129,7 @@ private:
         QGraphicsPixmapItem *pixmap;
     };
     OAMObjectViewData objects[sizeof(GameInstance::ObjectAttributeInfo::objects) / sizeof(GameInstance::ObjectAttributeInfo::objects[0])];
+    std::optional<GameInstance::VideoHashes> oam_shown;
     void redraw_oam_data() noexcept;
 
     // Palettes
@@ -111,8 +140,25 @@ private:
     std::optional<GB_palette_type_t> moused_over_palette;
     std::size_t moused_over_palette_index;
 
+    struct PaletteKey {
+        std::uint64_t palettes;
+        bool cgb_colors;
+        std::optional<GB_palette_type_t> moused_over_palette;
+        std::size_t moused_over_palette_index;
+        bool operator==(const PaletteKey &) const = default;
+    };
+    std::optional<PaletteKey> palette_shown;
     void redraw_palette() noexcept;
 
+    // Raster (LCD registers per line)
+    static constexpr const int RASTER_COLUMN_COUNT = 10;
+    QTableWidget *raster_table;
+    std::optional<GameInstance::ScanlineCapture> raster_shown;
+    void redraw_raster() noexcept;
+
+    void showEvent(QShowEvent *) override;
+    void hideEvent(QHideEvent *) override;
+
     bool cgb_colors = false;
     bool was_cgb_colors = true;
 };
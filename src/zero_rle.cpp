@@ -0,0 +1,44 @@
+#include "zero_rle.hpp"
+
+#include <cstring>
+
+void zero_rle_compress(const std::uint8_t *input, std::size_t size, std::vector<std::uint8_t> &output) {
+    for(std::size_t i = 0; i < size;) {
+        if(input[i] != 0) {
+            output.emplace_back(input[i++]);
+            continue;
+        }
+
+        std::size_t run = 1;
+        while(run < 256 && i + run < size && input[i + run] == 0) {
+            run++;
+        }
+        output.emplace_back(0);
+        output.emplace_back(static_cast<std::uint8_t>(run - 1));
+        i += run;
+    }
+}
+
+bool zero_rle_decompress(const std::uint8_t *input, std::size_t size, std::uint8_t *output, std::size_t output_size) noexcept {
+    std::size_t o = 0;
+    for(std::size_t i = 0; i < size; i++) {
+        if(input[i] != 0) {
+            if(o == output_size) {
+                return false;
+            }
+            output[o++] = input[i];
+            continue;
+        }
+
+        if(++i == size) {
+            return false;
+        }
+        std::size_t run = static_cast<std::size_t>(input[i]) + 1;
+        if(output_size - o < run) {
+            return false;
+        }
+        std::memset(output + o, 0, run);
+        o += run;
+    }
+    return o == output_size;
+}
@@ -0,0 +1,32 @@
+#ifndef ZERO_RLE_HPP
+#define ZERO_RLE_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Run-length encoding of zero bytes only. Runs of zeros are stored as a zero followed by the length of the run minus
+// one, and everything else is stored as-is. This is very cheap and works well on data that is mostly unchanged after
+// being delta encoded or XORed against something similar.
+
+/**
+ * Compress data, appending it to output
+ *
+ * @param input  data to compress
+ * @param size   size of the data
+ * @param output vector to append to
+ */
+void zero_rle_compress(const std::uint8_t *input, std::size_t size, std::vector<std::uint8_t> &output);
+
+/**
+ * Decompress data
+ *
+ * @param  input       compressed data
+ * @param  size        size of the compressed data
+ * @param  output      buffer to decompress into
+ * @param  output_size size the decompressed data must be
+ * @return             true if the data decompressed to exactly output_size bytes
+ */
+bool zero_rle_decompress(const std::uint8_t *input, std::size_t size, std::uint8_t *output, std::size_t output_size) noexcept;
+
+#endif